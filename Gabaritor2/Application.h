@@ -9,13 +9,40 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include <opencv2/opencv.hpp>
+#include "ConsoleBuffer.h"
 #include "ImageProcessing.h" // Assumindo que suas funções e classes estejam aqui
+#include "DigitClassifier.h"
+#include "TwoPassReading.h"
+#include "TemplateRegistry.h"
+#include "RegionGrid.h"
+#include "ResultStream.h"
+#include "ScanInput.h"
+#include "ResultsStore.h"
+#include "Sharding.h"
+#include "CpuBudget.h"
+#include "ImageWriter.h"
+#include "StageGraph.h"
+#include "ParameterTuner.h"
 #include <tinyfiledialogs/tinyfiledialogs.h>
 #include <thread>
 #include <fstream>
 #include <atomic>
 #include <vector>
 #include <string>
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <chrono>
+
+// Loop de eventos da interface: sem entrada nem novidades a thread da interface dorme
+const double SEGUNDOS_ESPERA_OCIOSA = 1.0;         // Rede de segurança quando nada acontece
+const double SEGUNDOS_ESPERA_PROCESSANDO = 0.25;   // Atualiza a taxa de páginas e a ETA
+const double SEGUNDOS_ENTRE_NOVIDADES = 0.05;      // Logs e resultados redesenham no máximo 20 vezes por segundo
+const int QUADROS_APOS_ENTRADA = 3;                // O ImGui precisa de alguns quadros para assentar hover e animações
+const int HISTORICO_QUADROS = 120;
+// Resultados ao vivo que guardam a miniatura (cerca de 576 KB cada, em RGBA): as páginas mais
+// recentes e a selecionada; as demais ficam só com a leitura, para a memória não crescer com o lote
+const int MINIATURAS_AO_VIVO = 64;
 
 
 class Application {
@@ -41,36 +68,105 @@ private:
     void renderReferenceImageWindow();
     void handleRectangleDrawing(const ImVec2& imagePos, const ImVec2& imageSize);
     void renderRectanglePropertiesWindow(bool* p_open);
+    void drawRectangles(ImDrawList* draw_list, const ImVec2& imageOrigin, const ImVec2& imageSize);
+    void renderLiveResultsWindow(bool* p_open);
+    void renderFrameStatsWindow(bool* p_open);
 
     // Funções auxiliares
-    GLuint loadImageAsTexture(const char* imagePath);
+    void requestRedraw();
+    void startReferenceImageLoad();
+    void finishReferenceImageLoad();
+    GLuint createTextureFromRGBA(const cv::Mat& image);
     void saveRectanglesToFile(const std::string& filename);
     void loadRectanglesFromFile(const std::string& filename);
+    void markRectanglesChanged();
+    void updateRectangleIndex();
     
     
 	// Variáveis de estado
     ConsoleBuffer consoleBuffer;
+    OcrEnginePool ocrEngines; // Engines do Tesseract ficam carregadas entre execuções
     GLFWwindow* window;
     std::thread processingThread;
     std::atomic<bool> isProcessing;
     std::atomic<bool> processFinished;
     bool showProcessPDFWindow;
     bool skipPdfConversion, skipPdfAlignment, skipNoiseReduction, skipContourExtraction, skipReadAnswers, skipReadWords, skipBinarize;
+    bool twoPassReading;
+    bool skipPageTriage;
+    bool saveContourImages;  // Depuração: imagem com todos os contornos de cada página em "Contornos"
+    bool saveComponentStats; // CSV de depuração com os componentes das bolhas (página e ROIs da leitura) em "Componentes"; nenhuma etapa os lê
+    ConfiguracaoDuasPassadas configuracaoDuasPassadas;
+    ConfiguracaoGravacao configuracaoGravacao;  // Codificação das imagens das pastas intermediárias
     GLuint referenceImageTexture;
     bool showReferenceImageWindow;
     char filenamePdf[1024];
     char referenceImage[1024];
     char coordinatesFilePath[1024];
+    char templatesFilePath[1024];  // Lista de modelos (versões da prova); vazio = só a referência e as coordenadas acima
+    char scanInputPath[1024];      // Pasta de imagens ou TIFF multipágina no lugar do PDF; vazio = usa o PDF
+    int scanDpi;
+    TemplateRegistry modelos;
     bool startDrawing;
     bool isDrawing;
     ImVec2 rectStart;
     ImVec2 rectEnd;
     ImVec4 currentRectangle;
     std::vector<RectangleData> rectangles;
+    int selectedRectangle;
+    bool scrollToSelectedRectangle;  // Seleção feita clicando na imagem: rola a lista até ela
+
+    // Índice espacial e geometria de desenho das regiões, refeitos só quando o modelo muda
+    // (ou, no caso da geometria, quando o tamanho da imagem na janela muda)
+    struct GeometriaRegiao {
+        ImVec2 p1, p2;         // Relativos ao canto superior esquerdo da imagem
+        int primeiraLinha;     // Subdivisões em subdivisionLines[primeiraLinha .. primeiraLinha + 2 * numeroLinhas)
+        int numeroLinhas;
+    };
+    GradeRegioes rectangleIndex;
+    bool rectangleIndexDirty;
+    std::vector<GeometriaRegiao> rectangleGeometry;
+    std::vector<ImVec2> subdivisionLines;
+    ImVec2 rectangleGeometrySize;
+    bool rectangleGeometryDirty;
+    std::vector<int> visibleRectangles;
     cv::Size originalImageSize;
     bool showRectanglePropertiesWindow;
+
+    // Resultados publicados pelas threads de processamento, consumidos a cada frame
+    ProgressoLeitura progressoLeitura;
+    std::vector<ResultadoParcialPagina> liveResults;
+    int selectedLiveResult;
+    GLuint liveThumbnailTexture;
+    int liveThumbnailIndex;  // Resultado cuja miniatura está em liveThumbnailTexture
+    bool showLiveResultsWindow;
+    bool showLiveMarks;
     bool isMaximized;
 
+    // Decodificação e conversão para RGBA da referência em segundo plano; só o envio da textura
+    // acontece na thread da interface
+    std::future<cv::Mat> referenceImageLoad;
+    // Treino do classificador de dígitos, também fora da thread da interface
+    std::future<void> digitTraining;
+
+    // Pedido de novo quadro vindo de outras threads (logs, resultados, imagem decodificada)
+    std::atomic<bool> redrawRequested;
+
+    // Tempo de CPU de cada quadro desenhado (sem a espera do V-sync) e quantos quadros o loop deixou de desenhar
+    struct EstatisticasQuadros {
+        float milissegundos[HISTORICO_QUADROS] = {};
+        int proximo = 0;
+        long long desenhados = 0;
+        long long acordouPorEntrada = 0;
+        long long acordouPorNovidades = 0;
+        long long acordouPorTempo = 0;
+        double quadrosPorSegundo = 0.0;
+        int quadrosNoSegundo = 0;
+        std::chrono::steady_clock::time_point inicioSegundo = std::chrono::steady_clock::now();
+    };
+    EstatisticasQuadros frameStats;
+    bool showFrameStatsWindow;
+
 };
 
 Application::Application()
@@ -78,22 +174,37 @@ Application::Application()
     showProcessPDFWindow(true),
     skipPdfConversion(false), skipPdfAlignment(false), skipNoiseReduction(false), skipContourExtraction(false),
     skipReadAnswers(false), skipReadWords(false), skipBinarize(false), // Inicializa a variável da nova checkbox
-    referenceImageTexture(0), showReferenceImageWindow(false),
+    twoPassReading(false), skipPageTriage(false), saveContourImages(false), saveComponentStats(false),
+    referenceImageTexture(0), showReferenceImageWindow(false), scanDpi(300),
     startDrawing(false), isDrawing(false),
+    selectedRectangle(-1), scrollToSelectedRectangle(false),
+    rectangleIndexDirty(true), rectangleGeometrySize(0, 0), rectangleGeometryDirty(true),
     originalImageSize(0, 0), showRectanglePropertiesWindow(true),
-    isMaximized(false) {
+    selectedLiveResult(-1), liveThumbnailTexture(0), liveThumbnailIndex(-1), showLiveResultsWindow(true), showLiveMarks(true),
+    isMaximized(false), redrawRequested(false), showFrameStatsWindow(false) {
     strncpy_s(filenamePdf, "C:/Users/Pedro/Downloads/AA.pdf", sizeof(filenamePdf));
     strncpy_s(referenceImage, "C:/Users/Pedro/Desktop/Nova pasta/Referencia.png", sizeof(referenceImage));
     strncpy_s(coordinatesFilePath, "D:/Projetos/Aprendizado/Garbaritor/Garbaritor/rectangles.txt", sizeof(coordinatesFilePath)); // Inicializa o caminho do arquivo de coordenadas
+    templatesFilePath[0] = '\0';
+    scanInputPath[0] = '\0';
 }
 
 Application::~Application() {
     if (referenceImageTexture) {
         glDeleteTextures(1, &referenceImageTexture);
     }
+    if (liveThumbnailTexture) {
+        glDeleteTextures(1, &liveThumbnailTexture);
+    }
     if (processingThread.joinable()) {
         processingThread.join();
     }
+    if (referenceImageLoad.valid()) {
+        referenceImageLoad.wait();  // A decodificação ainda chama requestRedraw()
+    }
+    if (digitTraining.valid()) {
+        digitTraining.wait();
+    }
     cleanup();
 }
 
@@ -153,6 +264,11 @@ void Application::run() {
         initGLFW();
         initGLAD();
         initImGui();
+        // Mensagens e resultados das threads de processamento acordam o loop de eventos
+        consoleBuffer.SetOnMessage([this]() { requestRedraw(); });
+        progressoLeitura.aoPublicar = [this]() { requestRedraw(); };
+        // Parâmetros gravados pelo ajuste automático (gabaritor --tune), antes de qualquer modelo ser carregado
+        carregarParametrosPipelineSeExistir(consoleBuffer, ARQUIVO_PARAMETROS_PIPELINE);
         mainLoop();
     }
     catch (const std::exception& e) {
@@ -161,9 +277,54 @@ void Application::run() {
     }
 }
 
+// Pode ser chamada de qualquer thread; vários pedidos antes do próximo quadro viram um só evento
+void Application::requestRedraw() {
+    if (!redrawRequested.exchange(true)) {
+        glfwPostEmptyEvent();
+    }
+}
+
 void Application::mainLoop() {
+    using relogio = std::chrono::steady_clock;
+    relogio::time_point ultimoQuadro = relogio::now();
+    int quadrosRestantes = QUADROS_APOS_ENTRADA;
+
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+        // Em vez de desenhar sem parar, espera por entrada, por requestRedraw() ou pelo intervalo que
+        // atualiza o progresso, e deixa os núcleos para o processamento
+        if (quadrosRestantes > 0) {
+            glfwPollEvents();
+            quadrosRestantes--;
+        }
+        else {
+            double espera = isProcessing ? SEGUNDOS_ESPERA_PROCESSANDO : SEGUNDOS_ESPERA_OCIOSA;
+            relogio::time_point inicioEspera = relogio::now();
+            glfwWaitEventsTimeout(espera);
+            double esperado = std::chrono::duration<double>(relogio::now() - inicioEspera).count();
+
+            if (redrawRequested) {
+                // Logs e resultados chegam em rajadas: junta tudo em no máximo um quadro por intervalo
+                frameStats.acordouPorNovidades++;
+                double desdeUltimo = std::chrono::duration<double>(relogio::now() - ultimoQuadro).count();
+                if (desdeUltimo < SEGUNDOS_ENTRE_NOVIDADES) {
+                    glfwWaitEventsTimeout(SEGUNDOS_ENTRE_NOVIDADES - desdeUltimo);
+                }
+            }
+            else if (esperado < espera * 0.95) {
+                frameStats.acordouPorEntrada++;
+                quadrosRestantes = QUADROS_APOS_ENTRADA;
+            }
+            else {
+                frameStats.acordouPorTempo++;
+            }
+        }
+        // Zerado antes de desenhar: um pedido feito durante o quadro garante o próximo
+        redrawRequested = false;
+
+        relogio::time_point inicioQuadro = relogio::now();
+        ultimoQuadro = inicioQuadro;
+        finishReferenceImageLoad();
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -185,11 +346,25 @@ void Application::mainLoop() {
             glfwMakeContextCurrent(backupCurrentContext);
         }
 
+        relogio::time_point fimQuadro = relogio::now();
+        frameStats.milissegundos[frameStats.proximo] = std::chrono::duration<float, std::milli>(fimQuadro - inicioQuadro).count();
+        frameStats.proximo = (frameStats.proximo + 1) % HISTORICO_QUADROS;
+        frameStats.desenhados++;
+        frameStats.quadrosNoSegundo++;
+        double segundos = std::chrono::duration<double>(fimQuadro - frameStats.inicioSegundo).count();
+        if (segundos >= 1.0) {
+            frameStats.quadrosPorSegundo = frameStats.quadrosNoSegundo / segundos;
+            frameStats.quadrosNoSegundo = 0;
+            frameStats.inicioSegundo = fimQuadro;
+        }
+
         glfwSwapBuffers(window);
     }
 }
 
 void Application::renderGUI() {
+    updateRectangleIndex();
+
     renderDockSpace();
     renderMenuBar();
 
@@ -204,6 +379,23 @@ void Application::renderGUI() {
     if (showRectanglePropertiesWindow) {
         renderRectanglePropertiesWindow(&showRectanglePropertiesWindow);
     }
+
+    // Os resultados são retirados da fila mesmo com a janela fechada
+    ResultadoParcialPagina resultado;
+    while (progressoLeitura.retirar(resultado)) {
+        liveResults.push_back(std::move(resultado));
+        int antiga = static_cast<int>(liveResults.size()) - 1 - MINIATURAS_AO_VIVO;
+        if (antiga >= 0 && antiga != selectedLiveResult) {
+            liveResults[antiga].miniatura.release();
+        }
+    }
+    if (showLiveResultsWindow) {
+        renderLiveResultsWindow(&showLiveResultsWindow);
+    }
+
+    if (showFrameStatsWindow) {
+        renderFrameStatsWindow(&showFrameStatsWindow);
+    }
 }
 
 void Application::renderDockSpace() {
@@ -237,6 +429,11 @@ void Application::renderMenuBar() {
             }
             ImGui::EndMenu();
         }
+        if (ImGui::BeginMenu("View")) {
+            ImGui::MenuItem("Live Results", nullptr, &showLiveResultsWindow);
+            ImGui::MenuItem("Frame Stats", nullptr, &showFrameStatsWindow);
+            ImGui::EndMenu();
+        }
         ImGui::EndMenuBar();
     }
 }
@@ -254,6 +451,35 @@ void Application::renderProcessPDFWindow() {
     ImGui::SameLine();
     ImGui::Text("PDF: %s", filenamePdf);
 
+    // Digitalizações lidas direto, sem converter o PDF nem gravar a pasta de PNGs
+    if (ImGui::Button("Select Scan Folder") && !isProcessing) {
+        const char* folderPath = tinyfd_selectFolderDialog("Select Scan Folder", scanInputPath);
+        if (folderPath) {
+            strncpy_s(scanInputPath, folderPath, sizeof(scanInputPath));
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Select Scan File") && !isProcessing) {
+        const char* filterPatterns[6] = { "*.tif", "*.tiff", "*.jpg", "*.jpeg", "*.png", "*.bmp" };
+        const char* filePath = tinyfd_openFileDialog("Select Scan File", scanInputPath, 6, filterPatterns, "Scanned Images", 0);
+        if (filePath) {
+            strncpy_s(scanInputPath, filePath, sizeof(scanInputPath));
+        }
+    }
+    ImGui::SameLine();
+    if (scanInputPath[0] != '\0') {
+        ImGui::Text("Scans: %s", scanInputPath);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Clear##scans") && !isProcessing) {
+            scanInputPath[0] = '\0';
+        }
+        ImGui::InputInt("Scan DPI", &scanDpi);
+        scanDpi = std::max(scanDpi, 36);
+    }
+    else {
+        ImGui::Text("Scans: (none, using PDF)");
+    }
+
     if (ImGui::Button("Select Reference Image") && !isProcessing) {
         const char* imageFilterPatterns[2] = { "*.png", "*.jpg" };
         const char* imagePath = tinyfd_openFileDialog("Select Reference Image", referenceImage, 2, imageFilterPatterns, "Image Files", 0);
@@ -264,9 +490,12 @@ void Application::renderProcessPDFWindow() {
     ImGui::SameLine();
     ImGui::Text("Image: %s", referenceImage);
 
-    if (ImGui::Button("Load Reference Image") && !isProcessing) {
-        referenceImageTexture = loadImageAsTexture(referenceImage);
-        showReferenceImageWindow = true;
+    if (ImGui::Button("Load Reference Image") && !isProcessing && !referenceImageLoad.valid()) {
+        startReferenceImageLoad();
+    }
+    if (referenceImageLoad.valid()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("Loading...");
     }
 
     if (ImGui::Button("Select Coordinates File") && !isProcessing) {
@@ -279,18 +508,84 @@ void Application::renderProcessPDFWindow() {
     ImGui::SameLine();
     ImGui::Text("Coordinates: %s", coordinatesFilePath);
 
+    // Uma linha "nome;imagem de referência;arquivo de coordenadas" por versão da prova
+    if (ImGui::Button("Select Templates File") && !isProcessing) {
+        const char* filterPatterns[1] = { "*.txt" };
+        const char* filePath = tinyfd_openFileDialog("Select Templates File", templatesFilePath, 1, filterPatterns, NULL, 0);
+        if (filePath) {
+            strncpy_s(templatesFilePath, filePath, sizeof(templatesFilePath));
+        }
+    }
+    ImGui::SameLine();
+    if (templatesFilePath[0] != '\0') {
+        ImGui::Text("Templates: %s", templatesFilePath);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Clear") && !isProcessing) {
+            templatesFilePath[0] = '\0';
+        }
+    }
+    else {
+        ImGui::Text("Templates: (single reference)");
+    }
+
+    bool treinando = digitTraining.valid() && digitTraining.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    if (ImGui::Button("Train Digit Classifier") && !treinando) {
+        const char* pastaAmostras = tinyfd_selectFolderDialog("Select Labeled Digit Folder (<folder>/<digit>/*.png)", "");
+        if (pastaAmostras) {
+            // A leitura em andamento continua com o classificador antigo até o novo ser trocado
+            std::string pasta = pastaAmostras;
+            digitTraining = std::async(std::launch::async, [this, pasta]() {
+                treinarClassificadorDigitos(consoleBuffer, pasta, MODELO_DIGITOS_PADRAO);
+                requestRedraw();
+            });
+        }
+    }
+    if (treinando) {
+        ImGui::SameLine();
+        ImGui::Text("Training...");
+    }
+
     ImGui::Checkbox("Skip PDF Conversion", &skipPdfConversion);
     ImGui::Checkbox("Skip PDF Alignment", &skipPdfAlignment);
     ImGui::Checkbox("Skip Noise Reduction", &skipNoiseReduction);
     ImGui::Checkbox("Skip Contour Extraction", &skipContourExtraction);
+    if (!skipContourExtraction) {
+        ImGui::Checkbox("Save Contour Debug Images", &saveContourImages);
+        ImGui::Checkbox("Save Bubble Component Stats", &saveComponentStats);
+    }
     ImGui::Checkbox("Skip Binarize Feature", &skipBinarize);
     ImGui::Checkbox("Skip Read Answers", &skipReadAnswers);
     ImGui::Checkbox("Skip Read Words", &skipReadWords);
+    ImGui::Checkbox("Skip Page Triage", &skipPageTriage); // Não descarta páginas em branco, capas e instruções
+
+    // Leitura de respostas direto do PDF: DPI baixo para todas as páginas, DPI alto só nas duvidosas
+    ImGui::Checkbox("Two-Pass Reading", &twoPassReading);
+    if (twoPassReading) {
+        ImGui::InputInt("Low DPI", &configuracaoDuasPassadas.dpiBaixo);
+        ImGui::InputInt("High DPI", &configuracaoDuasPassadas.dpiAlto);
+        ImGui::SliderFloat("Confidence Threshold", &configuracaoDuasPassadas.limiarConfianca, 0.0f, 1.0f);
+        configuracaoDuasPassadas.dpiBaixo = std::max(configuracaoDuasPassadas.dpiBaixo, 36);
+        configuracaoDuasPassadas.dpiAlto = std::max(configuracaoDuasPassadas.dpiAlto, configuracaoDuasPassadas.dpiBaixo);
+        // A leitura em duas passadas só lê as marcações; o OCR das palavras ainda precisa das etapas em pastas
+        if (!skipReadWords) {
+            ImGui::TextDisabled("Read Words still runs conversion, alignment and noise reduction");
+        }
+    }
+
+    // Imagens intermediárias: compressão mais alta economiza disco e custa tempo das threads de gravação
+    ImGui::SliderInt("PNG Compression", &configuracaoGravacao.compressaoPng, 0, 9);
+    ImGui::Checkbox("Sync Image Writes to Disk", &configuracaoGravacao.sincronizarDisco);
 
     ImGui::Separator();
 
     if (ImGui::Button("Start Processing") && !isProcessing) {
+        GravadorImagens::global().configurar(configuracaoGravacao);
         if (processingThread.joinable()) processingThread.join();
+        liveResults.clear();
+        selectedLiveResult = -1;
+        liveThumbnailIndex = -1;
+        progressoLeitura.iniciar(0);
+        progressoLeitura.limiarDuvida = configuracaoDuasPassadas.limiarConfianca;
         processingThread = std::thread(&Application::processTask, this);
         isProcessing = true;
     }
@@ -308,10 +603,43 @@ void Application::renderProcessPDFWindow() {
     ImGui::End();
 }
 
-GLuint Application::loadImageAsTexture(const char* imagePath) {
-    cv::Mat image = cv::imread(imagePath, cv::IMREAD_UNCHANGED);
-    cv::cvtColor(image, image, cv::COLOR_BGR2RGBA);
+// Decodifica e converte a referência em outra thread; a janela continua respondendo em imagens grandes
+void Application::startReferenceImageLoad() {
+    std::string imagePath = referenceImage;
+    referenceImageLoad = std::async(std::launch::async, [this, imagePath]() {
+        cv::Mat image = cv::imread(imagePath, cv::IMREAD_COLOR);
+        cv::Mat rgba;
+        if (image.empty()) {
+            consoleBuffer.AddLogMessage(LogLevel::Error, "Failed to load image: " + imagePath);
+        }
+        else {
+            cv::cvtColor(image, rgba, cv::COLOR_BGR2RGBA);
+        }
+        requestRedraw();
+        return rgba;
+    });
+}
+
+// Chamada a cada quadro, na thread da interface (a única com o contexto OpenGL)
+void Application::finishReferenceImageLoad() {
+    if (!referenceImageLoad.valid() || referenceImageLoad.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    cv::Mat image = referenceImageLoad.get();
+    if (image.empty()) {
+        return;
+    }
+    if (referenceImageTexture) {
+        glDeleteTextures(1, &referenceImageTexture);
+    }
+    referenceImageTexture = createTextureFromRGBA(image);
+    originalImageSize = image.size(); // A janela da referência usa o tamanho guardado, sem reler a imagem a cada frame
+    showReferenceImageWindow = true;
+    markRectanglesChanged();
+}
 
+// Só o envio para a GPU: a imagem já chega em RGBA
+GLuint Application::createTextureFromRGBA(const cv::Mat& image) {
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
@@ -330,69 +658,179 @@ GLuint Application::loadImageAsTexture(const char* imagePath) {
 void Application::processTask() {
     isProcessing = true;
     processFinished = false;
-
-    if (!skipPdfConversion) {
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Iniciando processamento do PDF: " + std::string(filenamePdf));
-        processPdf(consoleBuffer, filenamePdf, "Imagens", 300);
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Processamento de PDF concluido.");
-    }
-
-    if (!skipPdfAlignment) {
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Iniciando processamento de alinhamento de Imagens");
-        alinharImagens(consoleBuffer, "Imagens", "ImagensAlinhadas", referenceImage);
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Processamento de alinhamento de Imagens concluido.");
-    }
-
-    if (!skipNoiseReduction) {
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Iniciando processamento de Reducao de Ruido");
-        aplicarFiltroReducaoRuido(consoleBuffer, "ImagensAlinhadas", "ImagensSemRuidos");
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Processamento de Reducao de Ruído concluido.");
-    }
-
-    if (!skipContourExtraction) {
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Iniciando processamento de Extracao de Contornos");
-        extrairContornos(consoleBuffer, "ImagensSemRuidos", "Contornos", "ImagemThreshold");
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Processamento de Extracao de Contornos concluido.");
+    // Esta thread também executa itens do pool e chama o Tesseract: o limite de OCR do orçamento vale por thread
+    limitarThreadAtual();
+
+    // Os modelos são carregados uma vez por execução (referência, features ORB, miniatura e geometria)
+    bool usarModelos = templatesFilePath[0] != '\0';
+    if (usarModelos && !modelos.carregarLista(consoleBuffer, templatesFilePath)) {
+        isProcessing = false;
+        processFinished = true;
+        requestRedraw();
+        return;
     }
 
-    if (!skipBinarize) {
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Iniciando processamento de Binarização de Imagem");
-        BinarizarDinamico(consoleBuffer, "ImagensSemRuidos", "ImagemBinarizadas");
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Processamento de Extracao de Contornos concluido.");
+    // Com digitalizações, a conversão do PDF não existe e o alinhamento (ou a leitura em duas passadas)
+    // decodifica as páginas direto dos arquivos. Sem lista de modelos, a referência vira um modelo único.
+    bool usarDigitalizacao = scanInputPath[0] != '\0';
+    FonteDigitalizacao digitalizacao;
+    TemplateRegistry referenciaUnica;
+    if (usarDigitalizacao) {
+        bool carregado = digitalizacao.abrir(consoleBuffer, scanInputPath, scanDpi);
+        if (carregado && !usarModelos) {
+            carregado = referenciaUnica.adicionar(consoleBuffer, "referencia", referenceImage, twoPassReading ? coordinatesFilePath : "");
+        }
+        if (!carregado) {
+            isProcessing = false;
+            processFinished = true;
+            requestRedraw();
+            return;
+        }
     }
-
-    if (!skipReadAnswers) {
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Iniciando leitura de respostas");
-        processImagesAndReadAnswers(consoleBuffer, "ImagemBinarizadas", coordinatesFilePath, "Respostas");
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Leitura de respostas concluida.");
+    const TemplateRegistry& modelosDigitalizacao = usarModelos ? modelos : referenciaUnica;
+
+    // Cada etapa declara as pastas que lê e grava; o grafo decide a ordem, pula as etapas cujas saídas
+    // ninguém usa (a binarização com a leitura em duas passadas) e
+    // junta redução de ruído e binarização em uma passada quando as duas rodam
+    std::string origem = usarDigitalizacao ? std::string(scanInputPath) : std::string(filenamePdf);
+    GrafoEtapas grafo;
+
+    // Cada página lida vai para o armazém assim que termina, a partir do resultado em memória, com o
+    // nome do PDF (ou das digitalizações) como lote. Um escritor por processo, como na pasta monitorada.
+    static const std::string idEscritorArmazem = idWorkerPadrao();
+    std::filesystem::path caminhoOrigem(origem);
+    if (!caminhoOrigem.has_filename()) caminhoOrigem = caminhoOrigem.parent_path();  // Pasta terminada em barra
+    std::string loteArmazem = caminhoOrigem.stem().string();
+    std::string arquivoArmazem = caminhoOrigem.filename().string();
+    ArmazemResultados armazem;
+    bool usarArmazem = armazem.abrir(consoleBuffer, "Resposta/" + PASTA_ARMAZEM_RESULTADOS, idEscritorArmazem);
+    if (usarArmazem) {
+        progressoLeitura.aoConcluirPagina = [&](const ResultadoParcialPagina& resultado) {
+            armazem.anexar(registroDaPagina(loteArmazem, arquivoArmazem, resultado));
+        };
     }
 
-    if (!skipReadWords) {
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Iniciando leitura de palavras");
-        processImagesAndExtractWords(consoleBuffer, "ImagemThreshold", coordinatesFilePath, "Respostas1");
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Leitura de palavras concluida.");
+    if (!usarDigitalizacao) {
+        grafo.adicionar({ "pdf", { origem }, { "Imagens" }, !skipPdfConversion, false, [this](Logger& logger) {
+            logger.AddLogMessage(LogLevel::Info, "Iniciando processamento do PDF: " + std::string(filenamePdf));
+            processPdf(logger, filenamePdf, "Imagens", parametrosPipeline().DPI);
+            logger.AddLogMessage(LogLevel::Info, "Processamento de PDF concluido.");
+        } });
     }
 
-        juntarRespostasEmTXT(consoleBuffer, "Respostas", "Resposta");
-
-
-
+    // O relatório da triagem (páginas ignoradas e modelo de cada página) fica em "Triagem", gravado pela etapa
+    // que tria as páginas: o alinhamento ou, em duas passadas, a própria leitura. Assim juntar as respostas
+    // não depende das imagens alinhadas.
+    std::vector<std::string> saidasAlinhamento = { "ImagensAlinhadas" };
+    if (!twoPassReading) saidasAlinhamento.push_back("Triagem");
+    grafo.adicionar({ "alinhamento", { usarDigitalizacao ? origem : std::string("Imagens") }, saidasAlinhamento, !skipPdfAlignment, false,
+        [&, this](Logger& logger) {
+            logger.AddLogMessage(LogLevel::Info, "Iniciando processamento de alinhamento de Imagens");
+            std::string pastaTriagem = twoPassReading ? "" : "Triagem";
+            if (usarDigitalizacao) {
+                alinharImagens(logger, digitalizacao, "ImagensAlinhadas", modelosDigitalizacao, !skipPageTriage, parametrosPipeline().DPI, pastaTriagem);
+            }
+            else if (usarModelos) {
+                alinharImagens(logger, "Imagens", "ImagensAlinhadas", modelos, !skipPageTriage, pastaTriagem);
+            }
+            else {
+                alinharImagens(logger, "Imagens", "ImagensAlinhadas", referenceImage, !skipPageTriage, pastaTriagem);
+            }
+            logger.AddLogMessage(LogLevel::Info, "Processamento de alinhamento de Imagens concluido.");
+        } });
+
+    grafo.adicionar({ "reducaoRuido", { "ImagensAlinhadas" }, { "ImagensSemRuidos" }, !skipNoiseReduction, false, [](Logger& logger) {
+        logger.AddLogMessage(LogLevel::Info, "Iniciando processamento de Reducao de Ruido");
+        aplicarFiltroReducaoRuido(logger, "ImagensAlinhadas", "ImagensSemRuidos");
+        logger.AddLogMessage(LogLevel::Info, "Processamento de Reducao de Ruído concluido.");
+    } });
+
+    // Threshold do OCR, lido pela leitura de palavras. Os componentes das bolhas e os contornos só saem quando
+    // pedidos e só então a etapa é final; senão ela roda apenas se a leitura de palavras rodar.
+    std::vector<std::string> saidasComponentes = { "ImagemThreshold" };
+    if (saveComponentStats) saidasComponentes.push_back("Componentes");
+    if (saveContourImages) saidasComponentes.push_back("Contornos");
+    bool componentesPedidos = saveComponentStats || saveContourImages;
+    grafo.adicionar({ "contornos", { "ImagensSemRuidos", "ImagensAlinhadas" }, saidasComponentes, !skipContourExtraction, componentesPedidos, [&, this](Logger& logger) {
+        logger.AddLogMessage(LogLevel::Info, "Iniciando processamento de Extracao de Componentes");
+        extrairComponentes(logger, "ImagensSemRuidos", saveComponentStats ? "Componentes" : "", "ImagemThreshold", coordinatesFilePath,
+            usarModelos ? &modelos : nullptr, "ImagensAlinhadas", saveContourImages ? "Contornos" : "", usarModelos ? "" : referenceImage);
+        logger.AddLogMessage(LogLevel::Info, "Processamento de Extracao de Componentes concluido.");
+    } });
+
+    grafo.adicionar({ "binarizacao", { "ImagensSemRuidos" }, { "ImagemBinarizadas" }, !skipBinarize, false, [](Logger& logger) {
+        logger.AddLogMessage(LogLevel::Info, "Iniciando processamento de Binarização de Imagem");
+        BinarizarDinamico(logger, "ImagensSemRuidos", "ImagemBinarizadas");
+        logger.AddLogMessage(LogLevel::Info, "Processamento de Binarização de Imagem concluido.");
+    } });
+
+    grafo.adicionarFusao({ "reducaoRuido", "binarizacao", [](Logger& logger, bool gravarIntermediaria) {
+        logger.AddLogMessage(LogLevel::Info, "Iniciando Reducao de Ruido e Binarização em uma passada");
+        reduzirRuidoEBinarizar(logger, "ImagensAlinhadas", "ImagensSemRuidos", "ImagemBinarizadas", gravarIntermediaria);
+        logger.AddLogMessage(LogLevel::Info, "Reducao de Ruido e Binarização concluidas.");
+    } });
+
+    // A leitura em duas passadas parte do PDF (ou das digitalizações), não das pastas
+    std::vector<std::string> entradasLeitura = twoPassReading ? std::vector<std::string>{ origem }
+                                                              : std::vector<std::string>{ "ImagemBinarizadas", "ImagensAlinhadas" };
+    std::vector<std::string> saidasLeitura = { "Respostas" };
+    if (twoPassReading) saidasLeitura.push_back("Triagem");
+    grafo.adicionar({ "leituraRespostas", entradasLeitura, saidasLeitura, !skipReadAnswers, false, [&, this](Logger& logger) {
+        logger.AddLogMessage(LogLevel::Info, "Iniciando leitura de respostas");
+        if (twoPassReading) {
+            configuracaoDuasPassadas.triarPaginas = !skipPageTriage;
+            configuracaoDuasPassadas.pastaTriagem = "Triagem";
+            if (usarDigitalizacao) {
+                processarDigitalizacaoDuasPassadas(logger, digitalizacao, modelosDigitalizacao, "Respostas", configuracaoDuasPassadas, &progressoLeitura);
+            }
+            else if (usarModelos) {
+                processarPdfDuasPassadas(logger, filenamePdf, modelos, "Respostas", configuracaoDuasPassadas, &progressoLeitura);
+            }
+            else {
+                processarPdfDuasPassadas(logger, filenamePdf, referenceImage, coordinatesFilePath, "Respostas", configuracaoDuasPassadas, &progressoLeitura);
+            }
+        }
+        else {
+            processImagesAndReadAnswers(logger, "ImagemBinarizadas", coordinatesFilePath, "Respostas",
+                usarModelos ? &modelos : nullptr, "ImagensAlinhadas", &progressoLeitura, usarModelos ? "" : referenceImage);
+        }
+        logger.AddLogMessage(LogLevel::Info, "Leitura de respostas concluida.");
+    } });
+
+    grafo.adicionar({ "leituraPalavras", { "ImagemThreshold", "ImagensAlinhadas" }, { "Respostas1" }, !skipReadWords, false, [&, this](Logger& logger) {
+        logger.AddLogMessage(LogLevel::Info, "Iniciando leitura de palavras");
+        processImagesAndExtractWords(logger, ocrEngines, "ImagemThreshold", coordinatesFilePath, "Respostas1",
+            usarModelos ? &modelos : nullptr, "ImagensAlinhadas");
+        logger.AddLogMessage(LogLevel::Info, "Leitura de palavras concluida.");
+    } });
+
+    // Resultado do lote: junta as respostas e completa o armazém. As páginas lidas já estão nele; as
+    // palavras só existem depois da leitura de palavras e a triagem do alinhamento não publica páginas.
+    grafo.adicionar({ "juntarRespostas", { "Respostas", "Respostas1", "Triagem" }, { "Resposta" }, true, true, [&](Logger& logger) {
+        juntarRespostasEmTXT(logger, "Respostas", "Resposta", "Triagem");
+
+        if (!usarArmazem) return;
+        // Sem leitura nesta execução, as respostas de uma execução anterior são lidas dos arquivos
+        bool lerArquivos = !skipReadWords || skipReadAnswers;
+        importarRespostas(logger, armazem, loteArmazem, arquivoArmazem, lerArquivos ? "Respostas" : "",
+            lerArquivos && !skipReadWords ? "Respostas1" : "", "Triagem");
+    } });
+
+    grafo.executar(consoleBuffer);
+    progressoLeitura.aoConcluirPagina = nullptr;
+    if (usarArmazem) armazem.salvarIndice();
 
     isProcessing = false;
     processFinished = true;
+    requestRedraw();
 }
 
 void Application::renderReferenceImageWindow() {
     ImGui::Begin("Reference Image", &showReferenceImageWindow, ImGuiWindowFlags_NoCollapse);
 
     ImVec2 avail = ImGui::GetContentRegionAvail();
-    cv::Mat img = cv::imread(referenceImage);
-    if (!img.empty()) {
-        if (originalImageSize.width == 0 && originalImageSize.height == 0) {
-            originalImageSize = img.size(); // Armazena o tamanho original da imagem
-        }
-
-        float aspectRatio = static_cast<float>(img.rows) / img.cols;
+    if (originalImageSize.width > 0 && originalImageSize.height > 0) {
+        float aspectRatio = static_cast<float>(originalImageSize.height) / originalImageSize.width;
         ImVec2 imageSize(avail.x, avail.x * aspectRatio);
 
         ImGui::Image(reinterpret_cast<void*>(static_cast<intptr_t>(referenceImageTexture)), imageSize);
@@ -400,26 +838,9 @@ void Application::renderReferenceImageWindow() {
         ImVec2 imagePos = ImGui::GetCursorScreenPos();
         handleRectangleDrawing(imagePos, imageSize);
 
-        // Desenha todos os retângulos armazenados
+        // imagePos é o canto inferior esquerdo da imagem (cursor depois do Image)
         ImDrawList* draw_list = ImGui::GetWindowDrawList();
-        for (const auto& rectData : rectangles) {
-            const auto& rect = rectData.coordinates;
-            ImVec2 p1(imagePos.x + rect.x * imageSize.x, imagePos.y + ( rect.y - 1.0f) * imageSize.y);
-            ImVec2 p2(imagePos.x + rect.z * imageSize.x, imagePos.y + ( rect.w - 1.0f) * imageSize.y);
-            draw_list->AddRect(p1, p2, IM_COL32(255, 0, 0, 255));
-
-            // Desenha subdivisões
-            int lines = rectData.subdivisions.first;
-            int columns = rectData.subdivisions.second;
-            float cellWidth = (p2.x - p1.x) / columns;
-            float cellHeight = (p2.y - p1.y) / lines;
-            for (int l = 1; l < lines; ++l) {
-                draw_list->AddLine(ImVec2(p1.x, p1.y + l * cellHeight), ImVec2(p2.x, p1.y + l * cellHeight), IM_COL32(255, 0, 0, 255));
-            }
-            for (int c = 1; c < columns; ++c) {
-                draw_list->AddLine(ImVec2(p1.x + c * cellWidth, p1.y), ImVec2(p1.x + c * cellWidth, p2.y), IM_COL32(255, 0, 0, 255));
-            }
-        }
+        drawRectangles(draw_list, ImVec2(imagePos.x, imagePos.y - imageSize.y), imageSize);
 
         // Desenha o retângulo atual
         if (currentRectangle.z != 0 && currentRectangle.w != 0) {
@@ -435,6 +856,63 @@ void Application::renderReferenceImageWindow() {
     ImGui::End();
 }
 
+void Application::drawRectangles(ImDrawList* draw_list, const ImVec2& imageOrigin, const ImVec2& imageSize) {
+    // Retângulos e subdivisões em pixels da imagem, refeitos só quando o modelo ou o tamanho muda
+    if (rectangleGeometryDirty || rectangleGeometrySize.x != imageSize.x || rectangleGeometrySize.y != imageSize.y) {
+        rectangleGeometry.clear();
+        subdivisionLines.clear();
+        for (const auto& rectData : rectangles) {
+            const auto& rect = rectData.coordinates;
+            GeometriaRegiao geometria;
+            geometria.p1 = ImVec2(rect.x * imageSize.x, rect.y * imageSize.y);
+            geometria.p2 = ImVec2(rect.z * imageSize.x, rect.w * imageSize.y);
+            geometria.primeiraLinha = static_cast<int>(subdivisionLines.size());
+
+            int lines = rectData.subdivisions.first;
+            int columns = rectData.subdivisions.second;
+            float cellWidth = (geometria.p2.x - geometria.p1.x) / columns;
+            float cellHeight = (geometria.p2.y - geometria.p1.y) / lines;
+            for (int l = 1; l < lines; ++l) {
+                subdivisionLines.push_back(ImVec2(geometria.p1.x, geometria.p1.y + l * cellHeight));
+                subdivisionLines.push_back(ImVec2(geometria.p2.x, geometria.p1.y + l * cellHeight));
+            }
+            for (int c = 1; c < columns; ++c) {
+                subdivisionLines.push_back(ImVec2(geometria.p1.x + c * cellWidth, geometria.p1.y));
+                subdivisionLines.push_back(ImVec2(geometria.p1.x + c * cellWidth, geometria.p2.y));
+            }
+            geometria.numeroLinhas = (static_cast<int>(subdivisionLines.size()) - geometria.primeiraLinha) / 2;
+            rectangleGeometry.push_back(geometria);
+        }
+        rectangleGeometrySize = imageSize;
+        rectangleGeometryDirty = false;
+    }
+
+    // Só as regiões que aparecem na parte visível da janela
+    ImVec2 clipMin = draw_list->GetClipRectMin();
+    ImVec2 clipMax = draw_list->GetClipRectMax();
+    rectangleIndex.consultar((clipMin.x - imageOrigin.x) / imageSize.x, (clipMin.y - imageOrigin.y) / imageSize.y,
+        (clipMax.x - imageOrigin.x) / imageSize.x, (clipMax.y - imageOrigin.y) / imageSize.y, visibleRectangles);
+
+    for (int i : visibleRectangles) {
+        const GeometriaRegiao& geometria = rectangleGeometry[i];
+        ImU32 color = IM_COL32(255, 0, 0, 255);
+        if (i == selectedRectangle) {
+            color = IM_COL32(255, 255, 0, 255);
+        }
+        else if (rectangleIndex.sobreposta(i)) {
+            color = IM_COL32(255, 140, 0, 255);
+        }
+
+        draw_list->AddRect(ImVec2(imageOrigin.x + geometria.p1.x, imageOrigin.y + geometria.p1.y),
+            ImVec2(imageOrigin.x + geometria.p2.x, imageOrigin.y + geometria.p2.y), color);
+        for (int l = 0; l < geometria.numeroLinhas; ++l) {
+            const ImVec2& a = subdivisionLines[geometria.primeiraLinha + 2 * l];
+            const ImVec2& b = subdivisionLines[geometria.primeiraLinha + 2 * l + 1];
+            draw_list->AddLine(ImVec2(imageOrigin.x + a.x, imageOrigin.y + a.y), ImVec2(imageOrigin.x + b.x, imageOrigin.y + b.y), color);
+        }
+    }
+}
+
 void Application::handleRectangleDrawing(const ImVec2& imagePos, const ImVec2& imageSize) {
     ImGuiIO& io = ImGui::GetIO();
     ImDrawList* draw_list = ImGui::GetWindowDrawList();
@@ -467,7 +945,16 @@ void Application::handleRectangleDrawing(const ImVec2& imagePos, const ImVec2& i
             );
 
             // Adiciona o retângulo desenhado à lista de retângulos
-            rectangles.push_back({ currentRectangle, {1, 1}, "Rectangle " + std::to_string(rectangles.size()) });
+            rectangles.push_back({ { currentRectangle.x, currentRectangle.y, currentRectangle.z, currentRectangle.w }, {1, 1}, "Rectangle " + std::to_string(rectangles.size()) });
+            markRectanglesChanged();
+        }
+    }
+    else if (!startDrawing && ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+        // Clique na imagem seleciona a região sob o mouse
+        int clicked = rectangleIndex.regiaoNoPonto((io.MousePos.x - imagePos.x) / imageSize.x, 1.0f + (io.MousePos.y - imagePos.y) / imageSize.y);
+        if (clicked >= 0) {
+            selectedRectangle = clicked;
+            scrollToSelectedRectangle = true;
         }
     }
 
@@ -477,6 +964,16 @@ void Application::handleRectangleDrawing(const ImVec2& imagePos, const ImVec2& i
     }
 }
 
+// InputText editando um std::string: cresce a string quando o texto passa da capacidade
+static int resizeStringCallback(ImGuiInputTextCallbackData* data) {
+    if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+        std::string* str = static_cast<std::string*>(data->UserData);
+        str->resize(data->BufTextLen);
+        data->Buf = &(*str)[0];
+    }
+    return 0;
+}
+
 void Application::renderRectanglePropertiesWindow(bool* p_open) {
     ImGui::SetNextWindowSize(ImVec2(500, 440), ImGuiCond_FirstUseEver);
     if (ImGui::Begin("Rectangle Properties", p_open)) {
@@ -508,20 +1005,35 @@ void Application::renderRectanglePropertiesWindow(bool* p_open) {
 
         ImGui::Separator();
 
+        ImGui::Text("Rectangles: %d", static_cast<int>(rectangles.size()));
+        if (rectangleIndex.numeroSobrepostas() > 0) {
+            ImGui::SameLine();
+            ImGui::TextColored(ImVec4(1.0f, 0.55f, 0.0f, 1.0f), "(%d overlapping)", rectangleIndex.numeroSobrepostas());
+        }
+
         // Left pane
-        static int selected = -1;
+        int& selected = selectedRectangle;
         {
             ImGui::BeginChild("left pane", ImVec2(150, 0), true);
-            for (int i = 0; i < rectangles.size(); i++) {
-                char label[128];
-                sprintf(label, "%s", rectangles[i].name.c_str());
-                if (ImGui::Selectable(label, selected == i))
-                    selected = i;
+            if (scrollToSelectedRectangle && selected >= 0) {
+                ImGui::SetScrollY(selected * ImGui::GetFrameHeightWithSpacing());
+                scrollToSelectedRectangle = false;
+            }
 
-                ImGui::SameLine();
-                char renameLabel[128];
-                sprintf(renameLabel, "##Rename%d", i);
-                ImGui::InputText(renameLabel, &rectangles[i].name[0], rectangles[i].name.size() + 1);
+            // Só as linhas visíveis são montadas
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(rectangles.size()), ImGui::GetFrameHeightWithSpacing());
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                    ImGui::PushID(i);
+                    if (ImGui::Selectable(rectangles[i].name.c_str(), selected == i))
+                        selected = i;
+
+                    ImGui::SameLine();
+                    ImGui::InputText("##Rename", &rectangles[i].name[0], rectangles[i].name.capacity() + 1,
+                        ImGuiInputTextFlags_CallbackResize, resizeStringCallback, &rectangles[i].name);
+                    ImGui::PopID();
+                }
             }
             ImGui::EndChild();
         }
@@ -534,13 +1046,16 @@ void Application::renderRectanglePropertiesWindow(bool* p_open) {
             ImGui::Text("Rectangle: %d", selected);
             ImGui::Separator();
             if (selected >= 0 && selected < rectangles.size()) {
-                ImVec4& rect = rectangles[selected].coordinates;
+                CoordenadasRegiao& rect = rectangles[selected].coordinates;
                 ImGui::Text("Coordinates: (%.2f, %.2f) - (%.2f, %.2f)", rect.x, rect.y, rect.z, rect.w);
 
                 int& lines = rectangles[selected].subdivisions.first;
                 int& columns = rectangles[selected].subdivisions.second;
-                ImGui::SliderInt("Lines", &lines, 1, 20);    // Aumenta o limite dos sliders
-                ImGui::SliderInt("Columns", &columns, 1, 20); // Aumenta o limite dos sliders
+                if (ImGui::SliderInt("Lines", &lines, 1, 20)) markRectanglesChanged();    // Aumenta o limite dos sliders
+                if (ImGui::SliderInt("Columns", &columns, 1, 20)) markRectanglesChanged(); // Aumenta o limite dos sliders
+                if (rectangleIndex.sobreposta(selected)) {
+                    ImGui::TextColored(ImVec4(1.0f, 0.55f, 0.0f, 1.0f), "Overlaps another rectangle");
+                }
 
                 bool& analyzeVertical = rectangles[selected].analyzeVertical;
                 bool& isWord = rectangles[selected].isWord;
@@ -549,17 +1064,40 @@ void Application::renderRectanglePropertiesWindow(bool* p_open) {
                 ImGui::Checkbox("Is word", &isWord);
                 ImGui::Checkbox("Is Number ", &isNumber);
 
+                if (isWord) {
+                    // Perfil de OCR da região
+                    const char* segmentacoes[] = { "Single Line", "Single Word" };
+                    const char* motores[] = { "LSTM", "Legacy" };
+                    int segmentacao = static_cast<int>(rectangles[selected].ocrSegmentation);
+                    int motor = static_cast<int>(rectangles[selected].ocrEngine);
+                    if (ImGui::Combo("OCR Segmentation", &segmentacao, segmentacoes, 2)) {
+                        rectangles[selected].ocrSegmentation = static_cast<OcrSegmentation>(segmentacao);
+                    }
+                    if (ImGui::Combo("OCR Engine", &motor, motores, 2)) {
+                        rectangles[selected].ocrEngine = static_cast<OcrEngineKind>(motor);
+                    }
+                    if (isNumber) {
+                        const char* reconhecedores[] = { "Tesseract", "Digit Classifier" };
+                        int reconhecedor = static_cast<int>(rectangles[selected].numberRecognizer);
+                        if (ImGui::Combo("Number Recognizer", &reconhecedor, reconhecedores, 2)) {
+                            rectangles[selected].numberRecognizer = static_cast<NumberRecognizer>(reconhecedor);
+                        }
+                    }
+                }
+
                 if (ImGui::Button("Delete")) {
                     rectangles.erase(rectangles.begin() + selected);
                     selected = -1; // Reseta a seleção após deletar
+                    markRectanglesChanged();
                 }
                 ImGui::SameLine();
                 if (ImGui::Button("Modify")) {
                     startDrawing = true;
                     isDrawing = false; // Reinicia o estado de desenho
-                    currentRectangle = rect; // Usa as coordenadas do retângulo selecionado
+                    currentRectangle = ImVec4(rect.x, rect.y, rect.z, rect.w); // Usa as coordenadas do retângulo selecionado
                     rectangles.erase(rectangles.begin() + selected);
                     selected = -1; // Reseta a seleção para iniciar o desenho modificado
+                    markRectanglesChanged();
                 }
             }
             ImGui::EndChild();
@@ -570,6 +1108,157 @@ void Application::renderRectanglePropertiesWindow(bool* p_open) {
     }
 }
 
+void Application::renderLiveResultsWindow(bool* p_open) {
+    ImGui::SetNextWindowSize(ImVec2(700, 500), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Live Results", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    int total = progressoLeitura.total();
+    int concluidas = progressoLeitura.concluidas();
+    char progressLabel[64];
+    snprintf(progressLabel, sizeof(progressLabel), "%d / %d pages", concluidas, total);
+    ImGui::ProgressBar(total > 0 ? static_cast<float>(concluidas) / total : 0.0f, ImVec2(-1, 0), progressLabel);
+
+    double restantes = progressoLeitura.segundosRestantes();
+    if (isProcessing && restantes >= 0) {
+        int segundos = static_cast<int>(restantes);
+        ImGui::Text("%.2f pages/s, ETA %d:%02d", progressoLeitura.paginasPorSegundo(), segundos / 60, segundos % 60);
+    }
+    else {
+        ImGui::Text("%.2f pages/s", progressoLeitura.paginasPorSegundo());
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("Show Marks", &showLiveMarks);
+
+    // Tabela à esquerda (só as linhas visíveis são montadas), miniatura da página selecionada à direita
+    const ImVec4 corAlerta(1.0f, 0.55f, 0.0f, 1.0f);
+    const ImVec4 corErro(1.0f, 0.3f, 0.3f, 1.0f);
+    float larguraTabela = ImGui::GetContentRegionAvail().x * 0.6f;
+    ImGui::BeginChild("results table", ImVec2(larguraTabela, 0));
+    if (ImGui::BeginTable("results", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Page");
+        ImGui::TableSetupColumn("Template");
+        ImGui::TableSetupColumn("Questions");
+        ImGui::TableSetupColumn("Doubtful");
+        ImGui::TableSetupColumn("Min Conf.");
+        ImGui::TableSetupColumn("Status");
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(liveResults.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                const ResultadoParcialPagina& resultado = liveResults[i];
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::PushID(i);
+                if (ImGui::Selectable(resultado.fileName.c_str(), selectedLiveResult == i, ImGuiSelectableFlags_SpanAllColumns)) {
+                    // A página que deixa de ser selecionada perde a miniatura se já não estiver entre as recentes
+                    if (selectedLiveResult >= 0 && selectedLiveResult < static_cast<int>(liveResults.size()) - MINIATURAS_AO_VIVO) {
+                        liveResults[selectedLiveResult].miniatura.release();
+                    }
+                    selectedLiveResult = i;
+                }
+                ImGui::PopID();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(resultado.modelo.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", resultado.questoes);
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", resultado.duvidosas);
+                ImGui::TableNextColumn();
+                if (resultado.questoes > 0) ImGui::Text("%.2f", resultado.confiancaMinima);
+                ImGui::TableNextColumn();
+                if (resultado.ignorada) {
+                    ImGui::TextDisabled("skipped: %s", resultado.motivo.c_str());
+                }
+                else if (!resultado.alinhada) {
+                    ImGui::TextColored(corErro, "alignment failed");
+                }
+                else if (resultado.duvidosas > 0 || resultado.anuladas > 0) {
+                    ImGui::TextColored(corAlerta, "review (%d void)", resultado.anuladas);
+                }
+                else {
+                    ImGui::TextUnformatted("ok");
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+    ImGui::EndChild();
+    ImGui::SameLine();
+
+    ImGui::BeginChild("results page");
+    if (selectedLiveResult >= 0 && selectedLiveResult < static_cast<int>(liveResults.size())) {
+        const ResultadoParcialPagina& resultado = liveResults[selectedLiveResult];
+        // A textura é criada só quando a seleção muda
+        if (liveThumbnailIndex != selectedLiveResult) {
+            if (liveThumbnailTexture) {
+                glDeleteTextures(1, &liveThumbnailTexture);
+                liveThumbnailTexture = 0;
+            }
+            if (!resultado.miniatura.empty()) {
+                liveThumbnailTexture = createTextureFromRGBA(resultado.miniatura);
+            }
+            liveThumbnailIndex = selectedLiveResult;
+        }
+
+        if (liveThumbnailTexture) {
+            ImVec2 avail = ImGui::GetContentRegionAvail();
+            float aspectRatio = static_cast<float>(resultado.miniatura.rows) / resultado.miniatura.cols;
+            ImVec2 size(avail.x, avail.x * aspectRatio);
+            ImGui::Image(reinterpret_cast<void*>(static_cast<intptr_t>(liveThumbnailTexture)), size);
+
+            if (showLiveMarks) {
+                ImVec2 origin = ImGui::GetItemRectMin();
+                ImDrawList* draw_list = ImGui::GetWindowDrawList();
+                for (const auto& marca : resultado.marcas) {
+                    ImU32 color = marca.confianca < progressoLeitura.limiarDuvida ? IM_COL32(255, 140, 0, 255) : IM_COL32(0, 200, 0, 255);
+                    draw_list->AddRect(ImVec2(origin.x + marca.celula.x * size.x, origin.y + marca.celula.y * size.y),
+                        ImVec2(origin.x + marca.celula.z * size.x, origin.y + marca.celula.w * size.y), color, 0.0f, 0, 2.0f);
+                }
+            }
+        }
+        else if (selectedLiveResult < static_cast<int>(liveResults.size()) - MINIATURAS_AO_VIVO && !resultado.ignorada) {
+            ImGui::Text("Thumbnails are kept only for the last %d pages.", MINIATURAS_AO_VIVO);
+        }
+        else {
+            ImGui::Text("No image for this page.");
+        }
+    }
+    ImGui::EndChild();
+
+    ImGui::End();
+}
+
+void Application::renderFrameStatsWindow(bool* p_open) {
+    if (!ImGui::Begin("Frame Stats", p_open)) {
+        ImGui::End();
+        return;
+    }
+
+    // Média e pior quadro do histórico (só as posições já preenchidas)
+    int preenchidos = static_cast<int>(std::min<long long>(frameStats.desenhados, HISTORICO_QUADROS));
+    float soma = 0.0f, maximo = 0.0f;
+    for (int i = 0; i < preenchidos; i++) {
+        soma += frameStats.milissegundos[i];
+        maximo = std::max(maximo, frameStats.milissegundos[i]);
+    }
+    float media = preenchidos > 0 ? soma / preenchidos : 0.0f;
+
+    ImGui::Text("CPU per frame: %.2f ms avg, %.2f ms max (last %d frames)", media, maximo, preenchidos);
+    ImGui::Text("Frames drawn: %lld (%.1f/s)", frameStats.desenhados, frameStats.quadrosPorSegundo);
+    ImGui::Text("Wake-ups: %lld input, %lld logs/results, %lld timeout",
+        frameStats.acordouPorEntrada, frameStats.acordouPorNovidades, frameStats.acordouPorTempo);
+    ImGui::PlotLines("##frame times", frameStats.milissegundos, HISTORICO_QUADROS, frameStats.proximo,
+        nullptr, 0.0f, std::max(maximo, 16.7f), ImVec2(-1, 80));
+
+    ImGui::End();
+}
+
 void Application::saveRectanglesToFile(const std::string& filename) {
     std::ofstream outFile(filename);
     if (!outFile) {
@@ -587,7 +1276,10 @@ void Application::saveRectanglesToFile(const std::string& filename) {
             << rectData.subdivisions.second << " "
             << rectData.analyzeVertical << " "
             << rectData.isWord << " "
-            << rectData.isNumber << "\n";
+            << rectData.isNumber << " "
+            << static_cast<int>(rectData.ocrSegmentation) << " "
+            << static_cast<int>(rectData.ocrEngine) << " "
+            << static_cast<int>(rectData.numberRecognizer) << "\n";
     }
 
     outFile.close();
@@ -607,6 +1299,8 @@ void Application::loadRectanglesFromFile(const std::string& filename) {
     }
 
     rectangles.clear();
+    selectedRectangle = -1;
+    markRectanglesChanged();
     std::string name;
     float x, y, z, w;
     int lines, columns;
@@ -615,8 +1309,10 @@ void Application::loadRectanglesFromFile(const std::string& filename) {
     bool isNumber;
     while (std::getline(inFile, name, '|')) { // Usa '|' como delimitador para o nome
         inFile >> x >> y >> z >> w >> lines >> columns >> analyzeVertical >> isWord >> isNumber;
-        inFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Ignora o resto da linha
-        rectangles.push_back({ ImVec4(x, y, z, w), {lines, columns}, name, analyzeVertical, isWord, isNumber });
+        std::string restoDaLinha;
+        std::getline(inFile, restoDaLinha); // Campos opcionais do perfil de OCR
+        rectangles.push_back({ {x, y, z, w}, {lines, columns}, name, analyzeVertical, isWord, isNumber });
+        lerPerfilOcr(restoDaLinha, rectangles.back());
     }
 
     inFile.close();
@@ -628,3 +1324,14 @@ void Application::loadRectanglesFromFile(const std::string& filename) {
     }
 }
 
+void Application::markRectanglesChanged() {
+    rectangleIndexDirty = true;
+    rectangleGeometryDirty = true;
+}
+
+void Application::updateRectangleIndex() {
+    if (rectangleIndexDirty) {
+        rectangleIndex.reconstruir(rectangles);
+        rectangleIndexDirty = false;
+    }
+}
@@ -0,0 +1,291 @@
+#include "BatchReader.h"
+#include "MeasurementStore.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+// Mesmos nomes, grades, orientao e isNumber, regio por regio. O nome entra na comparao porque as
+// medies do grupo saem com os nomes da primeira pgina: modelos diferentes com a mesma grade no se misturam.
+bool mesmaEstrutura(const std::vector<RectangleData>& a, const std::vector<RectangleData>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].name != b[i].name || a[i].subdivisions != b[i].subdivisions || a[i].analyzeVertical != b[i].analyzeVertical ||
+            a[i].isNumber != b[i].isNumber) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Estrutura de uma regio, comum s pginas do grupo
+struct RegiaoLote {
+    int alternativas = 0;
+    int escolhas = 0;
+    int primeiraCelula = 0;  // Clula (alternativa 0, escolha 0) na lista de clulas do grupo
+    bool vertical = false;
+    bool isNumber = false;
+};
+
+// Geometria das regies nas pginas do grupo, um vetor por campo, [regio * pginas + pgina]
+struct GeometriaLote {
+    std::vector<int> x, y, larguraCelula, alturaCelula;
+    std::vector<uint8_t> inteira;  // Todas as ROIs da regio dentro da pgina: a contagem no checa os limites
+
+    void redimensionar(size_t tamanho) {
+        x.assign(tamanho, 0);
+        y.assign(tamanho, 0);
+        larguraCelula.assign(tamanho, 0);
+        alturaCelula.assign(tamanho, 0);
+        inteira.assign(tamanho, 0);
+    }
+};
+
+// ROI de uma clula, com as mesmas contas de lerRespostas
+inline cv::Rect roiCelula(const RegiaoLote& regiao, const GeometriaLote& geometria, size_t indice, int alt, int choice, const ParametrosLeitura& parametros) {
+    int cellWidth = geometria.larguraCelula[indice];
+    int cellHeight = geometria.alturaCelula[indice];
+    int subX = geometria.x[indice] + (regiao.vertical ? 0 : alt * cellWidth);
+    int subY = geometria.y[indice] + (regiao.vertical ? alt * cellHeight : 0);
+    int roiX = subX + (regiao.vertical ? choice * cellWidth : 0) + parametros.marginX + parametros.offsetX;
+    int roiY = subY + (regiao.vertical ? 0 : choice * cellHeight) + parametros.marginY + parametros.offsetY;
+    return cv::Rect(roiX, roiY, cellWidth - 2 * parametros.marginX, cellHeight - 2 * parametros.marginY);
+}
+
+inline bool dentroDaPagina(const cv::Rect& roi, const PaginaBits& pagina) {
+    return roi.x >= 0 && roi.y >= 0 && roi.x + roi.width <= pagina.largura && roi.y + roi.height <= pagina.altura;
+}
+
+// Tinta de uma ROI dentro da pgina. Palavras  quantas palavras de 64 bits a ROI ocupa em cada linha
+// (1 ou 2 nas bolhas at uns 600 DPI, com as mscaras calculadas uma vez); 0 = qualquer quantidade
+template <int Palavras>
+int contarRoi(const PaginaBits& pagina, const cv::Rect& roi) {
+    if (Palavras == 0) return pagina.contarTinta(roi);
+
+    int ultimoX = roi.x + roi.width - 1;
+    int primeira = roi.x >> 6;
+    uint64_t mascaraInicio = ~0ull << (roi.x & 63);
+    uint64_t mascaraFim = ~0ull >> (63 - (ultimoX & 63));
+
+    int total = 0;
+    for (int y = roi.y; y < roi.y + roi.height; y++) {
+        const uint64_t* palavras = pagina.linha(y) + primeira;
+        if (Palavras == 1) {
+            total += contarBits(palavras[0] & mascaraInicio & mascaraFim);
+        }
+        else {
+            total += contarBits(palavras[0] & mascaraInicio) + contarBits(palavras[1] & mascaraFim);
+        }
+    }
+    return total;
+}
+
+int contarRoiDentro(const PaginaBits& pagina, const cv::Rect& roi) {
+    if (roi.width <= 0 || roi.height <= 0) return 0;
+    int palavras = ((roi.x + roi.width - 1) >> 6) - (roi.x >> 6) + 1;
+    if (palavras == 1) return contarRoi<1>(pagina, roi);
+    if (palavras == 2) return contarRoi<2>(pagina, roi);
+    return contarRoi<0>(pagina, roi);
+}
+
+// Decide as questes de uma regio em todas as pginas do grupo. Escolhas = 0: qualquer nmero, com a tinta em um vetor
+template <int Escolhas>
+void decidirRegiao(const RegiaoLote& regiao, size_t indiceRegiao, const GeometriaLote& geometria, const std::vector<int>& tinta,
+    const std::vector<int>& indices, const ParametrosLeitura& parametros, std::vector<std::vector<LeituraQuestao>>& leituras) {
+    size_t numPaginas = indices.size();
+    std::array<int, (Escolhas > 0 ? Escolhas : 1)> fixo{};
+    std::vector<int> variavel(Escolhas == 0 ? regiao.escolhas : 0);
+    int* valores = Escolhas > 0 ? fixo.data() : variavel.data();
+
+    for (int alt = 0; alt < regiao.alternativas; ++alt) {
+        size_t celula = static_cast<size_t>(regiao.primeiraCelula) + static_cast<size_t>(alt) * regiao.escolhas;
+        for (size_t p = 0; p < numPaginas; p++) {
+            size_t indice = indiceRegiao * numPaginas + p;
+            int areaRoi = (geometria.larguraCelula[indice] - 2 * parametros.marginX) * (geometria.alturaCelula[indice] - 2 * parametros.marginY);
+            for (int choice = 0; choice < regiao.escolhas; ++choice) {
+                valores[choice] = tinta[(celula + choice) * numPaginas + p];
+            }
+            leituras[indices[p]].push_back(decidirQuestaoTinta<Escolhas>(valores, regiao.escolhas, areaRoi, regiao.isNumber, parametros));
+        }
+    }
+}
+
+// L as pginas indices (todas com a estrutura de regies da primeira)
+void lerGrupo(Logger& logger, const std::vector<PaginaLote>& paginas, const std::vector<int>& indices, const ParametrosLeitura& parametros,
+    std::vector<std::vector<LeituraQuestao>>& leituras) {
+    const std::vector<RectangleData>& estrutura = *paginas[indices[0]].regioes;
+    size_t numPaginas = indices.size();
+
+    std::vector<RegiaoLote> regioes(estrutura.size());
+    int numCelulas = 0;
+    int numQuestoes = 0;
+    for (size_t r = 0; r < estrutura.size(); r++) {
+        const RectangleData& rectData = estrutura[r];
+        RegiaoLote& regiao = regioes[r];
+        regiao.vertical = rectData.analyzeVertical;
+        regiao.isNumber = rectData.isNumber;
+        regiao.alternativas = rectData.analyzeVertical ? rectData.subdivisions.first : rectData.subdivisions.second;
+        regiao.escolhas = rectData.analyzeVertical ? rectData.subdivisions.second : rectData.subdivisions.first;
+        regiao.primeiraCelula = numCelulas;
+        numCelulas += std::max(regiao.alternativas, 0) * std::max(regiao.escolhas, 0);
+        numQuestoes += std::max(regiao.alternativas, 0);
+    }
+
+    // Geometria de cada regio em cada pgina, com as coordenadas (j registradas) da prpria pgina
+    GeometriaLote geometria;
+    geometria.redimensionar(regioes.size() * numPaginas);
+    for (size_t r = 0; r < regioes.size(); r++) {
+        for (size_t p = 0; p < numPaginas; p++) {
+            const PaginaLote& paginaLote = paginas[indices[p]];
+            const RectangleData& rectData = (*paginaLote.regioes)[r];
+            cv::Size tamanhoImagem = paginaLote.pagina->tamanho();
+            size_t indice = r * numPaginas + p;
+
+            geometria.x[indice] = static_cast<int>(rectData.coordinates.x * tamanhoImagem.width);
+            geometria.y[indice] = static_cast<int>(rectData.coordinates.y * tamanhoImagem.height);
+            int width = static_cast<int>((rectData.coordinates.z - rectData.coordinates.x) * tamanhoImagem.width);
+            int height = static_cast<int>((rectData.coordinates.w - rectData.coordinates.y) * tamanhoImagem.height);
+            geometria.larguraCelula[indice] = width / rectData.subdivisions.second;
+            geometria.alturaCelula[indice] = height / rectData.subdivisions.first;
+
+            // A primeira e a ltima ROI so os cantos da regio
+            const RegiaoLote& regiao = regioes[r];
+            if (regiao.alternativas > 0 && regiao.escolhas > 0) {
+                cv::Rect primeira = roiCelula(regiao, geometria, indice, 0, 0, parametros);
+                cv::Rect ultima = roiCelula(regiao, geometria, indice, regiao.alternativas - 1, regiao.escolhas - 1, parametros);
+                geometria.inteira[indice] = primeira.width > 0 && primeira.height > 0
+                    && dentroDaPagina(primeira, *paginaLote.pagina) && dentroDaPagina(ultima, *paginaLote.pagina);
+            }
+        }
+    }
+
+    // A contagem de cada pgina vai para um bloco contguo, [pgina * clulas + clula], para que threads
+    // diferentes no escrevam na mesma linha de cache; a transposio para [clula * pginas + pgina] vem depois
+    std::vector<int> tintaPorPagina(static_cast<size_t>(numCelulas) * numPaginas, 0);
+    std::vector<uint8_t> dentroPorPagina(tintaPorPagina.size(), 0);
+    ThreadPool::global().parallelFor(static_cast<int>(numPaginas), [&](int p, int) {
+        const PaginaBits& pagina = *paginas[indices[p]].pagina;
+        int* tintaPagina = tintaPorPagina.data() + static_cast<size_t>(p) * numCelulas;
+        uint8_t* dentroPagina = dentroPorPagina.data() + static_cast<size_t>(p) * numCelulas;
+        for (size_t r = 0; r < regioes.size(); r++) {
+            const RegiaoLote& regiao = regioes[r];
+            size_t indice = r * numPaginas + p;
+            bool inteira = geometria.inteira[indice] != 0;
+            for (int alt = 0; alt < regiao.alternativas; ++alt) {
+                for (int choice = 0; choice < regiao.escolhas; ++choice) {
+                    size_t celula = static_cast<size_t>(regiao.primeiraCelula) + static_cast<size_t>(alt) * regiao.escolhas + choice;
+                    cv::Rect roi = roiCelula(regiao, geometria, indice, alt, choice, parametros);
+                    if (inteira || dentroDaPagina(roi, pagina)) {
+                        tintaPagina[celula] = contarRoiDentro(pagina, roi);
+                        dentroPagina[celula] = 1;
+                    }
+                }
+            }
+        }
+    });
+
+    std::vector<int> tinta(tintaPorPagina.size());
+    std::vector<uint8_t> dentro(tinta.size());
+    for (size_t p = 0; p < numPaginas; p++) {
+        for (size_t celula = 0; celula < static_cast<size_t>(numCelulas); celula++) {
+            tinta[celula * numPaginas + p] = tintaPorPagina[p * numCelulas + celula];
+            dentro[celula * numPaginas + p] = dentroPorPagina[p * numCelulas + celula];
+        }
+    }
+
+    // Os avisos saem na ordem das pginas, como na leitura pgina a pgina
+    for (size_t p = 0; p < numPaginas; p++) {
+        for (size_t r = 0; r < regioes.size(); r++) {
+            const RegiaoLote& regiao = regioes[r];
+            size_t indice = r * numPaginas + p;
+            if (geometria.inteira[indice]) continue;
+            for (int alt = 0; alt < regiao.alternativas; ++alt) {
+                for (int choice = 0; choice < regiao.escolhas; ++choice) {
+                    size_t celula = static_cast<size_t>(regiao.primeiraCelula) + static_cast<size_t>(alt) * regiao.escolhas + choice;
+                    if (dentro[celula * numPaginas + p]) continue;
+                    cv::Rect roi = roiCelula(regiao, geometria, indice, alt, choice, parametros);
+                    logger.AddLogMessage(LogLevel::Warning, "ROI fora dos limites: (" + std::to_string(roi.x) + ", " + std::to_string(roi.y) + ")");
+                }
+            }
+        }
+    }
+
+    for (int indicePagina : indices) {
+        leituras[indicePagina].reserve(numQuestoes);
+    }
+    for (size_t r = 0; r < regioes.size(); r++) {
+        switch (regioes[r].escolhas) {
+        case 2: decidirRegiao<2>(regioes[r], r, geometria, tinta, indices, parametros, leituras); break;
+        case 3: decidirRegiao<3>(regioes[r], r, geometria, tinta, indices, parametros, leituras); break;
+        case 4: decidirRegiao<4>(regioes[r], r, geometria, tinta, indices, parametros, leituras); break;
+        case 5: decidirRegiao<5>(regioes[r], r, geometria, tinta, indices, parametros, leituras); break;
+        case 10: decidirRegiao<10>(regioes[r], r, geometria, tinta, indices, parametros, leituras); break;
+        default: decidirRegiao<0>(regioes[r], r, geometria, tinta, indices, parametros, leituras); break;
+        }
+    }
+
+    // Medies, no mesmo formato da leitura pgina a pgina
+    for (size_t p = 0; p < numPaginas; p++) {
+        MedicoesPagina* medicoes = paginas[indices[p]].medicoes;
+        if (medicoes == nullptr) continue;
+        const PaginaBits& pagina = *paginas[indices[p]].pagina;
+        medicoes->regioes.clear();
+        medicoes->questoes.clear();
+        for (size_t r = 0; r < regioes.size(); r++) {
+            const RectangleData& rectData = estrutura[r];
+            const RegiaoLote& regiao = regioes[r];
+            size_t indice = r * numPaginas + p;
+            int cellWidth = geometria.larguraCelula[indice];
+            int cellHeight = geometria.alturaCelula[indice];
+            medicoes->regioes.push_back({ rectData.name, rectData.subdivisions, rectData.analyzeVertical, rectData.isNumber });
+
+            for (int alt = 0; alt < regiao.alternativas; ++alt) {
+                medicoes->questoes.emplace_back();
+                MedicaoQuestao& medicao = medicoes->questoes.back();
+                medicao.regiao = static_cast<int>(medicoes->regioes.size()) - 1;
+                medicao.escala = static_cast<float>(parametros.escala);
+                medicao.larguraJanela = static_cast<uint16_t>(std::max(cellWidth, 0));
+                medicao.alturaJanela = static_cast<uint16_t>(std::max(cellHeight, 0));
+                medicao.margemX = static_cast<uint16_t>(std::max(parametros.marginX, 0));
+                medicao.margemY = static_cast<uint16_t>(std::max(parametros.marginY, 0));
+                medicao.celulas.resize(regiao.escolhas);
+                for (int choice = 0; choice < regiao.escolhas; ++choice) {
+                    size_t celula = static_cast<size_t>(regiao.primeiraCelula) + static_cast<size_t>(alt) * regiao.escolhas + choice;
+                    CelulaMedida& celulaMedida = medicao.celulas[choice];
+                    celulaMedida.tinta = static_cast<uint32_t>(tinta[celula * numPaginas + p]);
+                    celulaMedida.dentro = dentro[celula * numPaginas + p] != 0;
+                    cv::Rect roi = roiCelula(regiao, geometria, indice, alt, choice, parametros);
+                    medirPerfilCelula(pagina, cv::Rect(roi.x - parametros.marginX, roi.y - parametros.marginY, cellWidth, cellHeight), celulaMedida);
+                }
+            }
+        }
+    }
+}
+
+}  // namespace
+
+std::vector<std::vector<LeituraQuestao>> lerRespostasEmLote(Logger& logger, const std::vector<PaginaLote>& paginas, const ParametrosLeitura& parametros) {
+    std::vector<std::vector<LeituraQuestao>> leituras(paginas.size());
+
+    // Grupos de pginas com a mesma estrutura (em geral um por modelo), na ordem da primeira pgina de cada um
+    std::vector<std::vector<int>> grupos;
+    for (size_t i = 0; i < paginas.size(); i++) {
+        if (paginas[i].pagina == nullptr || paginas[i].regioes == nullptr || paginas[i].pagina->vazia()) continue;
+        auto grupo = std::find_if(grupos.begin(), grupos.end(), [&](const std::vector<int>& g) {
+            return mesmaEstrutura(*paginas[g.front()].regioes, *paginas[i].regioes);
+        });
+        if (grupo == grupos.end()) {
+            grupos.push_back({ static_cast<int>(i) });
+        }
+        else {
+            grupo->push_back(static_cast<int>(i));
+        }
+    }
+
+    for (const auto& grupo : grupos) {
+        lerGrupo(logger, paginas, grupo, parametros, leituras);
+    }
+    return leituras;
+}
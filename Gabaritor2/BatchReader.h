@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ImageProcessing.h"
+#include "PackedPage.h"
+
+// Leitura das marcaes de vrias pginas de uma vez. Em vez de percorrer regio por regio de cada
+// pgina (readAnswersWithConfidence), a geometria e a tinta de cada clula ficam em vetores separados
+// por campo, indexados por [clula * pginas + pgina]: a contagem percorre as clulas de uma pgina
+// em sequncia e a deciso percorre a mesma questo de todas as pginas com os valores lado a lado.
+//
+// A deciso (decidirQuestaoTinta, a mesma de decidirQuestao)  especializada pelo nmero de escolhas das
+// grades mais comuns (2, 3, 4, 5 e 10), com a tinta em um std::array na pilha. As contagens e as decises so as
+// mesmas da leitura pgina a pgina, inclusive nas ROIs fora da pgina.
+
+// Tamanho dos lotes da leitura das pastas: memria de TAMANHO_LOTE_LEITURA pginas empacotadas
+// (cerca de 1 MB cada a 300 DPI)
+const int TAMANHO_LOTE_LEITURA = 32;
+
+struct PaginaLote {
+    const PaginaBits* pagina = nullptr;
+    const std::vector<RectangleData>* regioes = nullptr;  // J registradas para a pgina
+    MedicoesPagina* medicoes = nullptr;                   // Opcional, como em readAnswersWithConfidence
+};
+
+// Uma lista de leituras por pgina, na ordem de paginas. As pginas so agrupadas pela estrutura das
+// regies (grades, orientao e isNumber iguais; as coordenadas podem variar por pgina) e cada grupo
+//  lido junto. Pginas vazias ficam sem leituras.
+std::vector<std::vector<LeituraQuestao>> lerRespostasEmLote(Logger& logger, const std::vector<PaginaLote>& paginas, const ParametrosLeitura& parametros);
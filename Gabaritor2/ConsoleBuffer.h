@@ -6,13 +6,9 @@
 #include <sstream>
 #include <mutex>
 #include <queue>
+#include <functional>
 #include <imgui.h>
-
-enum class LogLevel {
-    Info,
-    Warning,
-    Error
-};
+#include "Logger.h"
 
 struct LogEntry {
     std::string message;
@@ -25,14 +21,23 @@ struct LogMessage {
     LogLevel level;
 };
 
-class ConsoleBuffer {
+class ConsoleBuffer : public Logger {
 public:
     ConsoleBuffer() {}
 
     // Funo thread-safe para adicionar mensagens  fila
-    void AddLogMessage(LogLevel level, const std::string& message) {
-        std::lock_guard<std::mutex> lock(logMutex);
-        logQueue.push(LogEntry{ message, level });
+    void AddLogMessage(LogLevel level, const std::string& message) override {
+        {
+            std::lock_guard<std::mutex> lock(logMutex);
+            logQueue.push(LogEntry{ message, level });
+        }
+        if (onMessage) onMessage();
+    }
+
+    // Chamado (na thread que registrou a mensagem) depois de cada mensagem; a interface usa para
+    // acordar o loop de eventos. Definir antes de iniciar as threads que registram mensagens.
+    void SetOnMessage(std::function<void()> callback) {
+        onMessage = std::move(callback);
     }
 
     void Draw(const char* title) {
@@ -60,6 +65,7 @@ private:
     std::vector<LogEntry> logs;
     std::queue<LogEntry> logQueue;
     std::mutex logMutex;
+    std::function<void()> onMessage;
 
     // Processa a fila de logs
     void ProcessLogs() {
@@ -0,0 +1,241 @@
+#include "CpuBudget.h"
+#include "ThreadPool.h"
+#include "ImageWriter.h"
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
+
+static OrcamentoCpu orcamentoAplicado;
+
+const OrcamentoCpu& orcamentoCpu() {
+    return orcamentoAplicado;
+}
+
+bool carregarOrcamentoCpu(Logger& logger, const std::string& caminho, OrcamentoCpu& orcamento) {
+    std::ifstream arquivo(caminho);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "No foi possvel abrir o arquivo do oramento de CPU: " + caminho);
+        return false;
+    }
+
+    std::map<std::string, std::string> valores;
+    std::string linha;
+    while (std::getline(arquivo, linha)) {
+        if (!linha.empty() && linha.back() == '\r') linha.pop_back();
+        if (linha.empty() || linha[0] == '#') continue;
+        size_t pos = linha.find('=');
+        if (pos != std::string::npos) {
+            valores[linha.substr(0, pos)] = linha.substr(pos + 1);
+        }
+    }
+
+    OrcamentoCpu lido = orcamento;
+    auto lerInteiro = [&](const char* chave, int& destino) {
+        if (valores.count(chave)) destino = std::atoi(valores[chave].c_str());
+    };
+    lerInteiro("nucleos", lido.nucleos);
+    lerInteiro("threads_pool", lido.threadsPool);
+    lerInteiro("threads_opencv", lido.threadsOpenCv);
+    lerInteiro("threads_ocr", lido.threadsOcr);
+    lerInteiro("threads_gravacao", lido.threadsGravacao);
+    lerInteiro("primeiro_nucleo", lido.primeiroNucleo);
+
+    bool valido = lido.nucleos >= 0 && lido.threadsPool >= 0 && lido.threadsOpenCv >= 0 && lido.threadsOcr >= 1
+        && lido.threadsGravacao >= 1 && lido.primeiroNucleo >= -1;
+    if (!valido) {
+        logger.AddLogMessage(LogLevel::Warning, "Oramento de CPU fora da faixa em " + caminho + "; mantidos os valores anteriores.");
+        return false;
+    }
+    orcamento = lido;
+    return true;
+}
+
+bool salvarOrcamentoCpu(const std::string& caminho, const OrcamentoCpu& orcamento) {
+    std::ofstream arquivo(caminho, std::ios::trunc);
+    if (!arquivo.is_open()) return false;
+    arquivo << "nucleos=" << orcamento.nucleos << "\n"
+        << "threads_pool=" << orcamento.threadsPool << "\n"
+        << "threads_opencv=" << orcamento.threadsOpenCv << "\n"
+        << "threads_ocr=" << orcamento.threadsOcr << "\n"
+        << "threads_gravacao=" << orcamento.threadsGravacao << "\n"
+        << "primeiro_nucleo=" << orcamento.primeiroNucleo << "\n";
+    return static_cast<bool>(arquivo);
+}
+
+OrcamentoCpu dividirOrcamentoCpu(const OrcamentoCpu& orcamento, int processos) {
+    processos = std::max(1, processos);
+    int nucleos = orcamento.nucleos > 0 ? orcamento.nucleos : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    OrcamentoCpu parte = orcamento;
+    parte.nucleos = std::max(1, nucleos / processos);
+    // Contagens explcitas (ou j efetivas) viram a frao proporcional aos ncleos de cada processo;
+    // zeros continuam zero e cada processo calcula o padro a partir dos prprios ncleos
+    auto escalar = [&](int threads) { return threads > 0 ? std::max(1, threads * parte.nucleos / nucleos) : 0; };
+    parte.threadsPool = escalar(orcamento.threadsPool);
+    parte.threadsOpenCv = escalar(orcamento.threadsOpenCv);
+    parte.threadsGravacao = escalar(orcamento.threadsGravacao);
+    parte.primeiroNucleo = -1;
+    return parte;
+}
+
+// Nmero de threads OpenMP das prximas regies paralelas abertas pela thread atual
+static bool limitarOpenMpNaThread(int threads) {
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+    return true;
+#else
+    (void)threads;
+    return false;
+#endif
+}
+
+// Fixa a thread atual nos ncleos [primeiro, primeiro + quantidade). Com processo, as threads criadas
+// depois tambm ficam no intervalo (no Windows a mscara passa a ser a do processo; no Linux elas a herdam)
+static bool fixarNucleos(int primeiro, int quantidade, bool processo) {
+#ifdef _WIN32
+    if (primeiro + quantidade > 64) return false;  // S o primeiro grupo de processadores
+    DWORD_PTR mascara = 0;
+    for (int n = primeiro; n < primeiro + quantidade; n++) mascara |= static_cast<DWORD_PTR>(1) << n;
+    if (processo) return SetProcessAffinityMask(GetCurrentProcess(), mascara) != 0;
+    return SetThreadAffinityMask(GetCurrentThread(), mascara) != 0;
+#elif defined(__linux__)
+    cpu_set_t nucleos;
+    CPU_ZERO(&nucleos);
+    for (int n = primeiro; n < primeiro + quantidade; n++) CPU_SET(n, &nucleos);
+    (void)processo;
+    return pthread_setaffinity_np(pthread_self(), sizeof(nucleos), &nucleos) == 0;
+#else
+    (void)primeiro;
+    (void)quantidade;
+    (void)processo;
+    return false;
+#endif
+}
+
+// Limite das threads OpenMP do Tesseract. O runtime s l OMP_THREAD_LIMIT quando inicia, o que pode j ter
+// acontecido (ou nem ser o mesmo ambiente, com a varivel vinda do lanador); por isso, com OpenMP na
+// compilao, o nmero de threads tambm  definido em cada thread que chama o Tesseract. Retorna se foi.
+static bool definirLimiteOpenMp(int threads) {
+    std::string valor = std::to_string(threads);
+#ifdef _WIN32
+    _putenv_s("OMP_THREAD_LIMIT", valor.c_str());
+#else
+    setenv("OMP_THREAD_LIMIT", valor.c_str(), 1);
+#endif
+    return limitarOpenMpNaThread(threads);
+}
+
+void aplicarOrcamentoCpu(Logger& logger, const OrcamentoCpu& orcamento) {
+    int maquina = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    OrcamentoCpu efetivo = orcamento;
+    efetivo.nucleos = efetivo.nucleos > 0 ? std::min(efetivo.nucleos, maquina) : maquina;
+    if (efetivo.threadsPool <= 0) efetivo.threadsPool = std::max(1, efetivo.nucleos - 1);
+    if (efetivo.threadsOpenCv <= 0) efetivo.threadsOpenCv = efetivo.nucleos;
+    efetivo.threadsOcr = std::max(1, efetivo.threadsOcr);
+    efetivo.threadsGravacao = std::max(1, efetivo.threadsGravacao);
+
+    if (efetivo.primeiroNucleo >= 0 && efetivo.primeiroNucleo + efetivo.nucleos > maquina) {
+        logger.AddLogMessage(LogLevel::Warning, "Ncleos " + std::to_string(efetivo.primeiroNucleo) + " a "
+            + std::to_string(efetivo.primeiroNucleo + efetivo.nucleos - 1) + " no existem nesta mquina; threads sem ncleos fixos.");
+        efetivo.primeiroNucleo = -1;
+    }
+    // O processo vai para o intervalo antes de as outras threads serem criadas
+    if (efetivo.primeiroNucleo >= 0 && !fixarNucleos(efetivo.primeiroNucleo, efetivo.nucleos, true)) {
+        logger.AddLogMessage(LogLevel::Warning, "No foi possvel fixar os ncleos; threads sem ncleos fixos.");
+        efetivo.primeiroNucleo = -1;
+    }
+
+    cv::setNumThreads(efetivo.threadsOpenCv);
+    // Na thread principal (que tambm executa itens do pool e  a do worker externo)
+    bool openMpPorThread = definirLimiteOpenMp(efetivo.threadsOcr);
+
+    int primeiro = efetivo.primeiroNucleo;
+    int nucleos = efetivo.nucleos;
+    int threadsOcr = efetivo.threadsOcr;
+    auto iniciarWorker = [primeiro, nucleos, threadsOcr](int worker) {
+        if (primeiro >= 0) fixarNucleos(primeiro + worker % nucleos, 1, false);
+        limitarOpenMpNaThread(threadsOcr);
+    };
+    if (!ThreadPool::prepararGlobal(static_cast<unsigned>(efetivo.threadsPool), iniciarWorker)) {
+        logger.AddLogMessage(LogLevel::Warning, "O pool de threads j estava criado; o oramento no muda o nmero de workers.");
+        efetivo.threadsPool = static_cast<int>(ThreadPool::global().size());
+    }
+    if (!GravadorImagens::prepararGlobal(static_cast<unsigned>(efetivo.threadsGravacao))) {
+        logger.AddLogMessage(LogLevel::Warning, "O gravador de imagens j estava criado; o oramento no muda as threads de gravao.");
+        efetivo.threadsGravacao = static_cast<int>(GravadorImagens::global().configuracao().threads);
+    }
+    orcamentoAplicado = efetivo;
+
+    std::string resumo = "Oramento de CPU: " + std::to_string(efetivo.nucleos) + " de " + std::to_string(maquina) + " ncleos, "
+        + std::to_string(efetivo.threadsPool) + " workers no pool, OpenCV " + std::to_string(efetivo.threadsOpenCv)
+        + ", OCR " + std::to_string(efetivo.threadsOcr) + ", gravao " + std::to_string(efetivo.threadsGravacao);
+    if (efetivo.primeiroNucleo >= 0) {
+        resumo += ", ncleos " + std::to_string(efetivo.primeiroNucleo) + " a " + std::to_string(efetivo.primeiroNucleo + efetivo.nucleos - 1);
+    }
+    logger.AddLogMessage(LogLevel::Info, resumo);
+    if (openMpPorThread) {
+        logger.AddLogMessage(LogLevel::Info, "Threads OpenMP do OCR limitadas por omp_set_num_threads em cada worker, na thread principal "
+            "e na thread de processamento da interface.");
+    }
+    else {
+        logger.AddLogMessage(LogLevel::Warning, "Compilado sem OpenMP: o limite das threads do OCR depende de OMP_THREAD_LIMIT=" + std::to_string(efetivo.threadsOcr)
+            + " j estar no ambiente ao iniciar o processo (defina no lanador).");
+    }
+}
+
+void limitarThreadAtual() {
+    limitarOpenMpNaThread(orcamentoAplicado.threadsOcr);
+    if (orcamentoAplicado.primeiroNucleo >= 0) {
+        fixarNucleos(orcamentoAplicado.primeiroNucleo, orcamentoAplicado.nucleos, false);
+    }
+}
+
+double tempoCpuProcessoMs() {
+#ifdef _WIN32
+    FILETIME criacao, saida, kernel, usuario;
+    if (!GetProcessTimes(GetCurrentProcess(), &criacao, &saida, &kernel, &usuario)) return 0.0;
+    auto paraMs = [](const FILETIME& tempo) {
+        ULARGE_INTEGER valor;
+        valor.LowPart = tempo.dwLowDateTime;
+        valor.HighPart = tempo.dwHighDateTime;
+        return valor.QuadPart / 10000.0;  // Unidades de 100 ns
+    };
+    return paraMs(kernel) + paraMs(usuario);
+#else
+    rusage uso;
+    if (getrusage(RUSAGE_SELF, &uso) != 0) return 0.0;
+    return (uso.ru_utime.tv_sec + uso.ru_stime.tv_sec) * 1000.0 + (uso.ru_utime.tv_usec + uso.ru_stime.tv_usec) / 1000.0;
+#endif
+}
+
+MedidorCpu::MedidorCpu() : inicio(std::chrono::steady_clock::now()), cpuInicioMs(tempoCpuProcessoMs()) {
+}
+
+double MedidorCpu::milissegundos() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+double MedidorCpu::cpuMs() const {
+    return tempoCpuProcessoMs() - cpuInicioMs;
+}
+
+double MedidorCpu::utilizacao() const {
+    double parede = milissegundos();
+    int nucleos = orcamentoAplicado.nucleos > 0 ? orcamentoAplicado.nucleos : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    return parede > 0 ? cpuMs() / (parede * nucleos) : 0.0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Logger.h"
+#include <chrono>
+#include <string>
+
+// Oramento de CPU do processo. O pool de threads das etapas (ThreadPool::global), o pool interno do
+// OpenCV, as threads OpenMP do Tesseract e o gravador de imagens se dimensionavam cada um pelo total de
+// ncleos da mquina; rodando juntos, e com vrios lotes no mesmo servidor, disputavam os mesmos
+// ncleos. Agora todos saem daqui, aplicados uma vez no incio do processo.
+//
+// Com primeiroNucleo >= 0 o processo fica nos ncleos [primeiroNucleo, primeiroNucleo + nucleos):
+// as threads que no so do pool (OpenCV, OpenMP, gravador, interface) podem usar qualquer ncleo
+// do intervalo e cada worker do pool fica fixo em um deles. Lotes no mesmo servidor usam intervalos
+// diferentes.
+
+// Arquivo do oramento (na pasta de trabalho), "chave=valor" por linha
+const std::string ARQUIVO_ORCAMENTO_CPU = "orcamento_cpu.txt";
+
+struct OrcamentoCpu {
+    int nucleos = 0;          // Ncleos do processo; 0 = todos os da mquina
+    int threadsPool = 0;      // Workers do ThreadPool::global; 0 = nucleos - 1 (quem chama parallelFor tambm executa)
+    int threadsOpenCv = 0;    // cv::setNumThreads; 0 = nucleos. O alinhamento (warpPerspective) e o filtro bilateral
+                              // dependem do paralelismo interno do OpenCV, que tambm vale dentro dos workers do pool
+    int threadsOcr = 1;       // Threads OpenMP do Tesseract (por thread e OMP_THREAD_LIMIT); as regies de palavra j vo pelo pool
+    int threadsGravacao = 2;  // Threads do GravadorImagens::global
+    int primeiroNucleo = -1;  // >= 0: fixa o processo no intervalo de ncleos (ver acima)
+};
+
+// Chaves ausentes ficam com o valor de orcamento; valores fora da faixa so recusados com um aviso
+bool carregarOrcamentoCpu(Logger& logger, const std::string& caminho, OrcamentoCpu& orcamento);
+
+// Aplica o oramento: OpenCV, OpenMP, tamanho do pool e do gravador e a fixao dos ncleos. Precisa vir
+// antes do primeiro uso do pool e do gravador (e antes de iniciar o Tesseract); o que j foi criado
+// fica como est, com um aviso.
+void aplicarOrcamentoCpu(Logger& logger, const OrcamentoCpu& orcamento);
+
+// Oramento aplicado, com os zeros j trocados pelos valores usados
+const OrcamentoCpu& orcamentoCpu();
+
+// Grava o oramento no formato de carregarOrcamentoCpu
+bool salvarOrcamentoCpu(const std::string& caminho, const OrcamentoCpu& orcamento);
+
+// Parte do oramento de cada um de processos que dividem os mesmos ncleos (os workers locais do
+// coordenador): ncleos e contagens de threads divididos na mesma proporo, sem ncleos fixos
+OrcamentoCpu dividirOrcamentoCpu(const OrcamentoCpu& orcamento, int processos);
+
+// Aplica o limite de threads OpenMP do OCR (e o intervalo de ncleos)  thread atual. O limite do OpenMP
+// vale por thread: threads criadas fora do pool que tambm executam itens do pool e chamam o Tesseract
+// (a thread de processamento da interface) precisam chamar esta funo ao comear.
+void limitarThreadAtual();
+
+// Tempo de CPU do processo (todas as threads, usurio e sistema), em milissegundos
+double tempoCpuProcessoMs();
+
+// Tempo de parede e de CPU desde a criao. A utilizao  a frao dos ncleos do oramento ocupada no
+// intervalo (1 = todos os ncleos o tempo todo); como o tempo de CPU  do processo inteiro, inclui o
+// que outras threads (a interface, o gravador) fizeram ao mesmo tempo.
+class MedidorCpu {
+public:
+    MedidorCpu();
+
+    double milissegundos() const;
+    double cpuMs() const;
+    double utilizacao() const;
+
+private:
+    std::chrono::steady_clock::time_point inicio;
+    double cpuInicioMs;
+};
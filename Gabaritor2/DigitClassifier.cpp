@@ -0,0 +1,293 @@
+#include "DigitClassifier.h"
+#include <fstream>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <mutex>
+#include <opencv2/core/utils/filesystem.hpp>
+
+// Glifos 5x7 dos dgitos, uma string por linha ('#' = tinta)
+static const char* GLIFOS_5X7[10][7] = {
+    { ".###.", "#...#", "#..##", "#.#.#", "##..#", "#...#", ".###." },
+    { "..#..", ".##..", "..#..", "..#..", "..#..", "..#..", ".###." },
+    { ".###.", "#...#", "....#", "...#.", "..#..", ".#...", "#####" },
+    { "#####", "...#.", "..#..", "...#.", "....#", "#...#", ".###." },
+    { "...#.", "..##.", ".#.#.", "#..#.", "#####", "...#.", "...#." },
+    { "#####", "#....", "####.", "....#", "....#", "#...#", ".###." },
+    { "..##.", ".#...", "#....", "####.", "#...#", "#...#", ".###." },
+    { "#####", "....#", "...#.", "..#..", ".#...", ".#...", ".#..." },
+    { ".###.", "#...#", "#...#", ".###.", "#...#", "#...#", ".###." },
+    { ".###.", "#...#", "#...#", ".####", "....#", "...#.", ".##.." },
+};
+
+static const int FONTES_HERSHEY[] = {
+    cv::FONT_HERSHEY_SIMPLEX, cv::FONT_HERSHEY_DUPLEX, cv::FONT_HERSHEY_COMPLEX,
+    cv::FONT_HERSHEY_TRIPLEX, cv::FONT_HERSHEY_SCRIPT_SIMPLEX
+};
+
+static const float INCLINACOES[] = { -0.25f, 0.0f, 0.25f };
+
+static const int TAMANHO_CANVAS = 48;
+
+static const uint32_t MAGICO_MODELO = 0x47444247; // "GBDG"
+static const uint32_t VERSAO_MODELO = 1;
+
+DigitClassifier::DigitClassifier() {
+    gerarPrototiposEmbutidos();
+}
+
+bool DigitClassifier::extrairCaracteristicas(const cv::Mat& caixa, std::vector<float>& caracteristicas) {
+    cv::Mat cinza;
+    if (caixa.channels() == 3) {
+        cv::cvtColor(caixa, cinza, cv::COLOR_BGR2GRAY);
+    }
+    else {
+        cinza = caixa;
+    }
+
+    // A maior parte da caixa  fundo: se o fundo for claro, inverte para a tinta ficar em branco
+    cv::Mat tinta;
+    if (cv::mean(cinza)[0] > 127) {
+        cv::threshold(cinza, tinta, 127, 255, cv::THRESH_BINARY_INV);
+    }
+    else {
+        cv::threshold(cinza, tinta, 127, 255, cv::THRESH_BINARY);
+    }
+
+    int pixelsTinta = cv::countNonZero(tinta);
+    if (pixelsTinta < 4 || pixelsTinta < 0.01 * tinta.rows * tinta.cols) {
+        return false;
+    }
+
+    // Recorta o dgito e escala o lado maior para TAMANHO_DIGITO - 4, mantendo a proporo
+    std::vector<cv::Point> pontos;
+    cv::findNonZero(tinta, pontos);
+    cv::Rect envolvente = cv::boundingRect(pontos);
+    cv::Mat digito = tinta(envolvente);
+
+    int ladoMaximo = TAMANHO_DIGITO - 4;
+    double escala = static_cast<double>(ladoMaximo) / std::max(envolvente.width, envolvente.height);
+    int largura = std::max(1, static_cast<int>(std::lround(envolvente.width * escala)));
+    int altura = std::max(1, static_cast<int>(std::lround(envolvente.height * escala)));
+
+    cv::Mat reduzido;
+    cv::resize(digito, reduzido, cv::Size(largura, altura), 0, 0, cv::INTER_AREA);
+
+    cv::Mat normalizado = cv::Mat::zeros(TAMANHO_DIGITO, TAMANHO_DIGITO, CV_8UC1);
+    reduzido.copyTo(normalizado(cv::Rect((TAMANHO_DIGITO - largura) / 2, (TAMANHO_DIGITO - altura) / 2, largura, altura)));
+
+    caracteristicas.resize(TAMANHO_DIGITO * TAMANHO_DIGITO);
+    double somaQuadrados = 0;
+    for (int y = 0; y < TAMANHO_DIGITO; y++) {
+        const uchar* linha = normalizado.ptr<uchar>(y);
+        for (int x = 0; x < TAMANHO_DIGITO; x++) {
+            float valor = linha[x] / 255.0f;
+            caracteristicas[y * TAMANHO_DIGITO + x] = valor;
+            somaQuadrados += valor * valor;
+        }
+    }
+
+    // Vetor com norma unitria reduz a influncia da espessura do trao
+    float norma = static_cast<float>(std::sqrt(somaQuadrados));
+    for (float& valor : caracteristicas) {
+        valor /= norma;
+    }
+
+    return true;
+}
+
+void DigitClassifier::adicionarAmostra(const cv::Mat& caixa, int digito) {
+    std::vector<float> caracteristicas;
+    if (!extrairCaracteristicas(caixa, caracteristicas)) {
+        return;
+    }
+    amostras.insert(amostras.end(), caracteristicas.begin(), caracteristicas.end());
+    labels.push_back(digito);
+}
+
+void DigitClassifier::gerarPrototiposEmbutidos() {
+    for (int digito = 0; digito < 10; digito++) {
+        std::vector<cv::Mat> glifos;
+
+        // Glifo 5x7 ampliado, fino e engrossado
+        cv::Mat glifo5x7(7, 5, CV_8UC1, cv::Scalar(0));
+        for (int y = 0; y < 7; y++) {
+            for (int x = 0; x < 5; x++) {
+                if (GLIFOS_5X7[digito][y][x] == '#') {
+                    glifo5x7.at<uchar>(y, x) = 255;
+                }
+            }
+        }
+        cv::Mat ampliado;
+        cv::resize(glifo5x7, ampliado, cv::Size(25, 35), 0, 0, cv::INTER_NEAREST);
+        cv::Mat canvas5x7 = cv::Mat::zeros(TAMANHO_CANVAS, TAMANHO_CANVAS, CV_8UC1);
+        ampliado.copyTo(canvas5x7(cv::Rect((TAMANHO_CANVAS - 25) / 2, (TAMANHO_CANVAS - 35) / 2, 25, 35)));
+        glifos.push_back(canvas5x7);
+        cv::Mat engrossado;
+        cv::dilate(canvas5x7, engrossado, cv::Mat::ones(3, 3, CV_8UC1));
+        glifos.push_back(engrossado);
+
+        // Fontes Hershey com espessuras diferentes
+        std::string texto(1, static_cast<char>('0' + digito));
+        for (int fonte : FONTES_HERSHEY) {
+            for (int espessura = 1; espessura <= 3; espessura++) {
+                int baseline = 0;
+                cv::Size tamanhoTexto = cv::getTextSize(texto, fonte, 1.2, espessura, &baseline);
+                cv::Mat canvas = cv::Mat::zeros(TAMANHO_CANVAS, TAMANHO_CANVAS, CV_8UC1);
+                cv::Point origem((TAMANHO_CANVAS - tamanhoTexto.width) / 2, (TAMANHO_CANVAS + tamanhoTexto.height) / 2);
+                cv::putText(canvas, texto, origem, fonte, 1.2, cv::Scalar(255), espessura, cv::LINE_AA);
+                glifos.push_back(canvas);
+            }
+        }
+
+        // Cada glifo entra com algumas inclinaes, como na escrita  mo
+        for (const auto& glifo : glifos) {
+            for (float inclinacao : INCLINACOES) {
+                cv::Mat cisalhamento = (cv::Mat_<double>(2, 3) << 1, inclinacao, -inclinacao * TAMANHO_CANVAS / 2, 0, 1, 0);
+                cv::Mat inclinado;
+                cv::warpAffine(glifo, inclinado, cisalhamento, glifo.size());
+                adicionarAmostra(inclinado, digito);
+            }
+        }
+    }
+
+    numPrototiposEmbutidos = labels.size();
+}
+
+ResultadoDigito DigitClassifier::classificar(const cv::Mat& caixa) const {
+    std::vector<float> caracteristicas;
+    if (!extrairCaracteristicas(caixa, caracteristicas)) {
+        return { ' ', 1.0f };
+    }
+
+    // Menor distncia ao quadrado para cada dgito (vizinho mais prximo por classe)
+    const size_t dimensao = caracteristicas.size();
+    float melhorPorDigito[10];
+    std::fill(melhorPorDigito, melhorPorDigito + 10, std::numeric_limits<float>::max());
+
+    for (size_t i = 0; i < labels.size(); i++) {
+        const float* amostra = &amostras[i * dimensao];
+        float distancia = 0;
+        for (size_t j = 0; j < dimensao; j++) {
+            float diferenca = caracteristicas[j] - amostra[j];
+            distancia += diferenca * diferenca;
+        }
+        if (distancia < melhorPorDigito[labels[i]]) {
+            melhorPorDigito[labels[i]] = distancia;
+        }
+    }
+
+    int melhor = 0;
+    for (int d = 1; d < 10; d++) {
+        if (melhorPorDigito[d] < melhorPorDigito[melhor]) melhor = d;
+    }
+    float segundo = std::numeric_limits<float>::max();
+    for (int d = 0; d < 10; d++) {
+        if (d != melhor && melhorPorDigito[d] < segundo) segundo = melhorPorDigito[d];
+    }
+
+    // Margem entre o dgito escolhido e o segundo colocado
+    float confianca = segundo > 0 ? 1.0f - std::sqrt(melhorPorDigito[melhor]) / std::sqrt(segundo) : 0.0f;
+    return { static_cast<char>('0' + melhor), std::max(0.0f, confianca) };
+}
+
+int DigitClassifier::treinar(const std::string& pastaAmostras) {
+    int lidas = 0;
+    for (int digito = 0; digito < 10; digito++) {
+        std::string pastaDigito = pastaAmostras + "/" + std::to_string(digito);
+        if (!cv::utils::fs::exists(pastaDigito)) {
+            continue;
+        }
+
+        std::vector<cv::String> arquivos;
+        cv::glob(pastaDigito + "/*.png", arquivos, false);
+        for (const auto& arquivo : arquivos) {
+            cv::Mat caixa = cv::imread(arquivo, cv::IMREAD_GRAYSCALE);
+            if (caixa.empty()) {
+                continue;
+            }
+            size_t antes = labels.size();
+            adicionarAmostra(caixa, digito);
+            if (labels.size() > antes) lidas++;
+        }
+    }
+    return lidas;
+}
+
+bool DigitClassifier::salvar(const std::string& arquivoModelo) const {
+    std::ofstream arquivo(arquivoModelo, std::ios::binary);
+    if (!arquivo.is_open()) {
+        return false;
+    }
+
+    const uint32_t dimensao = TAMANHO_DIGITO * TAMANHO_DIGITO;
+    const uint32_t quantidade = static_cast<uint32_t>(numeroAmostrasLocais());
+    arquivo.write(reinterpret_cast<const char*>(&MAGICO_MODELO), sizeof(MAGICO_MODELO));
+    arquivo.write(reinterpret_cast<const char*>(&VERSAO_MODELO), sizeof(VERSAO_MODELO));
+    arquivo.write(reinterpret_cast<const char*>(&dimensao), sizeof(dimensao));
+    arquivo.write(reinterpret_cast<const char*>(&quantidade), sizeof(quantidade));
+
+    for (size_t i = numPrototiposEmbutidos; i < labels.size(); i++) {
+        int32_t label = labels[i];
+        arquivo.write(reinterpret_cast<const char*>(&label), sizeof(label));
+        arquivo.write(reinterpret_cast<const char*>(&amostras[i * dimensao]), dimensao * sizeof(float));
+    }
+
+    return !arquivo.fail();
+}
+
+bool DigitClassifier::carregar(const std::string& arquivoModelo) {
+    std::ifstream arquivo(arquivoModelo, std::ios::binary);
+    if (!arquivo.is_open()) {
+        return false;
+    }
+
+    uint32_t magico = 0, versao = 0, dimensao = 0, quantidade = 0;
+    arquivo.read(reinterpret_cast<char*>(&magico), sizeof(magico));
+    arquivo.read(reinterpret_cast<char*>(&versao), sizeof(versao));
+    arquivo.read(reinterpret_cast<char*>(&dimensao), sizeof(dimensao));
+    arquivo.read(reinterpret_cast<char*>(&quantidade), sizeof(quantidade));
+    if (!arquivo || magico != MAGICO_MODELO || versao != VERSAO_MODELO || dimensao != TAMANHO_DIGITO * TAMANHO_DIGITO) {
+        return false;
+    }
+
+    std::vector<float> novasAmostras(static_cast<size_t>(quantidade) * dimensao);
+    std::vector<int> novosLabels(quantidade);
+    for (uint32_t i = 0; i < quantidade; i++) {
+        int32_t label = 0;
+        arquivo.read(reinterpret_cast<char*>(&label), sizeof(label));
+        arquivo.read(reinterpret_cast<char*>(&novasAmostras[static_cast<size_t>(i) * dimensao]), dimensao * sizeof(float));
+        if (!arquivo || label < 0 || label > 9) {
+            return false;
+        }
+        novosLabels[i] = label;
+    }
+
+    // Substitui as amostras locais atuais pelas do arquivo
+    amostras.resize(numPrototiposEmbutidos * dimensao);
+    labels.resize(numPrototiposEmbutidos);
+    amostras.insert(amostras.end(), novasAmostras.begin(), novasAmostras.end());
+    labels.insert(labels.end(), novosLabels.begin(), novosLabels.end());
+    return true;
+}
+
+static std::mutex mutexClassificador;
+static std::shared_ptr<const DigitClassifier> classificadorAtual;
+
+std::shared_ptr<const DigitClassifier> classificadorDigitos() {
+    std::lock_guard<std::mutex> lock(mutexClassificador);
+    if (!classificadorAtual) {
+        auto classificador = std::make_shared<DigitClassifier>();
+        if (cv::utils::fs::exists(MODELO_DIGITOS_PADRAO)) {
+            classificador->carregar(MODELO_DIGITOS_PADRAO);
+        }
+        classificadorAtual = classificador;
+    }
+    return classificadorAtual;
+}
+
+void substituirClassificadorDigitos(std::shared_ptr<const DigitClassifier> classificador) {
+    std::lock_guard<std::mutex> lock(mutexClassificador);
+    classificadorAtual = std::move(classificador);
+}
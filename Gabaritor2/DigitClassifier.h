@@ -0,0 +1,56 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Lado da imagem normalizada de um dgito (TAMANHO_DIGITO x TAMANHO_DIGITO pixels)
+const int TAMANHO_DIGITO = 16;
+
+// Arquivo de modelo carregado automaticamente, se existir, com as amostras treinadas localmente
+const std::string MODELO_DIGITOS_PADRAO = "digitos.model";
+
+struct ResultadoDigito {
+    char digito;       // '0'..'9', ou ' ' se a caixa estiver vazia
+    float confianca;   // 0 = empate com outro dgito, 1 = sem dvida
+};
+
+// Classificador k-NN de dgitos para caixas de campos numricos (matrcula, etc.).
+// Vem com prottipos embutidos (glifos 5x7 e fontes Hershey com variaes de espessura e
+// inclinao) e aceita amostras locais rotuladas, que podem ser salvas em um arquivo de modelo.
+class DigitClassifier {
+public:
+    DigitClassifier();
+
+    // Classifica a caixa de um dgito. A imagem deve ser binria com a tinta em branco (no zero),
+    // como as imagens de threshold do pipeline.
+    ResultadoDigito classificar(const cv::Mat& caixa) const;
+
+    // Adiciona amostras de uma pasta organizada como <pasta>/<dgito>/*.png. Retorna quantas foram lidas.
+    int treinar(const std::string& pastaAmostras);
+
+    // Salva/carrega somente as amostras locais; os prottipos embutidos so sempre gerados no construtor
+    bool salvar(const std::string& arquivoModelo) const;
+    bool carregar(const std::string& arquivoModelo);
+
+    size_t numeroAmostrasLocais() const { return labels.size() - numPrototiposEmbutidos; }
+
+    // Converte a caixa em um vetor de caractersticas (TAMANHO_DIGITO^2 floats com norma 1).
+    // Retorna false se no houver tinta suficiente.
+    static bool extrairCaracteristicas(const cv::Mat& caixa, std::vector<float>& caracteristicas);
+
+private:
+    void adicionarAmostra(const cv::Mat& caixa, int digito);
+    void gerarPrototiposEmbutidos();
+
+    std::vector<float> amostras;   // Uma linha de TAMANHO_DIGITO^2 floats por amostra
+    std::vector<int> labels;
+    size_t numPrototiposEmbutidos = 0;
+};
+
+// Classificador compartilhado pelo processo (carrega MODELO_DIGITOS_PADRAO na primeira chamada).
+// Nunca  alterado depois de publicado: quem est classificando continua com a instncia que pegou.
+std::shared_ptr<const DigitClassifier> classificadorDigitos();
+// Troca o classificador compartilhado por um j treinado (as prximas chamadas recebem o novo)
+void substituirClassificadorDigitos(std::shared_ptr<const DigitClassifier> classificador);
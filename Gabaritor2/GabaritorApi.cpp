@@ -0,0 +1,167 @@
+#include "GabaritorApi.h"
+#include "PagePipeline.h"
+#include "ThreadPool.h"
+#include <exception>
+#include <mutex>
+
+struct LeitorGabarito::Estado {
+    LoggerNulo loggerNulo;
+    Logger* logger;
+    TemplateRegistry modelos;
+    OcrEnginePool ocrEngines;
+    // Todas as threads de fora do pool usam o mesmo slot e, portanto, as mesmas engines de OCR:
+    // chamadas concorrentes ao leitor (e a troca de modelos) passam uma de cada vez
+    std::mutex chamadasMutex;
+
+    Estado(Logger* logger, const std::string& idiomaOcr)
+        : logger(logger != nullptr ? logger : &loggerNulo), ocrEngines(idiomaOcr) {
+    }
+};
+
+// Embrulha o buffer em um cv::Mat sem copiar os pixels. S RGB/RGBA precisam de converso,
+// porque todas as etapas trabalham em BGR.
+static cv::Mat envolverBuffer(const BufferPagina& buffer) {
+    int canais = 3;
+    int conversao = -1;
+    switch (buffer.formato) {
+    case FormatoPixel::Cinza8: canais = 1; break;
+    case FormatoPixel::BGR8: canais = 3; break;
+    case FormatoPixel::RGB8: canais = 3; conversao = cv::COLOR_RGB2BGR; break;
+    case FormatoPixel::BGRA8: canais = 4; break;
+    case FormatoPixel::RGBA8: canais = 4; conversao = cv::COLOR_RGBA2BGR; break;
+    }
+
+    if (buffer.dados == nullptr || buffer.largura <= 0 || buffer.altura <= 0) {
+        return cv::Mat();
+    }
+
+    size_t stride = buffer.stride != 0 ? buffer.stride : static_cast<size_t>(buffer.largura) * canais;
+    cv::Mat imagem(buffer.altura, buffer.largura, CV_8UC(canais), const_cast<unsigned char*>(buffer.dados), stride);
+    if (conversao >= 0) {
+        cv::Mat convertida;
+        cv::cvtColor(imagem, convertida, conversao);
+        return convertida;
+    }
+    return imagem;
+}
+
+static ResultadoLeitura converterResultado(const ResultadoPagina& resultado, int indicePagina) {
+    ResultadoLeitura leitura;
+    leitura.indicePagina = indicePagina;
+    leitura.alinhada = resultado.alinhada;
+    leitura.tempos.triagemMs = resultado.tempos.triagemMs;
+    leitura.tempos.alinhamentoMs = resultado.tempos.alinhamentoMs;
+    leitura.tempos.reducaoRuidoMs = resultado.tempos.reducaoRuidoMs;
+    leitura.tempos.leituraRespostasMs = resultado.tempos.leituraRespostasMs;
+    leitura.tempos.leituraPalavrasMs = resultado.tempos.leituraPalavrasMs;
+    leitura.tempos.totalMs = resultado.tempos.totalMs;
+
+    if (resultado.modelo == nullptr) {
+        leitura.descartada = true;
+        leitura.motivoDescarte = nomeTipoPagina(resultado.classificacao.tipo);
+        return leitura;
+    }
+    leitura.modelo = resultado.modelo->nome;
+
+    // As leituras seguem a ordem das regies e subdivises, como em salvarRespostas
+    size_t indice = 0;
+    for (const auto& rectData : resultado.modelo->rectangles) {
+        int numSubdivisions = rectData.analyzeVertical ? rectData.subdivisions.first : rectData.subdivisions.second;
+        for (int sub = 0; sub < numSubdivisions && indice < resultado.leituras.size(); ++sub) {
+            const LeituraQuestao& questao = resultado.leituras[indice++];
+            leitura.respostas.push_back({ rectData.name, sub + 1, questao.resposta, questao.confianca });
+        }
+    }
+
+    for (size_t i = 0; i < resultado.regioesPalavra.size() && i < resultado.palavras.size(); i++) {
+        const TextoRegiao& texto = resultado.palavras[i];
+        leitura.palavras.push_back({ resultado.regioesPalavra[i]->name, texto.texto, texto.confianca, texto.vazia });
+    }
+    return leitura;
+}
+
+LeitorGabarito::LeitorGabarito(Logger* logger, const std::string& idiomaOcr)
+    : estado(new Estado(logger, idiomaOcr)) {
+}
+
+LeitorGabarito::~LeitorGabarito() {
+}
+
+bool LeitorGabarito::adicionarModelo(const std::string& nome, const std::string& referenceImagePath, const std::string& coordinatesFilePath) {
+    std::lock_guard<std::mutex> lock(estado->chamadasMutex);
+    return estado->modelos.adicionar(*estado->logger, nome, referenceImagePath, coordinatesFilePath);
+}
+
+bool LeitorGabarito::adicionarModelo(const std::string& nome, const BufferPagina& referencia, const std::string& coordinatesFilePath) {
+    cv::Mat imagem = envolverBuffer(referencia);
+    if (!imagem.empty() && imagem.channels() != 3) {
+        cv::cvtColor(imagem, imagem, imagem.channels() == 1 ? cv::COLOR_GRAY2BGR : cv::COLOR_BGRA2BGR);
+    }
+    // A referncia fica guardada no modelo, ento aqui os pixels precisam ser copiados
+    std::lock_guard<std::mutex> lock(estado->chamadasMutex);
+    return estado->modelos.adicionar(*estado->logger, nome, imagem.clone(), coordinatesFilePath);
+}
+
+bool LeitorGabarito::carregarModelos(const std::string& arquivoLista) {
+    std::lock_guard<std::mutex> lock(estado->chamadasMutex);
+    return estado->modelos.carregarLista(*estado->logger, arquivoLista);
+}
+
+size_t LeitorGabarito::numeroModelos() const {
+    std::lock_guard<std::mutex> lock(estado->chamadasMutex);
+    return estado->modelos.size();
+}
+
+void LeitorGabarito::processarPagina(const BufferPagina& pagina, int indicePagina, const CallbackResultado& aoConcluir, const OpcoesLeitura& opcoes) {
+    processarPaginas({ pagina }, [&](const ResultadoLeitura& resultado) {
+        ResultadoLeitura comIndice = resultado;
+        comIndice.indicePagina = indicePagina;
+        aoConcluir(comIndice);
+    }, opcoes);
+}
+
+void LeitorGabarito::processarPaginas(const std::vector<BufferPagina>& paginas, const CallbackResultado& aoConcluir, const OpcoesLeitura& opcoes) {
+    std::lock_guard<std::mutex> chamadaLock(estado->chamadasMutex);
+    if (estado->modelos.empty()) {
+        estado->logger->AddLogMessage(LogLevel::Error, "Nenhum modelo de referncia carregado.");
+        return;
+    }
+
+    OpcoesPagina opcoesPagina;
+    opcoesPagina.triarPaginas = opcoes.triarPaginas;
+    opcoesPagina.lerPalavras = opcoes.lerPalavras;
+
+    std::mutex callbackMutex;
+    ThreadPool::global().parallelFor(static_cast<int>(paginas.size()), [&](int i, int) {
+        ResultadoLeitura leitura;
+        // Uma exceo escapando do parallelFor derrubaria o lote inteiro: ela vira o erro da prpria pgina
+        try {
+            cv::Mat imagem = envolverBuffer(paginas[i]);
+            if (imagem.empty()) {
+                leitura.erro = true;
+                leitura.mensagemErro = "buffer invlido";
+            }
+            else {
+                ResultadoPagina resultado = processarPaginaEmMemoria(*estado->logger, estado->modelos, estado->ocrEngines, imagem, opcoesPagina);
+                leitura = converterResultado(resultado, i);
+            }
+        }
+        catch (const std::exception& e) {
+            leitura = ResultadoLeitura();
+            leitura.erro = true;
+            leitura.mensagemErro = e.what();
+        }
+        catch (...) {
+            leitura = ResultadoLeitura();
+            leitura.erro = true;
+            leitura.mensagemErro = "exceo desconhecida";
+        }
+        if (leitura.erro) {
+            leitura.indicePagina = i;
+            estado->logger->AddLogMessage(LogLevel::Error, "Pgina " + std::to_string(i) + ": " + leitura.mensagemErro);
+        }
+
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        aoConcluir(leitura);
+    });
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+// API da biblioteca de leitura, para usar o processamento dentro de outro programa (sem ImGui,
+// GLFW nem troca de PNGs pelo disco). Este cabealho no depende de OpenCV nem de Tesseract.
+
+#include "Logger.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class FormatoPixel {
+    Cinza8,
+    BGR8,
+    RGB8,
+    BGRA8,
+    RGBA8
+};
+
+// Pgina em memria (8 bits por canal). Os pixels no so copiados para a entrada do pipeline,
+// ento precisam continuar vlidos at a chamada que recebeu o buffer retornar.
+struct BufferPagina {
+    const unsigned char* dados = nullptr;
+    int largura = 0;
+    int altura = 0;
+    size_t stride = 0;  // Bytes por linha; 0 = largura * bytes por pixel
+    FormatoPixel formato = FormatoPixel::BGR8;
+};
+
+struct OpcoesLeitura {
+    bool triarPaginas = true;  // Descarta pginas em branco e que no so folhas de resposta
+    bool lerPalavras = true;   // OCR/classificao das regies de palavra
+};
+
+struct RespostaLida {
+    std::string regiao;
+    int subdivisao;     // A partir de 1
+    char resposta;      // 'A'.. ('0'.. nas regies de nmero), 'V' se nenhuma alternativa foi marcada ou 'X' se mais de uma foi
+    float confianca;
+};
+
+struct TextoLido {
+    std::string regiao;
+    std::string texto;
+    float confianca;
+    bool vazia;         // Regio sem tinta, no passou pelo OCR
+};
+
+struct TemposLeitura {
+    double triagemMs = 0;
+    double alinhamentoMs = 0;
+    double reducaoRuidoMs = 0;
+    double leituraRespostasMs = 0;
+    double leituraPalavrasMs = 0;
+    double totalMs = 0;
+};
+
+struct ResultadoLeitura {
+    int indicePagina = 0;
+    std::string modelo;           // Nome do modelo usado; vazio se a pgina foi descartada
+    bool descartada = false;
+    std::string motivoDescarte;   // "em_branco", "nao_resposta", "ilegivel" ou "nao_alinhada"
+    bool alinhada = false;
+    bool erro = false;            // A leitura falhou (buffer invlido ou exceo); as outras pginas seguem
+    std::string mensagemErro;
+    std::vector<RespostaLida> respostas;
+    std::vector<TextoLido> palavras;
+    TemposLeitura tempos;
+};
+
+using CallbackResultado = std::function<void(const ResultadoLeitura& resultado)>;
+
+// Leitor com os modelos (referncia, features de alinhamento e geometria) e as engines de OCR
+// carregados uma vez e reaproveitados em todas as pginas. Pode ser chamado de vrias threads: as chamadas
+// so serializadas (cada uma j l as pginas em paralelo) e no podem ser feitas de dentro de aoConcluir.
+class LeitorGabarito {
+public:
+    // logger pode ser nulo (mensagens descartadas); se no for, precisa viver mais que o leitor
+    explicit LeitorGabarito(Logger* logger = nullptr, const std::string& idiomaOcr = "eng");
+    ~LeitorGabarito();
+
+    LeitorGabarito(const LeitorGabarito&) = delete;
+    LeitorGabarito& operator=(const LeitorGabarito&) = delete;
+
+    bool adicionarModelo(const std::string& nome, const std::string& referenceImagePath, const std::string& coordinatesFilePath);
+    bool adicionarModelo(const std::string& nome, const BufferPagina& referencia, const std::string& coordinatesFilePath);
+    // Lista "nome;imagem de referncia;arquivo de coordenadas", substitui os modelos atuais
+    bool carregarModelos(const std::string& arquivoLista);
+    size_t numeroModelos() const;
+
+    // L uma pgina e chama aoConcluir antes de retornar
+    void processarPagina(const BufferPagina& pagina, int indicePagina, const CallbackResultado& aoConcluir, const OpcoesLeitura& opcoes = OpcoesLeitura());
+
+    // L as pginas em paralelo. aoConcluir  chamado uma vez por pgina, na ordem em que as pginas
+    // terminam, de uma thread de cada vez (no precisa ser thread-safe). indicePagina = posio no vetor.
+    // Uma pgina que falha chega com erro e mensagemErro, sem interromper as outras.
+    void processarPaginas(const std::vector<BufferPagina>& paginas, const CallbackResultado& aoConcluir, const OpcoesLeitura& opcoes = OpcoesLeitura());
+
+private:
+    struct Estado;
+    std::unique_ptr<Estado> estado;
+};
@@ -0,0 +1,145 @@
+#include "gabaritor_c.h"
+#include "GabaritorApi.h"
+#include <exception>
+
+// Repassa as mensagens para o callback C
+class LoggerCallback : public Logger {
+public:
+    LoggerCallback(GabCallbackLog callback, void* usuario) : callback(callback), usuario(usuario) {}
+
+    void AddLogMessage(LogLevel level, const std::string& message) override {
+        if (callback == nullptr) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        callback(usuario, static_cast<int>(level), message.c_str());
+    }
+
+private:
+    GabCallbackLog callback;
+    void* usuario;
+    std::mutex mutex;
+};
+
+struct GabLeitor {
+    LoggerCallback logger;
+    LeitorGabarito leitor;
+
+    GabLeitor(const char* idiomaOcr, GabCallbackLog callbackLog, void* usuarioLog)
+        : logger(callbackLog, usuarioLog), leitor(&logger, idiomaOcr != nullptr ? idiomaOcr : "eng") {
+    }
+};
+
+static BufferPagina converterBuffer(const GabBufferPagina& buffer) {
+    BufferPagina pagina;
+    pagina.dados = buffer.dados;
+    pagina.largura = buffer.largura;
+    pagina.altura = buffer.altura;
+    pagina.stride = buffer.stride;
+    pagina.formato = static_cast<FormatoPixel>(buffer.formato);
+    return pagina;
+}
+
+// Nenhuma exceo pode atravessar a fronteira C
+static void registrarExcecao(GabLeitor* leitor, const std::exception& e) {
+    leitor->logger.AddLogMessage(LogLevel::Error, std::string("Erro: ") + e.what());
+}
+
+extern "C" {
+
+GabLeitor* gab_criar(const char* idiomaOcr, GabCallbackLog callbackLog, void* usuarioLog) {
+    try {
+        return new GabLeitor(idiomaOcr, callbackLog, usuarioLog);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void gab_destruir(GabLeitor* leitor) {
+    delete leitor;
+}
+
+int gab_adicionar_modelo(GabLeitor* leitor, const char* nome, const char* imagemReferencia, const char* arquivoCoordenadas) {
+    if (leitor == nullptr || nome == nullptr || imagemReferencia == nullptr || arquivoCoordenadas == nullptr) return 0;
+    try {
+        return leitor->leitor.adicionarModelo(nome, imagemReferencia, arquivoCoordenadas) ? 1 : 0;
+    }
+    catch (const std::exception& e) {
+        registrarExcecao(leitor, e);
+        return 0;
+    }
+}
+
+int gab_adicionar_modelo_buffer(GabLeitor* leitor, const char* nome, const GabBufferPagina* referencia, const char* arquivoCoordenadas) {
+    if (leitor == nullptr || nome == nullptr || referencia == nullptr || arquivoCoordenadas == nullptr) return 0;
+    try {
+        return leitor->leitor.adicionarModelo(nome, converterBuffer(*referencia), arquivoCoordenadas) ? 1 : 0;
+    }
+    catch (const std::exception& e) {
+        registrarExcecao(leitor, e);
+        return 0;
+    }
+}
+
+int gab_carregar_modelos(GabLeitor* leitor, const char* arquivoLista) {
+    if (leitor == nullptr || arquivoLista == nullptr) return 0;
+    try {
+        return leitor->leitor.carregarModelos(arquivoLista) ? 1 : 0;
+    }
+    catch (const std::exception& e) {
+        registrarExcecao(leitor, e);
+        return 0;
+    }
+}
+
+int gab_processar_paginas(GabLeitor* leitor, const GabBufferPagina* paginas, size_t numeroPaginas,
+    int triarPaginas, int lerPalavras, GabCallbackResultado callback, void* usuario) {
+    if (leitor == nullptr || (paginas == nullptr && numeroPaginas > 0) || callback == nullptr) return 0;
+
+    std::vector<BufferPagina> buffers;
+    buffers.reserve(numeroPaginas);
+    for (size_t i = 0; i < numeroPaginas; i++) {
+        buffers.push_back(converterBuffer(paginas[i]));
+    }
+
+    OpcoesLeitura opcoes;
+    opcoes.triarPaginas = triarPaginas != 0;
+    opcoes.lerPalavras = lerPalavras != 0;
+
+    try {
+        leitor->leitor.processarPaginas(buffers, [&](const ResultadoLeitura& resultado) {
+            std::vector<GabResposta> respostas;
+            respostas.reserve(resultado.respostas.size());
+            for (const auto& resposta : resultado.respostas) {
+                respostas.push_back({ resposta.regiao.c_str(), resposta.subdivisao, resposta.resposta, resposta.confianca });
+            }
+            std::vector<GabTexto> palavras;
+            palavras.reserve(resultado.palavras.size());
+            for (const auto& palavra : resultado.palavras) {
+                palavras.push_back({ palavra.regiao.c_str(), palavra.texto.c_str(), palavra.confianca, palavra.vazia ? 1 : 0 });
+            }
+
+            GabResultado saida;
+            saida.indicePagina = resultado.indicePagina;
+            saida.modelo = resultado.modelo.c_str();
+            saida.descartada = resultado.descartada ? 1 : 0;
+            saida.motivoDescarte = resultado.motivoDescarte.c_str();
+            saida.alinhada = resultado.alinhada ? 1 : 0;
+            saida.respostas = respostas.data();
+            saida.numeroRespostas = respostas.size();
+            saida.palavras = palavras.data();
+            saida.numeroPalavras = palavras.size();
+            saida.tempos = { resultado.tempos.triagemMs, resultado.tempos.alinhamentoMs, resultado.tempos.reducaoRuidoMs,
+                resultado.tempos.leituraRespostasMs, resultado.tempos.leituraPalavrasMs, resultado.tempos.totalMs };
+            saida.erro = resultado.erro ? 1 : 0;
+            saida.mensagemErro = resultado.mensagemErro.c_str();
+            callback(usuario, &saida);
+        }, opcoes);
+    }
+    catch (const std::exception& e) {
+        registrarExcecao(leitor, e);
+        return 0;
+    }
+    return 1;
+}
+
+}
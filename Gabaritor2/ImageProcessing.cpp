@@ -5,78 +5,132 @@
 #include <poppler/cpp/poppler-image.h>
 #include <poppler/cpp/poppler-page-renderer.h>
 #include <opencv2/opencv.hpp>
-#include <glad/glad.h>
 #include <filesystem>
-#include <GLFW/glfw3.h>
 #include "ImageProcessing.h"
+#include "TileExecutor.h"
+#include "ThreadPool.h"
+#include "DigitClassifier.h"
+#include "PageTriage.h"
+#include "TemplateRegistry.h"
+#include "ResultStream.h"
+#include "ScanInput.h"
+#include "PdfImages.h"
+#include "MeasurementStore.h"
+#include "PackedPage.h"
+#include "ImageWriter.h"
+#include "LocalRegistration.h"
+#include "BatchReader.h"
 #include <tesseract/baseapi.h>
 #include <cmath>
 #include <numeric>
 #include <vector>
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <climits>
+#include <functional>
+#include <mutex>
 
 
 
-const int MAX_FEATURES = 800;
-const float GOOD_MATCH_PERCENT = 0.10f;
-// Defina a margem de segurana (em pixels)
-const int marginX = 15;  // Margem para o eixo X
-const int marginY = 10;  // Margem para o eixo Y
-const int offsetX = 0;  // Deslocamento para o eixo X
-const int offsetY = 20;  // Deslocamento para o eixo Y
+// Features ORB, filtro bilateral, threshold adaptativo, DPI e margens da leitura ficam em
+// ParametrosPipeline (ImageProcessing.h)
+static ParametrosPipeline parametrosEmUso;
+
+const ParametrosPipeline& parametrosPipeline() {
+    return parametrosEmUso;
+}
+
+void definirParametrosPipeline(const ParametrosPipeline& parametros) {
+    parametrosEmUso = parametros;
+}
 
 const int tolerancia = 1;
 
-void processPdf(ConsoleBuffer& consoleBuffer, const std::string& filenamePdf, const std::string& imag_output_folder, int DPI) {
-    auto mypdf = poppler::document::load_from_file(filenamePdf);
+cv::Mat renderizarPaginaPdf(const poppler::document& documento, int indicePagina, int DPI) {
+    std::unique_ptr<poppler::page> mypage(documento.create_page(indicePagina));
+    if (!mypage) {
+        return cv::Mat();
+    }
+
+    poppler::page_renderer renderer;
+    renderer.set_render_hint(poppler::page_renderer::text_antialiasing);
+    poppler::image myimage = renderer.render_page(mypage.get(), DPI, DPI);
+
+    cv::Mat cvimg;
+    if (myimage.format() == poppler::image::format_enum::format_rgb24) {
+        cv::Mat(myimage.height(), myimage.width(), CV_8UC3, myimage.data()).copyTo(cvimg);
+    }
+    else if (myimage.format() == poppler::image::format_enum::format_argb32) {
+        cv::Mat(myimage.height(), myimage.width(), CV_8UC4, myimage.data()).copyTo(cvimg);
+    }
+
+    return cvimg;
+}
+
+void processPdf(Logger& logger, const std::string& filenamePdf, const std::string& imag_output_folder, int DPI) {
+    std::unique_ptr<poppler::document> mypdf(poppler::document::load_from_file(filenamePdf));
     if (mypdf == nullptr) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "couldn't read pdf: " + filenamePdf);
+        logger.AddLogMessage(LogLevel::Error, "couldn't read pdf: " + filenamePdf);
         return;
     }
 
     int num_pages = mypdf->pages();
-    consoleBuffer.AddLogMessage(LogLevel::Info, "pdf has " + std::to_string(num_pages) + " pages");
-
-    for (int i = 0; i < num_pages; i++) {
-        auto mypage = mypdf->create_page(i);
-        poppler::page_renderer renderer;
-        renderer.set_render_hint(poppler::page_renderer::text_antialiasing);
-        poppler::image myimage = renderer.render_page(mypage, DPI, DPI);
-
-        cv::Mat cvimg;
-        if (myimage.format() == poppler::image::format_enum::format_rgb24) {
-            cv::Mat(myimage.height(), myimage.width(), CV_8UC3, myimage.data()).copyTo(cvimg);
-        }
-        else if (myimage.format() == poppler::image::format_enum::format_argb32) {
-            cv::Mat(myimage.height(), myimage.width(), CV_8UC4, myimage.data()).copyTo(cvimg);
-        }
-        else {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Unsupported PDF format in page " + std::to_string(i + 1));
-            continue; // Alterado de 'return' para 'continue' para processar as demais pginas mesmo com erro
+    logger.AddLogMessage(LogLevel::Info, "pdf has " + std::to_string(num_pages) + " pages");
+
+    // PDFs de scanner: a imagem de cada pgina  decodificada direto, sem renderizar
+    ImagensEmbutidasPdf imagensEmbutidas;
+    imagensEmbutidas.abrir(logger, filenamePdf, num_pages);
+
+    // S a renderizao pelo poppler  serializada; a extrao das imagens embutidas roda em paralelo
+    std::mutex renderMutex;
+    ThreadPool::global().parallelFor(num_pages, [&](int i, int) {
+        cv::Mat cvimg = lerPaginaPdf(*mypdf, imagensEmbutidas, i, DPI, &renderMutex);
+        if (cvimg.empty()) {
+            logger.AddLogMessage(LogLevel::Error, "Unsupported PDF format in page " + std::to_string(i + 1));
+            return; // Continua com as demais pginas mesmo com erro
         }
 
         // Ajuste aqui: passa somente o nome do arquivo para salvarImagem, no o caminho completo
         std::string nomeArquivo = "page_" + std::to_string(i + 1) + ".png";
 
-        salvarImagem(consoleBuffer, imag_output_folder, nomeArquivo, cvimg); // Ajustado para passar o consoleBuffer
-    }
+        salvarImagem(logger, imag_output_folder, nomeArquivo, std::move(cvimg)); // Ajustado para passar o logger
+    });
 
-    consoleBuffer.AddLogMessage(LogLevel::Info, "Todas as pginas foram salvas com sucesso!");
+    aguardarImagensSalvas();
+    logger.AddLogMessage(LogLevel::Info, "Todas as pginas foram salvas com sucesso!");
+}
+
+ReferenciaAlinhamento prepararReferenciaAlinhamento(const cv::Mat& imagemReferencia) {
+    ReferenciaAlinhamento referencia;
+    referencia.imagem = imagemReferencia;
+
+    cv::Mat gray;
+    cv::cvtColor(imagemReferencia, gray, cv::COLOR_BGR2GRAY);
+    cv::Ptr<cv::Feature2D> orb = cv::ORB::create(parametrosPipeline().maxFeatures);
+    orb->detectAndCompute(gray, cv::Mat(), referencia.keypoints, referencia.descritores);
+    return referencia;
 }
 
 void alignImagesORB(cv::Mat& im1, cv::Mat& im2, cv::Mat& im1Reg, cv::Mat& h) {
+    alignImagesORB(im1, prepararReferenciaAlinhamento(im2), im1Reg, h);
+}
+
+void alignImagesORB(const cv::Mat& im1, const ReferenciaAlinhamento& referencia, cv::Mat& im1Reg, cv::Mat& h, double* qualidade) {
     // Convert images to grayscale
-    cv::Mat im1Gray, im2Gray;
+    cv::Mat im1Gray;
     cv::cvtColor(im1, im1Gray, cv::COLOR_BGR2GRAY);
-    cv::cvtColor(im2, im2Gray, cv::COLOR_BGR2GRAY);
 
     // Variables to store keypoints and descriptors
-    std::vector<cv::KeyPoint> keypoints1, keypoints2;
-    cv::Mat descriptors1, descriptors2;
+    std::vector<cv::KeyPoint> keypoints1;
+    const std::vector<cv::KeyPoint>& keypoints2 = referencia.keypoints;
+    cv::Mat descriptors1;
+    const cv::Mat& descriptors2 = referencia.descritores;
 
-    // Detect ORB features and compute descriptors.
-    cv::Ptr<cv::Feature2D> orb = cv::ORB::create(MAX_FEATURES);
+    // Detect ORB features and compute descriptors (as da referncia j vm prontas)
+    cv::Ptr<cv::Feature2D> orb = cv::ORB::create(parametrosPipeline().maxFeatures);
     orb->detectAndCompute(im1Gray, cv::Mat(), keypoints1, descriptors1);
-    orb->detectAndCompute(im2Gray, cv::Mat(), keypoints2, descriptors2);
 
     // Match features.
     std::vector<cv::DMatch> matches;
@@ -87,7 +141,7 @@ void alignImagesORB(cv::Mat& im1, cv::Mat& im2, cv::Mat& im1Reg, cv::Mat& h) {
     std::sort(matches.begin(), matches.end());
 
     // Remove not so good matches
-    const int numGoodMatches = static_cast<int>(matches.size() * GOOD_MATCH_PERCENT);
+    const int numGoodMatches = static_cast<int>(matches.size() * parametrosPipeline().percentualBonsPares);
     matches.erase(matches.begin() + numGoodMatches, matches.end());
 
     // Extract location of good matches
@@ -99,84 +153,184 @@ void alignImagesORB(cv::Mat& im1, cv::Mat& im2, cv::Mat& im1Reg, cv::Mat& h) {
     }
 
     // Find homography
-    h = cv::findHomography(points1, points2, cv::RANSAC);
+    cv::Mat inliers;
+    h = points1.size() < 4 ? cv::Mat() : cv::findHomography(points1, points2, cv::RANSAC, 3, inliers);
+    if (qualidade != nullptr) {
+        *qualidade = points1.empty() || inliers.empty() ? 0.0 : static_cast<double>(cv::countNonZero(inliers)) / points1.size();
+    }
+    // Sem homografia (pgina sem features em comum com a referncia) a imagem alinhada fica vazia
+    if (h.empty()) {
+        im1Reg.release();
+        return;
+    }
 
     // Use homography to warp image
-    cv::warpPerspective(im1, im1Reg, h, im2.size());
+    cv::warpPerspective(im1, im1Reg, h, referencia.imagem.size());
 }
 
-void alinharImagens(ConsoleBuffer& consoleBuffer, const std::string& imag_output_folder, const std::string& aling_imag_folder, 
-    const std::string& reference_image_path) {
-    cv::Mat imageRef = cv::imread(reference_image_path);
-    if (imageRef.empty()) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "Error loading reference image from path: " + reference_image_path);
+void alinharImagens(Logger& logger, const std::string& imag_output_folder, const std::string& aling_imag_folder, 
+    const std::string& reference_image_path, bool triarPaginas, const std::string& pastaTriagem) {
+    TemplateRegistry modelos;
+    if (!modelos.adicionar(logger, "referencia", reference_image_path, "")) {
         return;
     }
+    alinharImagens(logger, imag_output_folder, aling_imag_folder, modelos, triarPaginas, pastaTriagem);
+}
 
-    std::vector<cv::String> filenames;
-    cv::glob(imag_output_folder + "/*.png", filenames, false);
+// Alinhamento comum s entradas em pasta de PNGs e s digitalizaes: lerPagina(i) devolve a pgina i
+// (vazia se no pde ser lida) e nomePagina(i) o nome usado nas pastas das etapas seguintes
+static void alinharPaginas(Logger& logger, int numeroPaginas, const std::function<std::string(int)>& nomePagina,
+    const std::function<cv::Mat(int)>& lerPagina, const std::string& aling_imag_folder, const TemplateRegistry& modelos, bool triarPaginas,
+    const std::string& pastaTriagem) {
+    if (modelos.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Nenhum modelo de referncia carregado.");
+        return;
+    }
 
-    for (const auto& filename : filenames) {
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Processing file: " + filename);
+    std::vector<PaginaIgnorada> paginasIgnoradas;
+    std::vector<std::pair<std::string, std::string>> modelosPaginas;
+
+    for (int i = 0; i < numeroPaginas; i++) {
+        std::string fileName = nomePagina(i);
+        logger.AddLogMessage(LogLevel::Info, "Processing file: " + fileName);
 
-        cv::Mat image = cv::imread(filename);
+        cv::Mat image = lerPagina(i);
         if (image.empty()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Error loading image: " + filename);
+            logger.AddLogMessage(LogLevel::Error, "Error loading image: " + fileName);
+            paginasIgnoradas.push_back({ fileName, { TipoPagina::Ilegivel, 0.0, 0.0 } });
             continue;
         }
 
+        // A miniatura serve tanto para a triagem quanto para escolher o modelo; com um s modelo
+        // e sem triagem ela nem  calculada
+        int indiceModelo = 0;
+        ClassificacaoPagina classificacao{ TipoPagina::Resposta, 0.0, 0.0 };
+        if (triarPaginas || modelos.size() > 1) {
+            RoteamentoPagina roteamento = modelos.rotear(criarMiniatura(image));
+            if (triarPaginas && roteamento.classificacao.tipo != TipoPagina::Resposta) {
+                paginasIgnoradas.push_back({ fileName, roteamento.classificacao });
+                logger.AddLogMessage(LogLevel::Warning, "Pgina ignorada (" + std::string(nomeTipoPagina(roteamento.classificacao.tipo)) + "): " + fileName);
+                continue;
+            }
+            indiceModelo = std::max(roteamento.modelo, 0);
+            classificacao = roteamento.classificacao;
+        }
+        const ModeloGabarito& modelo = modelos.modelo(indiceModelo);
+
         cv::Mat alignedImage, h;
-        alignImagesORB(image, imageRef, alignedImage, h);
+        alignImagesORB(image, modelo.alinhamento, alignedImage, h);
 
         if (alignedImage.empty()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Error aligning image: " + filename);
+            logger.AddLogMessage(LogLevel::Error, "Error aligning image: " + fileName);
+            classificacao.tipo = TipoPagina::NaoAlinhada;
+            paginasIgnoradas.push_back({ fileName, classificacao });
             continue;
         }
 
-        // Extrai o nome do arquivo do caminho completo
-        auto pos = filename.find_last_of("/\\");
-        std::string fileName = filename.substr(pos + 1);
+        salvarImagem(logger, aling_imag_folder, fileName, std::move(alignedImage)); // Adicionado logger como parmetro
+        modelosPaginas.emplace_back(fileName, modelo.nome);
+    }
 
-        salvarImagem(consoleBuffer, aling_imag_folder, fileName, alignedImage); // Adicionado consoleBuffer como parmetro
+    // O relatrio  regravado mesmo sem triagem, para no sobrar o de uma execuo anterior
+    std::string destinoTriagem = pastaTriagem.empty() ? aling_imag_folder : pastaTriagem;
+    salvarPaginasIgnoradas(logger, destinoTriagem, paginasIgnoradas);
+    if (triarPaginas) {
+        logger.AddLogMessage(LogLevel::Info, std::to_string(paginasIgnoradas.size()) + " pginas ignoradas na triagem.");
+    }
+    salvarModelosPaginas(logger, aling_imag_folder, modelosPaginas);
+    if (destinoTriagem != aling_imag_folder) {
+        salvarModelosPaginas(logger, destinoTriagem, modelosPaginas);
     }
 
-    consoleBuffer.AddLogMessage(LogLevel::Info, "All images have been aligned and saved.");
+    aguardarImagensSalvas();
+    logger.AddLogMessage(LogLevel::Info, "All images have been aligned and saved.");
 }
 
-void calcularParametrosDinamicos(const cv::Mat& image, int& tolerancia, int& intensidadeMinima) {
-    std::vector<int> intensities;
-    std::vector<int> diffs;
-
-    for (int y = 0; y < image.rows; y++) {
-        for (int x = 0; x < image.cols; x++) {
-            cv::Vec3b pixel = image.at<cv::Vec3b>(y, x);
+void alinharImagens(Logger& logger, const std::string& imag_output_folder, const std::string& aling_imag_folder,
+    const TemplateRegistry& modelos, bool triarPaginas, const std::string& pastaTriagem) {
+    std::vector<cv::String> filenames;
+    cv::glob(imag_output_folder + "/*.png", filenames, false);
 
-            int blue = pixel[0];
-            int green = pixel[1];
-            int red = pixel[2];
+    alinharPaginas(logger, static_cast<int>(filenames.size()),
+        [&](int i) {
+            // Extrai o nome do arquivo do caminho completo
+            auto pos = filenames[i].find_last_of("/\\");
+            return filenames[i].substr(pos + 1);
+        },
+        [&](int i) { return cv::imread(filenames[i]); },
+        aling_imag_folder, modelos, triarPaginas, pastaTriagem);
+}
 
-            int intensity = (red + green + blue) / 3;
-            intensities.push_back(intensity);
+void alinharImagens(Logger& logger, const FonteDigitalizacao& entrada, const std::string& aling_imag_folder, const TemplateRegistry& modelos,
+    bool triarPaginas, int DPI, const std::string& pastaTriagem) {
+    if (criarDiretorio(logger, aling_imag_folder)) {
+        entrada.salvarOrigemPaginas(logger, aling_imag_folder);
+    }
+    alinharPaginas(logger, entrada.numeroPaginas(),
+        [&](int i) { return entrada.nomePagina(i); },
+        [&](int i) { return entrada.lerPagina(i, DPI); },
+        aling_imag_folder, modelos, triarPaginas, pastaTriagem);
+}
 
-            int diffRG = abs(red - green);
-            int diffRB = abs(red - blue);
-            int diffGB = abs(green - blue);
+// Somas parciais de um bloco para o clculo dos parmetros dinmicos
+struct SomasCinza {
+    long long somaIntensidade = 0;
+    long long somaQuadradosIntensidade = 0;
+    long long somaDiffs = 0;
+    long long somaQuadradosDiffs = 0;
+};
 
-            diffs.push_back(diffRG);
-            diffs.push_back(diffRB);
-            diffs.push_back(diffGB);
+void calcularParametrosDinamicos(const cv::Mat& image, int& tolerancia, int& intensidadeMinima) {
+    // Acumula somas inteiras por bloco em vez de guardar todas as intensidades e diferenas.
+    // Para uma pgina esses totais ficam muito abaixo de 2^53, ento a soma em double do clculo
+    // original era exata e a diviso em blocos no muda nenhum bit do resultado.
+    std::vector<SomasCinza> parciais(numeroDeBlocos(image.size()));
+
+    executarEmBlocos(image.size(), 0, [&](int indice, const cv::Rect& bloco, const cv::Rect&) {
+        SomasCinza& somas = parciais[indice];
+        for (int y = bloco.y; y < bloco.y + bloco.height; y++) {
+            const cv::Vec3b* linha = image.ptr<cv::Vec3b>(y);
+            for (int x = bloco.x; x < bloco.x + bloco.width; x++) {
+                const cv::Vec3b& pixel = linha[x];
+
+                int blue = pixel[0];
+                int green = pixel[1];
+                int red = pixel[2];
+
+                int intensity = (red + green + blue) / 3;
+                somas.somaIntensidade += intensity;
+                somas.somaQuadradosIntensidade += intensity * intensity;
+
+                int diffRG = abs(red - green);
+                int diffRB = abs(red - blue);
+                int diffGB = abs(green - blue);
+
+                somas.somaDiffs += diffRG + diffRB + diffGB;
+                somas.somaQuadradosDiffs += diffRG * diffRG + diffRB * diffRB + diffGB * diffGB;
+            }
         }
+    });
+
+    SomasCinza total;
+    for (const auto& somas : parciais) {
+        total.somaIntensidade += somas.somaIntensidade;
+        total.somaQuadradosIntensidade += somas.somaQuadradosIntensidade;
+        total.somaDiffs += somas.somaDiffs;
+        total.somaQuadradosDiffs += somas.somaQuadradosDiffs;
     }
 
+    size_t numPixels = static_cast<size_t>(image.rows) * image.cols;
+    size_t numDiffs = numPixels * 3;
+
     // Calcula a mdia e o desvio padro das intensidades
-    double meanIntensity = std::accumulate(intensities.begin(), intensities.end(), 0.0) / intensities.size();
-    double sq_sum_intensity = std::inner_product(intensities.begin(), intensities.end(), intensities.begin(), 0.0);
-    double stdevIntensity = std::sqrt(sq_sum_intensity / intensities.size() - meanIntensity * meanIntensity);
+    double meanIntensity = static_cast<double>(total.somaIntensidade) / numPixels;
+    double sq_sum_intensity = static_cast<double>(total.somaQuadradosIntensidade);
+    double stdevIntensity = std::sqrt(sq_sum_intensity / numPixels - meanIntensity * meanIntensity);
 
     // Calcula a mdia e o desvio padro das diferenas
-    double meanDiff = std::accumulate(diffs.begin(), diffs.end(), 0.0) / diffs.size();
-    double sq_sum_diff = std::inner_product(diffs.begin(), diffs.end(), diffs.begin(), 0.0);
-    double stdevDiff = std::sqrt(sq_sum_diff / diffs.size() - meanDiff * meanDiff);
+    double meanDiff = static_cast<double>(total.somaDiffs) / numDiffs;
+    double sq_sum_diff = static_cast<double>(total.somaQuadradosDiffs);
+    double stdevDiff = std::sqrt(sq_sum_diff / numDiffs - meanDiff * meanDiff);
 
     // Define a tolerncia e a intensidade mnima baseadas nas mdias e desvios padro
     tolerancia = static_cast<int>((meanDiff + stdevDiff + 6 ) * 2 );
@@ -187,101 +341,255 @@ void removerCinzaLeveDinamico(cv::Mat& image) {
     int tolerancia, intensidadeMinima;
     calcularParametrosDinamicos(image, tolerancia, intensidadeMinima);
 
-    for (int y = 0; y < image.rows; y++) {
-        for (int x = 0; x < image.cols; x++) {
-            cv::Vec3b& pixel = image.at<cv::Vec3b>(y, x);
+    // Kernel por pixel: cada bloco  independente, no precisa de halo
+    executarEmBlocos(image.size(), 0, [&](int, const cv::Rect& bloco, const cv::Rect&) {
+        for (int y = bloco.y; y < bloco.y + bloco.height; y++) {
+            cv::Vec3b* linha = image.ptr<cv::Vec3b>(y);
+            for (int x = bloco.x; x < bloco.x + bloco.width; x++) {
+                cv::Vec3b& pixel = linha[x];
 
-            int blue = pixel[0];
-            int green = pixel[1];
-            int red = pixel[2];
+                int blue = pixel[0];
+                int green = pixel[1];
+                int red = pixel[2];
 
-            int diffRG = abs(red - green);
-            int diffRB = abs(red - blue);
-            int diffGB = abs(green - blue);
+                int diffRG = abs(red - green);
+                int diffRB = abs(red - blue);
+                int diffGB = abs(green - blue);
 
-            int intensity = (red + green + blue) / 3;
+                int intensity = (red + green + blue) / 3;
 
-            if (diffRG < tolerancia && diffRB < tolerancia && diffGB < tolerancia && intensity > intensidadeMinima) {
-                pixel = cv::Vec3b(255, 255, 255); // Substitua por preto: cv::Vec3b(0, 0, 0)
+                if (diffRG < tolerancia && diffRB < tolerancia && diffGB < tolerancia && intensity > intensidadeMinima) {
+                    pixel = cv::Vec3b(255, 255, 255); // Substitua por preto: cv::Vec3b(0, 0, 0)
+                }
             }
         }
+    });
+}
+
+// Filtro bilateral da reduo de rudo (ou s a cpia, com dimetro 0)
+static cv::Mat filtrarBilateral(const cv::Mat& imagem) {
+    const ParametrosPipeline& parametros = parametrosPipeline();
+    cv::Mat imagemFiltrada;
+    if (parametros.diametroBilateral > 0) {
+        cv::bilateralFilter(imagem, imagemFiltrada, parametros.diametroBilateral, parametros.sigmaCorBilateral, parametros.sigmaEspacoBilateral);
     }
+    else {
+        imagemFiltrada = imagem.clone();
+    }
+    return imagemFiltrada;
+}
+
+cv::Mat reduzirRuido(const cv::Mat& imagem) {
+    // Aplica o filtro de mdia bilateral
+    cv::Mat imagemFiltrada = filtrarBilateral(imagem);
+
+    // Remove tons de cinza leve de forma dinmica
+    removerCinzaLeveDinamico(imagemFiltrada);
+
+    return imagemFiltrada;
 }
 
-void aplicarFiltroReducaoRuido(ConsoleBuffer& consoleBuffer, const std::string& pastaImagensAlinhadas, const std::string& pastaDestino) {
+void aplicarFiltroReducaoRuido(Logger& logger, const std::string& pastaImagensAlinhadas, const std::string& pastaDestino) {
     std::vector<cv::String> arquivos;
     cv::glob(pastaImagensAlinhadas + "/*.png", arquivos, false);
 
     for (const auto& arquivo : arquivos) {
         cv::Mat imagem = cv::imread(arquivo, cv::IMREAD_COLOR);
         if (imagem.empty()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + std::string(arquivo));
+            logger.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + std::string(arquivo));
             continue;
         }
 
-        // Aplica o filtro de mdia bilateral
-        cv::Mat imagemFiltrada;
-        cv::bilateralFilter(imagem, imagemFiltrada, 9, 75, 75);
-
-        // Remove tons de cinza leve de forma dinmica
-        removerCinzaLeveDinamico(imagemFiltrada);
-
+        cv::Mat imagemFiltrada = reduzirRuido(imagem);
 
         // Extrai o nome do arquivo do caminho completo
         auto pos = arquivo.find_last_of("/\\");
         std::string fileName = arquivo.substr(pos + 1);
 
         // Salva a imagem processada na pasta de destino
-        salvarImagem(consoleBuffer, pastaDestino, fileName, imagemFiltrada);
+        salvarImagem(logger, pastaDestino, fileName, std::move(imagemFiltrada));
+    }
+
+    aguardarImagensSalvas();
+    logger.AddLogMessage(LogLevel::Info, "Filtro de reduo de rudo aplicado a todas as imagens com sucesso.");
+}
+
+cv::Mat calcularImagemThreshold(const cv::Mat& imagemCinza) {
+    cv::Mat imagemThreshold;
+    adaptiveThresholdEmBlocos(imagemCinza, imagemThreshold, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY_INV,
+        parametrosPipeline().blocoThresholdAdaptativo, parametrosPipeline().constanteThresholdAdaptativo);
+    return imagemThreshold;
+}
+
+std::vector<std::vector<ComponenteBolha>> medirComponentesBolhas(const PaginaBits& pagina, const std::vector<RectangleData>& rectangles,
+    const ParametrosLeitura& parametros) {
+    std::vector<std::vector<ComponenteBolha>> questoes;
+    cv::Mat tinta, rotulos, estatisticas, centroides;
+
+    // Mesmas regies, na mesma ordem, e mesma ROI de lerRespostas (clula menos a margem, deslocada pelo offset)
+    for (const auto& rectData : rectangles) {
+        int x = static_cast<int>(rectData.coordinates.x * pagina.largura);
+        int y = static_cast<int>(rectData.coordinates.y * pagina.altura);
+        int cellWidth = static_cast<int>((rectData.coordinates.z - rectData.coordinates.x) * pagina.largura) / rectData.subdivisions.second;
+        int cellHeight = static_cast<int>((rectData.coordinates.w - rectData.coordinates.y) * pagina.altura) / rectData.subdivisions.first;
+        int numAlternatives = rectData.analyzeVertical ? rectData.subdivisions.first : rectData.subdivisions.second;
+        int numChoices = rectData.analyzeVertical ? rectData.subdivisions.second : rectData.subdivisions.first;
+        int roiWidth = cellWidth - 2 * parametros.marginX;
+        int roiHeight = cellHeight - 2 * parametros.marginY;
+
+        for (int alt = 0; alt < numAlternatives; ++alt) {
+            std::vector<ComponenteBolha> bolhas(numChoices);
+            for (int choice = 0; choice < numChoices; ++choice) {
+                int roiX = x + (rectData.analyzeVertical ? choice : alt) * cellWidth + parametros.marginX + parametros.offsetX;
+                int roiY = y + (rectData.analyzeVertical ? alt : choice) * cellHeight + parametros.marginY + parametros.offsetY;
+                // A leitura conta zero tinta quando a ROI sai da pgina; aqui a bolha fica vazia
+                if (roiWidth <= 0 || roiHeight <= 0 || roiX < 0 || roiY < 0 ||
+                    roiX + roiWidth > pagina.largura || roiY + roiHeight > pagina.altura) continue;
+                cv::Rect janela(roiX, roiY, roiWidth, roiHeight);
+
+                // S a janela da bolha  desempacotada e rotulada, no a pgina
+                tinta.create(janela.size(), CV_8UC1);
+                for (int j = 0; j < janela.height; j++) {
+                    uint8_t* linha = tinta.ptr<uint8_t>(j);
+                    for (int i = 0; i < janela.width; i++) {
+                        linha[i] = pagina.tinta(janela.x + i, janela.y + j) ? 255 : 0;
+                    }
+                }
+                int numeroRotulos = cv::connectedComponentsWithStats(tinta, rotulos, estatisticas, centroides, 8, CV_32S);
+                ComponenteBolha& bolha = bolhas[choice];
+                bolha.componentes = numeroRotulos - 1;
+                int tintaTotal = 0;
+                int maior = 0;
+                for (int r = 1; r < numeroRotulos; r++) {
+                    int area = estatisticas.at<int>(r, cv::CC_STAT_AREA);
+                    tintaTotal += area;
+                    if (area > bolha.area) {
+                        bolha.area = area;
+                        maior = r;
+                    }
+                }
+                bolha.preenchimento = static_cast<float>(tintaTotal) / janela.area();
+                if (maior > 0) {
+                    bolha.centroX = static_cast<float>(centroides.at<double>(maior, 0) / janela.width);
+                    bolha.centroY = static_cast<float>(centroides.at<double>(maior, 1) / janela.height);
+                }
+            }
+            questoes.push_back(std::move(bolhas));
+        }
     }
+    return questoes;
+}
 
-    consoleBuffer.AddLogMessage(LogLevel::Info, "Filtro de reduo de rudo aplicado a todas as imagens com sucesso.");
+bool salvarComponentes(Logger& logger, const std::string& outputFolder, const std::string& fileName,
+    const std::vector<std::vector<ComponenteBolha>>& componentes) {
+    std::string caminho = outputFolder + "/" + fileName + "_components.csv";
+    std::ofstream arquivo(caminho);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "No foi possvel criar o arquivo de componentes: " + caminho);
+        return false;
+    }
+    arquivo << "questao;escolha;componentes;area_maior;preenchimento;centro_x;centro_y\n";
+    arquivo << std::fixed << std::setprecision(4);
+    for (size_t q = 0; q < componentes.size(); q++) {
+        for (size_t e = 0; e < componentes[q].size(); e++) {
+            const ComponenteBolha& bolha = componentes[q][e];
+            arquivo << q + 1 << ";" << e << ";" << bolha.componentes << ";" << bolha.area << ";" << bolha.preenchimento << ";"
+                << bolha.centroX << ";" << bolha.centroY << "\n";
+        }
+    }
+    return true;
 }
 
-void extrairContornos(ConsoleBuffer& consoleBuffer, const std::string& pastaOrigem, const std::string& pastaDestino, const std::string& pastaThreshold) {
+// Imagem de depurao com todos os contornos da pgina (o que a etapa gravava antes em toda execuo)
+static cv::Mat desenharContornos(const cv::Mat& imagemThreshold) {
+    int contourThickness = 5; // Ajuste a espessura do contorno conforme necessrio
+
+    std::vector<std::vector<cv::Point>> contornos;
+    cv::findContours(imagemThreshold, contornos, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
+
+    cv::Mat imagemContornos = cv::Mat::zeros(imagemThreshold.size(), CV_8UC3);
+    for (size_t i = 0; i < contornos.size(); i++) {
+        cv::Scalar cor = cv::Scalar(0, 255, 0); // Cor verde para os contornos
+        cv::drawContours(imagemContornos, contornos, static_cast<int>(i), cor, contourThickness, cv::LINE_8);
+    }
+    return imagemContornos;
+}
+
+void extrairComponentes(Logger& logger, const std::string& pastaOrigem, const std::string& pastaComponentes, const std::string& pastaThreshold,
+    const std::string& coordinatesFilePath, const TemplateRegistry* modelos, const std::string& pastaRoteamento, const std::string& pastaContornos,
+    const std::string& referenceImagePath) {
     std::vector<cv::String> arquivos;
     cv::glob(pastaOrigem + "/*.png", arquivos, false); // Adaptar o padro conforme necessrio
 
-    int contourThickness = 5; // Ajuste a espessura do contorno conforme necessrio
+    std::vector<RectangleData> retangulosPadrao = loadAnswerRectangles(coordinatesFilePath);
+    GeometriaPorPagina geometria(retangulosPadrao, modelos, pastaRoteamento);
+    bool medirBolhas = !pastaComponentes.empty() && !geometria.vazia();
+    if (!pastaComponentes.empty() && !medirBolhas) {
+        logger.AddLogMessage(LogLevel::Warning, "Sem regies do modelo: s a imagem de threshold ser gerada.");
+    }
+
+    // Mesmo registro local da leitura das respostas, para as janelas carem sobre as mesmas bolhas
+    cv::Mat mapaPadrao;
+    if (medirBolhas && !referenceImagePath.empty() && parametrosPipeline().raioRegistroLocal > 0) {
+        mapaPadrao = criarMapaRegistro(cv::imread(referenceImagePath, cv::IMREAD_COLOR));
+    }
 
-    // Cria o diretrio de sada de threshold se no existir
-    if (!criarDiretorio(consoleBuffer, pastaThreshold)) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "Failed to create threshold directory: " + pastaThreshold);
+    // Cria os diretrios de sada se no existirem
+    if (!criarDiretorio(logger, pastaThreshold) || (medirBolhas && !criarDiretorio(logger, pastaComponentes))) {
+        logger.AddLogMessage(LogLevel::Error, "Failed to create output directory: " + pastaThreshold);
         return; // Se no foi possvel criar o diretrio, aborta o processamento
     }
 
     for (const auto& arquivo : arquivos) {
         cv::Mat imagem = cv::imread(arquivo, cv::IMREAD_GRAYSCALE);
         if (imagem.empty()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + std::string(arquivo));
+            logger.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + std::string(arquivo));
             continue;
         }
 
-        // Aplica threshold adaptativo
-        cv::Mat imagemThreshold;
-        cv::adaptiveThreshold(imagem, imagemThreshold, 255, cv::ADAPTIVE_THRESH_MEAN_C, cv::THRESH_BINARY_INV, 11, 2);
+        // Aplica threshold adaptativo (entrada do OCR das regies de palavra)
+        cv::Mat imagemThreshold = calcularImagemThreshold(imagem);
 
-        // Salva a imagem de threshold na pasta de threshold
         auto pos = arquivo.find_last_of("/\\");
         std::string nomeArquivo = arquivo.substr(pos + 1);
-        salvarImagem(consoleBuffer, pastaThreshold, nomeArquivo, imagemThreshold);
-
-        // Encontra contornos
-        std::vector<std::vector<cv::Point>> contornos;
-        cv::findContours(imagemThreshold, contornos, cv::RETR_TREE, cv::CHAIN_APPROX_SIMPLE);
 
-        // Desenha contornos em uma nova imagem
-        cv::Mat imagemContornos = cv::Mat::zeros(imagem.size(), CV_8UC3);
-        for (size_t i = 0; i < contornos.size(); i++) {
-            cv::Scalar cor = cv::Scalar(0, 255, 0); // Cor verde para os contornos
-            cv::drawContours(imagemContornos, contornos, static_cast<int>(i), cor, contourThickness, cv::LINE_8);
+        if (medirBolhas) {
+            std::string nomeModelo = geometria.nomeModelo(nomeArquivo);
+            int indiceModelo = nomeModelo.empty() || modelos == nullptr ? -1 : modelos->indice(nomeModelo);
+            const cv::Mat& mapaReferencia = indiceModelo < 0 ? mapaPadrao : modelos->modelo(indiceModelo).mapaRegistro;
+            std::vector<RectangleData> rectangles = geometria.para(nomeArquivo);
+            // A pgina  binarizada como em BinarizarDinamico (Otsu), a entrada da leitura, e no pelo threshold do OCR
+            PaginaBits pagina = binarizarPaginaBits(imagem);
+            if (!mapaReferencia.empty()) {
+                rectangles = registrarRegioes(pagina, mapaReferencia, rectangles, parametrosPipeline().raioRegistroLocal);
+            }
+            salvarComponentes(logger, pastaComponentes, nomeArquivo, medirComponentesBolhas(pagina, rectangles, parametrosPipeline().leitura));
+        }
+        if (!pastaContornos.empty()) {
+            salvarImagem(logger, pastaContornos, nomeArquivo, desenharContornos(imagemThreshold));
         }
 
-        // Salva a imagem com contornos na pasta de destino
-        salvarImagem(consoleBuffer, pastaDestino, nomeArquivo, imagemContornos);
+        // Salva a imagem de threshold na pasta de threshold
+        salvarImagem(logger, pastaThreshold, nomeArquivo, std::move(imagemThreshold));
     }
 
-    consoleBuffer.AddLogMessage(LogLevel::Info, "Extrao de contornos e salvamento de imagens de threshold concludos.");
+    aguardarImagensSalvas();
+    logger.AddLogMessage(LogLevel::Info, "Componentes das bolhas e imagens de threshold salvos.");
+}
+
+void lerPerfilOcr(const std::string& restoDaLinha, RectangleData& rectData) {
+    std::istringstream campos(restoDaLinha);
+    int segmentacao, motor;
+    if (campos >> segmentacao) {
+        rectData.ocrSegmentation = segmentacao == 1 ? OcrSegmentation::SingleWord : OcrSegmentation::SingleLine;
+    }
+    if (campos >> motor) {
+        rectData.ocrEngine = motor == 1 ? OcrEngineKind::Legacy : OcrEngineKind::Lstm;
+    }
+    int reconhecedor;
+    if (campos >> reconhecedor) {
+        rectData.numberRecognizer = reconhecedor == 1 ? NumberRecognizer::DigitClassifier : NumberRecognizer::Tesseract;
+    }
 }
 
 std::vector<RectangleData> loadAnswerRectangles(const std::string& filepath) {
@@ -301,8 +609,10 @@ std::vector<RectangleData> loadAnswerRectangles(const std::string& filepath) {
 
     while (std::getline(file, name, '|')) {
         if (file >> x >> y >> z >> w >> lines >> columns >> analyzeVertical >> isWord >> isNumber) {
-            file.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Ignora o resto da linha
-            rectangles.push_back({ ImVec4(x, y, z, w), {lines, columns}, name, analyzeVertical, isWord, isNumber });
+            std::string restoDaLinha;
+            std::getline(file, restoDaLinha); // Campos opcionais do perfil de OCR
+            rectangles.push_back({ {x, y, z, w}, {lines, columns}, name, analyzeVertical, isWord, isNumber });
+            lerPerfilOcr(restoDaLinha, rectangles.back());
         }
         else {
             std::cerr << "Erro ao ler os dados do retngulo do arquivo: " << filepath << std::endl;
@@ -314,290 +624,738 @@ std::vector<RectangleData> loadAnswerRectangles(const std::string& filepath) {
     return rectangles;
 }
 
-std::vector<char> readAnswersFromRectangles(const cv::Mat& image, const std::vector<RectangleData>& rectangles, ConsoleBuffer& consoleBuffer) {
-    std::vector<char> answers;
+ParametrosLeitura ParametrosLeitura::escalados(double fator) const {
+    ParametrosLeitura escalados;
+    escalados.marginX = static_cast<int>(std::lround(marginX * fator));
+    escalados.marginY = static_cast<int>(std::lround(marginY * fator));
+    escalados.offsetX = static_cast<int>(std::lround(offsetX * fator));
+    escalados.offsetY = static_cast<int>(std::lround(offsetY * fator));
+    escalados.divisorMaximo = divisorMaximo;
+    escalados.divisorMedia = divisorMedia;
+    escalados.preenchimentoMinimo = preenchimentoMinimo;
+    escalados.escala = escala * fator;
+    return escalados;
+}
+
+LeituraQuestao decidirQuestao(const std::vector<int>& tintaPorEscolha, int areaRoi, bool isNumber, const ParametrosLeitura& parametros) {
+    return decidirQuestaoTinta<0>(tintaPorEscolha.data(), static_cast<int>(tintaPorEscolha.size()), areaRoi, isNumber, parametros);
+}
+
+// Tinta (pixels no zero) de um retngulo a partir da imagem integral de 0/1; o que cai fora da imagem conta como vazio
+static int somarTinta(const cv::Mat& integralTinta, cv::Rect retangulo) {
+    retangulo &= cv::Rect(0, 0, integralTinta.cols - 1, integralTinta.rows - 1);
+    if (retangulo.area() <= 0) return 0;
+    return integralTinta.at<int>(retangulo.y + retangulo.height, retangulo.x + retangulo.width) - integralTinta.at<int>(retangulo.y, retangulo.x + retangulo.width)
+        - integralTinta.at<int>(retangulo.y + retangulo.height, retangulo.x) + integralTinta.at<int>(retangulo.y, retangulo.x);
+}
+
+// Perfil da janela da clula (a clula inteira, deslocada pelo offset): frao de tinta de cada bloco.
+// contarTinta(retngulo) conta a tinta, com o que cai fora da imagem contando como vazio.
+template <typename ContarTinta>
+static void medirPerfilCelula(const ContarTinta& contarTinta, const cv::Rect& janela, CelulaMedida& celula) {
+    for (int by = 0; by < LADO_PERFIL_CELULA; by++) {
+        int y0 = janela.y + by * janela.height / LADO_PERFIL_CELULA;
+        int y1 = janela.y + (by + 1) * janela.height / LADO_PERFIL_CELULA;
+        for (int bx = 0; bx < LADO_PERFIL_CELULA; bx++) {
+            int x0 = janela.x + bx * janela.width / LADO_PERFIL_CELULA;
+            int x1 = janela.x + (bx + 1) * janela.width / LADO_PERFIL_CELULA;
+            int area = (x1 - x0) * (y1 - y0);
+            int tinta = contarTinta(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+            celula.perfil[by * LADO_PERFIL_CELULA + bx] = area > 0 ? static_cast<uint8_t>(std::lround(255.0 * tinta / area)) : 0;
+        }
+    }
+}
+
+void medirPerfilCelula(const PaginaBits& pagina, const cv::Rect& janela, CelulaMedida& celula) {
+    medirPerfilCelula([&](const cv::Rect& bloco) { return pagina.contarTinta(bloco); }, janela, celula);
+}
+
+// Leitura comum s pginas em 8 bits e empacotadas. contarRoi conta a tinta de uma ROI j dentro da
+// imagem; contarPerfil  usada s nas medies (ver medirPerfilCelula).
+template <typename ContarRoi, typename ContarPerfil>
+static std::vector<LeituraQuestao> lerRespostas(cv::Size tamanhoImagem, const ContarRoi& contarRoi, const ContarPerfil& contarPerfil,
+    const std::vector<RectangleData>& rectangles, Logger& logger, const ParametrosLeitura& parametros, MedicoesPagina* medicoes) {
+    std::vector<LeituraQuestao> answers;
+
+    if (medicoes != nullptr) {
+        medicoes->regioes.clear();
+        medicoes->questoes.clear();
+    }
 
     for (const auto& rectData : rectangles) {
-        int x = static_cast<int>(rectData.coordinates.x * image.cols);
-        int y = static_cast<int>(rectData.coordinates.y * image.rows);
-        int width = static_cast<int>((rectData.coordinates.z - rectData.coordinates.x) * image.cols);
-        int height = static_cast<int>((rectData.coordinates.w - rectData.coordinates.y) * image.rows);
+        int x = static_cast<int>(rectData.coordinates.x * tamanhoImagem.width);
+        int y = static_cast<int>(rectData.coordinates.y * tamanhoImagem.height);
+        int width = static_cast<int>((rectData.coordinates.z - rectData.coordinates.x) * tamanhoImagem.width);
+        int height = static_cast<int>((rectData.coordinates.w - rectData.coordinates.y) * tamanhoImagem.height);
         int cellWidth = width / rectData.subdivisions.second;
         int cellHeight = height / rectData.subdivisions.first;
 
         int numAlternatives = rectData.analyzeVertical ? rectData.subdivisions.first : rectData.subdivisions.second;
         int numChoices = rectData.analyzeVertical ? rectData.subdivisions.second : rectData.subdivisions.first;
 
+        if (medicoes != nullptr) {
+            medicoes->regioes.push_back({ rectData.name, rectData.subdivisions, rectData.analyzeVertical, rectData.isNumber });
+        }
+
         for (int alt = 0; alt < numAlternatives; ++alt) {
             int subX = x + (rectData.analyzeVertical ? 0 : alt * cellWidth);
             int subY = y + (rectData.analyzeVertical ? alt * cellHeight : 0);
 
-            char selectedAnswer = 'X';
-            int maxWhitePixels = 0;
-            int totalWhitePixels = 0; // Total de pixels brancos para calcular a mdia
             std::vector<int> whitePixelsPerChoice(numChoices, 0); // Pixels brancos por escolha
 
+            int roiWidth = cellWidth - 2 * parametros.marginX;
+            int roiHeight = cellHeight - 2 * parametros.marginY;
+
+            MedicaoQuestao* medicao = nullptr;
+            if (medicoes != nullptr) {
+                medicoes->questoes.emplace_back();
+                medicao = &medicoes->questoes.back();
+                medicao->regiao = static_cast<int>(medicoes->regioes.size()) - 1;
+                medicao->escala = static_cast<float>(parametros.escala);
+                medicao->larguraJanela = static_cast<uint16_t>(std::max(cellWidth, 0));
+                medicao->alturaJanela = static_cast<uint16_t>(std::max(cellHeight, 0));
+                medicao->margemX = static_cast<uint16_t>(std::max(parametros.marginX, 0));
+                medicao->margemY = static_cast<uint16_t>(std::max(parametros.marginY, 0));
+                medicao->celulas.resize(numChoices);
+            }
+
             for (int choice = 0; choice < numChoices; ++choice) {
-                int roiX = subX + (rectData.analyzeVertical ? choice * cellWidth : 0) + marginX + offsetX;
-                int roiY = subY + (rectData.analyzeVertical ? 0 : choice * cellHeight) + marginY + offsetY;
-                int roiWidth = cellWidth - 2 * marginX;
-                int roiHeight = cellHeight - 2 * marginY;
+                int roiX = subX + (rectData.analyzeVertical ? choice * cellWidth : 0) + parametros.marginX + parametros.offsetX;
+                int roiY = subY + (rectData.analyzeVertical ? 0 : choice * cellHeight) + parametros.marginY + parametros.offsetY;
 
                 // Verifica se a ROI ajustada est dentro dos limites da imagem
-                if (roiX >= 0 && roiY >= 0 && roiX + roiWidth <= image.cols && roiY + roiHeight <= image.rows) {
-                    cv::Rect roi(roiX, roiY, roiWidth, roiHeight);
-                    cv::Mat region = image(roi);
-
-                    // Salva a ROI para debug
-                    //std::string nomeArquivo = "roi_alt_" + std::to_string(alt) + "_choice_" + std::to_string(choice) + ".png";
-                    //salvarImagem(consoleBuffer, "ROIs", nomeArquivo, region);
-
+                if (roiX >= 0 && roiY >= 0 && roiX + roiWidth <= tamanhoImagem.width && roiY + roiHeight <= tamanhoImagem.height) {
                     // Conta pixels no zero (brancos) na ROI
-                    int whitePixels = cv::countNonZero(region);
-                    whitePixelsPerChoice[choice] = whitePixels;
-                    totalWhitePixels += whitePixels;
-
-                    if (whitePixels > maxWhitePixels) {
-                        maxWhitePixels = whitePixels;
-                        selectedAnswer = 'A' + choice; // 'A', 'B', 'C', ou 'D', etc.
-                        if (rectData.isNumber) selectedAnswer = '0' + choice;
-                    }
+                    whitePixelsPerChoice[choice] = contarRoi(cv::Rect(roiX, roiY, roiWidth, roiHeight));
                 }
                 else {
-                    consoleBuffer.AddLogMessage(LogLevel::Warning, "ROI fora dos limites: (" + std::to_string(roiX) + ", " + std::to_string(roiY) + ")");
+                    logger.AddLogMessage(LogLevel::Warning, "ROI fora dos limites: (" + std::to_string(roiX) + ", " + std::to_string(roiY) + ")");
+                }
+
+                if (medicao != nullptr) {
+                    CelulaMedida& celula = medicao->celulas[choice];
+                    celula.tinta = static_cast<uint32_t>(whitePixelsPerChoice[choice]);
+                    celula.dentro = roiX >= 0 && roiY >= 0 && roiX + roiWidth <= tamanhoImagem.width && roiY + roiHeight <= tamanhoImagem.height;
+                    cv::Rect janela(roiX - parametros.marginX, roiY - parametros.marginY, cellWidth, cellHeight);
+                    medirPerfilCelula(contarPerfil, janela, celula);
                 }
             }
 
-            // Calcula a mdia dos pixels brancos
-            int averageWhitePixels = totalWhitePixels / numChoices;
+            answers.push_back(decidirQuestao(whitePixelsPerChoice, roiWidth * roiHeight, rectData.isNumber, parametros));
+        }
+    }
 
-            // Calcula o dynamic threshold
-            int dynamicThreshold = ((maxWhitePixels / 2) + (averageWhitePixels)/1.5);
-            int selectedCount = 0;
+    return answers;
+}
 
-            // Conta quantas escolhas esto acima do threshold dinmico
-            for (int choice = 0; choice < numChoices; ++choice) {
-                if (whitePixelsPerChoice[choice] > dynamicThreshold) {
-                    selectedCount++;
-                }
-            }
+std::vector<LeituraQuestao> readAnswersWithConfidence(const cv::Mat& image, const std::vector<RectangleData>& rectangles, Logger& logger, const ParametrosLeitura& parametros,
+    MedicoesPagina* medicoes) {
+    // As medies usam uma imagem integral da tinta para o perfil das clulas
+    cv::Mat integralTinta;
+    if (medicoes != nullptr) {
+        cv::Mat tinta;
+        cv::threshold(image, tinta, 0, 1, cv::THRESH_BINARY);
+        cv::integral(tinta, integralTinta, CV_32S);
+    }
 
-            // Se mais de uma escolha est acima do threshold, marque como 'X'
-            if (selectedCount > 1) {
-                selectedAnswer = 'X';
-            }
-            else if (selectedCount == 0) {
-                selectedAnswer = 'V';
-            }
+    return lerRespostas(image.size(),
+        [&](const cv::Rect& roi) { return cv::countNonZero(image(roi)); },
+        [&](const cv::Rect& bloco) { return somarTinta(integralTinta, bloco); },
+        rectangles, logger, parametros, medicoes);
+}
 
+std::vector<LeituraQuestao> readAnswersWithConfidence(const PaginaBits& pagina, const std::vector<RectangleData>& rectangles, Logger& logger, const ParametrosLeitura& parametros,
+    MedicoesPagina* medicoes) {
+    auto contarTinta = [&](const cv::Rect& retangulo) { return pagina.contarTinta(retangulo); };
+    return lerRespostas(pagina.tamanho(), contarTinta, contarTinta, rectangles, logger, parametros, medicoes);
+}
 
-            answers.push_back(selectedAnswer);
+std::vector<char> readAnswersFromRectangles(const cv::Mat& image, const std::vector<RectangleData>& rectangles, Logger& logger) {
+    std::vector<LeituraQuestao> leituras = readAnswersWithConfidence(image, rectangles, logger, parametrosPipeline().leitura);
+    std::vector<char> answers;
+    answers.reserve(leituras.size());
+    for (const auto& leitura : leituras) {
+        answers.push_back(leitura.resposta);
+    }
+    return answers;
+}
+
+bool salvarRespostas(Logger& logger, const std::string& outputFolder, const std::string& fileName,
+    const std::vector<RectangleData>& rectangles, const std::vector<LeituraQuestao>& leituras) {
+    // Salva as respostas no diretrio de sada
+    std::string outputFilePath = outputFolder + "/" + fileName + "_answers.txt";
+    std::ofstream outputFile(outputFilePath);
+    if (!outputFile.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "Erro ao salvar as respostas: " + outputFilePath);
+        return false;
+    }
+
+    // A confiana de cada questo vai para um arquivo separado para no mudar o formato das respostas
+    std::string confidenceFilePath = outputFolder + "/" + fileName + "_confidence.csv";
+    std::ofstream confidenceFile(confidenceFilePath);
+
+    size_t answerIndex = 0;
+    for (const auto& rectData : rectangles) {
+        int numSubdivisions = rectData.analyzeVertical ? rectData.subdivisions.first : rectData.subdivisions.second;
+        for (int sub = 0; sub < numSubdivisions && answerIndex < leituras.size(); ++sub) {
+            const LeituraQuestao& leitura = leituras[answerIndex++];
+            outputFile << rectData.name << " Subdivision " << sub + 1 << ": " << leitura.resposta << std::endl;
+            if (confidenceFile.is_open()) {
+                confidenceFile << rectData.name << ";" << sub + 1 << ";" << leitura.resposta << ";"
+                    << std::fixed << std::setprecision(3) << leitura.confianca << "\n";
+            }
         }
     }
 
-    return answers;
+    outputFile.close();
+    logger.AddLogMessage(LogLevel::Info, "Respostas salvas em: " + outputFilePath);
+    return true;
 }
 
-void processImagesAndReadAnswers(ConsoleBuffer& consoleBuffer, const std::string& contourImageFolder, const std::string& coordinatesFilePath, const std::string& outputFolder) {
+void processImagesAndReadAnswers(Logger& logger, const std::string& contourImageFolder, const std::string& coordinatesFilePath, const std::string& outputFolder,
+    const TemplateRegistry* modelos, const std::string& pastaRoteamento, ProgressoLeitura* progresso, const std::string& referenceImagePath) {
+    // Pginas binarizadas em PBM de 1 bit (BinarizarDinamico) ou, em pastas antigas, PNG
     std::vector<std::string> filenames;
-    cv::glob(contourImageFolder + "/*.png", filenames, false);
+    cv::glob(contourImageFolder + "/*.pbm", filenames, false);
+    bool paginasEmBits = !filenames.empty();
+    if (!paginasEmBits) {
+        cv::glob(contourImageFolder + "/*.png", filenames, false);
+    }
+    if (progresso != nullptr) {
+        progresso->iniciar(static_cast<int>(filenames.size()));
+    }
 
-    std::vector<RectangleData> rectangles = loadAnswerRectangles(coordinatesFilePath);
-    if (rectangles.empty()) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "Failed to load answer areas from file: " + coordinatesFilePath);
+    std::vector<RectangleData> retangulosPadrao = loadAnswerRectangles(coordinatesFilePath);
+    GeometriaPorPagina geometria(retangulosPadrao, modelos, pastaRoteamento);
+    if (geometria.vazia()) {
+        logger.AddLogMessage(LogLevel::Error, "Failed to load answer areas from file: " + coordinatesFilePath);
         return;
     }
 
     // Cria o diretrio de sada se no existir
-    if (!criarDiretorio(consoleBuffer, outputFolder)) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "Failed to create output directory: " + outputFolder);
+    if (!criarDiretorio(logger, outputFolder)) {
+        logger.AddLogMessage(LogLevel::Error, "Failed to create output directory: " + outputFolder);
         return; // Se no foi possvel criar o diretrio, aborta o processamento
     }
 
-    for (const auto& filename : filenames) {
-        cv::Mat image = cv::imread(filename, cv::IMREAD_GRAYSCALE);
-        if (image.empty()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + filename);
-            continue;
-        }
+    // Medies das clulas para reler o lote com outro critrio sem as imagens
+    ArquivoMedicoes arquivoMedicoes;
+    arquivoMedicoes.abrir(logger, outputFolder);
 
-        std::vector<char> answers = readAnswersFromRectangles(image, rectangles, consoleBuffer);
+    // Mapa de tinta da referncia da geometria padro, para o registro local
+    cv::Mat mapaPadrao;
+    if (!referenceImagePath.empty() && parametrosPipeline().raioRegistroLocal > 0) {
+        mapaPadrao = criarMapaRegistro(cv::imread(referenceImagePath, cv::IMREAD_COLOR));
+    }
+    int regioesDeslocadas = 0;
+
+    // As pginas so carregadas e registradas uma a uma e lidas em lotes de TAMANHO_LOTE_LEITURA (BatchReader.h)
+    struct PaginaCarregada {
+        PaginaBits pagina;
+        std::string fileName;
+        std::string nomeModelo;
+        std::vector<RectangleData> rectangles;
+        MedicoesPagina medicoes;
+    };
+    for (size_t inicio = 0; inicio < filenames.size(); inicio += TAMANHO_LOTE_LEITURA) {
+        size_t fim = std::min(filenames.size(), inicio + TAMANHO_LOTE_LEITURA);
+        std::vector<PaginaCarregada> lote;
+        lote.reserve(fim - inicio);
+
+        for (size_t i = inicio; i < fim; i++) {
+            const std::string& filename = filenames[i];
+            // As pginas em PNG (pastas antigas) tambm so empacotadas: a leitura  a mesma nos dois formatos
+            PaginaBits pagina;
+            bool carregada = false;
+            if (paginasEmBits) {
+                carregada = lerPbm(filename, pagina);
+            }
+            else {
+                cv::Mat image = cv::imread(filename, cv::IMREAD_GRAYSCALE);
+                carregada = !image.empty();
+                if (carregada) pagina = empacotarPagina(image);
+            }
+            if (!carregada) {
+                logger.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + filename);
+                continue;
+            }
 
-        // Extrai o nome do arquivo do caminho completo
-        auto pos = filename.find_last_of("/\\");
-        std::string fileName = filename.substr(pos + 1);
+            // Extrai o nome do arquivo do caminho completo; o PBM de page_N.png continua sendo "page_N.png"
+            // nas respostas, no roteamento dos modelos e nas medies
+            auto pos = filename.find_last_of("/\\");
+            std::string fileName = filename.substr(pos + 1);
+            if (paginasEmBits) {
+                fileName = std::filesystem::path(fileName).stem().string() + ".png";
+            }
 
-        // Salva as respostas no diretrio de sada
-        std::string outputFilePath = outputFolder + "/" + fileName + "_answers.txt";
-        std::ofstream outputFile(outputFilePath);
-        if (!outputFile.is_open()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao salvar as respostas: " + outputFilePath);
-            continue;
+            std::string nomeModelo = geometria.nomeModelo(fileName);
+            int indiceModelo = nomeModelo.empty() || modelos == nullptr ? -1 : modelos->indice(nomeModelo);
+            const cv::Mat& mapaReferencia = indiceModelo < 0 ? mapaPadrao : modelos->modelo(indiceModelo).mapaRegistro;
+            int deslocadasPagina = 0;
+            std::vector<RectangleData> rectangles = registrarRegioes(pagina, mapaReferencia, geometria.para(fileName),
+                parametrosPipeline().raioRegistroLocal, &deslocadasPagina);
+            regioesDeslocadas += deslocadasPagina;
+
+            lote.emplace_back();
+            PaginaCarregada& paginaCarregada = lote.back();
+            paginaCarregada.pagina = std::move(pagina);
+            paginaCarregada.fileName = fileName;
+            paginaCarregada.nomeModelo = nomeModelo;
+            paginaCarregada.rectangles = std::move(rectangles);
+            paginaCarregada.medicoes.fileName = fileName;
+            paginaCarregada.medicoes.modelo = nomeModelo;
         }
 
-        int answerIndex = 0;
-        for (const auto& rectData : rectangles) {
-            int numSubdivisions = rectData.analyzeVertical ? rectData.subdivisions.first : rectData.subdivisions.second;
-            for (int sub = 0; sub < numSubdivisions; ++sub) {
-                outputFile << rectData.name << " Subdivision " << sub + 1 << ": " << answers[answerIndex++] << std::endl;
+        std::vector<PaginaLote> paginasLote;
+        paginasLote.reserve(lote.size());
+        for (auto& paginaCarregada : lote) {
+            paginasLote.push_back({ &paginaCarregada.pagina, &paginaCarregada.rectangles, arquivoMedicoes.aberto() ? &paginaCarregada.medicoes : nullptr });
+        }
+        std::vector<std::vector<LeituraQuestao>> leituras = lerRespostasEmLote(logger, paginasLote, parametrosPipeline().leitura);
+
+        for (size_t k = 0; k < lote.size(); k++) {
+            const PaginaCarregada& paginaCarregada = lote[k];
+            const std::vector<LeituraQuestao>& answers = leituras[k];
+            salvarRespostas(logger, outputFolder, paginaCarregada.fileName, paginaCarregada.rectangles, answers);
+            if (arquivoMedicoes.aberto()) {
+                arquivoMedicoes.gravar(paginaCarregada.medicoes);
+            }
+            if (progresso != nullptr) {
+                // A miniatura sai direto dos bits, sem desempacotar a pgina
+                cv::Mat miniatura = reduzirPagina(paginaCarregada.pagina, LARGURA_MINIATURA_PROGRESSO);
+                progresso->publicar(montarResultadoParcial(paginaCarregada.fileName, paginaCarregada.nomeModelo, paginaCarregada.rectangles,
+                    answers, miniatura, progresso->limiarDuvida));
             }
         }
+    }
 
-        outputFile.close();
-        consoleBuffer.AddLogMessage(LogLevel::Info, "Respostas salvas em: " + outputFilePath);
+    if (regioesDeslocadas > 0) {
+        logger.AddLogMessage(LogLevel::Info, std::to_string(regioesDeslocadas) + " regies reposicionadas pelo registro local.");
     }
 }
 
-std::string extractWordsFromRegion(const cv::Mat& image, const cv::Rect& region) {
-    // Corte a regio de interesse (ROI) da imagem
-    cv::Mat roi = image(region);
+// Frao mnima de pixels de tinta para uma regio de palavras ir para o OCR
+const double DENSIDADE_MINIMA_TINTA = 0.005;
+
+// Checagem barata de regio vazia: conta os pixels de tinta (brancos na imagem de threshold)
+// no miolo da regio, ignorando uma faixa de 10% nas bordas onde ficam as linhas da caixa
+bool regiaoTemTinta(const cv::Mat& image, const cv::Rect& region) {
+    int bordaX = region.width / 10;
+    int bordaY = region.height / 10;
+    cv::Rect miolo(region.x + bordaX, region.y + bordaY, region.width - 2 * bordaX, region.height - 2 * bordaY);
+    if (miolo.area() <= 0) {
+        return false;
+    }
+
+    int pixelsTinta = cv::countNonZero(image(miolo));
+    return pixelsTinta >= DENSIDADE_MINIMA_TINTA * miolo.area();
+}
+
+TextoRegiao extractWordsFromRegion(tesseract::TessBaseAPI& ocr, const RectangleData& rectData, const cv::Rect& region) {
+    // A pgina j foi enviada com SetImage; aqui s restringimos a busca  regio
+    ocr.SetPageSegMode(rectData.ocrSegmentation == OcrSegmentation::SingleWord ? tesseract::PSM_SINGLE_WORD : tesseract::PSM_SINGLE_LINE);
+    ocr.SetVariable("tessedit_char_whitelist", rectData.isNumber ? "0123456789" : "");
+    ocr.SetRectangle(region.x, region.y, region.width, region.height);
 
-    // Inicialize o Tesseract OCR
-    tesseract::TessBaseAPI* ocr = new tesseract::TessBaseAPI();
-    if (ocr->Init(NULL, "eng")) {
-        std::cerr << "Could not initialize tesseract.\n";
-        return "";
+    // Realize o OCR na regio e obtenha o texto (o buffer retornado  nosso e precisa ser liberado)
+    TextoRegiao resultado;
+    char* texto = ocr.GetUTF8Text();
+    resultado.texto = texto ? std::string(texto) : "";
+    resultado.confianca = ocr.MeanTextConf() / 100.0f;
+    delete[] texto;
+
+    // Uma regio vira uma linha no registro da pgina
+    std::replace(resultado.texto.begin(), resultado.texto.end(), '\n', ' ');
+    resultado.texto.erase(resultado.texto.find_last_not_of(" \t") + 1);
+
+    return resultado;
+}
+
+// L um campo numrico escrito em caixas (uma por subdiviso) com o classificador de dgitos.
+// A confiana do campo  a menor entre as caixas preenchidas.
+TextoRegiao lerDigitosDasCaixas(const cv::Mat& image, const RectangleData& rectData, const cv::Rect& region) {
+    TextoRegiao resultado;
+    resultado.confianca = 1.0f;
+
+    std::shared_ptr<const DigitClassifier> classificador = classificadorDigitos();
+    int lines = std::max(1, rectData.subdivisions.first);
+    int columns = std::max(1, rectData.subdivisions.second);
+    int cellWidth = region.width / columns;
+    int cellHeight = region.height / lines;
+
+    for (int l = 0; l < lines; l++) {
+        for (int c = 0; c < columns; c++) {
+            // Descarta 15% de cada lado para no pegar as linhas da caixa
+            int bordaX = cellWidth * 15 / 100;
+            int bordaY = cellHeight * 15 / 100;
+            cv::Rect caixa(region.x + c * cellWidth + bordaX, region.y + l * cellHeight + bordaY, cellWidth - 2 * bordaX, cellHeight - 2 * bordaY);
+            if (caixa.area() <= 0) {
+                continue;
+            }
+
+            ResultadoDigito digito = classificador->classificar(image(caixa));
+            resultado.texto += digito.digito;
+            if (digito.digito != ' ') {
+                resultado.confianca = std::min(resultado.confianca, digito.confianca);
+            }
+        }
     }
 
-    // Converta a imagem para o formato que o Tesseract entende
-    ocr->SetImage(roi.data, roi.cols, roi.rows, roi.elemSize(), roi.step);
+    resultado.texto.erase(resultado.texto.find_last_not_of(' ') + 1);
+    return resultado;
+}
 
-    // Realize o OCR na ROI e obtenha o texto
-    std::string extractedText = std::string(ocr->GetUTF8Text());
+std::vector<TextoRegiao> extrairPalavrasDaPagina(Logger& logger, OcrEnginePool& ocrEngines, const cv::Mat& image,
+    const std::vector<const RectangleData*>& regioesPalavra, int* numeroRegioesVazias) {
+    cv::Rect limites(0, 0, image.cols, image.rows);
+    uint64_t paginaId = ocrEngines.novaPagina();
+    std::atomic<int> regioesVazias{ 0 };
 
-    // Limpe
-    ocr->End();
-    delete ocr;
+    // Distribui as regies da pgina entre as engines do pool (uma por worker)
+    std::vector<TextoRegiao> textos(regioesPalavra.size());
+    ThreadPool::global().parallelFor(static_cast<int>(regioesPalavra.size()), [&](int i, int slot) {
+        const RectangleData& rectData = *regioesPalavra[i];
+        int x = static_cast<int>(rectData.coordinates.x * image.cols);
+        int y = static_cast<int>(rectData.coordinates.y * image.rows);
+        int width = static_cast<int>((rectData.coordinates.z - rectData.coordinates.x) * image.cols);
+        int height = static_cast<int>((rectData.coordinates.w - rectData.coordinates.y) * image.rows);
 
-    return extractedText;
+        cv::Rect region = cv::Rect(x, y, width, height) & limites;
+        if (!regiaoTemTinta(image, region)) {
+            textos[i].vazia = true;
+            regioesVazias++;
+            return;
+        }
+
+        if (rectData.isNumber && rectData.numberRecognizer == NumberRecognizer::DigitClassifier) {
+            textos[i] = lerDigitosDasCaixas(image, rectData, region);
+            return;
+        }
+
+        // O slot externo  compartilhado por todas as threads fora do pool: SetImage e o OCR ficam sob a trava
+        std::unique_lock<std::mutex> travaSlot = ocrEngines.travarSlot(slot);
+        tesseract::TessBaseAPI* ocr = ocrEngines.engineParaPagina(slot, rectData.ocrEngine, image, paginaId);
+        if (ocr == nullptr) {
+            logger.AddLogMessage(LogLevel::Error, "Could not initialize tesseract.");
+            return;
+        }
+
+        textos[i] = extractWordsFromRegion(*ocr, rectData, region);
+    });
+
+    if (numeroRegioesVazias != nullptr) {
+        *numeroRegioesVazias = regioesVazias.load();
+    }
+    return textos;
+}
+
+bool salvarPalavras(Logger& logger, const std::string& outputFolder, const std::string& baseName,
+    const std::vector<const RectangleData*>& regioesPalavra, const std::vector<TextoRegiao>& textos, int regioesVazias) {
+    // Salva todas as regies da pgina em um nico registro, uma linha por regio
+    std::string outputFilePath = outputFolder + "/" + baseName + "_words.txt";
+    std::ofstream outputFile(outputFilePath);
+    if (!outputFile.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "Erro ao salvar as palavras: " + outputFilePath);
+        return false;
+    }
+
+    // Formato da linha: "nome: texto | confiana", com "vazia" no lugar da confiana se a regio foi ignorada
+    for (size_t i = 0; i < regioesPalavra.size(); i++) {
+        outputFile << regioesPalavra[i]->name << ": " << textos[i].texto << " | ";
+        if (textos[i].vazia) {
+            outputFile << "vazia";
+        }
+        else {
+            outputFile << std::fixed << std::setprecision(2) << textos[i].confianca;
+        }
+        outputFile << "\n";
+    }
+
+    outputFile.close();
+    logger.AddLogMessage(LogLevel::Info, "Palavras extradas salvas em: " + outputFilePath
+        + " (" + std::to_string(regioesVazias) + " regies vazias ignoradas)");
+    return true;
 }
 
-void processImagesAndExtractWords(ConsoleBuffer& consoleBuffer, const std::string& imageFolder, const std::string& coordinatesFilePath, const std::string& outputFolder) {
+void processImagesAndExtractWords(Logger& logger, OcrEnginePool& ocrEngines, const std::string& imageFolder, const std::string& coordinatesFilePath, const std::string& outputFolder,
+    const TemplateRegistry* modelos, const std::string& pastaRoteamento) {
     std::vector<std::string> filenames;
     cv::glob(imageFolder + "/*.png", filenames, false);
 
-    std::vector<RectangleData> rectangles = loadAnswerRectangles(coordinatesFilePath);
-    if (rectangles.empty()) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "Failed to load regions from file: " + coordinatesFilePath);
+    std::vector<RectangleData> retangulosPadrao = loadAnswerRectangles(coordinatesFilePath);
+    GeometriaPorPagina geometria(retangulosPadrao, modelos, pastaRoteamento);
+    if (geometria.vazia()) {
+        logger.AddLogMessage(LogLevel::Error, "Failed to load regions from file: " + coordinatesFilePath);
         return;
     }
 
     // Cria o diretrio de sada se no existir
-    if (!criarDiretorio(consoleBuffer, outputFolder)) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "Failed to create output directory: " + outputFolder);
+    if (!criarDiretorio(logger, outputFolder)) {
+        logger.AddLogMessage(LogLevel::Error, "Failed to create output directory: " + outputFolder);
         return; // Se no foi possvel criar o diretrio, aborta o processamento
     }
 
     for (const auto& filename : filenames) {
         cv::Mat image = cv::imread(filename, cv::IMREAD_GRAYSCALE);
         if (image.empty()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + filename);
+            logger.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + filename);
             continue;
         }
 
-        // Processa cada regio definida
-        for (const auto& rectData : rectangles) {
-            if (!rectData.isWord) {
-                continue; // Ignora retngulos que no so palavras
-            }
-            int x = static_cast<int>(rectData.coordinates.x * image.cols);
-            int y = static_cast<int>(rectData.coordinates.y * image.rows);
-            int width = static_cast<int>((rectData.coordinates.z - rectData.coordinates.x) * image.cols);
-            int height = static_cast<int>((rectData.coordinates.w - rectData.coordinates.y) * image.rows);
+        // Extrai o nome do arquivo do caminho completo
+        auto pos = filename.find_last_of("/\\");
+        std::string fileName = filename.substr(pos + 1);
+        std::string baseName = fileName.substr(0, fileName.find_last_of('.'));
 
-            cv::Rect region(x, y, width, height);
-            std::string extractedWords = extractWordsFromRegion(image, region);
+        // Somente os retngulos marcados como palavra passam pelo OCR
+        std::vector<const RectangleData*> regioesPalavra;
+        for (const auto& rectData : geometria.para(fileName)) {
+            if (rectData.isWord) {
+                regioesPalavra.push_back(&rectData);
+            }
+        }
 
-            // Extrai o nome do arquivo do caminho completo
-            auto pos = filename.find_last_of("/\\");
-            std::string fileName = filename.substr(pos + 1);
-            std::string baseName = fileName.substr(0, fileName.find_last_of('.'));
+        int regioesVazias = 0;
+        std::vector<TextoRegiao> textos = extrairPalavrasDaPagina(logger, ocrEngines, image, regioesPalavra, &regioesVazias);
+        salvarPalavras(logger, outputFolder, baseName, regioesPalavra, textos, regioesVazias);
+    }
+}
 
-            // Salva o texto extrado no diretrio de sada
-            std::string outputFilePath = outputFolder + "/" + baseName + "_region_" + rectData.name + "_words.txt";
-            std::ofstream outputFile(outputFilePath);
-            if (!outputFile.is_open()) {
-                consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao salvar as palavras: " + outputFilePath);
-                continue;
-            }
+void treinarClassificadorDigitos(Logger& logger, const std::string& pastaAmostras, const std::string& arquivoModelo) {
+    // Treina uma cpia e s troca o classificador compartilhado no fim; dois treinos no se sobrepem
+    static std::mutex mutexTreino;
+    std::lock_guard<std::mutex> lock(mutexTreino);
+    auto classificador = std::make_shared<DigitClassifier>(*classificadorDigitos());
+    int lidas = classificador->treinar(pastaAmostras);
+    if (lidas == 0) {
+        logger.AddLogMessage(LogLevel::Error, "Nenhuma amostra de dgito encontrada em: " + pastaAmostras + " (esperado <pasta>/<dgito>/*.png)");
+        return;
+    }
 
-            outputFile << "Extracted Words for " << rectData.name << ":\n" << extractedWords;
-            outputFile.close();
-            consoleBuffer.AddLogMessage(LogLevel::Info, "Palavras extradas salvas em: " + outputFilePath);
-        }
+    if (!classificador->salvar(arquivoModelo)) {
+        logger.AddLogMessage(LogLevel::Error, "Erro ao salvar o modelo de dgitos: " + arquivoModelo);
+        return;
     }
+
+    substituirClassificadorDigitos(classificador);
+    logger.AddLogMessage(LogLevel::Info, std::to_string(lidas) + " amostras adicionadas; modelo com "
+        + std::to_string(classificador->numeroAmostrasLocais()) + " amostras locais salvo em: " + arquivoModelo);
 }
 
 void binarizarImagemDinamico(cv::Mat& image) {
     // Converte a imagem para escala de cinza
     cv::Mat grayImage;
-    cv::cvtColor(image, grayImage, cv::COLOR_BGR2GRAY);
+    cvtColorEmBlocos(image, grayImage, cv::COLOR_BGR2GRAY, 1);
 
-    // Calcula o threshold usando o mtodo de Otsu
-    double otsuThreshold = cv::threshold(grayImage, grayImage, 0, 255, cv::THRESH_BINARY_INV | cv::THRESH_OTSU);
+    // Calcula o threshold usando o mtodo de Otsu sobre o histograma da pgina inteira
+    int histograma[256];
+    calcularHistogramaEmBlocos(grayImage, histograma);
+    double otsuThreshold = calcularThresholdOtsu(histograma, grayImage.rows * grayImage.cols);
 
-    // Aplica o limiar calculado
-    cv::threshold(grayImage, grayImage, otsuThreshold, 255, cv::THRESH_BINARY);
+    // Aplica as duas passadas originais (THRESH_BINARY_INV com Otsu e depois THRESH_BINARY
+    // com o mesmo limiar) bloco a bloco, enquanto o bloco ainda est no cache
+    executarEmBlocos(grayImage.size(), 0, [&](int, const cv::Rect& bloco, const cv::Rect&) {
+        cv::Mat regiao = grayImage(bloco);
+        cv::threshold(regiao, regiao, otsuThreshold, 255, cv::THRESH_BINARY_INV);
+        cv::threshold(regiao, regiao, otsuThreshold, 255, cv::THRESH_BINARY);
+    });
 
     // Converte a imagem de volta para BGR
-    cv::cvtColor(grayImage, image, cv::COLOR_GRAY2BGR);
+    cvtColorEmBlocos(grayImage, image, cv::COLOR_GRAY2BGR, 3);
+}
+
+PaginaBits binarizarPaginaBits(const cv::Mat& image) {
+    cv::Mat grayImage;
+    if (image.channels() == 1) {
+        grayImage = image;
+    }
+    else {
+        cvtColorEmBlocos(image, grayImage, image.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY, 1);
+    }
+
+    int histograma[256];
+    calcularHistogramaEmBlocos(grayImage, histograma);
+    double otsuThreshold = calcularThresholdOtsu(histograma, grayImage.rows * grayImage.cols);
+
+    // As duas passadas de binarizarImagemDinamico deixam tinta onde cinza <= floor(limiar) (THRESH_BINARY_INV)
+    // e a segunda s a mantm se 255 > floor(limiar); com limiar >= 255 a pgina fica sem tinta
+    int limiar = static_cast<int>(std::floor(otsuThreshold));
+    return empacotarPagina(grayImage, limiar < 255 ? limiar : -1);
 }
 
-void BinarizarDinamico(ConsoleBuffer& consoleBuffer, const std::string& pastaOrigem, const std::string& pastaDestino) {
+PaginaBits reduzirRuidoEBinarizar(const cv::Mat& imagem, cv::Mat* semRuido, cv::Mat* cinzaSemRuido) {
+    cv::Mat imagemFiltrada = filtrarBilateral(imagem);
+
+    int tolerancia, intensidadeMinima;
+    calcularParametrosDinamicos(imagemFiltrada, tolerancia, intensidadeMinima);
+
+    // Uma passada por bloco: remove o cinza leve, converte o bloco para cinza e soma o histograma
+    // enquanto o bloco ainda est no cache. O resultado  o mesmo de reduzirRuido + binarizarPaginaBits.
+    cv::Mat cinza(imagemFiltrada.size(), CV_8UC1);
+    std::vector<std::vector<int>> parciais(numeroDeBlocos(imagemFiltrada.size()), std::vector<int>(256, 0));
+    executarEmBlocos(imagemFiltrada.size(), 0, [&](int indice, const cv::Rect& bloco, const cv::Rect&) {
+        for (int y = bloco.y; y < bloco.y + bloco.height; y++) {
+            cv::Vec3b* linha = imagemFiltrada.ptr<cv::Vec3b>(y);
+            for (int x = bloco.x; x < bloco.x + bloco.width; x++) {
+                cv::Vec3b& pixel = linha[x];
+
+                int blue = pixel[0];
+                int green = pixel[1];
+                int red = pixel[2];
+
+                int intensity = (red + green + blue) / 3;
+                if (abs(red - green) < tolerancia && abs(red - blue) < tolerancia && abs(green - blue) < tolerancia && intensity > intensidadeMinima) {
+                    pixel = cv::Vec3b(255, 255, 255);
+                }
+            }
+        }
+
+        cv::Mat cinzaBloco = cinza(bloco);
+        cv::cvtColor(imagemFiltrada(bloco), cinzaBloco, cv::COLOR_BGR2GRAY);
+
+        std::vector<int>& parcial = parciais[indice];
+        for (int y = 0; y < cinzaBloco.rows; y++) {
+            const uchar* linha = cinzaBloco.ptr<uchar>(y);
+            for (int x = 0; x < cinzaBloco.cols; x++) {
+                parcial[linha[x]]++;
+            }
+        }
+    });
+
+    int histograma[256] = {};
+    for (const auto& parcial : parciais) {
+        for (int i = 0; i < 256; i++) {
+            histograma[i] += parcial[i];
+        }
+    }
+    double otsuThreshold = calcularThresholdOtsu(histograma, cinza.rows * cinza.cols);
+    int limiar = static_cast<int>(std::floor(otsuThreshold));
+    PaginaBits pagina = empacotarPagina(cinza, limiar < 255 ? limiar : -1);
+
+    if (semRuido != nullptr) {
+        *semRuido = std::move(imagemFiltrada);
+    }
+    if (cinzaSemRuido != nullptr) {
+        *cinzaSemRuido = std::move(cinza);
+    }
+    return pagina;
+}
+
+void reduzirRuidoEBinarizar(Logger& logger, const std::string& pastaImagensAlinhadas, const std::string& pastaSemRuido, const std::string& pastaBinarizadas,
+    bool gravarSemRuido) {
+    if (!criarDiretorio(logger, pastaBinarizadas)) {
+        return;
+    }
+
     std::vector<cv::String> arquivos;
-    cv::glob(pastaOrigem + "/*.png", arquivos, false);
+    cv::glob(pastaImagensAlinhadas + "/*.png", arquivos, false);
 
     for (const auto& arquivo : arquivos) {
         cv::Mat imagem = cv::imread(arquivo, cv::IMREAD_COLOR);
         if (imagem.empty()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + std::string(arquivo));
+            logger.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + std::string(arquivo));
             continue;
         }
 
-        // Binariza a imagem com threshold dinmico
-        binarizarImagemDinamico(imagem);
+        cv::Mat imagemFiltrada;
+        PaginaBits pagina = reduzirRuidoEBinarizar(imagem, gravarSemRuido ? &imagemFiltrada : nullptr);
 
-        // Extrai o nome do arquivo do caminho completo
-        auto pos = arquivo.find_last_of("/\\");
-        std::string fileName = arquivo.substr(pos + 1);
+        std::filesystem::path caminho = std::string(arquivo);
+        if (gravarSemRuido) {
+            salvarImagem(logger, pastaSemRuido, caminho.filename().string(), std::move(imagemFiltrada));
+        }
+        GravadorImagens::global().enfileirar(logger, pastaBinarizadas, caminho.stem().string() + ".pbm", codificarPbm(pagina));
+    }
 
-        // Salva a imagem processada na pasta de destino
-        salvarImagem(consoleBuffer, pastaDestino, fileName, imagem);
+    aguardarImagensSalvas();
+    logger.AddLogMessage(LogLevel::Info, "Reduo de rudo e binarizao aplicadas a todas as imagens com sucesso.");
+}
+
+void BinarizarDinamico(Logger& logger, const std::string& pastaOrigem, const std::string& pastaDestino) {
+    if (!criarDiretorio(logger, pastaDestino)) {
+        return;
+    }
+
+    std::vector<cv::String> arquivos;
+    cv::glob(pastaOrigem + "/*.png", arquivos, false);
+
+    for (const auto& arquivo : arquivos) {
+        cv::Mat imagem = cv::imread(arquivo, cv::IMREAD_COLOR);
+        if (imagem.empty()) {
+            logger.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + std::string(arquivo));
+            continue;
+        }
+
+        // Binariza a imagem com threshold dinmico, j em 1 bit por pixel
+        PaginaBits pagina = binarizarPaginaBits(imagem);
+
+        // Mesmo nome da pgina, com a extenso .pbm; a escrita fica com o gravador em segundo plano
+        std::string nomePbm = std::filesystem::path(std::string(arquivo)).stem().string() + ".pbm";
+        GravadorImagens::global().enfileirar(logger, pastaDestino, nomePbm, codificarPbm(pagina));
     }
 
-    consoleBuffer.AddLogMessage(LogLevel::Info, "Binarizao dinmica aplicada a todas as imagens com sucesso.");
+    aguardarImagensSalvas();
+
+    logger.AddLogMessage(LogLevel::Info, "Binarizao dinmica aplicada a todas as imagens com sucesso.");
+}
+
+int numeroDaPaginaDoArquivo(const std::string& arquivo) {
+    size_t inicio = arquivo.find("page_");
+    if (inicio == std::string::npos) return 0;
+    return std::atoi(arquivo.c_str() + inicio + 5);
 }
 
 bool compararArquivos(const std::string& a, const std::string& b) {
-    int numA = std::stoi(a.substr(a.find("page_") + 5, a.find(".png_answers") - (a.find("page_") + 5)));
-    int numB = std::stoi(b.substr(b.find("page_") + 5, b.find(".png_answers") - (a.find("page_") + 5)));
-    return numA < numB;
+    return numeroDaPaginaDoArquivo(a) < numeroDaPaginaDoArquivo(b);
 }
 
-void juntarRespostasEmTXT(ConsoleBuffer& consoleBuffer, const std::string& pastaRespostas, const std::string& pastaDestino) {
+void juntarRespostasEmTXT(Logger& logger, const std::string& pastaRespostas, const std::string& pastaDestino, const std::string& pastaTriagem) {
     // Cria o diretrio de destino se no existir
-    if (!criarDiretorio(consoleBuffer, pastaDestino)) {
+    if (!criarDiretorio(logger, pastaDestino)) {
         return;
     }
 
     std::vector<std::string> arquivos;
-    cv::glob(pastaRespostas + "/*.txt", arquivos, false);
+    cv::glob(pastaRespostas + "/*_answers.txt", arquivos, false);
 
     // Ordena os arquivos pela numerao da pgina
     std::sort(arquivos.begin(), arquivos.end(), compararArquivos);
 
+    // Pginas descartadas na triagem, por nmero da pgina
+    std::map<int, PaginaIgnorada> paginasIgnoradas;
+    for (const std::string& pasta : { pastaTriagem, pastaRespostas }) {
+        if (pasta.empty()) continue;
+        for (const auto& pagina : lerPaginasIgnoradas(pasta)) {
+            paginasIgnoradas[numeroDaPaginaDoArquivo(pagina.fileName)] = pagina;
+        }
+    }
+    auto proximaIgnorada = paginasIgnoradas.begin();
+
     std::string arquivoTXT = pastaDestino + "/respostas.txt";  // Nome do arquivo de respostas
 
     std::ofstream txtFile(arquivoTXT);
     if (!txtFile.is_open()) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao abrir o arquivo TXT para escrita: " + arquivoTXT);
+        logger.AddLogMessage(LogLevel::Error, "Erro ao abrir o arquivo TXT para escrita: " + arquivoTXT);
         return;
     }
 
+    auto escreverIgnoradasAte = [&](int pagina) {
+        for (; proximaIgnorada != paginasIgnoradas.end() && proximaIgnorada->first < pagina; ++proximaIgnorada) {
+            txtFile << "ignorada:" << nomeTipoPagina(proximaIgnorada->second.classificacao.tipo) << ",\n";
+        }
+    };
+
     for (const auto& arquivo : arquivos) {
+        int pagina = numeroDaPaginaDoArquivo(arquivo);
+        escreverIgnoradasAte(pagina);
+        // Uma leitura que existe tem prioridade sobre um relatrio de triagem antigo
+        if (proximaIgnorada != paginasIgnoradas.end() && proximaIgnorada->first == pagina) {
+            ++proximaIgnorada;
+        }
+
         std::ifstream inputFile(arquivo);
         if (!inputFile.is_open()) {
-            consoleBuffer.AddLogMessage(LogLevel::Error, "Erro ao abrir o arquivo de respostas: " + arquivo);
+            logger.AddLogMessage(LogLevel::Error, "Erro ao abrir o arquivo de respostas: " + arquivo);
             continue;
         }
 
@@ -630,7 +1388,8 @@ void juntarRespostasEmTXT(ConsoleBuffer& consoleBuffer, const std::string& pasta
         }
         txtFile << ",\n";
     }
+    escreverIgnoradasAte(INT_MAX);
 
     txtFile.close();
-    consoleBuffer.AddLogMessage(LogLevel::Info, "Todas as respostas foram unidas no arquivo TXT com sucesso: " + arquivoTXT);
+    logger.AddLogMessage(LogLevel::Info, "Todas as respostas foram unidas no arquivo TXT com sucesso: " + arquivoTXT);
 }
\ No newline at end of file
@@ -1,26 +1,302 @@
 #pragma once
 
-#include "ConsoleBuffer.h"
+#include "Logger.h"
+#include "OcrEnginePool.h"
+#include <algorithm>
+#include <cmath>
+
+// Modo de segmentao usado no OCR de uma regio de palavras
+enum class OcrSegmentation {
+    SingleLine = 0,
+    SingleWord = 1
+};
+
+// Reconhecedor usado nas regies de palavra marcadas como nmero
+enum class NumberRecognizer {
+    Tesseract = 0,
+    DigitClassifier = 1  // Classificador k-NN embutido, uma caixa por subdiviso
+};
+
+// Cantos de uma regio em coordenadas normalizadas (0 a 1): (x, y) superior esquerdo, (z, w) inferior direito
+struct CoordenadasRegiao {
+    float x, y, z, w;
+};
 
 // Estrutura para armazenar dados de retngulo
 struct RectangleData {
-    ImVec4 coordinates;
+    CoordenadasRegiao coordinates;
     std::pair<int, int> subdivisions;
     std::string name;
     bool analyzeVertical;  // Novo campo para a anlise vertical
     bool isWord;
     bool isNumber;
+    // Perfil de OCR (usado quando isWord); a whitelist de dgitos vem de isNumber
+    OcrSegmentation ocrSegmentation = OcrSegmentation::SingleLine;
+    OcrEngineKind ocrEngine = OcrEngineKind::Lstm;
+    NumberRecognizer numberRecognizer = NumberRecognizer::Tesseract;
+};
+
+// Defina a margem de segurana (em pixels). Os valores padro so para pginas a 300 DPI;
+// use escalados() para outras resolues.
+struct ParametrosLeitura {
+    int marginX = 15;  // Margem para o eixo X
+    int marginY = 10;  // Margem para o eixo Y
+    int offsetX = 0;  // Deslocamento para o eixo X
+    int offsetY = 20;  // Deslocamento para o eixo Y
+
+    // Critrio de marcao: uma escolha conta como marcada se passar de
+    // maior / divisorMaximo + mdia / divisorMedia (mais de uma marcada = 'X', nenhuma = 'V').
+    // Com preenchimentoMinimo > 0, a questo tambm  'V' se a escolha mais cheia no chegar a
+    // essa frao da rea da clula.
+    double divisorMaximo = 2.0;
+    double divisorMedia = 1.5;
+    double preenchimentoMinimo = 0.0;
+
+    double escala = 1.0;  // Resoluo da leitura relativa  da referncia (s informativo, para as medies)
+
+    ParametrosLeitura escalados(double fator) const;
+};
+
+// Parmetros do pipeline que antes eram constantes no cdigo. Os valores padro so os de sempre;
+// o ajuste automtico (ParameterTuner.h) grava outros em ARQUIVO_PARAMETROS_PIPELINE, carregado na
+// inicializao.
+struct ParametrosPipeline {
+    int maxFeatures = 800;                     // Features ORB por imagem no alinhamento
+    float percentualBonsPares = 0.10f;         // Frao dos pares de features mantida para a homografia
+    int diametroBilateral = 9;                 // 0 = sem filtro bilateral na reduo de rudo
+    double sigmaCorBilateral = 75;
+    double sigmaEspacoBilateral = 75;
+    int blocoThresholdAdaptativo = 11;         // Threshold do OCR (mpar, >= 3)
+    double constanteThresholdAdaptativo = 2;
+    int DPI = 300;                             // Renderizao do PDF e decodificao das digitalizaes
+    int raioRegistroLocal = 12;                // Deslocamento mximo do registro local das regies, em pixels do
+                                               // mapa de LARGURA_MAPA_REGISTRO (0 = sem registro local)
+    ParametrosLeitura leitura;
+};
+
+// Parmetros em uso no processo. So definidos na inicializao (ou pelo ajuste), antes de o
+// processamento comear; as etapas s os leem.
+const ParametrosPipeline& parametrosPipeline();
+void definirParametrosPipeline(const ParametrosPipeline& parametros);
+
+// Resposta lida de uma questo e a confiana da deciso (0 a 1). Numa resposta,  a diferena de preenchimento
+// (frao da rea da clula) entre a alternativa mais preenchida e a segunda; em 'V' e 'X', a folga at o
+// threshold dinmico: quanto falta de tinta para a mais cheia virar marcao ('V') ou quanto a menos cheia
+// das marcadas est acima do threshold ('X'), como frao dessa tinta
+struct LeituraQuestao {
+    char resposta;
+    float confianca;
+};
+
+// Imagem de referncia com as features ORB j calculadas, para no recalcular a cada pgina
+struct ReferenciaAlinhamento {
+    cv::Mat imagem;
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descritores;
 };
 
-void processPdf(ConsoleBuffer& consoleBuffer,const std::string& filenamePdf, const std::string& imag_output_folder, int DPI);
+// Texto reconhecido em uma regio de palavras e a confiana do reconhecimento (0 a 1)
+struct TextoRegiao {
+    std::string texto;
+    float confianca = 0.0f;
+    bool vazia = false;
+};
+
+// L os campos opcionais do perfil de OCR que vm depois de isNumber na linha do arquivo de coordenadas
+void lerPerfilOcr(const std::string& restoDaLinha, RectangleData& rectData);
+
+namespace poppler { class document; }
+class TemplateRegistry;
+class ProgressoLeitura;
+class FonteDigitalizacao;
+struct MedicoesPagina;
+struct CelulaMedida;
+struct PaginaBits;
+
+void processPdf(Logger& logger,const std::string& filenamePdf, const std::string& imag_output_folder, int DPI);
+cv::Mat renderizarPaginaPdf(const poppler::document& documento, int indicePagina, int DPI);
+cv::Mat reduzirRuido(const cv::Mat& imagem);
+void binarizarImagemDinamico(cv::Mat& image);
+// Mesma binarizao (Otsu na pgina inteira), mas direto para 1 bit por pixel, sem a imagem em BGR
+PaginaBits binarizarPaginaBits(const cv::Mat& image);
 void alignImagesORB(cv::Mat& im1, cv::Mat& im2, cv::Mat& im1Reg, cv::Mat& h);
-void alinharImagens(ConsoleBuffer& consoleBuffer, const std::string& imag_output_folder, const std::string& aling_imag_folder, const std::string& reference_image_path);
-void aplicarFiltroReducaoRuido(ConsoleBuffer& consoleBuffer, const std::string& pastaImagensAlinhadas, const std::string& pastaDestino);
-void extrairContornos(ConsoleBuffer& consoleBuffer, const std::string& pastaOrigem, const std::string& pastaDestino, const std::string& pastaThreshold);
-void BinarizarDinamico(ConsoleBuffer& consoleBuffer, const std::string& pastaOrigem, const std::string& pastaDestino);
-
-void salvarImagem(ConsoleBuffer& consoleBuffer,const std::string& pastaDestino, const std::string& nomeArquivo, const cv::Mat& imagem);
-bool criarDiretorio(ConsoleBuffer& consoleBuffer,const std::string& pastaDestino);
-void processImagesAndReadAnswers(ConsoleBuffer& consoleBuffer, const std::string& contourImageFolder, const std::string& coordinatesFilePath, const std::string& outputFolder);
-void processImagesAndExtractWords(ConsoleBuffer& consoleBuffer, const std::string& imageFolder, const std::string& coordinatesFilePath, const std::string& outputFolder);
-void juntarRespostasEmTXT(ConsoleBuffer& consoleBuffer, const std::string& pastaRespostas, const std::string& arquivoTXT);
\ No newline at end of file
+ReferenciaAlinhamento prepararReferenciaAlinhamento(const cv::Mat& imagemReferencia);
+// qualidade (se no for nulo) recebe a frao dos pares de features que a homografia aceitou (0 a 1)
+void alignImagesORB(const cv::Mat& im1, const ReferenciaAlinhamento& referencia, cv::Mat& im1Reg, cv::Mat& h, double* qualidade = nullptr);
+// Com triarPaginas, pginas em branco e que no so folhas de resposta no so alinhadas e vo
+// para ARQUIVO_PAGINAS_IGNORADAS em pastaTriagem (vazia = a pasta de sada), junto com uma cpia de
+// ARQUIVO_MODELOS_PAGINAS: quem s junta as respostas l a triagem sem depender das imagens alinhadas
+void alinharImagens(Logger& logger, const std::string& imag_output_folder, const std::string& aling_imag_folder, const std::string& reference_image_path,
+    bool triarPaginas = true, const std::string& pastaTriagem = "");
+// Com vrios modelos, cada pgina  alinhada  referncia do modelo roteado para ela, registrado
+// em ARQUIVO_MODELOS_PAGINAS para as etapas de leitura
+void alinharImagens(Logger& logger, const std::string& imag_output_folder, const std::string& aling_imag_folder, const TemplateRegistry& modelos,
+    bool triarPaginas = true, const std::string& pastaTriagem = "");
+// Alinha as pginas de uma digitalizao direto da fonte, sem a pasta de PNGs da converso do PDF;
+// as pginas so decodificadas em DPI (a resoluo da referncia)
+void alinharImagens(Logger& logger, const FonteDigitalizacao& entrada, const std::string& aling_imag_folder, const TemplateRegistry& modelos,
+    bool triarPaginas = true, int DPI = 300, const std::string& pastaTriagem = "");
+void aplicarFiltroReducaoRuido(Logger& logger, const std::string& pastaImagensAlinhadas, const std::string& pastaDestino);
+// Imagem de threshold (tinta em branco) usada pelo OCR, a partir da imagem sem rudo em cinza
+cv::Mat calcularImagemThreshold(const cv::Mat& imagemCinza);
+// Componentes conexos de tinta da ROI de uma bolha (clula de marcao), exportados s para depurao:
+// a deciso da leitura continua sendo a contagem de tinta de decidirQuestao
+struct ComponenteBolha {
+    int componentes = 0;        // Componentes na ROI
+    int area = 0;               // Pixels do maior componente
+    float preenchimento = 0.0f; // Tinta de todos os componentes / rea da ROI
+    float centroX = 0.0f;       // Centroide do maior componente, relativo  ROI (0 a 1)
+    float centroY = 0.0f;
+};
+// Uma entrada por questo, com uma bolha por escolha, sobre a pgina binarizada da leitura e com as mesmas
+// ROIs de readAnswersWithConfidence (margem e offset de parametros). connectedComponentsWithStats roda s
+// dentro das ROIs, nunca na pgina inteira.
+std::vector<std::vector<ComponenteBolha>> medirComponentesBolhas(const PaginaBits& pagina, const std::vector<RectangleData>& rectangles,
+    const ParametrosLeitura& parametros);
+bool salvarComponentes(Logger& logger, const std::string& outputFolder, const std::string& fileName,
+    const std::vector<std::vector<ComponenteBolha>>& componentes);
+// Grava a imagem de threshold do OCR e, com pastaComponentes, "<arquivo>_components.csv" por pgina com os
+// componentes de cada bolha do modelo, medidos na pgina binarizada da leitura (Otsu) e nas ROIs j
+// deslocadas pelo registro local (referenceImagePath  a referncia da geometria padro). A imagem com
+// todos os contornos da pgina s  gerada para depurao, com pastaContornos.
+void extrairComponentes(Logger& logger, const std::string& pastaOrigem, const std::string& pastaComponentes, const std::string& pastaThreshold,
+    const std::string& coordinatesFilePath, const TemplateRegistry* modelos = nullptr, const std::string& pastaRoteamento = "",
+    const std::string& pastaContornos = "", const std::string& referenceImagePath = "");
+// Grava as pginas binarizadas em PBM de 1 bit (page_N.pbm); a leitura das respostas aceita PBM ou PNG
+void BinarizarDinamico(Logger& logger, const std::string& pastaOrigem, const std::string& pastaDestino);
+// reduzirRuido seguido de binarizarPaginaBits em uma passada s por bloco, sem a pgina intermediria
+// ir e voltar da memria; semRuido e cinzaSemRuido (se no forem nulos) recebem as imagens intermedirias
+PaginaBits reduzirRuidoEBinarizar(const cv::Mat& imagem, cv::Mat* semRuido = nullptr, cv::Mat* cinzaSemRuido = nullptr);
+// aplicarFiltroReducaoRuido + BinarizarDinamico sem ler de volta a pasta intermediria; com gravarSemRuido
+// as imagens sem rudo tambm vo para pastaSemRuido (quando outra etapa as l)
+void reduzirRuidoEBinarizar(Logger& logger, const std::string& pastaImagensAlinhadas, const std::string& pastaSemRuido, const std::string& pastaBinarizadas,
+    bool gravarSemRuido);
+
+// A imagem vai para o gravador em segundo plano (ImageWriter.h): a verso com const& copia a imagem,
+// a com && s entrega o buffer. As etapas chamam aguardarImagensSalvas() antes de a prxima ler a pasta.
+void salvarImagem(Logger& logger,const std::string& pastaDestino, const std::string& nomeArquivo, const cv::Mat& imagem);
+void salvarImagem(Logger& logger, const std::string& pastaDestino, const std::string& nomeArquivo, cv::Mat&& imagem);
+void aguardarImagensSalvas();
+bool criarDiretorio(Logger& logger,const std::string& pastaDestino);
+std::vector<RectangleData> loadAnswerRectangles(const std::string& filepath);
+// Com medicoes, as contagens de tinta de cada clula tambm so guardadas para a releitura sem imagens
+// (medicoes->questoes fica com uma entrada por leitura, na mesma ordem)
+std::vector<LeituraQuestao> readAnswersWithConfidence(const cv::Mat& image, const std::vector<RectangleData>& rectangles, Logger& logger, const ParametrosLeitura& parametros,
+    MedicoesPagina* medicoes = nullptr);
+// Mesma leitura sobre a pgina empacotada: a tinta de cada ROI  contada com popcount
+std::vector<LeituraQuestao> readAnswersWithConfidence(const PaginaBits& pagina, const std::vector<RectangleData>& rectangles, Logger& logger, const ParametrosLeitura& parametros,
+    MedicoesPagina* medicoes = nullptr);
+// Deciso de uma questo a partir da tinta de cada escolha e da rea da ROI (clula menos as margens), a mesma
+// usada na leitura das imagens e na releitura das medies
+LeituraQuestao decidirQuestao(const std::vector<int>& tintaPorEscolha, int areaRoi, bool isNumber, const ParametrosLeitura& parametros);
+
+// Implementao de decidirQuestao sobre numChoices contagens contguas. Escolhas > 0 fixa o nmero de escolhas
+// em tempo de compilao (a leitura em lote especializa as grades mais comuns); 0 = numChoices
+template <int Escolhas>
+LeituraQuestao decidirQuestaoTinta(const int* tinta, int numChoices, int areaRoi, bool isNumber, const ParametrosLeitura& parametros) {
+    const int escolhas = Escolhas > 0 ? Escolhas : numChoices;
+    char selectedAnswer = 'X';
+    int maxWhitePixels = 0;
+    int totalWhitePixels = 0; // Total de pixels brancos para calcular a mdia
+
+    for (int choice = 0; choice < escolhas; ++choice) {
+        totalWhitePixels += tinta[choice];
+        if (tinta[choice] > maxWhitePixels) {
+            maxWhitePixels = tinta[choice];
+            selectedAnswer = static_cast<char>((isNumber ? '0' : 'A') + choice); // 'A', 'B', 'C', ou 'D', etc.
+        }
+    }
+
+    // Calcula a mdia dos pixels brancos
+    int averageWhitePixels = escolhas > 0 ? totalWhitePixels / escolhas : 0;
+
+    // Calcula o dynamic threshold (com os divisores padro, maior / 2 + mdia / 1.5)
+    int dynamicThreshold = static_cast<int>(std::floor(maxWhitePixels / parametros.divisorMaximo) + averageWhitePixels / parametros.divisorMedia);
+    int selectedCount = 0;
+
+    // Conta quantas escolhas esto acima do threshold dinmico
+    for (int choice = 0; choice < escolhas; ++choice) {
+        if (tinta[choice] > dynamicThreshold) {
+            selectedCount++;
+        }
+    }
+
+    areaRoi = std::max(1, areaRoi);
+
+    // Se mais de uma escolha est acima do threshold, marque como 'X'
+    if (selectedCount > 1) {
+        selectedAnswer = 'X';
+    }
+    else if (selectedCount == 0 || maxWhitePixels < parametros.preenchimentoMinimo * areaRoi) {
+        selectedAnswer = 'V';
+    }
+
+    if (escolhas == 0) {
+        return { selectedAnswer, 0.0f };
+    }
+
+    if (selectedAnswer == 'V') {
+        // Tinta que a escolha mais cheia precisaria ter (com as outras como esto) para passar do threshold,
+        // que tambm cresce com ela, e do preenchimento mnimo
+        double fatorMaior = 1.0 - 1.0 / parametros.divisorMaximo - 1.0 / (escolhas * parametros.divisorMedia);
+        if (fatorMaior <= 0) {
+            return { selectedAnswer, 1.0f };  // Com esses divisores nenhuma escolha sozinha vira marcao
+        }
+        double necessaria = (totalWhitePixels - maxWhitePixels) / (escolhas * parametros.divisorMedia) / fatorMaior;
+        necessaria = std::max(necessaria, parametros.preenchimentoMinimo * areaRoi);
+        if (necessaria <= 0) {
+            return { selectedAnswer, 1.0f };  // Nenhuma tinta em nenhuma escolha
+        }
+        return { selectedAnswer, static_cast<float>(std::clamp((necessaria - maxWhitePixels) / necessaria, 0.0, 1.0)) };
+    }
+
+    if (selectedAnswer == 'X') {
+        int menorMarcada = maxWhitePixels;
+        for (int choice = 0; choice < escolhas; ++choice) {
+            if (tinta[choice] > dynamicThreshold) menorMarcada = std::min(menorMarcada, tinta[choice]);
+        }
+        return { selectedAnswer, static_cast<float>(menorMarcada - dynamicThreshold) / menorMarcada };
+    }
+
+    // Confiana: diferena de preenchimento (frao da ROI) entre a escolha mais cheia e a segunda
+    int segundoMaior = 0;
+    bool maiorVisto = false;
+    for (int choice = 0; choice < escolhas; ++choice) {
+        if (!maiorVisto && tinta[choice] == maxWhitePixels) {
+            maiorVisto = true;
+            continue;
+        }
+        segundoMaior = std::max(segundoMaior, tinta[choice]);
+    }
+    float confianca = static_cast<float>(maxWhitePixels - segundoMaior) / areaRoi;
+
+    return { selectedAnswer, confianca };
+}
+// Perfil da janela de uma clula (a clula inteira, deslocada pelo offset) nas medies; o que cai fora da pgina conta como vazio
+void medirPerfilCelula(const PaginaBits& pagina, const cv::Rect& janela, CelulaMedida& celula);
+std::vector<char> readAnswersFromRectangles(const cv::Mat& image, const std::vector<RectangleData>& rectangles, Logger& logger);
+bool salvarRespostas(Logger& logger, const std::string& outputFolder, const std::string& fileName,
+    const std::vector<RectangleData>& rectangles, const std::vector<LeituraQuestao>& leituras);
+// Com modelos, a geometria de cada pgina  a do modelo registrado para ela em pastaRoteamento;
+// coordinatesFilePath (pode ser vazio) fica para as pginas sem modelo.
+// Com progresso, cada pgina lida  publicada assim que termina.
+// As regies so registradas localmente contra a referncia do modelo da pgina ou, para a geometria
+// padro, contra referenceImagePath (vazio = sem registro local nessas pginas).
+void processImagesAndReadAnswers(Logger& logger, const std::string& contourImageFolder, const std::string& coordinatesFilePath, const std::string& outputFolder,
+    const TemplateRegistry* modelos = nullptr, const std::string& pastaRoteamento = "", ProgressoLeitura* progresso = nullptr,
+    const std::string& referenceImagePath = "");
+void processImagesAndExtractWords(Logger& logger, OcrEnginePool& ocrEngines, const std::string& imageFolder, const std::string& coordinatesFilePath, const std::string& outputFolder,
+    const TemplateRegistry* modelos = nullptr, const std::string& pastaRoteamento = "");
+// OCR/classificao das regies de palavra de uma pgina j carregada (imagem de threshold)
+std::vector<TextoRegiao> extrairPalavrasDaPagina(Logger& logger, OcrEnginePool& ocrEngines, const cv::Mat& image,
+    const std::vector<const RectangleData*>& regioesPalavra, int* numeroRegioesVazias = nullptr);
+bool salvarPalavras(Logger& logger, const std::string& outputFolder, const std::string& baseName,
+    const std::vector<const RectangleData*>& regioesPalavra, const std::vector<TextoRegiao>& textos, int regioesVazias);
+// Pode rodar fora da thread de leitura: o classificador em uso s  trocado depois de treinado e salvo
+void treinarClassificadorDigitos(Logger& logger, const std::string& pastaAmostras, const std::string& arquivoModelo);
+// Nmero da pgina a partir do nome "page_N.png..." (0 se no houver), usado por todas as etapas
+// que ordenam ou indexam arquivos de pgina
+int numeroDaPaginaDoArquivo(const std::string& arquivo);
+// As pginas ignoradas na triagem (em pastaRespostas ou pastaTriagem) entram como uma linha
+// "ignorada:<motivo>," para manter uma linha por pgina do PDF
+void juntarRespostasEmTXT(Logger& logger, const std::string& pastaRespostas, const std::string& arquivoTXT, const std::string& pastaTriagem = "");
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "ImageWriter.h"
+#include "ImageProcessing.h"
+#include <opencv2/core/utils/filesystem.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+GravadorImagens::GravadorImagens(const ConfiguracaoGravacao& configuracao) : config(configuracao) {
+    unsigned numeroThreads = std::max(1u, configuracao.threads);
+    for (unsigned i = 0; i < numeroThreads; i++) {
+        threads.emplace_back(&GravadorImagens::executar, this);
+    }
+}
+
+GravadorImagens::~GravadorImagens() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        parando = true;
+    }
+    temTrabalho.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void GravadorImagens::configurar(const ConfiguracaoGravacao& configuracao) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t capacidade = config.capacidadeFila;
+    unsigned numeroThreads = config.threads;
+    config = configuracao;
+    config.capacidadeFila = capacidade;
+    config.threads = numeroThreads;
+}
+
+ConfiguracaoGravacao GravadorImagens::configuracao() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return config;
+}
+
+void GravadorImagens::enfileirar(Logger& logger, const std::string& pasta, const std::string& nomeArquivo, cv::Mat&& imagem) {
+    Trabalho trabalho;
+    trabalho.logger = &logger;
+    trabalho.pasta = pasta;
+    trabalho.nomeArquivo = nomeArquivo;
+    trabalho.imagem = std::move(imagem);
+    inserir(std::move(trabalho));
+}
+
+void GravadorImagens::enfileirar(Logger& logger, const std::string& pasta, const std::string& nomeArquivo, std::vector<uint8_t>&& bytes) {
+    Trabalho trabalho;
+    trabalho.logger = &logger;
+    trabalho.pasta = pasta;
+    trabalho.nomeArquivo = nomeArquivo;
+    trabalho.bytes = std::move(bytes);
+    inserir(std::move(trabalho));
+}
+
+void GravadorImagens::inserir(Trabalho&& trabalho) {
+    std::unique_lock<std::mutex> lock(mutex);
+    temEspaco.wait(lock, [this] { return fila.size() < std::max<size_t>(1, config.capacidadeFila); });
+    fila.push_back(std::move(trabalho));
+    pendentes++;
+    lock.unlock();
+    temTrabalho.notify_one();
+}
+
+void GravadorImagens::aguardar() {
+    std::unique_lock<std::mutex> lock(mutex);
+    terminou.wait(lock, [this] { return pendentes == 0; });
+}
+
+void GravadorImagens::executar() {
+    for (;;) {
+        Trabalho trabalho;
+        ConfiguracaoGravacao configuracao;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            temTrabalho.wait(lock, [this] { return parando || !fila.empty(); });
+            if (fila.empty()) return;
+            trabalho = std::move(fila.front());
+            fila.pop_front();
+            configuracao = config;
+        }
+        temEspaco.notify_one();
+
+        gravar(trabalho, configuracao);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pendentes == 0) {
+            terminou.notify_all();
+        }
+    }
+}
+
+// A pasta  verificada (e criada) s na primeira imagem que vai para ela
+bool GravadorImagens::garantirPasta(Logger& logger, const std::string& pasta) {
+    std::lock_guard<std::mutex> lock(mutexPastas);
+    if (pastasCriadas.count(pasta) > 0) {
+        return true;
+    }
+    if (!criarDiretorio(logger, pasta)) {
+        return false;
+    }
+    pastasCriadas.insert(pasta);
+    return true;
+}
+
+static std::string extensaoMinuscula(const std::string& nomeArquivo) {
+    size_t ponto = nomeArquivo.find_last_of('.');
+    std::string extensao = ponto == std::string::npos ? ".png" : nomeArquivo.substr(ponto);
+    std::transform(extensao.begin(), extensao.end(), extensao.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extensao;
+}
+
+static bool gravarArquivo(const std::string& caminho, const std::vector<uint8_t>& bytes, bool sincronizarDisco) {
+    std::FILE* arquivo = std::fopen(caminho.c_str(), "wb");
+    if (arquivo == nullptr) return false;
+
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), arquivo) == bytes.size() && std::fflush(arquivo) == 0;
+    if (ok && sincronizarDisco) {
+#ifdef _WIN32
+        ok = _commit(_fileno(arquivo)) == 0;
+#else
+        ok = fsync(fileno(arquivo)) == 0;
+#endif
+    }
+    return std::fclose(arquivo) == 0 && ok;
+}
+
+void GravadorImagens::gravar(Trabalho& trabalho, const ConfiguracaoGravacao& configuracao) {
+    Logger& logger = *trabalho.logger;
+    if (!garantirPasta(logger, trabalho.pasta)) {
+        return;
+    }
+
+    // Constri o caminho completo para salvar a imagem
+    std::string caminhoCompleto = trabalho.pasta + "/" + trabalho.nomeArquivo;
+
+    if (!trabalho.imagem.empty()) {
+        std::string extensao = extensaoMinuscula(trabalho.nomeArquivo);
+        std::vector<int> parametros;
+        if (extensao == ".png") {
+            parametros = { cv::IMWRITE_PNG_COMPRESSION, configuracao.compressaoPng };
+        }
+        else if (extensao == ".jpg" || extensao == ".jpeg") {
+            parametros = { cv::IMWRITE_JPEG_QUALITY, configuracao.qualidadeJpeg };
+        }
+
+        bool codificou = false;
+        try {
+            codificou = cv::imencode(extensao, trabalho.imagem, trabalho.bytes, parametros);
+        }
+        catch (const cv::Exception&) {
+            codificou = false;
+        }
+        if (!codificou) {
+            logger.AddLogMessage(LogLevel::Error, "Falha ao salvar a imagem em: " + caminhoCompleto);
+            return;
+        }
+        trabalho.imagem.release();  // Libera a pgina antes da escrita
+    }
+
+    bool gravou = gravarArquivo(caminhoCompleto, trabalho.bytes, configuracao.sincronizarDisco);
+    if (!gravou && !cv::utils::fs::exists(trabalho.pasta)) {
+        // A pasta foi apagada depois de criada (nova execuo da etapa): cria de novo
+        {
+            std::lock_guard<std::mutex> lock(mutexPastas);
+            pastasCriadas.erase(trabalho.pasta);
+        }
+        gravou = garantirPasta(logger, trabalho.pasta) && gravarArquivo(caminhoCompleto, trabalho.bytes, configuracao.sincronizarDisco);
+    }
+    if (!gravou) {
+        logger.AddLogMessage(LogLevel::Error, "Falha ao salvar a imagem em: " + caminhoCompleto);
+        return;
+    }
+
+    logger.AddLogMessage(LogLevel::Warning, "Imagem salva com sucesso em: " + caminhoCompleto);
+}
+
+// Configurao com que o gravador global  criado; prepararGlobal s a muda antes disso
+static std::mutex mutexGlobal;
+static ConfiguracaoGravacao configuracaoGlobal;
+static bool globalCriado = false;
+
+static ConfiguracaoGravacao fecharConfiguracaoGlobal() {
+    std::lock_guard<std::mutex> lock(mutexGlobal);
+    globalCriado = true;
+    return configuracaoGlobal;
+}
+
+GravadorImagens& GravadorImagens::global() {
+    static GravadorImagens gravador(fecharConfiguracaoGlobal());
+    return gravador;
+}
+
+bool GravadorImagens::prepararGlobal(unsigned threads) {
+    std::lock_guard<std::mutex> lock(mutexGlobal);
+    if (globalCriado) return false;
+    configuracaoGlobal.threads = threads;
+    return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Logger.h"
+#include <opencv2/opencv.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Parmetros de codificao e de escrita das imagens intermedirias (Imagens, ImagensAlinhadas...)
+struct ConfiguracaoGravacao {
+    int compressaoPng = 1;           // 0 a 9; as pastas intermedirias so lidas logo em seguida, ento vale a rapidez
+    int qualidadeJpeg = 95;          // Para nomes terminados em .jpg/.jpeg
+    bool sincronizarDisco = false;   // fsync de cada arquivo antes de consider-lo gravado
+    size_t capacidadeFila = 16;      // Imagens esperando na fila; com a fila cheia quem grava espera
+    unsigned threads = 2;            // Threads de codificao e escrita
+};
+
+// Gravador de imagens em segundo plano. As etapas entregam a imagem (por move, sem cpia) e seguem
+// processando; a codificao, a criao da pasta (uma vez por pasta) e a escrita acontecem nas threads
+// do gravador. Quem grava s bloqueia se a fila estiver cheia.
+class GravadorImagens {
+public:
+    explicit GravadorImagens(const ConfiguracaoGravacao& configuracao = ConfiguracaoGravacao());
+    ~GravadorImagens();
+
+    GravadorImagens(const GravadorImagens&) = delete;
+    GravadorImagens& operator=(const GravadorImagens&) = delete;
+
+    // Vale para as imagens enfileiradas depois da chamada (a capacidade e as threads ficam as da criao)
+    void configurar(const ConfiguracaoGravacao& configuracao);
+    ConfiguracaoGravacao configuracao() const;
+
+    // O logger precisa continuar vlido at aguardar() retornar
+    void enfileirar(Logger& logger, const std::string& pasta, const std::string& nomeArquivo, cv::Mat&& imagem);
+    // Arquivo j codificado (PBM, por exemplo): s a criao da pasta e a escrita ficam com o gravador
+    void enfileirar(Logger& logger, const std::string& pasta, const std::string& nomeArquivo, std::vector<uint8_t>&& bytes);
+
+    // Bloqueia at tudo o que foi enfileirado estar no disco; as etapas chamam antes de a prxima ler a pasta
+    void aguardar();
+
+    // Gravador compartilhado pelo processo
+    static GravadorImagens& global();
+    // Threads do gravador global (o oramento de CPU, CpuBudget.h). S vale antes do primeiro global();
+    // depois retorna false e o gravador fica como est.
+    static bool prepararGlobal(unsigned threads);
+
+private:
+    struct Trabalho {
+        Logger* logger = nullptr;
+        std::string pasta;
+        std::string nomeArquivo;
+        cv::Mat imagem;
+        std::vector<uint8_t> bytes;  // Usado quando imagem est vazia
+    };
+
+    void inserir(Trabalho&& trabalho);
+    void executar();
+    void gravar(Trabalho& trabalho, const ConfiguracaoGravacao& configuracao);
+    bool garantirPasta(Logger& logger, const std::string& pasta);
+
+    ConfiguracaoGravacao config;
+    std::vector<std::thread> threads;
+    std::deque<Trabalho> fila;
+    size_t pendentes = 0;  // Na fila ou sendo gravados
+    bool parando = false;
+    mutable std::mutex mutex;
+    std::condition_variable temTrabalho;
+    std::condition_variable temEspaco;
+    std::condition_variable terminou;
+
+    std::mutex mutexPastas;
+    std::set<std::string> pastasCriadas;
+};
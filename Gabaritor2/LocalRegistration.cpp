@@ -0,0 +1,73 @@
+#include "LocalRegistration.h"
+#include <algorithm>
+#include <cmath>
+
+cv::Mat criarMapaRegistro(const cv::Mat& referencia) {
+    if (referencia.empty()) return cv::Mat();
+    return reduzirPagina(binarizarPaginaBits(referencia), LARGURA_MAPA_REGISTRO);
+}
+
+// Mesma reduo de reduzirPagina, mas s dos pixels do mapa dentro da janela
+static cv::Mat reduzirJanela(const PaginaBits& pagina, const cv::Size& tamanhoMapa, const cv::Rect& janela) {
+    cv::Mat reduzida(janela.size(), CV_32F);
+    for (int y = 0; y < janela.height; y++) {
+        int my = janela.y + y;
+        int y0 = static_cast<int>(static_cast<long long>(my) * pagina.altura / tamanhoMapa.height);
+        int y1 = std::max(y0 + 1, static_cast<int>(static_cast<long long>(my + 1) * pagina.altura / tamanhoMapa.height));
+        float* destino = reduzida.ptr<float>(y);
+        for (int x = 0; x < janela.width; x++) {
+            int mx = janela.x + x;
+            int x0 = static_cast<int>(static_cast<long long>(mx) * pagina.largura / tamanhoMapa.width);
+            int x1 = std::max(x0 + 1, static_cast<int>(static_cast<long long>(mx + 1) * pagina.largura / tamanhoMapa.width));
+            cv::Rect bloco(x0, y0, x1 - x0, y1 - y0);
+            destino[x] = 255.0f * pagina.contarTinta(bloco) / bloco.area();
+        }
+    }
+    return reduzida;
+}
+
+std::vector<RectangleData> registrarRegioes(const PaginaBits& pagina, const cv::Mat& mapaReferencia, const std::vector<RectangleData>& rectangles,
+    int raioMapa, int* regioesDeslocadas) {
+    std::vector<RectangleData> registradas = rectangles;
+    if (regioesDeslocadas != nullptr) *regioesDeslocadas = 0;
+    if (raioMapa <= 0 || mapaReferencia.empty() || pagina.vazia()) {
+        return registradas;
+    }
+
+    cv::Size tamanhoMapa = mapaReferencia.size();
+    cv::Rect limites(0, 0, tamanhoMapa.width, tamanhoMapa.height);
+
+    for (auto& rectData : registradas) {
+        if (rectData.isWord) continue;  // S as regies de marcao; o OCR tem a prpria tolerncia
+
+        // Janela da regio no mapa, com folga do raio procurado em volta
+        int x0 = static_cast<int>(std::floor(rectData.coordinates.x * tamanhoMapa.width)) - raioMapa;
+        int y0 = static_cast<int>(std::floor(rectData.coordinates.y * tamanhoMapa.height)) - raioMapa;
+        int x1 = static_cast<int>(std::ceil(rectData.coordinates.z * tamanhoMapa.width)) + raioMapa;
+        int y1 = static_cast<int>(std::ceil(rectData.coordinates.w * tamanhoMapa.height)) + raioMapa;
+        cv::Rect janela = cv::Rect(x0, y0, x1 - x0, y1 - y0) & limites;
+        if (janela.width < 16 || janela.height < 16) continue;
+
+        cv::Mat trechoReferencia;
+        mapaReferencia(janela).convertTo(trechoReferencia, CV_32F);
+        if (cv::sum(trechoReferencia)[0] < TINTA_MINIMA_REGISTRO * 255.0 * janela.area()) continue;
+        cv::Mat trechoPagina = reduzirJanela(pagina, tamanhoMapa, janela);
+
+        // Deslocamento do contedo da pgina em relao  referncia
+        cv::Mat hanning;
+        cv::createHanningWindow(hanning, janela.size(), CV_32F);
+        double resposta = 0.0;
+        cv::Point2d deslocamento = cv::phaseCorrelate(trechoReferencia, trechoPagina, hanning, &resposta);
+        if (resposta < RESPOSTA_MINIMA_REGISTRO || std::abs(deslocamento.x) > raioMapa || std::abs(deslocamento.y) > raioMapa) continue;
+        if (std::abs(deslocamento.x) < 0.5 && std::abs(deslocamento.y) < 0.5) continue;
+
+        float dx = static_cast<float>(deslocamento.x / tamanhoMapa.width);
+        float dy = static_cast<float>(deslocamento.y / tamanhoMapa.height);
+        rectData.coordinates.x += dx;
+        rectData.coordinates.z += dx;
+        rectData.coordinates.y += dy;
+        rectData.coordinates.w += dy;
+        if (regioesDeslocadas != nullptr) (*regioesDeslocadas)++;
+    }
+    return registradas;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ImageProcessing.h"
+#include "PackedPage.h"
+
+// Registro local das regies de resposta. Depois do alinhamento global sobra um erro residual que
+// varia pela pgina (papel torto no scanner, escala um pouco diferente); em vez de compens-lo s com
+// as margens e deslocamentos fixos de ParametrosLeitura, cada regio  comparada com o mesmo trecho da
+// referncia por correlao de fase e deslocada antes da contagem da tinta.
+//
+// A comparao  feita em mapas de tinta reduzidos para LARGURA_MAPA_REGISTRO, nos dois lados: o da
+// referncia  calculado uma vez por modelo e o da pgina s nas janelas das regies, direto dos bits.
+// Como as coordenadas das regies so normalizadas, o mesmo mapa serve para qualquer DPI de leitura.
+
+const int LARGURA_MAPA_REGISTRO = 1240;      // Metade de uma pgina A4 a 300 DPI
+const double RESPOSTA_MINIMA_REGISTRO = 0.1; // Pico da correlao de fase abaixo disso: regio sem deslocamento
+const double TINTA_MINIMA_REGISTRO = 0.01;   // Janela da referncia com menos tinta que isso no tem o que casar
+
+// Mapa de tinta da referncia (BGR), binarizada como as pginas (tinta = 255)
+cv::Mat criarMapaRegistro(const cv::Mat& referencia);
+
+// Cpia de rectangles com cada regio deslocada para onde ela est na pgina. raioMapa  o maior
+// deslocamento procurado, em pixels do mapa (0 ou mapaReferencia vazio: devolve as regies sem mudana).
+// regioesDeslocadas (se no for nulo) recebe quantas regies mudaram de lugar.
+std::vector<RectangleData> registrarRegioes(const PaginaBits& pagina, const cv::Mat& mapaReferencia, const std::vector<RectangleData>& rectangles,
+    int raioMapa, int* regioesDeslocadas = nullptr);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <iostream>
+#include <mutex>
+
+enum class LogLevel {
+    Info,
+    Warning,
+    Error
+};
+
+// Destino das mensagens do processamento. A interface grfica usa o ConsoleBuffer; quem usa
+// o processamento como biblioteca passa a prpria implementao (ou LoggerNulo).
+class Logger {
+public:
+    virtual ~Logger() {}
+
+    // Pode ser chamada de vrias threads ao mesmo tempo
+    virtual void AddLogMessage(LogLevel level, const std::string& message) = 0;
+};
+
+// Modos de linha de comando e servio: as mensagens vo para stdout/stderr
+class LoggerTerminal : public Logger {
+public:
+    void AddLogMessage(LogLevel level, const std::string& message) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ostream& saida = level == LogLevel::Error ? std::cerr : std::cout;
+        saida << (level == LogLevel::Error ? "[erro] " : level == LogLevel::Warning ? "[aviso] " : "") << message << std::endl;
+    }
+
+private:
+    std::mutex mutex;
+};
+
+// Descarta todas as mensagens
+class LoggerNulo : public Logger {
+public:
+    void AddLogMessage(LogLevel, const std::string&) override {}
+};
@@ -0,0 +1,358 @@
+#include "MeasurementStore.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+// Formato (little-endian): cabealho ASSINATURA_MEDICOES e um registro por pgina, cada um
+// precedido do seu tamanho em bytes (uint32) para detectar um registro cortado no fim.
+//   pgina:  fileName, modelo (uint16 + bytes), qualidadeAlinhamento (float),
+//            n de regies (uint32) e regies, n de questes (uint32) e questes
+//   regio:  nome, lines, columns (int32), flags (uint8: 1 = analyzeVertical, 2 = isNumber)
+//   questo: regiao (uint32), escala (float), janela e margens (4 x uint16), n de clulas (uint16)
+//   clula:  tinta (uint32), dentro (uint8), perfil (LADO_PERFIL_CELULA^2 bytes)
+static const char ASSINATURA_MEDICOES[8] = { 'G', 'A', 'B', 'M', 'E', 'D', '0', '1' };
+
+namespace {
+
+void escreverU8(std::string& saida, uint8_t valor) {
+    saida.push_back(static_cast<char>(valor));
+}
+
+void escreverU16(std::string& saida, uint16_t valor) {
+    saida.push_back(static_cast<char>(valor & 0xFF));
+    saida.push_back(static_cast<char>(valor >> 8));
+}
+
+void escreverU32(std::string& saida, uint32_t valor) {
+    for (int i = 0; i < 4; i++) saida.push_back(static_cast<char>((valor >> (8 * i)) & 0xFF));
+}
+
+void escreverFloat(std::string& saida, float valor) {
+    uint32_t bits;
+    std::memcpy(&bits, &valor, sizeof(bits));
+    escreverU32(saida, bits);
+}
+
+void escreverTexto(std::string& saida, const std::string& texto) {
+    uint16_t tamanho = static_cast<uint16_t>(std::min<size_t>(texto.size(), 0xFFFF));
+    escreverU16(saida, tamanho);
+    saida.append(texto, 0, tamanho);
+}
+
+// Leitura sequencial de um registro; qualquer leitura alm do fim marca o registro como invlido
+class LeitorRegistro {
+public:
+    LeitorRegistro(const std::string& dados) : dados(dados) {}
+
+    bool valido() const { return ok; }
+
+    uint8_t u8() {
+        if (!disponivel(1)) return 0;
+        return static_cast<uint8_t>(dados[pos++]);
+    }
+
+    uint16_t u16() {
+        if (!disponivel(2)) return 0;
+        uint16_t valor = static_cast<uint8_t>(dados[pos]) | (static_cast<uint8_t>(dados[pos + 1]) << 8);
+        pos += 2;
+        return valor;
+    }
+
+    uint32_t u32() {
+        if (!disponivel(4)) return 0;
+        uint32_t valor = 0;
+        for (int i = 0; i < 4; i++) valor |= static_cast<uint32_t>(static_cast<uint8_t>(dados[pos + i])) << (8 * i);
+        pos += 4;
+        return valor;
+    }
+
+    float real() {
+        uint32_t bits = u32();
+        float valor;
+        std::memcpy(&valor, &bits, sizeof(valor));
+        return valor;
+    }
+
+    std::string texto() {
+        uint16_t tamanho = u16();
+        if (!disponivel(tamanho)) return std::string();
+        std::string valor = dados.substr(pos, tamanho);
+        pos += tamanho;
+        return valor;
+    }
+
+    void bytes(uint8_t* destino, size_t tamanho) {
+        if (!disponivel(tamanho)) return;
+        std::memcpy(destino, dados.data() + pos, tamanho);
+        pos += tamanho;
+    }
+
+private:
+    bool disponivel(size_t tamanho) {
+        if (pos + tamanho > dados.size()) ok = false;
+        return ok;
+    }
+
+    const std::string& dados;
+    size_t pos = 0;
+    bool ok = true;
+};
+
+std::string serializarPagina(const MedicoesPagina& pagina) {
+    std::string registro;
+    escreverTexto(registro, pagina.fileName);
+    escreverTexto(registro, pagina.modelo);
+    escreverFloat(registro, pagina.qualidadeAlinhamento);
+
+    escreverU32(registro, static_cast<uint32_t>(pagina.regioes.size()));
+    for (const auto& regiao : pagina.regioes) {
+        escreverTexto(registro, regiao.nome);
+        escreverU32(registro, static_cast<uint32_t>(regiao.subdivisions.first));
+        escreverU32(registro, static_cast<uint32_t>(regiao.subdivisions.second));
+        escreverU8(registro, static_cast<uint8_t>((regiao.analyzeVertical ? 1 : 0) | (regiao.isNumber ? 2 : 0)));
+    }
+
+    escreverU32(registro, static_cast<uint32_t>(pagina.questoes.size()));
+    for (const auto& questao : pagina.questoes) {
+        escreverU32(registro, static_cast<uint32_t>(questao.regiao));
+        escreverFloat(registro, questao.escala);
+        escreverU16(registro, questao.larguraJanela);
+        escreverU16(registro, questao.alturaJanela);
+        escreverU16(registro, questao.margemX);
+        escreverU16(registro, questao.margemY);
+        escreverU16(registro, static_cast<uint16_t>(questao.celulas.size()));
+        for (const auto& celula : questao.celulas) {
+            escreverU32(registro, celula.tinta);
+            escreverU8(registro, celula.dentro ? 1 : 0);
+            registro.append(reinterpret_cast<const char*>(celula.perfil), sizeof(celula.perfil));
+        }
+    }
+    return registro;
+}
+
+bool desserializarPagina(const std::string& registro, MedicoesPagina& pagina) {
+    LeitorRegistro leitor(registro);
+    pagina.fileName = leitor.texto();
+    pagina.modelo = leitor.texto();
+    pagina.qualidadeAlinhamento = leitor.real();
+
+    uint32_t numeroRegioes = leitor.u32();
+    for (uint32_t r = 0; r < numeroRegioes && leitor.valido(); r++) {
+        RegiaoMedida regiao;
+        regiao.nome = leitor.texto();
+        regiao.subdivisions.first = static_cast<int>(leitor.u32());
+        regiao.subdivisions.second = static_cast<int>(leitor.u32());
+        uint8_t flags = leitor.u8();
+        regiao.analyzeVertical = (flags & 1) != 0;
+        regiao.isNumber = (flags & 2) != 0;
+        pagina.regioes.push_back(regiao);
+    }
+
+    uint32_t numeroQuestoes = leitor.u32();
+    for (uint32_t q = 0; q < numeroQuestoes && leitor.valido(); q++) {
+        MedicaoQuestao questao;
+        questao.regiao = static_cast<int>(leitor.u32());
+        questao.escala = leitor.real();
+        questao.larguraJanela = leitor.u16();
+        questao.alturaJanela = leitor.u16();
+        questao.margemX = leitor.u16();
+        questao.margemY = leitor.u16();
+        questao.celulas.resize(leitor.u16());
+        for (auto& celula : questao.celulas) {
+            celula.tinta = leitor.u32();
+            celula.dentro = leitor.u8() != 0;
+            leitor.bytes(celula.perfil, sizeof(celula.perfil));
+        }
+        if (questao.regiao < 0 || questao.regiao >= static_cast<int>(pagina.regioes.size())) return false;
+        pagina.questoes.push_back(std::move(questao));
+    }
+    return leitor.valido();
+}
+
+// Tinta estimada em [x0, x1) x [y0, y1) da janela, somando a parte de cada bloco do perfil que cai
+// dentro do retngulo. Os limites dos blocos so os mesmos da medio, ento margens que caem
+// nesses limites do a contagem exata dos blocos.
+double estimarTinta(const MedicaoQuestao& questao, const CelulaMedida& celula, int x0, int y0, int x1, int y1) {
+    double tinta = 0;
+    for (int by = 0; by < LADO_PERFIL_CELULA; by++) {
+        int blocoY0 = by * questao.alturaJanela / LADO_PERFIL_CELULA;
+        int blocoY1 = (by + 1) * questao.alturaJanela / LADO_PERFIL_CELULA;
+        int alturaComum = std::min(blocoY1, y1) - std::max(blocoY0, y0);
+        if (alturaComum <= 0) continue;
+        for (int bx = 0; bx < LADO_PERFIL_CELULA; bx++) {
+            int blocoX0 = bx * questao.larguraJanela / LADO_PERFIL_CELULA;
+            int blocoX1 = (bx + 1) * questao.larguraJanela / LADO_PERFIL_CELULA;
+            int larguraComum = std::min(blocoX1, x1) - std::max(blocoX0, x0);
+            if (larguraComum <= 0) continue;
+            tinta += celula.perfil[by * LADO_PERFIL_CELULA + bx] / 255.0 * larguraComum * alturaComum;
+        }
+    }
+    return tinta;
+}
+
+}
+
+std::vector<char> lerGabarito(const std::string& arquivoGabarito) {
+    std::vector<char> respostas;
+    std::ifstream arquivo(arquivoGabarito);
+    std::string linha;
+    while (std::getline(arquivo, linha)) {
+        size_t pos = linha.find(':');
+        if (pos == std::string::npos) continue;
+        size_t inicio = linha.find_first_not_of(" \t", pos + 1);
+        respostas.push_back(inicio != std::string::npos ? linha[inicio] : 'V');
+    }
+    return respostas;
+}
+
+bool ArquivoMedicoes::abrir(Logger& logger, const std::string& pasta) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string caminho = pasta + "/" + ARQUIVO_MEDICOES;
+    arquivo.open(caminho, std::ios::binary | std::ios::trunc);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "No foi possvel criar o arquivo de medies: " + caminho);
+        return false;
+    }
+    arquivo.write(ASSINATURA_MEDICOES, sizeof(ASSINATURA_MEDICOES));
+    return true;
+}
+
+void ArquivoMedicoes::gravar(const MedicoesPagina& pagina) {
+    // A serializao fica fora do lock; s a escrita no arquivo  serializada
+    std::string registro;
+    escreverU32(registro, 0);
+    registro += serializarPagina(pagina);
+    uint32_t tamanho = static_cast<uint32_t>(registro.size() - 4);
+    for (int i = 0; i < 4; i++) registro[i] = static_cast<char>((tamanho >> (8 * i)) & 0xFF);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!arquivo.is_open()) return;
+    arquivo.write(registro.data(), registro.size());
+    arquivo.flush();
+}
+
+bool lerMedicoes(Logger& logger, const std::string& arquivoMedicoes, std::vector<MedicoesPagina>& paginas) {
+    std::ifstream arquivo(arquivoMedicoes, std::ios::binary);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "No foi possvel abrir o arquivo de medies: " + arquivoMedicoes);
+        return false;
+    }
+
+    char assinatura[sizeof(ASSINATURA_MEDICOES)] = {};
+    if (!arquivo.read(assinatura, sizeof(assinatura)) || std::memcmp(assinatura, ASSINATURA_MEDICOES, sizeof(assinatura)) != 0) {
+        logger.AddLogMessage(LogLevel::Error, "Arquivo de medies invlido: " + arquivoMedicoes);
+        return false;
+    }
+
+    std::string registro;
+    for (;;) {
+        unsigned char cabecalho[4];
+        if (!arquivo.read(reinterpret_cast<char*>(cabecalho), sizeof(cabecalho))) {
+            if (arquivo.gcount() != 0) {
+                logger.AddLogMessage(LogLevel::Warning, "Registro incompleto no fim de " + arquivoMedicoes + " (descartado).");
+            }
+            break;
+        }
+        uint32_t tamanho = cabecalho[0] | (cabecalho[1] << 8) | (cabecalho[2] << 16) | (static_cast<uint32_t>(cabecalho[3]) << 24);
+        registro.resize(tamanho);
+        MedicoesPagina pagina;
+        if (!arquivo.read(&registro[0], tamanho) || !desserializarPagina(registro, pagina)) {
+            logger.AddLogMessage(LogLevel::Warning, "Registro incompleto no fim de " + arquivoMedicoes + " (descartado).");
+            break;
+        }
+        paginas.push_back(std::move(pagina));
+    }
+    return true;
+}
+
+std::vector<LeituraQuestao> releituraDasMedicoes(const MedicoesPagina& pagina, const ParametrosLeitura& parametros) {
+    std::vector<LeituraQuestao> leituras;
+    leituras.reserve(pagina.questoes.size());
+
+    std::vector<int> tintaPorEscolha;
+    for (const auto& questao : pagina.questoes) {
+        // Margens na resoluo em que a questo foi lida, arredondadas como em ParametrosLeitura::escalados
+        int margemX = static_cast<int>(std::lround(parametros.marginX * questao.escala));
+        int margemY = static_cast<int>(std::lround(parametros.marginY * questao.escala));
+        bool mesmasMargens = margemX == questao.margemX && margemY == questao.margemY;
+
+        int larguraRoi = questao.larguraJanela - 2 * margemX;
+        int alturaRoi = questao.alturaJanela - 2 * margemY;
+
+        tintaPorEscolha.assign(questao.celulas.size(), 0);
+        for (size_t escolha = 0; escolha < questao.celulas.size(); escolha++) {
+            const CelulaMedida& celula = questao.celulas[escolha];
+            if (!celula.dentro || larguraRoi <= 0 || alturaRoi <= 0) continue;
+            tintaPorEscolha[escolha] = mesmasMargens ? static_cast<int>(celula.tinta)
+                : static_cast<int>(std::lround(estimarTinta(questao, celula, margemX, margemY, margemX + larguraRoi, margemY + alturaRoi)));
+        }
+
+        bool isNumber = pagina.regioes[questao.regiao].isNumber;
+        leituras.push_back(decidirQuestao(tintaPorEscolha, larguraRoi * alturaRoi, isNumber, parametros));
+    }
+    return leituras;
+}
+
+bool relerMedicoes(Logger& logger, const std::string& arquivoMedicoes, const std::string& pastaSaida, const ParametrosLeitura& parametros,
+    const std::string& arquivoGabarito) {
+    auto inicio = std::chrono::steady_clock::now();
+
+    std::vector<MedicoesPagina> paginas;
+    if (!lerMedicoes(logger, arquivoMedicoes, paginas) || !criarDiretorio(logger, pastaSaida)) {
+        return false;
+    }
+
+    std::vector<char> gabarito;
+    if (!arquivoGabarito.empty()) {
+        gabarito = lerGabarito(arquivoGabarito);
+        if (gabarito.empty()) {
+            logger.AddLogMessage(LogLevel::Error, "Gabarito vazio ou no encontrado: " + arquivoGabarito);
+            return false;
+        }
+    }
+
+    // As pginas de um lote em paralelo ficam fora de ordem no arquivo
+    std::stable_sort(paginas.begin(), paginas.end(), [](const MedicoesPagina& a, const MedicoesPagina& b) {
+        return numeroDaPaginaDoArquivo(a.fileName) < numeroDaPaginaDoArquivo(b.fileName);
+    });
+
+    std::ofstream notas;
+    if (!gabarito.empty()) {
+        notas.open(pastaSaida + "/" + ARQUIVO_NOTAS);
+        notas << "pagina;modelo;acertos;questoes;alinhamento\n";
+    }
+
+    for (const auto& pagina : paginas) {
+        std::vector<LeituraQuestao> leituras = releituraDasMedicoes(pagina, parametros);
+
+        // salvarRespostas s usa o nome, as subdivises e a orientao de cada retngulo
+        std::vector<RectangleData> rectangles;
+        for (const auto& regiao : pagina.regioes) {
+            RectangleData rectData{};
+            rectData.name = regiao.nome;
+            rectData.subdivisions = regiao.subdivisions;
+            rectData.analyzeVertical = regiao.analyzeVertical;
+            rectData.isNumber = regiao.isNumber;
+            rectangles.push_back(rectData);
+        }
+        salvarRespostas(logger, pastaSaida, pagina.fileName, rectangles, leituras);
+
+        if (notas.is_open()) {
+            int acertos = 0, questoes = 0;
+            for (size_t q = 0; q < leituras.size() && q < gabarito.size(); q++) {
+                if (gabarito[q] == 'X' || gabarito[q] == 'V') continue;
+                questoes++;
+                if (leituras[q].resposta == gabarito[q]) acertos++;
+            }
+            notas << pagina.fileName << ";" << pagina.modelo << ";" << acertos << ";" << questoes << ";"
+                << std::fixed << std::setprecision(3) << pagina.qualidadeAlinhamento << "\n";
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+    logger.AddLogMessage(LogLevel::Info, std::to_string(paginas.size()) + " pginas relidas das medies em "
+        + std::to_string(static_cast<int>(ms)) + " ms.");
+    return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ImageProcessing.h"
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Medies de cada clula de marcao (tinta, janela, margens) gravadas junto das respostas, para
+// reler as provas com outro critrio de marcao ou outras margens sem abrir nenhuma imagem.
+
+// Arquivo de medies gravado na pasta de respostas
+const std::string ARQUIVO_MEDICOES = "medicoes.bin";
+// Acertos por pgina gravados na releitura com gabarito
+const std::string ARQUIVO_NOTAS = "notas.csv";
+
+// Lado da grade de blocos do perfil de cada clula (LADO_PERFIL_CELULA^2 bytes por clula)
+const int LADO_PERFIL_CELULA = 8;
+
+struct CelulaMedida {
+    uint32_t tinta = 0;   // Pixels de tinta na ROI com as margens usadas na leitura
+    bool dentro = false;  // A ROI estava dentro da imagem (fora dela a escolha conta como vazia)
+    // Frao de tinta (0 a 255) de cada bloco da janela da clula, em linhas; serve para estimar a
+    // tinta com outras margens
+    uint8_t perfil[LADO_PERFIL_CELULA * LADO_PERFIL_CELULA] = {};
+};
+
+// Uma questo (uma subdiviso do retngulo), com uma clula por escolha
+struct MedicaoQuestao {
+    int regiao = 0;                // ndice em MedicoesPagina::regioes
+    float escala = 1.0f;           // Resoluo da leitura relativa  referncia (a leitura em DPI baixo tem escala < 1)
+    uint16_t larguraJanela = 0;    // Clula inteira, j deslocada pelo offset, em pixels da leitura
+    uint16_t alturaJanela = 0;
+    uint16_t margemX = 0;          // Margens usadas na leitura, em pixels da leitura
+    uint16_t margemY = 0;
+    std::vector<CelulaMedida> celulas;
+};
+
+// O necessrio do retngulo para gravar as respostas relidas no mesmo formato
+struct RegiaoMedida {
+    std::string nome;
+    std::pair<int, int> subdivisions;
+    bool analyzeVertical = false;
+    bool isNumber = false;
+};
+
+struct MedicoesPagina {
+    std::string fileName;
+    std::string modelo;
+    float qualidadeAlinhamento = -1.0f;  // Frao de inliers da homografia; -1 se a leitura no mediu
+    std::vector<RegiaoMedida> regioes;   // Um por retngulo do modelo
+    std::vector<MedicaoQuestao> questoes;  // Na ordem das leituras
+};
+
+// Gravao das medies de um lote, uma pgina por registro. Pode ser chamada de vrias threads;
+// a ordem dos registros  a ordem em que as pginas terminam.
+class ArquivoMedicoes {
+public:
+    // Cria (ou recria) pasta/ARQUIVO_MEDICOES
+    bool abrir(Logger& logger, const std::string& pasta);
+    bool aberto() const { return arquivo.is_open(); }
+    void gravar(const MedicoesPagina& pagina);
+
+private:
+    std::ofstream arquivo;
+    std::mutex mutex;
+};
+
+// L todas as pginas de um arquivo de medies. Um registro incompleto no fim (lote interrompido)
+//  descartado com um aviso.
+bool lerMedicoes(Logger& logger, const std::string& arquivoMedicoes, std::vector<MedicoesPagina>& paginas);
+
+// Respostas de uma pgina a partir das medies. Margens e critrio vm de parametros (em pixels
+// da referncia, como na leitura); o deslocamento (offsetX/offsetY)  o da leitura original.
+std::vector<LeituraQuestao> releituraDasMedicoes(const MedicoesPagina& pagina, const ParametrosLeitura& parametros);
+
+// Respostas de um "_answers.txt" (a parte depois de ':' de cada linha), na ordem do arquivo
+std::vector<char> lerGabarito(const std::string& arquivoGabarito);
+
+// Rel todas as pginas de arquivoMedicoes e grava as respostas e confianas em pastaSaida, nos
+// formatos do pipeline. Com arquivoGabarito (um "_answers.txt" com as respostas certas), grava
+// tambm ARQUIVO_NOTAS com os acertos de cada pgina.
+bool relerMedicoes(Logger& logger, const std::string& arquivoMedicoes, const std::string& pastaSaida, const ParametrosLeitura& parametros,
+    const std::string& arquivoGabarito = "");
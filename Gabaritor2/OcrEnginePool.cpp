@@ -0,0 +1,70 @@
+#include "OcrEnginePool.h"
+#include "ThreadPool.h"
+#include <iostream>
+
+OcrEnginePool::OcrEnginePool(const std::string& idioma)
+    : idioma(idioma), slots(ThreadPool::global().slots()) {
+}
+
+OcrEnginePool::~OcrEnginePool() {
+    for (auto& slot : slots) {
+        for (auto& engine : slot.engines) {
+            if (engine.api && engine.inicializado) {
+                engine.api->End();
+            }
+        }
+    }
+}
+
+OcrEnginePool::Engine* OcrEnginePool::obterEngine(int slotIndex, OcrEngineKind motor) {
+    int indiceMotor = static_cast<int>(motor);
+    if (slotIndex < 0 || slotIndex >= static_cast<int>(slots.size()) || indiceMotor < 0 || indiceMotor >= NUM_MOTORES) {
+        return nullptr;
+    }
+
+    Engine& engine = slots[slotIndex].engines[indiceMotor];
+    if (engine.falhou) {
+        return nullptr;
+    }
+
+    if (!engine.inicializado) {
+        tesseract::OcrEngineMode oem = motor == OcrEngineKind::Legacy ? tesseract::OEM_TESSERACT_ONLY : tesseract::OEM_LSTM_ONLY;
+        engine.api = std::make_unique<tesseract::TessBaseAPI>();
+        if (engine.api->Init(NULL, idioma.c_str(), oem)) {
+            std::cerr << "Could not initialize tesseract.\n";
+            engine.api.reset();
+            engine.falhou = true;
+            return nullptr;
+        }
+        engine.inicializado = true;
+    }
+
+    return &engine;
+}
+
+std::unique_lock<std::mutex> OcrEnginePool::travarSlot(int slot) {
+    if (slot == static_cast<int>(slots.size()) - 1) {
+        return std::unique_lock<std::mutex>(mutexSlotExterno);
+    }
+    return std::unique_lock<std::mutex>();
+}
+
+tesseract::TessBaseAPI* OcrEnginePool::engine(int slot, OcrEngineKind motor) {
+    Engine* engine = obterEngine(slot, motor);
+    return engine ? engine->api.get() : nullptr;
+}
+
+tesseract::TessBaseAPI* OcrEnginePool::engineParaPagina(int slot, OcrEngineKind motor, const cv::Mat& pagina, uint64_t paginaId) {
+    Engine* engine = obterEngine(slot, motor);
+    if (engine == nullptr) {
+        return nullptr;
+    }
+
+    if (engine->paginaAtual != paginaId) {
+        // O Tesseract copia a imagem, ento a pgina pode ser liberada depois
+        engine->api->SetImage(pagina.data, pagina.cols, pagina.rows, static_cast<int>(pagina.elemSize()), static_cast<int>(pagina.step));
+        engine->paginaAtual = paginaId;
+    }
+
+    return engine->api.get();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <tesseract/baseapi.h>
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Motor de reconhecimento usado por uma regio de palavras
+enum class OcrEngineKind {
+    Lstm = 0,   // Somente LSTM (padro, melhor para texto impresso)
+    Legacy = 1  // Motor clssico (precisa de traineddata com os componentes legados)
+};
+
+// Conjunto de engines Tesseract j inicializadas, uma por slot do ThreadPool e por motor.
+// A inicializao (leitura do traineddata)  feita uma nica vez por slot, na primeira
+// vez que o slot pede a engine, e as engines vivem enquanto o pool existir.
+class OcrEnginePool {
+public:
+    explicit OcrEnginePool(const std::string& idioma = "eng");
+    ~OcrEnginePool();
+
+    OcrEnginePool(const OcrEnginePool&) = delete;
+    OcrEnginePool& operator=(const OcrEnginePool&) = delete;
+
+    // Engine do slot informado (ThreadPool::currentSlot()). Retorna nullptr se o Init falhar.
+    // Os slots dos workers do pool so usados por uma nica thread cada e no precisam de lock; o ltimo
+    // slot  o de todas as threads externas ao pool (GUI, API, pasta monitorada), que podem ler ao mesmo
+    // tempo, ento quem usa a engine dele deve segurar travarSlot(slot) do pedido da engine at o fim do OCR.
+    tesseract::TessBaseAPI* engine(int slot, OcrEngineKind motor = OcrEngineKind::Lstm);
+
+    // Trava o slot das threads externas; para os slots dos workers devolve uma trava vazia
+    std::unique_lock<std::mutex> travarSlot(int slot);
+
+    // Identificador nico para uma pgina; usado para saber quando trocar a imagem das engines
+    uint64_t novaPagina() { return ++contadorPaginas; }
+
+    // Engine do slot com a pgina j carregada via SetImage. A pgina s  enviada
+    // ao Tesseract uma vez por engine; as regies depois usam apenas SetRectangle.
+    tesseract::TessBaseAPI* engineParaPagina(int slot, OcrEngineKind motor, const cv::Mat& pagina, uint64_t paginaId);
+
+private:
+    static const int NUM_MOTORES = 2;
+
+    struct Engine {
+        std::unique_ptr<tesseract::TessBaseAPI> api;
+        bool inicializado = false;
+        bool falhou = false;
+        uint64_t paginaAtual = 0;
+    };
+
+    struct Slot {
+        Engine engines[NUM_MOTORES];
+    };
+
+    Engine* obterEngine(int slot, OcrEngineKind motor);
+
+    std::string idioma;
+    std::vector<Slot> slots;
+    std::mutex mutexSlotExterno;
+    std::atomic<uint64_t> contadorPaginas{ 0 };
+};
@@ -0,0 +1,187 @@
+#include "PackedPage.h"
+#include "ThreadPool.h"
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+// Linhas por item do ThreadPool ao empacotar
+const int LINHAS_POR_FAIXA = 64;
+
+PaginaBits::PaginaBits(int largura, int altura)
+    : largura(largura), altura(altura), palavrasPorLinha((largura + 63) / 64),
+    bits(static_cast<size_t>(altura) * ((largura + 63) / 64), 0) {
+}
+
+int PaginaBits::contarTinta(cv::Rect retangulo) const {
+    retangulo &= cv::Rect(0, 0, largura, altura);
+    if (retangulo.area() <= 0) return 0;
+
+    int ultimoX = retangulo.x + retangulo.width - 1;
+    int primeira = retangulo.x >> 6;
+    int ultima = ultimoX >> 6;
+    uint64_t mascaraInicio = ~0ull << (retangulo.x & 63);
+    uint64_t mascaraFim = ~0ull >> (63 - (ultimoX & 63));
+
+    int total = 0;
+    for (int y = retangulo.y; y < retangulo.y + retangulo.height; y++) {
+        const uint64_t* palavras = linha(y);
+        if (primeira == ultima) {
+            total += contarBits(palavras[primeira] & mascaraInicio & mascaraFim);
+            continue;
+        }
+        total += contarBits(palavras[primeira] & mascaraInicio);
+        for (int p = primeira + 1; p < ultima; p++) {
+            total += contarBits(palavras[p]);
+        }
+        total += contarBits(palavras[ultima] & mascaraFim);
+    }
+    return total;
+}
+
+// Empacota as linhas com uma tabela valor do pixel -> bit de tinta
+static PaginaBits empacotarComTabela(const cv::Mat& imagem, const uint8_t tabela[256]) {
+    CV_Assert(imagem.type() == CV_8UC1);
+    PaginaBits pagina(imagem.cols, imagem.rows);
+
+    int faixas = (imagem.rows + LINHAS_POR_FAIXA - 1) / LINHAS_POR_FAIXA;
+    ThreadPool::global().parallelFor(faixas, [&](int faixa, int) {
+        int fim = std::min(imagem.rows, (faixa + 1) * LINHAS_POR_FAIXA);
+        for (int y = faixa * LINHAS_POR_FAIXA; y < fim; y++) {
+            const uchar* origem = imagem.ptr<uchar>(y);
+            uint64_t* destino = pagina.linha(y);
+            for (int p = 0; p < pagina.palavrasPorLinha; p++) {
+                int x0 = p * 64;
+                int n = std::min(64, imagem.cols - x0);
+                uint64_t palavra = 0;
+                for (int i = 0; i < n; i++) {
+                    palavra |= static_cast<uint64_t>(tabela[origem[x0 + i]]) << i;
+                }
+                destino[p] = palavra;
+            }
+        }
+    });
+    return pagina;
+}
+
+PaginaBits empacotarPagina(const cv::Mat& binaria) {
+    uint8_t tabela[256];
+    for (int v = 0; v < 256; v++) tabela[v] = v != 0 ? 1 : 0;
+    return empacotarComTabela(binaria, tabela);
+}
+
+PaginaBits empacotarPagina(const cv::Mat& cinza, int limiarTinta) {
+    uint8_t tabela[256];
+    for (int v = 0; v < 256; v++) tabela[v] = v <= limiarTinta ? 1 : 0;
+    return empacotarComTabela(cinza, tabela);
+}
+
+cv::Mat desempacotarPagina(const PaginaBits& pagina) {
+    cv::Mat imagem(pagina.altura, pagina.largura, CV_8UC1);
+    for (int y = 0; y < pagina.altura; y++) {
+        const uint64_t* palavras = pagina.linha(y);
+        uchar* destino = imagem.ptr<uchar>(y);
+        for (int x = 0; x < pagina.largura; x++) {
+            destino[x] = ((palavras[x >> 6] >> (x & 63)) & 1) ? 255 : 0;
+        }
+    }
+    return imagem;
+}
+
+cv::Mat reduzirPagina(const PaginaBits& pagina, int larguraDestino) {
+    if (pagina.vazia() || larguraDestino <= 0) return cv::Mat();
+    int alturaDestino = std::max(1, static_cast<int>(std::lround(static_cast<double>(pagina.altura) * larguraDestino / pagina.largura)));
+    cv::Mat reduzida(alturaDestino, larguraDestino, CV_8UC1);
+    for (int y = 0; y < alturaDestino; y++) {
+        int y0 = static_cast<int>(static_cast<long long>(y) * pagina.altura / alturaDestino);
+        int y1 = std::max(y0 + 1, static_cast<int>(static_cast<long long>(y + 1) * pagina.altura / alturaDestino));
+        uchar* destino = reduzida.ptr<uchar>(y);
+        for (int x = 0; x < larguraDestino; x++) {
+            int x0 = static_cast<int>(static_cast<long long>(x) * pagina.largura / larguraDestino);
+            int x1 = std::max(x0 + 1, static_cast<int>(static_cast<long long>(x + 1) * pagina.largura / larguraDestino));
+            cv::Rect bloco(x0, y0, x1 - x0, y1 - y0);
+            destino[x] = static_cast<uchar>(255 * pagina.contarTinta(bloco) / bloco.area());
+        }
+    }
+    return reduzida;
+}
+
+// O PBM guarda o pixel mais  esquerda no bit mais alto de cada byte; na memria ele fica no mais baixo
+static uint8_t inverterByte(uint8_t b) {
+    b = static_cast<uint8_t>((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = static_cast<uint8_t>((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    b = static_cast<uint8_t>((b & 0xAA) >> 1 | (b & 0x55) << 1);
+    return b;
+}
+
+std::vector<uint8_t> codificarPbm(const PaginaBits& pagina) {
+    std::string cabecalho = "P4\n" + std::to_string(pagina.largura) + " " + std::to_string(pagina.altura) + "\n";
+    size_t bytesPorLinha = (pagina.largura + 7) / 8;
+
+    std::vector<uint8_t> bytes(cabecalho.begin(), cabecalho.end());
+    bytes.resize(cabecalho.size() + bytesPorLinha * pagina.altura);
+    uint8_t* destino = bytes.data() + cabecalho.size();
+    for (int y = 0; y < pagina.altura; y++) {
+        const uint64_t* palavras = pagina.linha(y);
+        for (size_t k = 0; k < bytesPorLinha; k++) {
+            *destino++ = inverterByte(static_cast<uint8_t>(palavras[k / 8] >> (8 * (k % 8))));
+        }
+    }
+    return bytes;
+}
+
+bool salvarPbm(const std::string& caminho, const PaginaBits& pagina) {
+    std::ofstream arquivo(caminho, std::ios::binary);
+    if (!arquivo.is_open()) return false;
+
+    std::vector<uint8_t> bytes = codificarPbm(pagina);
+    arquivo.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return static_cast<bool>(arquivo);
+}
+
+// Prximo nmero do cabealho do PBM, pulando espaos e comentrios
+static bool lerNumeroPbm(std::istream& entrada, int& valor) {
+    for (;;) {
+        int c = entrada.peek();
+        if (c == '#') {
+            std::string comentario;
+            std::getline(entrada, comentario);
+        }
+        else if (std::isspace(c)) {
+            entrada.get();
+        }
+        else {
+            break;
+        }
+    }
+    return static_cast<bool>(entrada >> valor);
+}
+
+bool lerPbm(const std::string& caminho, PaginaBits& pagina) {
+    std::ifstream arquivo(caminho, std::ios::binary);
+    if (!arquivo.is_open()) return false;
+
+    char assinatura[2];
+    int largura = 0, altura = 0;
+    if (!arquivo.read(assinatura, 2) || assinatura[0] != 'P' || assinatura[1] != '4'
+        || !lerNumeroPbm(arquivo, largura) || !lerNumeroPbm(arquivo, altura) || largura <= 0 || altura <= 0) {
+        return false;
+    }
+    arquivo.get();  // Um espao separa o cabealho dos dados
+
+    pagina = PaginaBits(largura, altura);
+    size_t bytesPorLinha = (largura + 7) / 8;
+    std::vector<uint8_t> linha(bytesPorLinha);
+    for (int y = 0; y < altura; y++) {
+        if (!arquivo.read(reinterpret_cast<char*>(linha.data()), bytesPorLinha)) return false;
+        uint64_t* palavras = pagina.linha(y);
+        for (size_t k = 0; k < bytesPorLinha; k++) {
+            palavras[k / 8] |= static_cast<uint64_t>(inverterByte(linha[k])) << (8 * (k % 8));
+        }
+        // Bits de preenchimento do ltimo byte no podem contar como tinta
+        if (largura % 64 != 0) {
+            palavras[pagina.palavrasPorLinha - 1] &= ~0ull >> (64 - largura % 64);
+        }
+    }
+    return true;
+}
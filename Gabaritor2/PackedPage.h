@@ -0,0 +1,65 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Pgina binarizada com 1 bit por pixel, 64 pixels por palavra. Depois da binarizao as pginas
+// so s tinta ou papel: guard-las em 8 bits (ou BGR) custa 8 a 24 vezes mais memria e banda na
+// leitura das respostas, que s conta a tinta de cada clula.
+//
+// Bit 1 = tinta. O pixel x de uma linha fica no bit (x % 64) da palavra x / 64; cada linha comea
+// em uma palavra nova e os bits depois da largura ficam zerados, ento as contagens no precisam
+// de mscara no fim da linha.
+// Bits 1 de uma palavra (popcount)
+inline int contarBits(uint64_t palavra) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    return static_cast<int>(__popcnt64(palavra));
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(palavra);
+#else
+    palavra = palavra - ((palavra >> 1) & 0x5555555555555555ull);
+    palavra = (palavra & 0x3333333333333333ull) + ((palavra >> 2) & 0x3333333333333333ull);
+    palavra = (palavra + (palavra >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((palavra * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+struct PaginaBits {
+    int largura = 0;
+    int altura = 0;
+    int palavrasPorLinha = 0;
+    std::vector<uint64_t> bits;
+
+    PaginaBits() {}
+    PaginaBits(int largura, int altura);
+
+    bool vazia() const { return bits.empty(); }
+    cv::Size tamanho() const { return cv::Size(largura, altura); }
+    const uint64_t* linha(int y) const { return bits.data() + static_cast<size_t>(y) * palavrasPorLinha; }
+    uint64_t* linha(int y) { return bits.data() + static_cast<size_t>(y) * palavrasPorLinha; }
+
+    bool tinta(int x, int y) const { return (linha(y)[x >> 6] >> (x & 63)) & 1; }
+
+    // Pixels de tinta do retngulo (a parte fora da pgina conta como papel), com popcount
+    int contarTinta(cv::Rect retangulo) const;
+};
+
+// Empacota uma imagem de 8 bits de um canal: pixel diferente de zero = tinta
+PaginaBits empacotarPagina(const cv::Mat& binaria);
+// Empacota uma imagem em cinza de 8 bits direto, sem a imagem binarizada: tinta = pixel <= limiarTinta
+PaginaBits empacotarPagina(const cv::Mat& cinza, int limiarTinta);
+// Volta para 8 bits de um canal, tinta = 255 (o formato que as etapas em PNG usam)
+cv::Mat desempacotarPagina(const PaginaBits& pagina);
+// Reduz a pgina para larguraDestino (miniaturas), com a frao de tinta de cada bloco (tinta = 255),
+// sem desempacotar a pgina inteira
+cv::Mat reduzirPagina(const PaginaBits& pagina, int larguraDestino);
+
+// PBM binrio (P4): 1 bit por pixel, 1 = preto, ento a tinta aparece preta em qualquer visualizador
+std::vector<uint8_t> codificarPbm(const PaginaBits& pagina);
+bool salvarPbm(const std::string& caminho, const PaginaBits& pagina);
+bool lerPbm(const std::string& caminho, PaginaBits& pagina);
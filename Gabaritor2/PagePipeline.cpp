@@ -0,0 +1,98 @@
+#include "PagePipeline.h"
+#include "PackedPage.h"
+#include "LocalRegistration.h"
+#include <chrono>
+
+// Milissegundos desde "inicio", reiniciando a contagem
+static double medirEtapa(std::chrono::steady_clock::time_point& inicio) {
+    auto agora = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(agora - inicio).count();
+    inicio = agora;
+    return ms;
+}
+
+ResultadoPagina processarPaginaEmMemoria(Logger& logger, const TemplateRegistry& modelos, OcrEnginePool& ocrEngines,
+    const cv::Mat& pagina, const OpcoesPagina& opcoes) {
+    ResultadoPagina resultado;
+    auto inicioPagina = std::chrono::steady_clock::now();
+    auto inicio = inicioPagina;
+
+    // As etapas trabalham em BGR; s h converso (e cpia) se a pgina vier em outro formato
+    cv::Mat imagem;
+    if (pagina.channels() == 4) {
+        cv::cvtColor(pagina, imagem, cv::COLOR_BGRA2BGR);
+    }
+    else if (pagina.channels() == 1) {
+        cv::cvtColor(pagina, imagem, cv::COLOR_GRAY2BGR);
+    }
+    else {
+        imagem = pagina;
+    }
+
+    int indiceModelo = 0;
+    if (opcoes.triarPaginas || modelos.size() > 1) {
+        RoteamentoPagina roteamento = modelos.rotear(criarMiniatura(imagem));
+        resultado.classificacao = roteamento.classificacao;
+        resultado.tempos.triagemMs = medirEtapa(inicio);
+        if (opcoes.triarPaginas && roteamento.classificacao.tipo != TipoPagina::Resposta) {
+            resultado.tempos.totalMs = resultado.tempos.triagemMs;
+            return resultado;
+        }
+        indiceModelo = std::max(roteamento.modelo, 0);
+    }
+    const ModeloGabarito& modelo = modelos.modelo(indiceModelo);
+    resultado.modelo = &modelo;
+
+    cv::Mat alignedImage, h;
+    double qualidadeAlinhamento = 0;
+    alignImagesORB(imagem, modelo.alinhamento, alignedImage, h, &qualidadeAlinhamento);
+    resultado.tempos.alinhamentoMs = medirEtapa(inicio);
+    if (alignedImage.empty()) {
+        resultado.tempos.totalMs = medirEtapa(inicioPagina);
+        return resultado;
+    }
+    resultado.alinhada = true;
+
+    // Reduo de rudo e binarizao em uma passada, direto em 1 bit por pixel: a leitura s conta a
+    // tinta das clulas. O cinza sem rudo fica para o threshold do OCR.
+    cv::Mat cinzaSemRuido;
+    PaginaBits paginaBinarizada = reduzirRuidoEBinarizar(alignedImage, nullptr, &cinzaSemRuido);
+    resultado.tempos.reducaoRuidoMs = medirEtapa(inicio);
+
+    resultado.medicoes.modelo = modelo.nome;
+    resultado.medicoes.qualidadeAlinhamento = static_cast<float>(qualidadeAlinhamento);
+    // Cada regio  reposicionada contra a referncia antes da contagem (o erro que o alinhamento global deixou)
+    std::vector<RectangleData> regioes = registrarRegioes(paginaBinarizada, modelo.mapaRegistro, modelo.rectangles, parametrosPipeline().raioRegistroLocal);
+    resultado.leituras = readAnswersWithConfidence(paginaBinarizada, regioes, logger, parametrosPipeline().leitura,
+        opcoes.medirCelulas ? &resultado.medicoes : nullptr);
+    resultado.tempos.leituraRespostasMs = medirEtapa(inicio);
+
+    if (opcoes.lerPalavras) {
+        for (const auto& rectData : modelo.rectangles) {
+            if (rectData.isWord) {
+                resultado.regioesPalavra.push_back(&rectData);
+            }
+        }
+
+        if (!resultado.regioesPalavra.empty()) {
+            cv::Mat imagemThreshold = calcularImagemThreshold(cinzaSemRuido);
+            resultado.palavras = extrairPalavrasDaPagina(logger, ocrEngines, imagemThreshold, resultado.regioesPalavra, &resultado.regioesVazias);
+        }
+        resultado.tempos.leituraPalavrasMs = medirEtapa(inicio);
+    }
+
+    resultado.tempos.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicioPagina).count();
+    return resultado;
+}
+
+void salvarResultadoPagina(Logger& logger, const std::string& pasta, const std::string& fileName, const ResultadoPagina& resultado) {
+    if (resultado.modelo == nullptr || !resultado.alinhada) {
+        return;
+    }
+
+    salvarRespostas(logger, pasta, fileName, resultado.modelo->rectangles, resultado.leituras);
+    if (!resultado.regioesPalavra.empty()) {
+        std::string baseName = fileName.substr(0, fileName.find_last_of('.'));
+        salvarPalavras(logger, pasta, baseName, resultado.regioesPalavra, resultado.palavras, resultado.regioesVazias);
+    }
+}
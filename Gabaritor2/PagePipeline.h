@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ImageProcessing.h"
+#include "PageTriage.h"
+#include "TemplateRegistry.h"
+#include "MeasurementStore.h"
+
+// Pipeline completo de uma pgina j em memria: triagem e roteamento, alinhamento, reduo de
+// rudo, leitura das respostas e OCR das regies de palavra.  o mesmo encadeamento das etapas do
+// pipeline em pastas, sem passar pelo disco.
+
+struct OpcoesPagina {
+    bool triarPaginas = true;
+    bool lerPalavras = true;
+    bool medirCelulas = false;  // Guarda as medies das clulas em ResultadoPagina::medicoes
+};
+
+// Tempo de cada etapa da pgina, em milissegundos
+struct TemposPagina {
+    double triagemMs = 0;
+    double alinhamentoMs = 0;
+    double reducaoRuidoMs = 0;        // Reduo de rudo e binarizao (uma passada s)
+    double leituraRespostasMs = 0;
+    double leituraPalavrasMs = 0;
+    double totalMs = 0;
+};
+
+struct ResultadoPagina {
+    ClassificacaoPagina classificacao{ TipoPagina::Resposta, 0.0, 0.0 };
+    const ModeloGabarito* modelo = nullptr;  // Modelo usado (nulo se a pgina foi descartada)
+    bool alinhada = false;
+    std::vector<LeituraQuestao> leituras;    // Uma por subdiviso, na ordem de modelo->rectangles
+    MedicoesPagina medicoes;                 // S com OpcoesPagina::medirCelulas (fileName fica vazio)
+    std::vector<const RectangleData*> regioesPalavra;
+    std::vector<TextoRegiao> palavras;       // Uma por regio de palavra
+    int regioesVazias = 0;
+    TemposPagina tempos;
+};
+
+// A pgina pode ser BGR, BGRA ou cinza (8 bits). No  copiada antes do processamento.
+ResultadoPagina processarPaginaEmMemoria(Logger& logger, const TemplateRegistry& modelos, OcrEnginePool& ocrEngines,
+    const cv::Mat& pagina, const OpcoesPagina& opcoes);
+
+// Grava as respostas, confianas e palavras da pgina nos formatos do pipeline em pastas
+void salvarResultadoPagina(Logger& logger, const std::string& pasta, const std::string& fileName, const ResultadoPagina& resultado);
@@ -0,0 +1,161 @@
+#include "PageTriage.h"
+#include "ImageProcessing.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+// Largura da imagem usada para detectar a tinta: ainda resolve traos de ~3 px a 300 DPI
+const int LARGURA_DETECCAO_TINTA = 512;
+// Largura da miniatura comparada com a da referncia
+const int LARGURA_MINIATURA = 64;
+// Um pixel  tinta se for este tanto mais escuro que o fundo (mediana), o que ignora papel
+// acinzentado e a transparncia do verso
+const int CONTRASTE_MINIMO_TINTA = 40;
+// Abaixo desta cobertura a pgina  considerada em branco
+const double COBERTURA_MINIMA_TINTA = 0.002;
+// Abaixo desta correlao com a referncia a pgina no  uma folha de respostas
+const double SIMILARIDADE_MINIMA = 0.5;
+
+static int medianaCinza(const cv::Mat& gray) {
+    int histograma[256] = { 0 };
+    for (int y = 0; y < gray.rows; y++) {
+        const uchar* linha = gray.ptr<uchar>(y);
+        for (int x = 0; x < gray.cols; x++) {
+            histograma[linha[x]]++;
+        }
+    }
+
+    int metade = static_cast<int>(gray.total() / 2);
+    int acumulado = 0;
+    for (int i = 0; i < 256; i++) {
+        acumulado += histograma[i];
+        if (acumulado > metade) return i;
+    }
+    return 255;
+}
+
+MiniaturaPagina criarMiniatura(const cv::Mat& pagina) {
+    MiniaturaPagina miniatura{ cv::Mat(), 0.0 };
+    if (pagina.empty()) return miniatura;
+
+    // Reduz primeiro e converte depois: a converso de cor roda sobre ~4% dos pixels
+    double escala = static_cast<double>(LARGURA_DETECCAO_TINTA) / pagina.cols;
+    int altura = std::max(1, static_cast<int>(std::lround(pagina.rows * escala)));
+    cv::Mat reduzida, gray;
+    cv::resize(pagina, reduzida, cv::Size(LARGURA_DETECCAO_TINTA, altura), 0, 0, cv::INTER_AREA);
+    if (reduzida.channels() == 4) {
+        cv::cvtColor(reduzida, gray, cv::COLOR_BGRA2GRAY);
+    }
+    else if (reduzida.channels() == 3) {
+        cv::cvtColor(reduzida, gray, cv::COLOR_BGR2GRAY);
+    }
+    else {
+        gray = reduzida;
+    }
+
+    int fundo = medianaCinza(gray);
+    cv::Mat tinta;
+    cv::threshold(gray, tinta, fundo - CONTRASTE_MINIMO_TINTA, 255, cv::THRESH_BINARY_INV);
+
+    // A cobertura ignora 5% de cada borda, onde ficam sombras e bordas pretas do scanner
+    int bordaX = tinta.cols / 20;
+    int bordaY = tinta.rows / 20;
+    cv::Mat miolo = tinta(cv::Rect(bordaX, bordaY, tinta.cols - 2 * bordaX, tinta.rows - 2 * bordaY));
+    miniatura.coberturaTinta = static_cast<double>(cv::countNonZero(miolo)) / miolo.total();
+
+    int alturaMiniatura = std::max(1, static_cast<int>(std::lround(tinta.rows * static_cast<double>(LARGURA_MINIATURA) / tinta.cols)));
+    cv::Mat tintaFloat;
+    tinta.convertTo(tintaFloat, CV_32F, 1.0 / 255);
+    cv::resize(tintaFloat, miniatura.densidadeTinta, cv::Size(LARGURA_MINIATURA, alturaMiniatura), 0, 0, cv::INTER_AREA);
+    // Suaviza para tolerar o deslocamento e a inclinao que o alinhamento ainda vai corrigir
+    cv::GaussianBlur(miniatura.densidadeTinta, miniatura.densidadeTinta, cv::Size(5, 5), 0);
+
+    return miniatura;
+}
+
+static double correlacao(const cv::Mat& a, const cv::Mat& b) {
+    cv::Mat resultado;
+    cv::matchTemplate(a, b, resultado, cv::TM_CCOEFF_NORMED);
+    double valor = resultado.at<float>(0, 0);
+    return std::isfinite(valor) ? valor : 0.0;
+}
+
+ClassificacaoPagina classificarPagina(const MiniaturaPagina& pagina, const MiniaturaPagina& referencia) {
+    ClassificacaoPagina classificacao{ TipoPagina::Resposta, pagina.coberturaTinta, 0.0 };
+
+    if (pagina.coberturaTinta < COBERTURA_MINIMA_TINTA) {
+        classificacao.tipo = TipoPagina::EmBranco;
+        return classificacao;
+    }
+
+    cv::Mat densidade;
+    cv::resize(pagina.densidadeTinta, densidade, referencia.densidadeTinta.size(), 0, 0, cv::INTER_AREA);
+
+    // Folhas digitalizadas de cabea para baixo so alinhadas depois pela homografia
+    cv::Mat girada;
+    cv::rotate(densidade, girada, cv::ROTATE_180);
+    classificacao.similaridade = std::max(correlacao(densidade, referencia.densidadeTinta), correlacao(girada, referencia.densidadeTinta));
+
+    if (classificacao.similaridade < SIMILARIDADE_MINIMA) {
+        classificacao.tipo = TipoPagina::NaoResposta;
+    }
+    return classificacao;
+}
+
+const char* nomeTipoPagina(TipoPagina tipo) {
+    switch (tipo) {
+    case TipoPagina::EmBranco: return "em_branco";
+    case TipoPagina::NaoResposta: return "nao_resposta";
+    case TipoPagina::Ilegivel: return "ilegivel";
+    case TipoPagina::NaoAlinhada: return "nao_alinhada";
+    default: return "resposta";
+    }
+}
+
+void salvarPaginasIgnoradas(Logger& logger, const std::string& pasta, std::vector<PaginaIgnorada> paginas) {
+    if (!criarDiretorio(logger, pasta)) {
+        return;
+    }
+
+    std::sort(paginas.begin(), paginas.end(), [](const PaginaIgnorada& a, const PaginaIgnorada& b) {
+        return numeroDaPaginaDoArquivo(a.fileName) < numeroDaPaginaDoArquivo(b.fileName);
+    });
+
+    // O arquivo  sempre regravado, mesmo vazio, para no sobrar relatrio de uma execuo anterior
+    std::string caminho = pasta + "/" + ARQUIVO_PAGINAS_IGNORADAS;
+    std::ofstream arquivo(caminho);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "Erro ao abrir o arquivo de pginas ignoradas: " + caminho);
+        return;
+    }
+
+    for (const auto& pagina : paginas) {
+        arquivo << pagina.fileName << ": " << nomeTipoPagina(pagina.classificacao.tipo)
+            << std::fixed << std::setprecision(4)
+            << " tinta=" << pagina.classificacao.coberturaTinta
+            << " similaridade=" << pagina.classificacao.similaridade << "\n";
+    }
+}
+
+std::vector<PaginaIgnorada> lerPaginasIgnoradas(const std::string& pasta) {
+    std::vector<PaginaIgnorada> paginas;
+    std::ifstream arquivo(pasta + "/" + ARQUIVO_PAGINAS_IGNORADAS);
+
+    std::string linha;
+    while (std::getline(arquivo, linha)) {
+        size_t pos = linha.find(':');
+        if (pos == std::string::npos) continue;
+
+        PaginaIgnorada pagina{ linha.substr(0, pos), { TipoPagina::NaoResposta, 0.0, 0.0 } };
+        std::istringstream resto(linha.substr(pos + 1));
+        std::string motivo;
+        resto >> motivo;
+        for (TipoPagina tipo : { TipoPagina::EmBranco, TipoPagina::Ilegivel, TipoPagina::NaoAlinhada }) {
+            if (motivo == nomeTipoPagina(tipo)) pagina.classificacao.tipo = tipo;
+        }
+        paginas.push_back(pagina);
+    }
+    return paginas;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include "Logger.h"
+
+// Triagem barata das pginas antes do alinhamento: pginas em branco (versos), capas e pginas de
+// instrues so descartadas olhando s uma miniatura, sem passar por ORB, filtros e leitura.
+
+// Arquivo com as pginas descartadas, gravado na pasta de sada da etapa que fez a triagem. As
+// pginas que no puderam ser lidas ou alinhadas tambm entram, para nenhuma sumir do resultado.
+const std::string ARQUIVO_PAGINAS_IGNORADAS = "paginas_ignoradas.txt";
+
+enum class TipoPagina {
+    Resposta,
+    EmBranco,
+    NaoResposta,
+    Ilegivel,       // A imagem da pgina no pde ser decodificada
+    NaoAlinhada     // Folha de resposta que o alinhamento no conseguiu registrar na referncia
+};
+
+struct MiniaturaPagina {
+    cv::Mat densidadeTinta;   // Densidade de tinta suavizada (CV_32F), usada na comparao de layout
+    double coberturaTinta;    // Frao de pixels de tinta no miolo da pgina
+};
+
+struct ClassificacaoPagina {
+    TipoPagina tipo;
+    double coberturaTinta;
+    double similaridade;      // Correlao com a miniatura da referncia (-1 a 1)
+};
+
+struct PaginaIgnorada {
+    std::string fileName;     // page_N.png
+    ClassificacaoPagina classificacao;
+};
+
+MiniaturaPagina criarMiniatura(const cv::Mat& pagina);
+ClassificacaoPagina classificarPagina(const MiniaturaPagina& pagina, const MiniaturaPagina& referencia);
+const char* nomeTipoPagina(TipoPagina tipo);
+
+// Grava/l o relatrio de pginas ignoradas (uma linha "page_N.png: motivo tinta=... similaridade=...")
+void salvarPaginasIgnoradas(Logger& logger, const std::string& pasta, std::vector<PaginaIgnorada> paginas);
+std::vector<PaginaIgnorada> lerPaginasIgnoradas(const std::string& pasta);
@@ -0,0 +1,389 @@
+#include "ParameterTuner.h"
+#include "PackedPage.h"
+#include "PageTriage.h"
+#include "MeasurementStore.h"
+#include "LocalRegistration.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace fs = std::filesystem;
+
+// Diferena de tempo abaixo da qual duas configuraes empatam (rudo da medio); no empate vale a acurcia
+const double TOLERANCIA_EMPATE_TEMPO = 0.02;
+
+bool carregarParametrosPipeline(Logger& logger, const std::string& caminho, ParametrosPipeline& parametros) {
+    std::ifstream arquivo(caminho);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "No foi possvel abrir o arquivo de parmetros: " + caminho);
+        return false;
+    }
+
+    std::map<std::string, std::string> valores;
+    std::string linha;
+    while (std::getline(arquivo, linha)) {
+        if (!linha.empty() && linha.back() == '\r') linha.pop_back();
+        if (linha.empty() || linha[0] == '#') continue;
+        size_t pos = linha.find('=');
+        if (pos != std::string::npos) {
+            valores[linha.substr(0, pos)] = linha.substr(pos + 1);
+        }
+    }
+
+    ParametrosPipeline lidos = parametros;
+    auto lerInteiro = [&](const char* chave, int& destino) {
+        if (valores.count(chave)) destino = std::atoi(valores[chave].c_str());
+    };
+    auto lerReal = [&](const char* chave, double& destino) {
+        if (valores.count(chave)) destino = std::atof(valores[chave].c_str());
+    };
+    double percentualBonsPares = lidos.percentualBonsPares;
+
+    lerInteiro("max_features", lidos.maxFeatures);
+    lerReal("bons_pares", percentualBonsPares);
+    lerInteiro("bilateral_diametro", lidos.diametroBilateral);
+    lerReal("bilateral_sigma_cor", lidos.sigmaCorBilateral);
+    lerReal("bilateral_sigma_espaco", lidos.sigmaEspacoBilateral);
+    lerInteiro("threshold_bloco", lidos.blocoThresholdAdaptativo);
+    lerReal("threshold_constante", lidos.constanteThresholdAdaptativo);
+    lerInteiro("dpi", lidos.DPI);
+    lerInteiro("registro_local_raio", lidos.raioRegistroLocal);
+    lerInteiro("margem_x", lidos.leitura.marginX);
+    lerInteiro("margem_y", lidos.leitura.marginY);
+    lerInteiro("deslocamento_x", lidos.leitura.offsetX);
+    lerInteiro("deslocamento_y", lidos.leitura.offsetY);
+    lerReal("divisor_maximo", lidos.leitura.divisorMaximo);
+    lerReal("divisor_media", lidos.leitura.divisorMedia);
+    lerReal("preenchimento_minimo", lidos.leitura.preenchimentoMinimo);
+    lidos.percentualBonsPares = static_cast<float>(percentualBonsPares);
+
+    bool valido = lidos.maxFeatures >= 50 && lidos.percentualBonsPares > 0.0f && lidos.percentualBonsPares <= 1.0f
+        && lidos.diametroBilateral >= 0 && lidos.blocoThresholdAdaptativo >= 3 && lidos.blocoThresholdAdaptativo % 2 == 1
+        && lidos.DPI >= 50 && lidos.raioRegistroLocal >= 0 && lidos.leitura.marginX >= 0 && lidos.leitura.marginY >= 0
+        && lidos.leitura.divisorMaximo > 0 && lidos.leitura.divisorMedia > 0;
+    if (!valido) {
+        logger.AddLogMessage(LogLevel::Warning, "Parmetros fora da faixa em " + caminho + "; mantidos os valores atuais.");
+        return false;
+    }
+
+    parametros = lidos;
+    return true;
+}
+
+bool salvarParametrosPipeline(Logger& logger, const std::string& caminho, const ParametrosPipeline& parametros) {
+    std::ostringstream conteudo;
+    conteudo << "# Parmetros do pipeline; chaves ausentes ficam com o valor padro\n"
+        << "max_features=" << parametros.maxFeatures << "\n"
+        << "bons_pares=" << parametros.percentualBonsPares << "\n"
+        << "bilateral_diametro=" << parametros.diametroBilateral << "\n"
+        << "bilateral_sigma_cor=" << parametros.sigmaCorBilateral << "\n"
+        << "bilateral_sigma_espaco=" << parametros.sigmaEspacoBilateral << "\n"
+        << "threshold_bloco=" << parametros.blocoThresholdAdaptativo << "\n"
+        << "threshold_constante=" << parametros.constanteThresholdAdaptativo << "\n"
+        << "dpi=" << parametros.DPI << "\n"
+        << "registro_local_raio=" << parametros.raioRegistroLocal << "\n"
+        << "margem_x=" << parametros.leitura.marginX << "\n"
+        << "margem_y=" << parametros.leitura.marginY << "\n"
+        << "deslocamento_x=" << parametros.leitura.offsetX << "\n"
+        << "deslocamento_y=" << parametros.leitura.offsetY << "\n"
+        << "divisor_maximo=" << parametros.leitura.divisorMaximo << "\n"
+        << "divisor_media=" << parametros.leitura.divisorMedia << "\n"
+        << "preenchimento_minimo=" << parametros.leitura.preenchimentoMinimo << "\n";
+
+    // Arquivo temporrio e rename: o pipeline nunca carrega um arquivo pela metade
+    fs::path temporario = caminho + ".tmp";
+    {
+        std::ofstream arquivo(temporario, std::ios::binary | std::ios::trunc);
+        arquivo << conteudo.str();
+        if (!arquivo) {
+            logger.AddLogMessage(LogLevel::Error, "No foi possvel gravar o arquivo de parmetros: " + caminho);
+            return false;
+        }
+    }
+    std::error_code erro;
+    fs::rename(temporario, caminho, erro);
+    if (erro) {
+        logger.AddLogMessage(LogLevel::Error, "No foi possvel gravar o arquivo de parmetros: " + caminho);
+        return false;
+    }
+    return true;
+}
+
+void carregarParametrosPipelineSeExistir(Logger& logger, const std::string& caminho) {
+    std::error_code erro;
+    if (!fs::exists(caminho, erro)) {
+        return;
+    }
+    ParametrosPipeline parametros = parametrosPipeline();
+    if (carregarParametrosPipeline(logger, caminho, parametros)) {
+        definirParametrosPipeline(parametros);
+        logger.AddLogMessage(LogLevel::Info, "Parmetros do pipeline carregados de " + caminho);
+    }
+}
+
+// Pgina da amostra j decodificada, com as respostas certas
+struct AmostraAjuste {
+    std::string nome;
+    cv::Mat imagem;
+    std::vector<char> gabarito;
+};
+
+static std::vector<AmostraAjuste> carregarAmostra(Logger& logger, const std::string& pasta) {
+    std::vector<AmostraAjuste> amostras;
+    std::error_code erro;
+    std::vector<fs::path> arquivos;
+    for (const auto& entrada : fs::directory_iterator(pasta, erro)) {
+        std::string extensao = entrada.path().extension().string();
+        std::transform(extensao.begin(), extensao.end(), extensao.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extensao == ".png" || extensao == ".jpg" || extensao == ".jpeg" || extensao == ".tif" || extensao == ".tiff") {
+            arquivos.push_back(entrada.path());
+        }
+    }
+    std::sort(arquivos.begin(), arquivos.end());
+
+    for (const auto& arquivo : arquivos) {
+        std::string nome = arquivo.filename().string();
+        std::string arquivoGabarito = (arquivo.parent_path() / (nome + "_answers.txt")).string();
+        if (!fs::exists(arquivoGabarito, erro)) {
+            logger.AddLogMessage(LogLevel::Warning, "Pgina da amostra sem gabarito, ignorada: " + nome);
+            continue;
+        }
+
+        AmostraAjuste amostra;
+        amostra.nome = nome;
+        amostra.imagem = cv::imread(arquivo.string(), cv::IMREAD_COLOR);
+        amostra.gabarito = lerGabarito(arquivoGabarito);
+        if (amostra.imagem.empty() || amostra.gabarito.empty()) {
+            logger.AddLogMessage(LogLevel::Warning, "Pgina da amostra ilegvel ou gabarito vazio, ignorada: " + nome);
+            continue;
+        }
+        amostras.push_back(std::move(amostra));
+    }
+    return amostras;
+}
+
+// Milissegundos desde "inicio", reiniciando a contagem
+static double medirEtapa(std::chrono::steady_clock::time_point& inicio) {
+    auto agora = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(agora - inicio).count();
+    inicio = agora;
+    return ms;
+}
+
+// Roda a amostra inteira com os parmetros em uso (parametrosPipeline()), pgina por pgina, como o
+// pipeline em memria: reamostragem para o DPI, roteamento, alinhamento, reduo de rudo com
+// binarizao e leitura das respostas
+static AvaliacaoParametros avaliar(Logger& logger, const TemplateRegistry& modelos, const std::vector<ReferenciaAlinhamento>& referencias,
+    const std::vector<AmostraAjuste>& amostras, int dpiAmostra) {
+    const ParametrosPipeline& parametros = parametrosPipeline();
+    AvaliacaoParametros avaliacao;
+    int acertos = 0;
+
+    for (const auto& amostra : amostras) {
+        auto inicio = std::chrono::steady_clock::now();
+
+        cv::Mat pagina = amostra.imagem;
+        if (parametros.DPI != dpiAmostra) {
+            double fator = static_cast<double>(parametros.DPI) / dpiAmostra;
+            cv::resize(amostra.imagem, pagina, cv::Size(), fator, fator, fator < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+        }
+        int indiceModelo = 0;
+        if (modelos.size() > 1) {
+            indiceModelo = std::max(modelos.rotear(criarMiniatura(pagina)).modelo, 0);
+        }
+        const ModeloGabarito& modelo = modelos.modelo(indiceModelo);
+        avaliacao.preparacaoMs += medirEtapa(inicio);
+
+        cv::Mat alinhada, h;
+        alignImagesORB(pagina, referencias[indiceModelo], alinhada, h);
+        avaliacao.alinhamentoMs += medirEtapa(inicio);
+
+        // Questes em branco ('V') contam: uma configurao que inventa marcas nelas tem que perder
+        // acurcia. 'X' (marca dupla no gabarito) fica de fora.
+        int questoesPagina = 0;
+        for (char certa : amostra.gabarito) {
+            if (certa != 'X') questoesPagina++;
+        }
+        avaliacao.questoes += questoesPagina;
+        if (alinhada.empty()) {
+            avaliacao.paginasNaoAlinhadas++;  // Todas as questes da pgina contam como erradas
+            continue;
+        }
+
+        PaginaBits binarizada = reduzirRuidoEBinarizar(alinhada);
+        avaliacao.reducaoRuidoMs += medirEtapa(inicio);
+
+        std::vector<RectangleData> regioes = registrarRegioes(binarizada, modelo.mapaRegistro, modelo.rectangles, parametros.raioRegistroLocal);
+        std::vector<LeituraQuestao> leituras = readAnswersWithConfidence(binarizada, regioes, logger, parametros.leitura);
+        avaliacao.leituraMs += medirEtapa(inicio);
+
+        for (size_t q = 0; q < leituras.size() && q < amostra.gabarito.size(); q++) {
+            char certa = amostra.gabarito[q];
+            if (certa == 'X') continue;
+            if (leituras[q].resposta == certa) acertos++;
+        }
+    }
+
+    double paginas = std::max<double>(1.0, static_cast<double>(amostras.size()));
+    avaliacao.preparacaoMs /= paginas;
+    avaliacao.alinhamentoMs /= paginas;
+    avaliacao.reducaoRuidoMs /= paginas;
+    avaliacao.leituraMs /= paginas;
+    avaliacao.totalMs = avaliacao.preparacaoMs + avaliacao.alinhamentoMs + avaliacao.reducaoRuidoMs + avaliacao.leituraMs;
+    avaliacao.acuracia = avaliacao.questoes > 0 ? static_cast<double>(acertos) / avaliacao.questoes : 0.0;
+    return avaliacao;
+}
+
+// a  melhor que b: entre as que atingem o alvo, a mais rpida (no empate, a mais precisa);
+// enquanto nenhuma atinge, a mais precisa
+static bool melhorQue(const AvaliacaoParametros& a, const AvaliacaoParametros& b, double alvo) {
+    bool aAtinge = a.acuracia >= alvo;
+    bool bAtinge = b.acuracia >= alvo;
+    if (aAtinge != bAtinge) return aAtinge;
+    if (!aAtinge) return a.acuracia > b.acuracia || (a.acuracia == b.acuracia && a.totalMs < b.totalMs);
+    if (a.totalMs < b.totalMs * (1.0 - TOLERANCIA_EMPATE_TEMPO)) return true;
+    return a.totalMs <= b.totalMs * (1.0 + TOLERANCIA_EMPATE_TEMPO) && a.acuracia > b.acuracia;
+}
+
+// Um parmetro varrido: os valores candidatos e como aplic-los
+struct DimensaoAjuste {
+    const char* nome;
+    std::vector<double> valores;
+    std::function<void(ParametrosPipeline&, double)> aplicar;
+    std::function<double(const ParametrosPipeline&)> valor;
+};
+
+static std::vector<DimensaoAjuste> dimensoesAjuste() {
+    return {
+        { "dpi", { 150, 200, 250, 300 },
+            [](ParametrosPipeline& p, double v) { p.DPI = static_cast<int>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.DPI); } },
+        { "registro_local_raio", { 0, 6, 12, 20 },
+            [](ParametrosPipeline& p, double v) { p.raioRegistroLocal = static_cast<int>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.raioRegistroLocal); } },
+        { "max_features", { 200, 300, 400, 500, 600, 800, 1000 },
+            [](ParametrosPipeline& p, double v) { p.maxFeatures = static_cast<int>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.maxFeatures); } },
+        { "bons_pares", { 0.05, 0.10, 0.15, 0.20, 0.30 },
+            [](ParametrosPipeline& p, double v) { p.percentualBonsPares = static_cast<float>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.percentualBonsPares); } },
+        { "bilateral_diametro", { 0, 5, 7, 9 },
+            [](ParametrosPipeline& p, double v) { p.diametroBilateral = static_cast<int>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.diametroBilateral); } },
+        { "bilateral_sigma_cor", { 25, 50, 75, 100 },
+            [](ParametrosPipeline& p, double v) { p.sigmaCorBilateral = v; }, [](const ParametrosPipeline& p) { return p.sigmaCorBilateral; } },
+        { "bilateral_sigma_espaco", { 25, 50, 75, 100 },
+            [](ParametrosPipeline& p, double v) { p.sigmaEspacoBilateral = v; }, [](const ParametrosPipeline& p) { return p.sigmaEspacoBilateral; } },
+        { "margem_x", { 5, 10, 15, 20, 25 },
+            [](ParametrosPipeline& p, double v) { p.leitura.marginX = static_cast<int>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.leitura.marginX); } },
+        { "margem_y", { 5, 10, 15, 20 },
+            [](ParametrosPipeline& p, double v) { p.leitura.marginY = static_cast<int>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.leitura.marginY); } },
+        { "deslocamento_x", { -10, -5, 0, 5, 10 },
+            [](ParametrosPipeline& p, double v) { p.leitura.offsetX = static_cast<int>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.leitura.offsetX); } },
+        { "deslocamento_y", { 10, 15, 20, 25, 30 },
+            [](ParametrosPipeline& p, double v) { p.leitura.offsetY = static_cast<int>(v); }, [](const ParametrosPipeline& p) { return static_cast<double>(p.leitura.offsetY); } },
+    };
+}
+
+static std::string descreverParametros(const ParametrosPipeline& p) {
+    std::ostringstream texto;
+    texto << "dpi=" << p.DPI << " max_features=" << p.maxFeatures << " bons_pares=" << p.percentualBonsPares
+        << " bilateral=" << p.diametroBilateral << "/" << p.sigmaCorBilateral << "/" << p.sigmaEspacoBilateral
+        << " registro_local=" << p.raioRegistroLocal << " margens=" << p.leitura.marginX << "," << p.leitura.marginY
+        << " deslocamento=" << p.leitura.offsetX << "," << p.leitura.offsetY;
+    return texto.str();
+}
+
+static std::string descreverAvaliacao(const AvaliacaoParametros& a) {
+    std::ostringstream texto;
+    texto << std::fixed << std::setprecision(2) << "acurcia " << a.acuracia * 100.0 << "%, " << a.totalMs << " ms/pgina (preparao "
+        << a.preparacaoMs << ", alinhamento " << a.alinhamentoMs << ", rudo+binarizao " << a.reducaoRuidoMs << ", leitura " << a.leituraMs << ")";
+    if (a.paginasNaoAlinhadas > 0) {
+        texto << ", " << a.paginasNaoAlinhadas << " pginas no alinhadas";
+    }
+    return texto.str();
+}
+
+bool ajustarParametros(Logger& logger, const TemplateRegistry& modelos, const ConfiguracaoAjuste& configuracao,
+    const ParametrosPipeline& inicial, ParametrosPipeline& melhor, AvaliacaoParametros* avaliacaoMelhor) {
+    if (modelos.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Ajuste de parmetros sem modelo de prova.");
+        return false;
+    }
+    std::vector<AmostraAjuste> amostras = carregarAmostra(logger, configuracao.pastaAmostra);
+    if (amostras.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Nenhuma pgina com gabarito na amostra: " + configuracao.pastaAmostra);
+        return false;
+    }
+    logger.AddLogMessage(LogLevel::Info, "Ajuste de parmetros com " + std::to_string(amostras.size()) + " pginas.");
+
+    std::ofstream relatorio;
+    if (!configuracao.relatorioCsv.empty()) {
+        relatorio.open(configuracao.relatorioCsv, std::ios::trunc);
+        relatorio << "dpi;registro_local_raio;max_features;bons_pares;bilateral_diametro;bilateral_sigma_cor;bilateral_sigma_espaco;margem_x;margem_y;"
+            "deslocamento_x;deslocamento_y;acuracia;preparacao_ms;alinhamento_ms;reducao_ruido_ms;leitura_ms;total_ms\n";
+    }
+
+    // As features das referncias dependem de max_features: calculadas uma vez por valor
+    std::map<int, std::vector<ReferenciaAlinhamento>> referenciasPorFeatures;
+    ParametrosPipeline anteriores = parametrosPipeline();
+    auto avaliarCandidato = [&](const ParametrosPipeline& candidato) {
+        definirParametrosPipeline(candidato);
+        auto& referencias = referenciasPorFeatures[candidato.maxFeatures];
+        if (referencias.empty()) {
+            for (size_t m = 0; m < modelos.size(); m++) {
+                referencias.push_back(prepararReferenciaAlinhamento(modelos.modelo(static_cast<int>(m)).alinhamento.imagem));
+            }
+        }
+        AvaliacaoParametros avaliacao = avaliar(logger, modelos, referencias, amostras, configuracao.dpiAmostra);
+        if (relatorio.is_open()) {
+            const ParametrosPipeline& p = candidato;
+            relatorio << p.DPI << ";" << p.raioRegistroLocal << ";" << p.maxFeatures << ";" << p.percentualBonsPares << ";" << p.diametroBilateral << ";"
+                << p.sigmaCorBilateral << ";" << p.sigmaEspacoBilateral << ";" << p.leitura.marginX << ";" << p.leitura.marginY << ";"
+                << p.leitura.offsetX << ";" << p.leitura.offsetY << ";" << avaliacao.acuracia << ";" << avaliacao.preparacaoMs << ";"
+                << avaliacao.alinhamentoMs << ";" << avaliacao.reducaoRuidoMs << ";" << avaliacao.leituraMs << ";" << avaliacao.totalMs << "\n";
+        }
+        return avaliacao;
+    };
+
+    melhor = inicial;
+    AvaliacaoParametros avaliacaoAtual = avaliarCandidato(melhor);
+    logger.AddLogMessage(LogLevel::Info, "Configurao inicial: " + descreverAvaliacao(avaliacaoAtual));
+
+    std::vector<DimensaoAjuste> dimensoes = dimensoesAjuste();
+    for (int rodada = 0; rodada < configuracao.rodadas; rodada++) {
+        bool mudou = false;
+        for (const auto& dimensao : dimensoes) {
+            for (double valor : dimensao.valores) {
+                if (std::fabs(dimensao.valor(melhor) - valor) < 1e-6) continue;
+                ParametrosPipeline candidato = melhor;
+                dimensao.aplicar(candidato, valor);
+                AvaliacaoParametros avaliacao = avaliarCandidato(candidato);
+                if (melhorQue(avaliacao, avaliacaoAtual, configuracao.acuraciaAlvo)) {
+                    melhor = candidato;
+                    avaliacaoAtual = avaliacao;
+                    mudou = true;
+                    std::ostringstream valorTexto;
+                    valorTexto << valor;
+                    logger.AddLogMessage(LogLevel::Info, std::string(dimensao.nome) + "=" + valorTexto.str() + ": " + descreverAvaliacao(avaliacao));
+                }
+            }
+        }
+        if (!mudou) break;
+    }
+
+    definirParametrosPipeline(anteriores);
+    if (avaliacaoMelhor != nullptr) {
+        *avaliacaoMelhor = avaliacaoAtual;
+    }
+
+    if (avaliacaoAtual.acuracia < configuracao.acuraciaAlvo) {
+        std::ostringstream alvo;
+        alvo << std::fixed << std::setprecision(2) << configuracao.acuraciaAlvo * 100.0;
+        logger.AddLogMessage(LogLevel::Warning, "Nenhuma configurao atingiu a acurcia alvo de " + alvo.str() + "%; gravada a mais precisa.");
+    }
+    logger.AddLogMessage(LogLevel::Info, "Configurao escolhida: " + descreverParametros(melhor) + " - " + descreverAvaliacao(avaliacaoAtual));
+    return salvarParametrosPipeline(logger, configuracao.arquivoSaida, melhor);
+}
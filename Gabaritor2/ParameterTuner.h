@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ImageProcessing.h"
+#include "TemplateRegistry.h"
+
+// Arquivo de parmetros carregado na inicializao (na pasta de trabalho), "chave=valor" por linha
+const std::string ARQUIVO_PARAMETROS_PIPELINE = "parametros_pipeline.txt";
+
+// Chaves ausentes ficam com o valor de parametros; valores fora da faixa so recusados com um aviso
+bool carregarParametrosPipeline(Logger& logger, const std::string& caminho, ParametrosPipeline& parametros);
+bool salvarParametrosPipeline(Logger& logger, const std::string& caminho, const ParametrosPipeline& parametros);
+// Carrega caminho (se existir) e define os parmetros do processo; sem o arquivo ficam os padres
+void carregarParametrosPipelineSeExistir(Logger& logger, const std::string& caminho);
+
+// Ajuste automtico de velocidade contra acurcia. A amostra  uma pasta de pginas (PNG, JPG ou TIFF,
+// uma pgina por arquivo, digitalizadas ou renderizadas em dpiAmostra) e, ao lado de cada pgina, as
+// respostas certas no formato da leitura: "<arquivo>_answers.txt" (por exemplo, "page_3.png_answers.txt").
+struct ConfiguracaoAjuste {
+    std::string pastaAmostra;
+    int dpiAmostra = 300;
+    double acuraciaAlvo = 0.995;    // Frao das questes do gabarito lidas certo (questes 'X' no gabarito no contam; 'V' exige a questo lida em branco)
+    int rodadas = 2;                // Passadas da varredura por todos os parmetros
+    std::string arquivoSaida = ARQUIVO_PARAMETROS_PIPELINE;
+    std::string relatorioCsv;       // Vazio = sem relatrio; seno uma linha por configurao avaliada
+};
+
+// Tempo mdio por pgina de cada etapa, em milissegundos, e a acurcia sobre a amostra
+struct AvaliacaoParametros {
+    double acuracia = 0.0;
+    int questoes = 0;
+    int paginasNaoAlinhadas = 0;
+    double preparacaoMs = 0;        // Reamostragem para o DPI e roteamento
+    double alinhamentoMs = 0;
+    double reducaoRuidoMs = 0;      // Reduo de rudo e binarizao
+    double leituraMs = 0;
+    double totalMs = 0;
+};
+
+// Varre os parmetros um de cada vez a partir de inicial (coordenada a coordenada, por rodadas) e fica com
+// a configurao mais rpida que atinge a acurcia alvo; enquanto nenhuma atinge, fica com a mais precisa.
+// O resultado  gravado em configuracao.arquivoSaida. O threshold adaptativo s afeta o OCR das regies
+// de palavra, que a amostra no avalia: fica com o valor de inicial.
+bool ajustarParametros(Logger& logger, const TemplateRegistry& modelos, const ConfiguracaoAjuste& configuracao,
+    const ParametrosPipeline& inicial, ParametrosPipeline& melhor, AvaliacaoParametros* avaliacaoMelhor = nullptr);
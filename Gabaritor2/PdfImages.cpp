@@ -0,0 +1,854 @@
+#include "PdfImages.h"
+#include "ImageProcessing.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <vector>
+
+// ---------------------------------------------------------------------------------------------
+// Leitura mnima de objetos PDF (s o necessrio para achar a rvore de pginas, os recursos e
+// o stream de contedo de cada pgina)
+
+namespace {
+
+struct ObjetoPdf {
+    enum Tipo { Nulo, Booleano, Numero, Nome, Texto, Lista, Dicionario, Referencia, Operador };
+
+    Tipo tipo = Nulo;
+    double numero = 0;
+    std::string texto;                        // Nome (sem a barra), string ou operador
+    std::vector<ObjetoPdf> itens;
+    std::map<std::string, ObjetoPdf> chaves;
+    int objeto = 0;                           // Nmero do objeto de uma referncia
+    // Stream do objeto indireto (posio no arquivo); tamanhoStream < 0 se no for stream
+    size_t inicioStream = 0;
+    long long tamanhoStream = -1;
+
+    const ObjetoPdf* chave(const std::string& nome) const {
+        auto it = chaves.find(nome);
+        return it != chaves.end() ? &it->second : nullptr;
+    }
+};
+
+bool ehEspaco(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\0';
+}
+
+bool ehDelimitador(char c) {
+    return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' || c == ']' || c == '{' || c == '}' || c == '/' || c == '%';
+}
+
+// Analisador de objetos sobre um buffer (o arquivo inteiro ou um stream de contedo)
+class AnalisadorPdf {
+public:
+    AnalisadorPdf(const char* inicio, size_t tamanho, size_t posicao = 0) : dados(inicio), tamanho(tamanho), pos(posicao) {}
+
+    size_t posicao() const { return pos; }
+    bool fim() { pularEspacos(); return pos >= tamanho; }
+
+    void pularEspacos() {
+        while (pos < tamanho) {
+            if (ehEspaco(dados[pos])) {
+                pos++;
+            }
+            else if (dados[pos] == '%') {
+                while (pos < tamanho && dados[pos] != '\n' && dados[pos] != '\r') pos++;
+            }
+            else {
+                break;
+            }
+        }
+    }
+
+    // Palavra sem delimitadores (operador, keyword ou nmero)
+    std::string lerPalavra() {
+        pularEspacos();
+        size_t inicio = pos;
+        while (pos < tamanho && !ehEspaco(dados[pos]) && !ehDelimitador(dados[pos])) pos++;
+        return std::string(dados + inicio, pos - inicio);
+    }
+
+    bool lerObjeto(ObjetoPdf& objeto, int profundidade = 0) {
+        pularEspacos();
+        if (pos >= tamanho || profundidade > 64) return false;
+
+        char c = dados[pos];
+        if (c == '/') {
+            pos++;
+            objeto.tipo = ObjetoPdf::Nome;
+            objeto.texto.clear();
+            while (pos < tamanho && !ehEspaco(dados[pos]) && !ehDelimitador(dados[pos])) {
+                if (dados[pos] == '#' && pos + 2 < tamanho) {
+                    objeto.texto += static_cast<char>(std::strtol(std::string(dados + pos + 1, 2).c_str(), nullptr, 16));
+                    pos += 3;
+                }
+                else {
+                    objeto.texto += dados[pos++];
+                }
+            }
+            return true;
+        }
+        if (c == '<' && pos + 1 < tamanho && dados[pos + 1] == '<') {
+            pos += 2;
+            objeto.tipo = ObjetoPdf::Dicionario;
+            for (;;) {
+                pularEspacos();
+                if (pos + 1 < tamanho && dados[pos] == '>' && dados[pos + 1] == '>') {
+                    pos += 2;
+                    return true;
+                }
+                ObjetoPdf nome, valor;
+                if (!lerObjeto(nome, profundidade + 1) || nome.tipo != ObjetoPdf::Nome) return false;
+                if (!lerObjeto(valor, profundidade + 1)) return false;
+                objeto.chaves[nome.texto] = std::move(valor);
+            }
+        }
+        if (c == '<') {
+            pos++;
+            objeto.tipo = ObjetoPdf::Texto;
+            while (pos < tamanho && dados[pos] != '>') pos++;
+            pos++;
+            return pos <= tamanho;
+        }
+        if (c == '(') {
+            // O contedo das strings no  usado; s precisa achar o fim respeitando parnteses e escapes
+            objeto.tipo = ObjetoPdf::Texto;
+            int nivel = 0;
+            while (pos < tamanho) {
+                char atual = dados[pos++];
+                if (atual == '\\') pos++;
+                else if (atual == '(') nivel++;
+                else if (atual == ')' && --nivel == 0) return true;
+            }
+            return false;
+        }
+        if (c == '[') {
+            pos++;
+            objeto.tipo = ObjetoPdf::Lista;
+            for (;;) {
+                pularEspacos();
+                if (pos < tamanho && dados[pos] == ']') {
+                    pos++;
+                    return true;
+                }
+                ObjetoPdf item;
+                if (!lerObjeto(item, profundidade + 1)) return false;
+                objeto.itens.push_back(std::move(item));
+            }
+        }
+        if (ehDelimitador(c)) {
+            return false;
+        }
+
+        std::string palavra = lerPalavra();
+        if (palavra.empty()) return false;
+        if (palavra == "true" || palavra == "false") {
+            objeto.tipo = ObjetoPdf::Booleano;
+            objeto.numero = palavra == "true" ? 1 : 0;
+            return true;
+        }
+        if (palavra == "null") {
+            objeto.tipo = ObjetoPdf::Nulo;
+            return true;
+        }
+
+        char* fimNumero = nullptr;
+        double numero = std::strtod(palavra.c_str(), &fimNumero);
+        if (fimNumero == nullptr || *fimNumero != '\0') {
+            objeto.tipo = ObjetoPdf::Operador;
+            objeto.texto = palavra;
+            return true;
+        }
+        objeto.tipo = ObjetoPdf::Numero;
+        objeto.numero = numero;
+
+        // "N G R"  uma referncia
+        size_t depoisDoNumero = pos;
+        std::string geracao = lerPalavra();
+        if (!geracao.empty() && geracao.find_first_not_of("0123456789") == std::string::npos && lerPalavra() == "R") {
+            objeto.tipo = ObjetoPdf::Referencia;
+            objeto.objeto = static_cast<int>(numero);
+            return true;
+        }
+        pos = depoisDoNumero;
+        return true;
+    }
+
+private:
+    const char* dados;
+    size_t tamanho;
+    size_t pos;
+};
+
+// Multiplicao de matrizes de transformao do PDF [a b c d e f]
+struct MatrizPdf {
+    double a = 1, b = 0, c = 0, d = 1, e = 0, f = 0;
+
+    MatrizPdf vezes(const MatrizPdf& m) const {
+        MatrizPdf r;
+        r.a = a * m.a + b * m.c;
+        r.b = a * m.b + b * m.d;
+        r.c = c * m.a + d * m.c;
+        r.d = c * m.b + d * m.d;
+        r.e = e * m.a + f * m.c + m.e;
+        r.f = e * m.b + f * m.d + m.f;
+        return r;
+    }
+};
+
+enum class FiltroImagem {
+    Nenhum,
+    Dct,
+    Flate,
+    Ccitt
+};
+
+bool inflarZlib(const unsigned char* entrada, size_t tamanho, std::vector<unsigned char>& saida) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit(&zs) != Z_OK) return false;
+
+    saida.clear();
+    zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(entrada));
+    zs.avail_in = static_cast<uInt>(tamanho);
+    int resultado = Z_OK;
+    while (resultado == Z_OK) {
+        size_t escrito = saida.size();
+        saida.resize(escrito + std::max<size_t>(tamanho * 2, 65536));
+        zs.next_out = reinterpret_cast<Bytef*>(saida.data() + escrito);
+        zs.avail_out = static_cast<uInt>(saida.size() - escrito);
+        resultado = inflate(&zs, Z_NO_FLUSH);
+        saida.resize(saida.size() - zs.avail_out);
+        // Streams sem o marcador de fim: tudo que havia na entrada j foi consumido
+        if (resultado == Z_BUF_ERROR && zs.avail_in == 0) resultado = Z_STREAM_END;
+    }
+    inflateEnd(&zs);
+    return resultado == Z_STREAM_END;
+}
+
+// Desfaz os preditores PNG (10 a 15) e TIFF (2) de /DecodeParms. Retorna false se o formato no bater.
+bool removerPreditor(std::vector<unsigned char>& dados, int preditor, int colunas, int cores, int bitsPorComponente) {
+    if (preditor <= 1) return true;
+
+    size_t bytesPorLinha = (static_cast<size_t>(colunas) * cores * bitsPorComponente + 7) / 8;
+    size_t bytesPorPixel = std::max<size_t>(1, (static_cast<size_t>(cores) * bitsPorComponente) / 8);
+
+    if (preditor == 2) {
+        if (bitsPorComponente != 8) return false;
+        for (size_t inicio = 0; inicio + bytesPorLinha <= dados.size(); inicio += bytesPorLinha) {
+            for (size_t x = bytesPorPixel; x < bytesPorLinha; x++) {
+                dados[inicio + x] = static_cast<unsigned char>(dados[inicio + x] + dados[inicio + x - bytesPorPixel]);
+            }
+        }
+        return true;
+    }
+
+    // PNG: cada linha comea com o byte do tipo de filtro
+    size_t linhas = dados.size() / (bytesPorLinha + 1);
+    std::vector<unsigned char> saida(linhas * bytesPorLinha);
+    std::vector<unsigned char> anterior(bytesPorLinha, 0);
+    for (size_t y = 0; y < linhas; y++) {
+        const unsigned char* linha = dados.data() + y * (bytesPorLinha + 1);
+        unsigned char filtro = linha[0];
+        unsigned char* atual = saida.data() + y * bytesPorLinha;
+        for (size_t x = 0; x < bytesPorLinha; x++) {
+            int esquerda = x >= bytesPorPixel ? atual[x - bytesPorPixel] : 0;
+            int cima = anterior[x];
+            int diagonal = x >= bytesPorPixel ? anterior[x - bytesPorPixel] : 0;
+            int valor = linha[1 + x];
+            switch (filtro) {
+            case 0: break;
+            case 1: valor += esquerda; break;
+            case 2: valor += cima; break;
+            case 3: valor += (esquerda + cima) / 2; break;
+            case 4: {
+                int p = esquerda + cima - diagonal;
+                int pa = std::abs(p - esquerda), pb = std::abs(p - cima), pc = std::abs(p - diagonal);
+                valor += (pa <= pb && pa <= pc) ? esquerda : (pb <= pc ? cima : diagonal);
+                break;
+            }
+            default: return false;
+            }
+            atual[x] = static_cast<unsigned char>(valor);
+        }
+        std::memcpy(anterior.data(), atual, bytesPorLinha);
+    }
+    dados.swap(saida);
+    return true;
+}
+
+void escreverTiff16(std::vector<unsigned char>& saida, uint16_t valor) {
+    saida.push_back(static_cast<unsigned char>(valor & 0xFF));
+    saida.push_back(static_cast<unsigned char>(valor >> 8));
+}
+
+void escreverTiff32(std::vector<unsigned char>& saida, uint32_t valor) {
+    for (int i = 0; i < 4; i++) saida.push_back(static_cast<unsigned char>((valor >> (8 * i)) & 0xFF));
+}
+
+// Embrulha dados CCITT G3/G4 em um TIFF de uma faixa, para o decodificador de TIFF do OpenCV (libtiff)
+std::vector<unsigned char> embrulharCcittEmTiff(const unsigned char* dados, size_t tamanho, int largura, int altura, int k) {
+    struct Entrada { uint16_t tag, tipo; uint32_t valor; };
+    const uint16_t SHORT = 3, LONG = 4;
+    std::vector<Entrada> entradas = {
+        { 256, LONG, static_cast<uint32_t>(largura) },
+        { 257, LONG, static_cast<uint32_t>(altura) },
+        { 258, SHORT, 1 },                                // BitsPerSample
+        { 259, SHORT, static_cast<uint32_t>(k < 0 ? 4 : 3) },  // Compression: 4 = G4, 3 = G3
+        { 262, SHORT, 0 },                                // WhiteIsZero, como no fax
+        { 273, LONG, 0 },                                 // StripOffsets, preenchido abaixo
+        { 277, SHORT, 1 },                                // SamplesPerPixel
+        { 278, LONG, static_cast<uint32_t>(altura) },     // RowsPerStrip
+        { 279, LONG, static_cast<uint32_t>(tamanho) },    // StripByteCounts
+        { static_cast<uint16_t>(k < 0 ? 293 : 292), LONG, static_cast<uint32_t>(k > 0 ? 1 : 0) }  // T6Options / T4Options (bit 0 = 2D)
+    };
+
+    uint32_t tamanhoIfd = 2 + static_cast<uint32_t>(entradas.size()) * 12 + 4;
+    uint32_t inicioDados = 8 + tamanhoIfd;
+    entradas[5].valor = inicioDados;
+
+    std::vector<unsigned char> tiff;
+    tiff.reserve(inicioDados + tamanho);
+    tiff.push_back('I');
+    tiff.push_back('I');
+    escreverTiff16(tiff, 42);
+    escreverTiff32(tiff, 8);
+    escreverTiff16(tiff, static_cast<uint16_t>(entradas.size()));
+    for (const auto& entrada : entradas) {
+        escreverTiff16(tiff, entrada.tag);
+        escreverTiff16(tiff, entrada.tipo);
+        escreverTiff32(tiff, 1);
+        if (entrada.tipo == SHORT) {
+            escreverTiff16(tiff, static_cast<uint16_t>(entrada.valor));
+            escreverTiff16(tiff, 0);
+        }
+        else {
+            escreverTiff32(tiff, entrada.valor);
+        }
+    }
+    escreverTiff32(tiff, 0);
+    tiff.insert(tiff.end(), dados, dados + tamanho);
+    return tiff;
+}
+
+}
+
+// ---------------------------------------------------------------------------------------------
+
+// Como decodificar a imagem de uma pgina que tem o atalho
+struct ImagemPagina {
+    bool valida = false;
+    size_t inicio = 0;            // Stream da imagem no arquivo
+    size_t tamanho = 0;
+    FiltroImagem filtro = FiltroImagem::Nenhum;
+    int largura = 0;
+    int altura = 0;
+    int bitsPorComponente = 8;
+    int componentes = 1;
+    bool inverter = false;        // /Decode [1 0]
+    int preditor = 1;             // Flate
+    int k = 0;                    // CCITT
+    bool blackIs1 = false;
+    double larguraPaginaPts = 0;  // Largura da MediaBox, para a resoluo nativa
+    int rotacao = 0;              // /Rotate da pgina (0, 90, 180, 270)
+};
+
+struct ImagensEmbutidasPdf::Dados {
+    std::string arquivo;                 // Contedo inteiro do PDF
+    std::map<int, size_t> objetos;       // Nmero do objeto -> posio de "N G obj"
+    std::vector<ImagemPagina> paginas;
+
+    bool lerIndireto(int numero, ObjetoPdf& objeto) const;
+    const ObjetoPdf& resolver(const ObjetoPdf& objeto, ObjetoPdf& armazenamento) const;
+    bool conteudoDoStream(const ObjetoPdf& stream, std::string& conteudo) const;
+    void indexarObjetos();
+    void coletarPaginas(const ObjetoPdf& no, const ObjetoPdf* recursos, const ObjetoPdf* mediaBox, int rotacao,
+        std::vector<ImagemPagina>& saida, int profundidade, bool& erro) const;
+    ImagemPagina analisarPagina(const ObjetoPdf& pagina, const ObjetoPdf* recursos, const ObjetoPdf* mediaBox, int rotacao) const;
+};
+
+void ImagensEmbutidasPdf::Dados::indexarObjetos() {
+    // Procura "N G obj" no arquivo inteiro em vez de confiar na tabela xref (que s vezes vem
+    // quebrada em PDFs de scanner). Em atualizaes incrementais vale a ltima definio.
+    size_t pos = 0;
+    while ((pos = arquivo.find("obj", pos)) != std::string::npos) {
+        size_t fim = pos + 3;
+        if (fim < arquivo.size() && !ehEspaco(arquivo[fim]) && !ehDelimitador(arquivo[fim])) {
+            pos = fim;
+            continue;
+        }
+        size_t p = pos;
+        auto voltarEspacos = [&]() { size_t inicio = p; while (p > 0 && ehEspaco(arquivo[p - 1])) p--; return p < inicio; };
+        auto voltarDigitos = [&]() { size_t inicio = p; while (p > 0 && std::isdigit(static_cast<unsigned char>(arquivo[p - 1]))) p--; return p < inicio; };
+        if (voltarEspacos() && voltarDigitos() && voltarEspacos() && voltarDigitos()
+            && (p == 0 || ehEspaco(arquivo[p - 1]) || ehDelimitador(arquivo[p - 1]))) {
+            objetos[std::atoi(arquivo.c_str() + p)] = p;
+        }
+        pos = fim;
+    }
+}
+
+bool ImagensEmbutidasPdf::Dados::lerIndireto(int numero, ObjetoPdf& objeto) const {
+    auto it = objetos.find(numero);
+    if (it == objetos.end()) return false;
+
+    AnalisadorPdf analisador(arquivo.data(), arquivo.size(), it->second);
+    analisador.lerPalavra();  // N
+    analisador.lerPalavra();  // G
+    if (analisador.lerPalavra() != "obj") return false;
+    objeto = ObjetoPdf();
+    if (!analisador.lerObjeto(objeto)) return false;
+
+    if (objeto.tipo == ObjetoPdf::Dicionario) {
+        if (analisador.lerPalavra() == "stream") {
+            size_t inicio = analisador.posicao();
+            if (inicio < arquivo.size() && arquivo[inicio] == '\r') inicio++;
+            if (inicio < arquivo.size() && arquivo[inicio] == '\n') inicio++;
+
+            long long tamanho = -1;
+            if (const ObjetoPdf* length = objeto.chave("Length")) {
+                ObjetoPdf armazenamento;
+                const ObjetoPdf& valor = length->tipo == ObjetoPdf::Referencia ? resolver(*length, armazenamento) : *length;
+                if (valor.tipo == ObjetoPdf::Numero) tamanho = static_cast<long long>(valor.numero);
+            }
+            // /Length errado: usa o "endstream"
+            bool tamanhoConfere = false;
+            if (tamanho >= 0 && inicio + tamanho <= arquivo.size()) {
+                size_t depois = arquivo.find_first_not_of(" \r\n", inicio + tamanho);
+                tamanhoConfere = depois != std::string::npos && arquivo.compare(depois, 9, "endstream") == 0;
+            }
+            if (!tamanhoConfere) {
+                size_t fim = arquivo.find("endstream", inicio);
+                if (fim == std::string::npos) return false;
+                while (fim > inicio && (arquivo[fim - 1] == '\n' || arquivo[fim - 1] == '\r')) fim--;
+                tamanho = static_cast<long long>(fim - inicio);
+            }
+            objeto.inicioStream = inicio;
+            objeto.tamanhoStream = tamanho;
+        }
+    }
+    return true;
+}
+
+const ObjetoPdf& ImagensEmbutidasPdf::Dados::resolver(const ObjetoPdf& objeto, ObjetoPdf& armazenamento) const {
+    if (objeto.tipo != ObjetoPdf::Referencia) return objeto;
+    if (!lerIndireto(objeto.objeto, armazenamento)) armazenamento = ObjetoPdf();
+    return armazenamento;
+}
+
+bool ImagensEmbutidasPdf::Dados::conteudoDoStream(const ObjetoPdf& stream, std::string& conteudo) const {
+    if (stream.tamanhoStream < 0) return false;
+    const unsigned char* inicio = reinterpret_cast<const unsigned char*>(arquivo.data() + stream.inicioStream);
+
+    const ObjetoPdf* filtro = stream.chave("Filter");
+    if (filtro != nullptr && filtro->tipo == ObjetoPdf::Lista && filtro->itens.size() == 1) filtro = &filtro->itens[0];
+    if (filtro == nullptr) {
+        conteudo.append(reinterpret_cast<const char*>(inicio), static_cast<size_t>(stream.tamanhoStream));
+        return true;
+    }
+    if (filtro->tipo == ObjetoPdf::Nome && filtro->texto == "FlateDecode") {
+        std::vector<unsigned char> inflado;
+        if (!inflarZlib(inicio, static_cast<size_t>(stream.tamanhoStream), inflado)) return false;
+        conteudo.append(inflado.begin(), inflado.end());
+        return true;
+    }
+    return false;
+}
+
+void ImagensEmbutidasPdf::Dados::coletarPaginas(const ObjetoPdf& no, const ObjetoPdf* recursos, const ObjetoPdf* mediaBox, int rotacao,
+    std::vector<ImagemPagina>& saida, int profundidade, bool& erro) const {
+    if (profundidade > 32) {
+        erro = true;
+        return;
+    }
+
+    // Recursos, MediaBox e Rotate so herdados dos ns intermedirios
+    if (const ObjetoPdf* r = no.chave("Resources")) recursos = r;
+    if (const ObjetoPdf* m = no.chave("MediaBox")) mediaBox = m;
+    if (const ObjetoPdf* r = no.chave("Rotate")) {
+        ObjetoPdf armazenamento;
+        const ObjetoPdf& valor = resolver(*r, armazenamento);
+        if (valor.tipo == ObjetoPdf::Numero) rotacao = static_cast<int>(valor.numero);
+    }
+
+    const ObjetoPdf* tipo = no.chave("Type");
+    const ObjetoPdf* kids = no.chave("Kids");
+    if (kids != nullptr && (tipo == nullptr || tipo->texto != "Page")) {
+        ObjetoPdf armazenamentoKids;
+        const ObjetoPdf& lista = resolver(*kids, armazenamentoKids);
+        for (const auto& kid : lista.itens) {
+            ObjetoPdf filho;
+            if (kid.tipo != ObjetoPdf::Referencia || !lerIndireto(kid.objeto, filho)) {
+                erro = true;
+                return;
+            }
+            coletarPaginas(filho, recursos, mediaBox, rotacao, saida, profundidade + 1, erro);
+            if (erro) return;
+        }
+        return;
+    }
+
+    // Os ponteiros de recursos/MediaBox herdados apontam para objetos dos ns acima, ainda vivos aqui
+    saida.push_back(analisarPagina(no, recursos, mediaBox, rotacao));
+}
+
+ImagemPagina ImagensEmbutidasPdf::Dados::analisarPagina(const ObjetoPdf& pagina, const ObjetoPdf* recursos, const ObjetoPdf* mediaBox, int rotacao) const {
+    ImagemPagina imagem;
+    if (recursos == nullptr || mediaBox == nullptr) return imagem;
+
+    ObjetoPdf armazenamentoCaixa;
+    const ObjetoPdf& caixa = resolver(*mediaBox, armazenamentoCaixa);
+    if (caixa.itens.size() != 4) return imagem;
+    double x0 = caixa.itens[0].numero, y0 = caixa.itens[1].numero;
+    double larguraPts = caixa.itens[2].numero - x0, alturaPts = caixa.itens[3].numero - y0;
+    if (larguraPts <= 0 || alturaPts <= 0) return imagem;
+
+    // Contedo da pgina (um stream ou uma lista de streams concatenados)
+    const ObjetoPdf* contents = pagina.chave("Contents");
+    if (contents == nullptr) return imagem;
+    std::vector<ObjetoPdf> referencias;
+    if (contents->tipo == ObjetoPdf::Lista) referencias = contents->itens;
+    else referencias.push_back(*contents);
+
+    std::string conteudo;
+    for (const auto& referencia : referencias) {
+        ObjetoPdf stream;
+        if (referencia.tipo != ObjetoPdf::Referencia || !lerIndireto(referencia.objeto, stream)) return imagem;
+        // Uma lista indireta de streams
+        if (stream.tipo == ObjetoPdf::Lista) {
+            for (const auto& item : stream.itens) {
+                ObjetoPdf parte;
+                if (item.tipo != ObjetoPdf::Referencia || !lerIndireto(item.objeto, parte) || !conteudoDoStream(parte, conteudo)) return imagem;
+                conteudo += '\n';
+            }
+            continue;
+        }
+        if (!conteudoDoStream(stream, conteudo)) return imagem;
+        conteudo += '\n';
+    }
+
+    // S estado grfico, recorte e um nico "Do" de imagem; qualquer operador que pinte (texto,
+    // caminhos, imagens inline, shading) deixa a pgina para a renderizao
+    static const char* operadoresPermitidos[] = { "q", "Q", "cm", "gs", "w", "J", "j", "M", "d", "ri", "i",
+        "g", "G", "rg", "RG", "k", "K", "cs", "CS", "sc", "SC", "scn", "SCN", "re", "m", "l", "h", "W", "W*", "n" };
+
+    AnalisadorPdf analisador(conteudo.data(), conteudo.size());
+    std::vector<ObjetoPdf> operandos;
+    std::vector<MatrizPdf> pilha;
+    MatrizPdf ctm;
+    std::string nomeImagem;
+    MatrizPdf matrizImagem;
+    while (!analisador.fim()) {
+        ObjetoPdf token;
+        if (!analisador.lerObjeto(token)) return imagem;
+        if (token.tipo != ObjetoPdf::Operador) {
+            operandos.push_back(std::move(token));
+            continue;
+        }
+
+        const std::string& op = token.texto;
+        if (op == "q") {
+            pilha.push_back(ctm);
+        }
+        else if (op == "Q") {
+            if (pilha.empty()) return imagem;
+            ctm = pilha.back();
+            pilha.pop_back();
+        }
+        else if (op == "cm") {
+            if (operandos.size() != 6) return imagem;
+            MatrizPdf m;
+            m.a = operandos[0].numero; m.b = operandos[1].numero; m.c = operandos[2].numero;
+            m.d = operandos[3].numero; m.e = operandos[4].numero; m.f = operandos[5].numero;
+            ctm = m.vezes(ctm);
+        }
+        else if (op == "Do") {
+            if (!nomeImagem.empty() || operandos.size() != 1 || operandos[0].tipo != ObjetoPdf::Nome) return imagem;
+            nomeImagem = operandos[0].texto;
+            matrizImagem = ctm;
+        }
+        else if (std::find_if(std::begin(operadoresPermitidos), std::end(operadoresPermitidos),
+            [&](const char* permitido) { return op == permitido; }) == std::end(operadoresPermitidos)) {
+            return imagem;
+        }
+        operandos.clear();
+    }
+    if (nomeImagem.empty()) return imagem;
+
+    // A imagem precisa ocupar a pgina inteira, sem rotao nem espelhamento (tolerncia de 2%)
+    const MatrizPdf& m = matrizImagem;
+    if (std::abs(m.b) > 0.001 * larguraPts || std::abs(m.c) > 0.001 * alturaPts) return imagem;
+    if (std::abs(m.a - larguraPts) > 0.02 * larguraPts || std::abs(m.d - alturaPts) > 0.02 * alturaPts) return imagem;
+    if (std::abs(m.e - x0) > 0.02 * larguraPts || std::abs(m.f - y0) > 0.02 * alturaPts) return imagem;
+
+    // Recursos -> XObject -> imagem
+    ObjetoPdf armazenamentoRecursos, armazenamentoXObjects, xobject;
+    const ObjetoPdf& dicionarioRecursos = resolver(*recursos, armazenamentoRecursos);
+    const ObjetoPdf* xobjects = dicionarioRecursos.chave("XObject");
+    if (xobjects == nullptr) return imagem;
+    const ObjetoPdf* referenciaImagem = resolver(*xobjects, armazenamentoXObjects).chave(nomeImagem);
+    if (referenciaImagem == nullptr || referenciaImagem->tipo != ObjetoPdf::Referencia || !lerIndireto(referenciaImagem->objeto, xobject)) return imagem;
+    if (xobject.tamanhoStream <= 0) return imagem;
+
+    const ObjetoPdf* subtipo = xobject.chave("Subtype");
+    if (subtipo == nullptr || subtipo->texto != "Image") return imagem;
+    if (xobject.chave("SMask") != nullptr || xobject.chave("Mask") != nullptr) return imagem;
+    if (const ObjetoPdf* mascara = xobject.chave("ImageMask")) {
+        if (mascara->numero != 0) return imagem;
+    }
+
+    auto numeroDe = [&](const ObjetoPdf* valor, int padrao) {
+        if (valor == nullptr) return padrao;
+        ObjetoPdf armazenamento;
+        const ObjetoPdf& resolvido = resolver(*valor, armazenamento);
+        return resolvido.tipo == ObjetoPdf::Numero ? static_cast<int>(resolvido.numero) : padrao;
+    };
+    imagem.largura = numeroDe(xobject.chave("Width"), 0);
+    imagem.altura = numeroDe(xobject.chave("Height"), 0);
+    imagem.bitsPorComponente = numeroDe(xobject.chave("BitsPerComponent"), 8);
+    if (imagem.largura <= 0 || imagem.altura <= 0) return imagem;
+
+    // Espao de cor: s cinza e RGB (sem paleta, CMYK ou separaes)
+    imagem.componentes = 0;
+    if (const ObjetoPdf* espaco = xobject.chave("ColorSpace")) {
+        ObjetoPdf armazenamentoEspaco;
+        const ObjetoPdf& cor = resolver(*espaco, armazenamentoEspaco);
+        std::string nome = cor.tipo == ObjetoPdf::Nome ? cor.texto : (!cor.itens.empty() ? cor.itens[0].texto : "");
+        if (nome == "DeviceGray" || nome == "CalGray") imagem.componentes = 1;
+        else if (nome == "DeviceRGB" || nome == "CalRGB") imagem.componentes = 3;
+        else if (nome == "ICCBased" && cor.itens.size() == 2) {
+            ObjetoPdf perfil;
+            if (cor.itens[1].tipo == ObjetoPdf::Referencia && lerIndireto(cor.itens[1].objeto, perfil)) {
+                int n = numeroDe(perfil.chave("N"), 0);
+                if (n == 1 || n == 3) imagem.componentes = n;
+            }
+        }
+    }
+
+    const ObjetoPdf* filtro = xobject.chave("Filter");
+    const ObjetoPdf* parametros = xobject.chave("DecodeParms");
+    if (filtro != nullptr && filtro->tipo == ObjetoPdf::Lista) {
+        if (filtro->itens.size() != 1) return imagem;
+        filtro = &filtro->itens[0];
+    }
+    if (parametros != nullptr && parametros->tipo == ObjetoPdf::Lista) {
+        parametros = parametros->itens.empty() ? nullptr : &parametros->itens[0];
+    }
+    ObjetoPdf armazenamentoParametros;
+    if (parametros != nullptr) parametros = &resolver(*parametros, armazenamentoParametros);
+
+    std::string nomeFiltro = filtro != nullptr ? filtro->texto : "";
+    if (nomeFiltro == "DCTDecode") {
+        imagem.filtro = FiltroImagem::Dct;
+        if (imagem.componentes == 0) imagem.componentes = 3;  // O JPEG diz quantos canais tem
+    }
+    else if (nomeFiltro == "CCITTFaxDecode") {
+        imagem.filtro = FiltroImagem::Ccitt;
+        imagem.componentes = 1;
+        imagem.bitsPorComponente = 1;
+        if (parametros != nullptr) {
+            imagem.k = numeroDe(parametros->chave("K"), 0);
+            if (const ObjetoPdf* preto = parametros->chave("BlackIs1")) imagem.blackIs1 = preto->numero != 0;
+            if (const ObjetoPdf* alinhado = parametros->chave("EncodedByteAlign")) {
+                if (alinhado->numero != 0) return imagem;
+            }
+            int colunas = numeroDe(parametros->chave("Columns"), 1728);
+            if (colunas != imagem.largura) return imagem;
+        }
+        else if (imagem.largura != 1728) {
+            return imagem;
+        }
+    }
+    else if (nomeFiltro == "FlateDecode" || nomeFiltro.empty()) {
+        imagem.filtro = nomeFiltro.empty() ? FiltroImagem::Nenhum : FiltroImagem::Flate;
+        if (imagem.componentes == 0) return imagem;
+        if (imagem.bitsPorComponente != 8 && !(imagem.bitsPorComponente == 1 && imagem.componentes == 1)) return imagem;
+        if (parametros != nullptr) {
+            imagem.preditor = numeroDe(parametros->chave("Predictor"), 1);
+            if (numeroDe(parametros->chave("Colors"), imagem.componentes) != imagem.componentes) return imagem;
+            if (numeroDe(parametros->chave("Columns"), imagem.largura) != imagem.largura) return imagem;
+        }
+    }
+    else {
+        return imagem;
+    }
+    if (imagem.componentes != 1 && imagem.componentes != 3) return imagem;
+
+    if (const ObjetoPdf* decode = xobject.chave("Decode")) {
+        if (decode->itens.size() >= 2 && decode->itens[0].numero > decode->itens[1].numero) {
+            if (imagem.componentes != 1) return imagem;
+            imagem.inverter = true;
+        }
+    }
+
+    rotacao = ((rotacao % 360) + 360) % 360;
+    if (rotacao % 90 != 0) return imagem;
+
+    imagem.inicio = xobject.inicioStream;
+    imagem.tamanho = static_cast<size_t>(xobject.tamanhoStream);
+    imagem.larguraPaginaPts = larguraPts;
+    imagem.rotacao = rotacao;
+    imagem.valida = true;
+    return imagem;
+}
+
+ImagensEmbutidasPdf::ImagensEmbutidasPdf() : dados(new Dados) {
+}
+
+ImagensEmbutidasPdf::~ImagensEmbutidasPdf() {
+}
+
+bool ImagensEmbutidasPdf::abrir(Logger& logger, const std::string& arquivoPdf, int numeroPaginas) {
+    dados.reset(new Dados);
+
+    std::ifstream entrada(arquivoPdf, std::ios::binary);
+    if (!entrada) return false;
+    dados->arquivo.assign(std::istreambuf_iterator<char>(entrada), std::istreambuf_iterator<char>());
+
+    // Streams criptografados no podem ser lidos direto
+    if (dados->arquivo.rfind("/Encrypt") != std::string::npos) {
+        dados->arquivo.clear();
+        return false;
+    }
+
+    dados->indexarObjetos();
+
+    // /Root do ltimo trailer ou do ltimo dicionrio de xref stream (atualizaes incrementais ficam no fim)
+    size_t posRaiz = dados->arquivo.rfind("/Root");
+    ObjetoPdf referenciaRaiz, raiz, paginas;
+    bool erro = posRaiz == std::string::npos;
+    if (!erro) {
+        AnalisadorPdf analisador(dados->arquivo.data(), dados->arquivo.size(), posRaiz + 5);
+        erro = !analisador.lerObjeto(referenciaRaiz) || referenciaRaiz.tipo != ObjetoPdf::Referencia
+            || !dados->lerIndireto(referenciaRaiz.objeto, raiz);
+    }
+    if (!erro) {
+        const ObjetoPdf* referenciaPaginas = raiz.chave("Pages");
+        erro = referenciaPaginas == nullptr || referenciaPaginas->tipo != ObjetoPdf::Referencia
+            || !dados->lerIndireto(referenciaPaginas->objeto, paginas);
+    }
+    if (!erro) {
+        dados->coletarPaginas(paginas, nullptr, nullptr, 0, dados->paginas, 0, erro);
+    }
+
+    if (erro || static_cast<int>(dados->paginas.size()) != numeroPaginas) {
+        dados->paginas.clear();
+        dados->arquivo.clear();
+        return false;
+    }
+
+    int embutidas = numeroPaginasEmbutidas();
+    logger.AddLogMessage(LogLevel::Info, std::to_string(embutidas) + " de " + std::to_string(numeroPaginas)
+        + " pginas com imagem embutida (sem renderizao).");
+    if (embutidas == 0) {
+        dados->arquivo.clear();
+    }
+    return embutidas > 0;
+}
+
+bool ImagensEmbutidasPdf::paginaEmbutida(int indicePagina) const {
+    return indicePagina >= 0 && indicePagina < static_cast<int>(dados->paginas.size()) && dados->paginas[indicePagina].valida;
+}
+
+int ImagensEmbutidasPdf::numeroPaginasEmbutidas() const {
+    int total = 0;
+    for (const auto& pagina : dados->paginas) {
+        if (pagina.valida) total++;
+    }
+    return total;
+}
+
+cv::Mat ImagensEmbutidasPdf::extrairPagina(int indicePagina, int DPI) const {
+    if (!paginaEmbutida(indicePagina)) return cv::Mat();
+    const ImagemPagina& pagina = dados->paginas[indicePagina];
+    const unsigned char* stream = reinterpret_cast<const unsigned char*>(dados->arquivo.data() + pagina.inicio);
+
+    double dpiNativo = pagina.largura * 72.0 / pagina.larguraPaginaPts;
+    double escala = DPI / dpiNativo;
+
+    cv::Mat imagem;
+    int reducao = 1;
+    if (pagina.filtro == FiltroImagem::Dct) {
+        // O JPEG pode ser reduzido j na decodificao, como nas digitalizaes diretas
+        int flags = cv::IMREAD_COLOR;
+        if (escala <= 1.0 / 8) { reducao = 8; flags = cv::IMREAD_REDUCED_COLOR_8; }
+        else if (escala <= 1.0 / 4) { reducao = 4; flags = cv::IMREAD_REDUCED_COLOR_4; }
+        else if (escala <= 1.0 / 2) { reducao = 2; flags = cv::IMREAD_REDUCED_COLOR_2; }
+        imagem = cv::imdecode(cv::Mat(1, static_cast<int>(pagina.tamanho), CV_8UC1, const_cast<unsigned char*>(stream)), flags);
+    }
+    else if (pagina.filtro == FiltroImagem::Ccitt) {
+        std::vector<unsigned char> tiff = embrulharCcittEmTiff(stream, pagina.tamanho, pagina.largura, pagina.altura, pagina.k);
+        imagem = cv::imdecode(tiff, cv::IMREAD_GRAYSCALE);
+    }
+    else {
+        std::vector<unsigned char> amostras;
+        if (pagina.filtro == FiltroImagem::Flate) {
+            if (!inflarZlib(stream, pagina.tamanho, amostras)) return cv::Mat();
+            if (!removerPreditor(amostras, pagina.preditor, pagina.largura, pagina.componentes, pagina.bitsPorComponente)) return cv::Mat();
+        }
+        else {
+            amostras.assign(stream, stream + pagina.tamanho);
+        }
+
+        size_t bytesPorLinha = (static_cast<size_t>(pagina.largura) * pagina.componentes * pagina.bitsPorComponente + 7) / 8;
+        if (amostras.size() < bytesPorLinha * pagina.altura) return cv::Mat();
+
+        if (pagina.bitsPorComponente == 1) {
+            // 1 = branco no DeviceGray
+            imagem.create(pagina.altura, pagina.largura, CV_8UC1);
+            for (int y = 0; y < pagina.altura; y++) {
+                const unsigned char* linha = amostras.data() + y * bytesPorLinha;
+                uchar* destino = imagem.ptr<uchar>(y);
+                for (int x = 0; x < pagina.largura; x++) {
+                    destino[x] = (linha[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+                }
+            }
+        }
+        else {
+            cv::Mat linhas(pagina.altura, pagina.largura, pagina.componentes == 1 ? CV_8UC1 : CV_8UC3, amostras.data(), bytesPorLinha);
+            if (pagina.componentes == 3) cv::cvtColor(linhas, imagem, cv::COLOR_RGB2BGR);
+            else imagem = linhas.clone();
+        }
+    }
+    if (imagem.empty()) return imagem;
+
+    // O TIFF do CCITT sai com as sequncias pretas em preto; no PDF elas so amostras 0 (ou 1 com /BlackIs1),
+    // que o /Decode [1 0] ainda inverte: a imagem fica negativa quando s uma das duas coisas vale
+    bool negativa = pagina.filtro == FiltroImagem::Ccitt ? pagina.blackIs1 != pagina.inverter : pagina.inverter;
+    if (negativa) {
+        cv::bitwise_not(imagem, imagem);
+    }
+    if (imagem.channels() == 1) {
+        cv::cvtColor(imagem, imagem, cv::COLOR_GRAY2BGR);
+    }
+
+    // S reamostra se a resoluo nativa for diferente da pedida (o caso comum de 300 DPI fica intacto)
+    double restante = escala * reducao;
+    if (std::abs(restante - 1.0) > 0.01) {
+        cv::resize(imagem, imagem, cv::Size(), restante, restante, restante < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+    }
+
+    if (pagina.rotacao == 90) cv::rotate(imagem, imagem, cv::ROTATE_90_CLOCKWISE);
+    else if (pagina.rotacao == 180) cv::rotate(imagem, imagem, cv::ROTATE_180);
+    else if (pagina.rotacao == 270) cv::rotate(imagem, imagem, cv::ROTATE_90_COUNTERCLOCKWISE);
+    return imagem;
+}
+
+cv::Mat lerPaginaPdf(const poppler::document& documento, const ImagensEmbutidasPdf& imagens, int indicePagina, int DPI, std::mutex* renderMutex) {
+    if (imagens.paginaEmbutida(indicePagina)) {
+        cv::Mat pagina = imagens.extrairPagina(indicePagina, DPI);
+        if (!pagina.empty()) return pagina;
+    }
+
+    if (renderMutex != nullptr) {
+        std::lock_guard<std::mutex> lock(*renderMutex);
+        return renderizarPaginaPdf(documento, indicePagina, DPI);
+    }
+    return renderizarPaginaPdf(documento, indicePagina, DPI);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "Logger.h"
+
+namespace poppler { class document; }
+
+// Atalho para PDFs gerados por scanner: cada pgina  uma nica imagem embutida (JPEG, CCITT ou
+// Flate) ocupando a pgina inteira. Nesses casos a imagem  decodificada direto do stream, na
+// resoluo nativa, sem passar pelo page_renderer do poppler (que reamostra e suaviza um bitmap
+// que j existe). Pginas com texto, vetores, vrias imagens, mscaras ou filtros no suportados
+// ficam com a renderizao normal.
+//
+// L objetos comuns do PDF (no os guardados em object streams) e no trata PDFs criptografados;
+// nesses casos nenhuma pgina usa o atalho.
+class ImagensEmbutidasPdf {
+public:
+    ImagensEmbutidasPdf();
+    ~ImagensEmbutidasPdf();
+
+    // numeroPaginas  o nmero de pginas visto pelo poppler; se a rvore de pginas lida aqui no
+    // bater com ele, o atalho fica desligado para o documento inteiro
+    bool abrir(Logger& logger, const std::string& arquivoPdf, int numeroPaginas);
+
+    bool paginaEmbutida(int indicePagina) const;
+    int numeroPaginasEmbutidas() const;
+
+    // Pgina em BGR na resoluo pedida, ou vazia se a pgina no tem o atalho ou o stream no
+    // pde ser decodificado. Pode ser chamada de vrias threads ao mesmo tempo.
+    cv::Mat extrairPagina(int indicePagina, int DPI) const;
+
+private:
+    struct Dados;
+    std::unique_ptr<Dados> dados;
+};
+
+// Pgina pronta para o pipeline: tenta a imagem embutida e, se no der, renderiza com o poppler.
+// renderMutex (se no for nulo) serializa s a renderizao, que o poppler no garante ser
+// segura em paralelo no mesmo documento.
+cv::Mat lerPaginaPdf(const poppler::document& documento, const ImagensEmbutidasPdf& imagens, int indicePagina, int DPI,
+    std::mutex* renderMutex = nullptr);
@@ -0,0 +1,91 @@
+#include "RegionGrid.h"
+#include <algorithm>
+
+GradeRegioes::GradeRegioes(int celulasPorLado) : lado(std::max(1, celulasPorLado)) {
+    celulas.resize(lado * lado);
+}
+
+void GradeRegioes::celulasDaJanela(float x0, float y0, float x1, float y1, int& cx0, int& cy0, int& cx1, int& cy1) const {
+    // Regies fora da pgina (desenhadas alm da borda) ficam nas clulas da borda
+    auto celula = [this](float v) { return std::min(lado - 1, std::max(0, static_cast<int>(v * lado))); };
+    cx0 = celula(x0);
+    cy0 = celula(y0);
+    cx1 = celula(x1);
+    cy1 = celula(y1);
+}
+
+void GradeRegioes::reconstruir(const std::vector<RectangleData>& regioes) {
+    for (auto& celula : celulas) {
+        celula.clear();
+    }
+    caixas.clear();
+    caixas.reserve(regioes.size());
+
+    for (size_t i = 0; i < regioes.size(); i++) {
+        // O retngulo pode ter sido desenhado de baixo para cima ou da direita para a esquerda
+        const CoordenadasRegiao& c = regioes[i].coordinates;
+        Caixa caixa = { std::min(c.x, c.z), std::min(c.y, c.w), std::max(c.x, c.z), std::max(c.y, c.w) };
+        caixas.push_back(caixa);
+
+        int cx0, cy0, cx1, cy1;
+        celulasDaJanela(caixa.x0, caixa.y0, caixa.x1, caixa.y1, cx0, cy0, cx1, cy1);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                celulas[cy * lado + cx].push_back(static_cast<int>(i));
+            }
+        }
+    }
+
+    // Sobreposio: s compara regies que dividem alguma clula. Bordas encostadas no contam.
+    sobreposicao.assign(regioes.size(), false);
+    for (const auto& celula : celulas) {
+        for (size_t a = 0; a < celula.size(); a++) {
+            const Caixa& ca = caixas[celula[a]];
+            for (size_t b = a + 1; b < celula.size(); b++) {
+                const Caixa& cb = caixas[celula[b]];
+                if (ca.x0 < cb.x1 && cb.x0 < ca.x1 && ca.y0 < cb.y1 && cb.y0 < ca.y1) {
+                    sobreposicao[celula[a]] = true;
+                    sobreposicao[celula[b]] = true;
+                }
+            }
+        }
+    }
+    numSobrepostas = static_cast<int>(std::count(sobreposicao.begin(), sobreposicao.end(), true));
+}
+
+void GradeRegioes::consultar(float x0, float y0, float x1, float y1, std::vector<int>& indices) const {
+    indices.clear();
+    if (caixas.empty() || x1 < x0 || y1 < y0) return;
+
+    int cx0, cy0, cx1, cy1;
+    celulasDaJanela(x0, y0, x1, y1, cx0, cy0, cx1, cy1);
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            for (int indice : celulas[cy * lado + cx]) {
+                const Caixa& caixa = caixas[indice];
+                if (caixa.x0 <= x1 && x0 <= caixa.x1 && caixa.y0 <= y1 && y0 <= caixa.y1) {
+                    indices.push_back(indice);
+                }
+            }
+        }
+    }
+
+    // Uma regio grande aparece em vrias clulas
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+}
+
+int GradeRegioes::regiaoNoPonto(float x, float y) const {
+    if (caixas.empty()) return -1;
+
+    int cx0, cy0, cx1, cy1;
+    celulasDaJanela(x, y, x, y, cx0, cy0, cx1, cy1);
+    int encontrada = -1;
+    for (int indice : celulas[cy0 * lado + cx0]) {
+        const Caixa& caixa = caixas[indice];
+        if (x >= caixa.x0 && x <= caixa.x1 && y >= caixa.y0 && y <= caixa.y1) {
+            encontrada = std::max(encontrada, indice);
+        }
+    }
+    return encontrada;
+}
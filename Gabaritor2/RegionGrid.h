@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ImageProcessing.h"
+#include <vector>
+
+// ndice espacial das regies de um modelo (grade uniforme em coordenadas normalizadas).
+// Usado pelo editor para desenhar s as regies visveis, achar a regio sob o mouse e marcar
+// regies sobrepostas, sem percorrer todas as regies a cada frame.
+class GradeRegioes {
+public:
+    explicit GradeRegioes(int celulasPorLado = 32);
+
+    // Refaz o ndice; precisa ser chamada sempre que as coordenadas das regies mudarem
+    void reconstruir(const std::vector<RectangleData>& regioes);
+
+    // ndices (em ordem crescente, sem repetio) das regies que tocam a janela [x0, x1] x [y0, y1]
+    void consultar(float x0, float y0, float x1, float y1, std::vector<int>& indices) const;
+
+    // Regio sob o ponto; se houver mais de uma, a ltima da lista (a desenhada por cima). -1 se nenhuma.
+    int regiaoNoPonto(float x, float y) const;
+
+    bool sobreposta(int indice) const { return indice >= 0 && indice < static_cast<int>(sobreposicao.size()) && sobreposicao[indice]; }
+    int numeroSobrepostas() const { return numSobrepostas; }
+
+private:
+    struct Caixa {
+        float x0, y0, x1, y1;
+    };
+
+    void celulasDaJanela(float x0, float y0, float x1, float y1, int& cx0, int& cy0, int& cx1, int& cy1) const;
+
+    int lado;
+    std::vector<Caixa> caixas;
+    std::vector<std::vector<int>> celulas;  // lado x lado listas de ndices de regies
+    std::vector<bool> sobreposicao;
+    int numSobrepostas = 0;
+};
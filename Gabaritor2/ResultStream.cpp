@@ -0,0 +1,95 @@
+#include "ResultStream.h"
+#include <algorithm>
+#include <thread>
+
+ResultadoParcialPagina montarResultadoParcial(const std::string& fileName, const std::string& modelo, const std::vector<RectangleData>& rectangles,
+    const std::vector<LeituraQuestao>& leituras, const cv::Mat& pagina, float limiarDuvida) {
+    ResultadoParcialPagina resultado;
+    resultado.fileName = fileName;
+    resultado.modelo = modelo;
+    resultado.alinhada = !leituras.empty();
+    resultado.questoes = static_cast<int>(leituras.size());
+    resultado.leituras = leituras;
+
+    // Mesma ordem e mesma diviso em clulas de readAnswersWithConfidence (sem as margens)
+    size_t indice = 0;
+    for (const auto& rectData : rectangles) {
+        const CoordenadasRegiao& c = rectData.coordinates;
+        float cellWidth = (c.z - c.x) / rectData.subdivisions.second;
+        float cellHeight = (c.w - c.y) / rectData.subdivisions.first;
+        int numAlternatives = rectData.analyzeVertical ? rectData.subdivisions.first : rectData.subdivisions.second;
+        if (indice < leituras.size()) {
+            resultado.regioes.emplace_back(rectData.name, static_cast<int>(std::min(static_cast<size_t>(numAlternatives), leituras.size() - indice)));
+        }
+
+        for (int alt = 0; alt < numAlternatives && indice < leituras.size(); ++alt) {
+            const LeituraQuestao& leitura = leituras[indice++];
+            resultado.confiancaMinima = std::min(resultado.confiancaMinima, leitura.confianca);
+            if (leitura.confianca < limiarDuvida) resultado.duvidosas++;
+
+            int choice = -1;
+            if (leitura.resposta >= 'A' && leitura.resposta < 'V') choice = leitura.resposta - 'A';
+            else if (leitura.resposta >= '0' && leitura.resposta <= '9') choice = leitura.resposta - '0';
+            if (choice < 0) {
+                resultado.anuladas++;
+                continue;
+            }
+
+            float x = c.x + (rectData.analyzeVertical ? choice * cellWidth : alt * cellWidth);
+            float y = c.y + (rectData.analyzeVertical ? alt * cellHeight : choice * cellHeight);
+            resultado.marcas.push_back({ { x, y, x + cellWidth, y + cellHeight }, leitura.resposta, leitura.confianca });
+        }
+    }
+
+    if (!pagina.empty()) {
+        double escala = static_cast<double>(LARGURA_MINIATURA_PROGRESSO) / pagina.cols;
+        cv::Mat reduzida;
+        cv::resize(pagina, reduzida, cv::Size(), escala, escala, cv::INTER_AREA);
+        // A converso acontece aqui, na thread de processamento; a interface s envia a textura
+        cv::cvtColor(reduzida, resultado.miniatura, reduzida.channels() == 1 ? cv::COLOR_GRAY2RGBA : cv::COLOR_BGR2RGBA);
+    }
+    return resultado;
+}
+
+ResultadoParcialPagina resultadoPaginaIgnorada(const std::string& fileName, const ClassificacaoPagina& classificacao) {
+    ResultadoParcialPagina resultado;
+    resultado.fileName = fileName;
+    resultado.ignorada = true;
+    resultado.motivo = nomeTipoPagina(classificacao.tipo);
+    return resultado;
+}
+
+static long long agoraNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ProgressoLeitura::iniciar(int totalPaginas) {
+    this->totalPaginas = totalPaginas;
+    paginasConcluidas = 0;
+    inicio = agoraNs();
+}
+
+void ProgressoLeitura::publicar(ResultadoParcialPagina&& resultado) {
+    if (aoConcluirPagina) aoConcluirPagina(resultado);
+    while (!fila.tentarInserir(resultado)) {
+        std::this_thread::yield();
+    }
+    paginasConcluidas++;
+    if (aoPublicar) aoPublicar();
+}
+
+double ProgressoLeitura::segundosDecorridos() const {
+    long long comeco = inicio.load();
+    return comeco == 0 ? 0.0 : (agoraNs() - comeco) / 1e9;
+}
+
+double ProgressoLeitura::paginasPorSegundo() const {
+    double segundos = segundosDecorridos();
+    return segundos > 0 ? concluidas() / segundos : 0.0;
+}
+
+double ProgressoLeitura::segundosRestantes() const {
+    double taxa = paginasPorSegundo();
+    if (taxa <= 0) return -1;
+    return std::max(total() - concluidas(), 0) / taxa;
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "ImageProcessing.h"
+#include "PageTriage.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Resultados de cada pgina enviados para a interface enquanto o lote ainda est rodando,
+// para que um modelo mal alinhado aparea na pgina 3 e no s no final do processamento.
+
+// Fila circular limitada sem locks (algoritmo de Dmitry Vyukov): cada clula tem um nmero de
+// sequncia que diz se ela est livre para o produtor ou pronta para o consumidor. Aceita vrios
+// produtores (as pginas rodam em paralelo no ThreadPool) e um ou mais consumidores.
+template <typename T>
+class FilaLockFree {
+public:
+    explicit FilaLockFree(size_t capacidade) {
+        size_t tamanho = 2;
+        while (tamanho < capacidade) tamanho *= 2;
+        mascara = tamanho - 1;
+        celulas.reset(new Celula[tamanho]);
+        for (size_t i = 0; i < tamanho; i++) {
+            celulas[i].sequencia.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    FilaLockFree(const FilaLockFree&) = delete;
+    FilaLockFree& operator=(const FilaLockFree&) = delete;
+
+    // Retorna false se a fila estiver cheia (o item no  movido)
+    bool tentarInserir(T& item) {
+        size_t posicao = posInsercao.load(std::memory_order_relaxed);
+        for (;;) {
+            Celula& celula = celulas[posicao & mascara];
+            size_t sequencia = celula.sequencia.load(std::memory_order_acquire);
+            intptr_t diferenca = static_cast<intptr_t>(sequencia) - static_cast<intptr_t>(posicao);
+            if (diferenca == 0) {
+                if (posInsercao.compare_exchange_weak(posicao, posicao + 1, std::memory_order_relaxed)) {
+                    celula.dado = std::move(item);
+                    celula.sequencia.store(posicao + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diferenca < 0) {
+                return false;
+            }
+            else {
+                posicao = posInsercao.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Retorna false se a fila estiver vazia
+    bool tentarRetirar(T& item) {
+        size_t posicao = posRetirada.load(std::memory_order_relaxed);
+        for (;;) {
+            Celula& celula = celulas[posicao & mascara];
+            size_t sequencia = celula.sequencia.load(std::memory_order_acquire);
+            intptr_t diferenca = static_cast<intptr_t>(sequencia) - static_cast<intptr_t>(posicao + 1);
+            if (diferenca == 0) {
+                if (posRetirada.compare_exchange_weak(posicao, posicao + 1, std::memory_order_relaxed)) {
+                    item = std::move(celula.dado);
+                    celula.sequencia.store(posicao + mascara + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diferenca < 0) {
+                return false;
+            }
+            else {
+                posicao = posRetirada.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct Celula {
+        std::atomic<size_t> sequencia;
+        T dado;
+    };
+
+    std::unique_ptr<Celula[]> celulas;
+    size_t mascara = 0;
+    // Em linhas de cache separadas para produtores e consumidor no disputarem a mesma linha
+    alignas(64) std::atomic<size_t> posInsercao{ 0 };
+    alignas(64) std::atomic<size_t> posRetirada{ 0 };
+};
+
+// Alternativa marcada em uma questo, para desenhar sobre a miniatura
+struct MarcaLida {
+    CoordenadasRegiao celula;   // Coordenadas normalizadas da clula da alternativa
+    char resposta;
+    float confianca;
+};
+
+struct ResultadoParcialPagina {
+    std::string fileName;           // page_N.png
+    std::string modelo;
+    bool ignorada = false;          // Descartada na triagem
+    std::string motivo;
+    bool alinhada = true;
+    int questoes = 0;
+    int duvidosas = 0;              // Questes com confiana abaixo do limiar
+    int anuladas = 0;               // 'X' (mais de uma marcada) ou 'V' (nenhuma)
+    float confiancaMinima = 1.0f;
+    std::vector<LeituraQuestao> leituras;
+    std::vector<std::pair<std::string, int>> regioes;  // Nome e nmero de questes de cada regio, na ordem das leituras
+    std::vector<MarcaLida> marcas;
+    cv::Mat miniatura;              // Pgina lida reduzida, j em RGBA para virar textura sem converso na interface
+};
+
+// Largura da miniatura enviada junto com cada pgina
+const int LARGURA_MINIATURA_PROGRESSO = 320;
+
+ResultadoParcialPagina montarResultadoParcial(const std::string& fileName, const std::string& modelo, const std::vector<RectangleData>& rectangles,
+    const std::vector<LeituraQuestao>& leituras, const cv::Mat& pagina, float limiarDuvida);
+ResultadoParcialPagina resultadoPaginaIgnorada(const std::string& fileName, const ClassificacaoPagina& classificacao);
+
+// Progresso de uma etapa de leitura: as threads de processamento publicam uma pgina por vez e a
+// interface retira os resultados a cada frame, sem locks nos dois lados
+class ProgressoLeitura {
+public:
+    explicit ProgressoLeitura(size_t capacidade = 1024) : fila(capacidade) {}
+
+    // Chamado pela etapa de leitura quando sabe quantas pginas vai processar
+    void iniciar(int totalPaginas);
+    // No bloqueia enquanto houver espao; com a fila cheia espera a interface consumir
+    void publicar(ResultadoParcialPagina&& resultado);
+    bool retirar(ResultadoParcialPagina& resultado) { return fila.tentarRetirar(resultado); }
+
+    int total() const { return totalPaginas.load(); }
+    int concluidas() const { return paginasConcluidas.load(); }
+    double paginasPorSegundo() const;
+    double segundosRestantes() const;  // -1 enquanto no houver taxa
+
+    float limiarDuvida = 0.15f;  // Confiana abaixo da qual a questo conta como duvidosa
+
+    // Chamado depois de cada publicao, na thread de processamento (a interface acorda o loop de
+    // eventos). Definir antes de iniciar a leitura.
+    std::function<void()> aoPublicar;
+    // Chamado com cada pgina antes de ela entrar na fila, tambm na thread de processamento e de
+    // vrias threads ao mesmo tempo (a interface grava a pgina no armazm de resultados aqui)
+    std::function<void(const ResultadoParcialPagina&)> aoConcluirPagina;
+
+private:
+    double segundosDecorridos() const;
+
+    FilaLockFree<ResultadoParcialPagina> fila;
+    std::atomic<int> totalPaginas{ 0 };
+    std::atomic<int> paginasConcluidas{ 0 };
+    std::atomic<long long> inicio{ 0 };  // steady_clock em nanossegundos
+};
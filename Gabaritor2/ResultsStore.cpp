@@ -0,0 +1,683 @@
+#include "ResultsStore.h"
+#include "ImageProcessing.h"
+#include "PageTriage.h"
+#include "ResultStream.h"
+#include "TemplateRegistry.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <tuple>
+
+namespace fs = std::filesystem;
+
+static const char ASSINATURA_REGISTRO[4] = { 'G', 'R', 'E', 'S' };
+// Verso 2: o ndice guarda o instante de cada registro (uma foto da verso 1  descartada e refeita)
+static const char ASSINATURA_INDICE[8] = { 'G', 'I', 'D', 'X', '0', '0', '0', '2' };
+static const std::string ARQUIVO_INDICE = "indice.bin";
+// Registros maiores que isso s aparecem com o arquivo corrompido
+static const uint32_t TAMANHO_MAXIMO_REGISTRO = 16 * 1024 * 1024;
+
+namespace {
+
+void escreverU16(std::string& saida, uint16_t valor) {
+    saida.push_back(static_cast<char>(valor & 0xFF));
+    saida.push_back(static_cast<char>(valor >> 8));
+}
+
+void escreverU32(std::string& saida, uint32_t valor) {
+    for (int i = 0; i < 4; i++) saida.push_back(static_cast<char>((valor >> (8 * i)) & 0xFF));
+}
+
+void escreverU64(std::string& saida, uint64_t valor) {
+    escreverU32(saida, static_cast<uint32_t>(valor & 0xFFFFFFFFu));
+    escreverU32(saida, static_cast<uint32_t>(valor >> 32));
+}
+
+void escreverTexto(std::string& saida, const std::string& texto) {
+    uint32_t tamanho = static_cast<uint32_t>(texto.size());
+    escreverU32(saida, tamanho);
+    saida += texto;
+}
+
+uint32_t lerU32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Leitura sequencial de um buffer; qualquer leitura alm do fim invalida o resto
+class Leitor {
+public:
+    Leitor(const std::string& dados, size_t inicio = 0) : dados(dados), pos(inicio) {}
+
+    bool valido() const { return ok; }
+    size_t posicao() const { return pos; }
+
+    uint16_t u16() {
+        if (!disponivel(2)) return 0;
+        uint16_t valor = static_cast<uint8_t>(dados[pos]) | (static_cast<uint8_t>(dados[pos + 1]) << 8);
+        pos += 2;
+        return valor;
+    }
+
+    uint32_t u32() {
+        if (!disponivel(4)) return 0;
+        uint32_t valor = lerU32(reinterpret_cast<const unsigned char*>(dados.data() + pos));
+        pos += 4;
+        return valor;
+    }
+
+    uint64_t u64() {
+        uint64_t baixo = u32();
+        return baixo | (static_cast<uint64_t>(u32()) << 32);
+    }
+
+    std::string texto() {
+        uint32_t tamanho = u32();
+        if (!disponivel(tamanho)) return std::string();
+        std::string valor = dados.substr(pos, tamanho);
+        pos += tamanho;
+        return valor;
+    }
+
+private:
+    bool disponivel(size_t tamanho) {
+        if (!ok || tamanho > dados.size() || pos > dados.size() - tamanho) ok = false;
+        return ok;
+    }
+
+    const std::string& dados;
+    size_t pos;
+    bool ok = true;
+};
+
+uint32_t calcularCrc(const std::string& dados) {
+    return static_cast<uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(dados.data()), static_cast<uInt>(dados.size())));
+}
+
+// Os primeiros campos so as chaves do ndice e o instante, assim a indexao no precisa decodificar o resto
+std::string serializarRegistro(const RegistroResultado& registro) {
+    std::string saida;
+    escreverTexto(saida, registro.lote);
+    escreverTexto(saida, registro.arquivo);
+    escreverU32(saida, static_cast<uint32_t>(registro.pagina));
+    escreverTexto(saida, registro.idAluno);
+    escreverTexto(saida, registro.modelo);
+    escreverU64(saida, static_cast<uint64_t>(registro.instante));
+    escreverTexto(saida, registro.situacao);
+    escreverTexto(saida, registro.respostas);
+
+    // Confiana em milsimos, como nos arquivos de texto
+    escreverU32(saida, static_cast<uint32_t>(registro.confiancas.size()));
+    for (float confianca : registro.confiancas) {
+        escreverU16(saida, static_cast<uint16_t>(std::lround(std::min(std::max(confianca, 0.0f), 1.0f) * 1000)));
+    }
+
+    escreverU32(saida, static_cast<uint32_t>(registro.regioes.size()));
+    for (const auto& regiao : registro.regioes) {
+        escreverTexto(saida, regiao.first);
+        escreverU32(saida, static_cast<uint32_t>(regiao.second));
+    }
+
+    escreverU32(saida, static_cast<uint32_t>(registro.palavras.size()));
+    for (const auto& palavra : registro.palavras) {
+        escreverTexto(saida, palavra.first);
+        escreverTexto(saida, palavra.second);
+    }
+    return saida;
+}
+
+bool desserializarRegistro(const std::string& dados, RegistroResultado& registro) {
+    Leitor leitor(dados);
+    registro.lote = leitor.texto();
+    registro.arquivo = leitor.texto();
+    registro.pagina = static_cast<int>(leitor.u32());
+    registro.idAluno = leitor.texto();
+    registro.modelo = leitor.texto();
+    registro.instante = static_cast<int64_t>(leitor.u64());
+    registro.situacao = leitor.texto();
+    registro.respostas = leitor.texto();
+
+    uint32_t numeroConfiancas = leitor.u32();
+    for (uint32_t i = 0; i < numeroConfiancas && leitor.valido(); i++) {
+        registro.confiancas.push_back(leitor.u16() / 1000.0f);
+    }
+    uint32_t numeroRegioes = leitor.u32();
+    for (uint32_t i = 0; i < numeroRegioes && leitor.valido(); i++) {
+        std::string nome = leitor.texto();
+        registro.regioes.emplace_back(nome, static_cast<int>(leitor.u32()));
+    }
+    uint32_t numeroPalavras = leitor.u32();
+    for (uint32_t i = 0; i < numeroPalavras && leitor.valido(); i++) {
+        std::string regiao = leitor.texto();
+        registro.palavras.emplace_back(regiao, leitor.texto());
+    }
+    return leitor.valido();
+}
+
+struct ChavePagina {
+    std::string lote;
+    std::string arquivo;
+    int pagina;
+
+    bool operator<(const ChavePagina& outra) const {
+        if (lote != outra.lote) return lote < outra.lote;
+        if (arquivo != outra.arquivo) return arquivo < outra.arquivo;
+        return pagina < outra.pagina;
+    }
+};
+
+struct PosicaoRegistro {
+    int segmento;
+    uint64_t offset;
+    std::string idAluno;
+    int64_t instante;
+};
+
+std::string nomeSegmento(const std::string& idEscritor) {
+    std::string nome = "seg_";
+    for (char c : idEscritor) {
+        nome += std::isalnum(static_cast<unsigned char>(c)) || c == '-' ? c : '_';
+    }
+    return nome + ".dat";
+}
+
+}
+
+struct ArmazemResultados::Dados {
+    mutable std::mutex mutex;
+    fs::path pasta;
+
+    std::vector<std::string> segmentos;       // Nomes dos arquivos de segmento
+    std::vector<uint64_t> indexadoAte;        // Bytes de cada segmento j indexados
+    std::map<ChavePagina, PosicaoRegistro> paginas;
+    std::map<std::string, std::set<ChavePagina>> porAluno;
+
+    int segmentoEscrita = -1;
+    std::ofstream escrita;
+
+    int indiceSegmento(const std::string& nome);
+    void indexar(const ChavePagina& chave, const PosicaoRegistro& posicao);
+    void varrerSegmento(int segmento);
+    void atualizarSemLock();
+    bool carregarIndice();
+    bool lerRegistro(std::ifstream& arquivo, uint64_t offset, RegistroResultado& registro) const;
+    bool lerRegistro(int segmento, uint64_t offset, RegistroResultado& registro) const;
+};
+
+int ArmazemResultados::Dados::indiceSegmento(const std::string& nome) {
+    auto it = std::find(segmentos.begin(), segmentos.end(), nome);
+    if (it != segmentos.end()) return static_cast<int>(it - segmentos.begin());
+    segmentos.push_back(nome);
+    indexadoAte.push_back(0);
+    return static_cast<int>(segmentos.size()) - 1;
+}
+
+// A verso de uma pgina que vale  a de instante mais recente, no a ltima varrida: os segmentos so
+// varridos na ordem da pasta. No empate, decide o nome do segmento e, dentro dele, a posio.
+void ArmazemResultados::Dados::indexar(const ChavePagina& chave, const PosicaoRegistro& posicao) {
+    auto existente = paginas.find(chave);
+    if (existente != paginas.end()) {
+        const PosicaoRegistro& atual = existente->second;
+        if (std::tie(atual.instante, segmentos[atual.segmento], atual.offset) > std::tie(posicao.instante, segmentos[posicao.segmento], posicao.offset)) {
+            return;
+        }
+    }
+    if (existente != paginas.end() && !existente->second.idAluno.empty()) {
+        auto aluno = porAluno.find(existente->second.idAluno);
+        if (aluno != porAluno.end()) {
+            aluno->second.erase(chave);
+            if (aluno->second.empty()) porAluno.erase(aluno);
+        }
+    }
+    paginas[chave] = posicao;
+    if (!posicao.idAluno.empty()) {
+        porAluno[posicao.idAluno].insert(chave);
+    }
+}
+
+void ArmazemResultados::Dados::varrerSegmento(int segmento) {
+    std::ifstream arquivo(pasta / segmentos[segmento], std::ios::binary);
+    if (!arquivo.is_open()) return;
+
+    uint64_t offset = indexadoAte[segmento];
+    arquivo.seekg(static_cast<std::streamoff>(offset));
+    std::string conteudo;
+    for (;;) {
+        unsigned char cabecalho[12];
+        if (!arquivo.read(reinterpret_cast<char*>(cabecalho), sizeof(cabecalho))) break;
+        uint32_t tamanho = lerU32(cabecalho + 4);
+        if (std::memcmp(cabecalho, ASSINATURA_REGISTRO, 4) != 0 || tamanho > TAMANHO_MAXIMO_REGISTRO) break;
+
+        conteudo.resize(tamanho);
+        if (tamanho > 0 && !arquivo.read(&conteudo[0], tamanho)) break;
+        if (calcularCrc(conteudo) != lerU32(cabecalho + 8)) break;
+
+        // S as chaves e o instante, que abrem o registro
+        Leitor leitor(conteudo);
+        ChavePagina chave;
+        chave.lote = leitor.texto();
+        chave.arquivo = leitor.texto();
+        chave.pagina = static_cast<int>(leitor.u32());
+        std::string idAluno = leitor.texto();
+        leitor.texto();  // Modelo
+        int64_t instante = static_cast<int64_t>(leitor.u64());
+        if (!leitor.valido()) break;
+
+        indexar(chave, { segmento, offset, idAluno, instante });
+        offset += sizeof(cabecalho) + tamanho;
+    }
+    // Um registro cortado no fim fica fora do ndice; se o escritor voltar, ele  truncado na abertura
+    indexadoAte[segmento] = offset;
+}
+
+void ArmazemResultados::Dados::atualizarSemLock() {
+    std::error_code erro;
+    for (const auto& entrada : fs::directory_iterator(pasta, erro)) {
+        std::string nome = entrada.path().filename().string();
+        if (nome.rfind("seg_", 0) == 0 && entrada.path().extension() == ".dat") {
+            indiceSegmento(nome);
+        }
+    }
+    for (size_t s = 0; s < segmentos.size(); s++) {
+        // O segmento deste processo j  indexado a cada anexar
+        if (static_cast<int>(s) != segmentoEscrita) {
+            varrerSegmento(static_cast<int>(s));
+        }
+    }
+}
+
+bool ArmazemResultados::Dados::carregarIndice() {
+    std::ifstream arquivo(pasta / ARQUIVO_INDICE, std::ios::binary);
+    if (!arquivo.is_open()) return false;
+    std::string conteudo((std::istreambuf_iterator<char>(arquivo)), std::istreambuf_iterator<char>());
+    if (conteudo.size() < sizeof(ASSINATURA_INDICE) + 4 || std::memcmp(conteudo.data(), ASSINATURA_INDICE, sizeof(ASSINATURA_INDICE)) != 0) {
+        return false;
+    }
+    std::string corpo = conteudo.substr(0, conteudo.size() - 4);
+    if (calcularCrc(corpo) != lerU32(reinterpret_cast<const unsigned char*>(conteudo.data() + corpo.size()))) {
+        return false;
+    }
+
+    Leitor leitor(corpo, sizeof(ASSINATURA_INDICE));
+    uint32_t numeroSegmentos = leitor.u32();
+    for (uint32_t s = 0; s < numeroSegmentos && leitor.valido(); s++) {
+        std::string nome = leitor.texto();
+        uint64_t indexado = leitor.u64();
+        // Um segmento menor do que a foto diz foi recriado: a foto no vale mais
+        std::error_code erro;
+        uint64_t tamanho = fs::file_size(pasta / nome, erro);
+        if (erro || tamanho < indexado) return false;
+        segmentos.push_back(nome);
+        indexadoAte.push_back(indexado);
+    }
+    uint32_t numeroPaginas = leitor.u32();
+    for (uint32_t i = 0; i < numeroPaginas && leitor.valido(); i++) {
+        ChavePagina chave;
+        chave.lote = leitor.texto();
+        chave.arquivo = leitor.texto();
+        chave.pagina = static_cast<int>(leitor.u32());
+        std::string idAluno = leitor.texto();
+        uint32_t segmento = leitor.u32();
+        uint64_t offset = leitor.u64();
+        int64_t instante = static_cast<int64_t>(leitor.u64());
+        if (segmento >= segmentos.size()) return false;
+        indexar(chave, { static_cast<int>(segmento), offset, idAluno, instante });
+    }
+    return leitor.valido();
+}
+
+bool ArmazemResultados::Dados::lerRegistro(std::ifstream& arquivo, uint64_t offset, RegistroResultado& registro) const {
+    arquivo.clear();
+    arquivo.seekg(static_cast<std::streamoff>(offset));
+    unsigned char cabecalho[12];
+    if (!arquivo.read(reinterpret_cast<char*>(cabecalho), sizeof(cabecalho))) return false;
+    uint32_t tamanho = lerU32(cabecalho + 4);
+    if (std::memcmp(cabecalho, ASSINATURA_REGISTRO, 4) != 0 || tamanho > TAMANHO_MAXIMO_REGISTRO) return false;
+    std::string conteudo(tamanho, '\0');
+    if (tamanho > 0 && !arquivo.read(&conteudo[0], tamanho)) return false;
+    registro = RegistroResultado();
+    return calcularCrc(conteudo) == lerU32(cabecalho + 8) && desserializarRegistro(conteudo, registro);
+}
+
+bool ArmazemResultados::Dados::lerRegistro(int segmento, uint64_t offset, RegistroResultado& registro) const {
+    std::ifstream arquivo(pasta / segmentos[segmento], std::ios::binary);
+    return arquivo.is_open() && lerRegistro(arquivo, offset, registro);
+}
+
+ArmazemResultados::ArmazemResultados() : dados(new Dados) {
+}
+
+ArmazemResultados::~ArmazemResultados() {
+}
+
+bool ArmazemResultados::abrir(Logger& logger, const std::string& pasta, const std::string& idEscritor) {
+    dados.reset(new Dados);
+    std::lock_guard<std::mutex> lock(dados->mutex);
+    dados->pasta = pasta;
+
+    if (!criarDiretorio(logger, pasta)) {
+        return false;
+    }
+
+    if (!dados->carregarIndice()) {
+        dados->segmentos.clear();
+        dados->indexadoAte.clear();
+        dados->paginas.clear();
+        dados->porAluno.clear();
+    }
+    dados->atualizarSemLock();
+
+    if (!idEscritor.empty()) {
+        std::string nome = nomeSegmento(idEscritor);
+        int segmento = dados->indiceSegmento(nome);
+        dados->varrerSegmento(segmento);
+
+        // Descarta a cauda de um registro cortado por uma queda, para os prximos ficarem alcanveis
+        fs::path caminho = dados->pasta / nome;
+        std::error_code erro;
+        if (fs::exists(caminho, erro) && fs::file_size(caminho, erro) > dados->indexadoAte[segmento]) {
+            logger.AddLogMessage(LogLevel::Warning, "Registro incompleto descartado no fim de " + caminho.string());
+            fs::resize_file(caminho, dados->indexadoAte[segmento], erro);
+        }
+
+        dados->escrita.open(caminho, std::ios::binary | std::ios::app);
+        if (!dados->escrita.is_open()) {
+            logger.AddLogMessage(LogLevel::Error, "No foi possvel abrir o armazm de resultados para escrita: " + caminho.string());
+            return false;
+        }
+        dados->segmentoEscrita = segmento;
+    }
+
+    logger.AddLogMessage(LogLevel::Info, "Armazm de resultados aberto: " + std::to_string(dados->paginas.size()) + " pginas em "
+        + std::to_string(dados->segmentos.size()) + " segmentos.");
+    return true;
+}
+
+bool ArmazemResultados::anexar(const RegistroResultado& registro) {
+    RegistroResultado comInstante = registro;
+    if (comInstante.instante == 0) {
+        comInstante.instante = static_cast<int64_t>(std::time(nullptr));
+    }
+
+    // Monta o registro emoldurado fora do lock
+    std::string conteudo = serializarRegistro(comInstante);
+    std::string moldura(ASSINATURA_REGISTRO, sizeof(ASSINATURA_REGISTRO));
+    escreverU32(moldura, static_cast<uint32_t>(conteudo.size()));
+    escreverU32(moldura, calcularCrc(conteudo));
+    moldura += conteudo;
+
+    std::lock_guard<std::mutex> lock(dados->mutex);
+    if (dados->segmentoEscrita < 0 || !dados->escrita.is_open()) return false;
+
+    uint64_t offset = dados->indexadoAte[dados->segmentoEscrita];
+    dados->escrita.write(moldura.data(), moldura.size());
+    dados->escrita.flush();
+    if (!dados->escrita) return false;
+
+    dados->indexadoAte[dados->segmentoEscrita] = offset + moldura.size();
+    dados->indexar({ comInstante.lote, comInstante.arquivo, comInstante.pagina }, { dados->segmentoEscrita, offset, comInstante.idAluno, comInstante.instante });
+    return true;
+}
+
+void ArmazemResultados::atualizar() {
+    std::lock_guard<std::mutex> lock(dados->mutex);
+    dados->atualizarSemLock();
+}
+
+bool ArmazemResultados::salvarIndice() {
+    std::lock_guard<std::mutex> lock(dados->mutex);
+    std::string conteudo(ASSINATURA_INDICE, sizeof(ASSINATURA_INDICE));
+    escreverU32(conteudo, static_cast<uint32_t>(dados->segmentos.size()));
+    for (size_t s = 0; s < dados->segmentos.size(); s++) {
+        escreverTexto(conteudo, dados->segmentos[s]);
+        escreverU64(conteudo, dados->indexadoAte[s]);
+    }
+    escreverU32(conteudo, static_cast<uint32_t>(dados->paginas.size()));
+    for (const auto& pagina : dados->paginas) {
+        escreverTexto(conteudo, pagina.first.lote);
+        escreverTexto(conteudo, pagina.first.arquivo);
+        escreverU32(conteudo, static_cast<uint32_t>(pagina.first.pagina));
+        escreverTexto(conteudo, pagina.second.idAluno);
+        escreverU32(conteudo, static_cast<uint32_t>(pagina.second.segmento));
+        escreverU64(conteudo, pagina.second.offset);
+        escreverU64(conteudo, static_cast<uint64_t>(pagina.second.instante));
+    }
+    escreverU32(conteudo, calcularCrc(conteudo));
+
+    // Temporrio com o nome do processo, para dois escritores no gravarem o mesmo arquivo
+    fs::path caminho = dados->pasta / ARQUIVO_INDICE;
+    fs::path temporario = caminho;
+    temporario += "." + (dados->segmentoEscrita >= 0 ? dados->segmentos[dados->segmentoEscrita] : std::string("leitor")) + ".tmp";
+    {
+        std::ofstream arquivo(temporario, std::ios::binary | std::ios::trunc);
+        if (!arquivo.is_open()) return false;
+        arquivo.write(conteudo.data(), conteudo.size());
+        if (!arquivo) return false;
+    }
+    std::error_code erro;
+    fs::rename(temporario, caminho, erro);
+    return !erro;
+}
+
+size_t ArmazemResultados::numeroPaginas() const {
+    std::lock_guard<std::mutex> lock(dados->mutex);
+    return dados->paginas.size();
+}
+
+bool ArmazemResultados::buscarPagina(const std::string& lote, const std::string& arquivo, int pagina, RegistroResultado& registro) const {
+    std::lock_guard<std::mutex> lock(dados->mutex);
+    auto it = dados->paginas.find({ lote, arquivo, pagina });
+    return it != dados->paginas.end() && dados->lerRegistro(it->second.segmento, it->second.offset, registro);
+}
+
+std::vector<RegistroResultado> ArmazemResultados::buscarAluno(const std::string& idAluno) const {
+    std::lock_guard<std::mutex> lock(dados->mutex);
+    std::vector<RegistroResultado> registros;
+    auto aluno = dados->porAluno.find(idAluno);
+    if (aluno == dados->porAluno.end()) return registros;
+
+    for (const auto& chave : aluno->second) {
+        const PosicaoRegistro& posicao = dados->paginas.at(chave);
+        RegistroResultado registro;
+        if (dados->lerRegistro(posicao.segmento, posicao.offset, registro)) {
+            registros.push_back(std::move(registro));
+        }
+    }
+    return registros;
+}
+
+void ArmazemResultados::percorrer(const std::string& lote, const std::string& arquivo, int paginaInicial, int paginaFinal,
+    const std::function<bool(const RegistroResultado&)>& callback) const {
+    std::lock_guard<std::mutex> lock(dados->mutex);
+
+    // Um arquivo aberto por segmento durante a varredura
+    std::vector<std::unique_ptr<std::ifstream>> arquivos(dados->segmentos.size());
+
+    auto it = dados->paginas.lower_bound({ lote, arquivo, arquivo.empty() ? std::numeric_limits<int>::min() : paginaInicial });
+    for (; it != dados->paginas.end() && it->first.lote == lote; ++it) {
+        const ChavePagina& chave = it->first;
+        if (!arquivo.empty() && chave.arquivo != arquivo) break;
+        if (chave.pagina < paginaInicial || (paginaFinal >= 0 && chave.pagina > paginaFinal)) continue;
+
+        int segmento = it->second.segmento;
+        if (!arquivos[segmento]) {
+            arquivos[segmento].reset(new std::ifstream(dados->pasta / dados->segmentos[segmento], std::ios::binary));
+        }
+        RegistroResultado registro;
+        if (arquivos[segmento]->is_open() && dados->lerRegistro(*arquivos[segmento], it->second.offset, registro)) {
+            if (!callback(registro)) return;
+        }
+    }
+}
+
+std::vector<std::string> ArmazemResultados::lotes() const {
+    std::lock_guard<std::mutex> lock(dados->mutex);
+    std::vector<std::string> nomes;
+    for (const auto& pagina : dados->paginas) {
+        if (nomes.empty() || nomes.back() != pagina.first.lote) {
+            nomes.push_back(pagina.first.lote);
+        }
+    }
+    return nomes;
+}
+
+std::string identificarAluno(const std::vector<std::pair<std::string, std::string>>& palavras) {
+    auto minusculas = [](std::string texto) {
+        std::transform(texto.begin(), texto.end(), texto.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return texto;
+    };
+    for (const auto& palavra : palavras) {
+        if (minusculas(palavra.first) == REGIAO_ID_ALUNO_PADRAO && !palavra.second.empty()) {
+            return palavra.second;
+        }
+    }
+    for (const auto& palavra : palavras) {
+        const std::string& texto = palavra.second;
+        if (!texto.empty() && std::all_of(texto.begin(), texto.end(), [](unsigned char c) { return std::isdigit(c) != 0; })) {
+            return texto;
+        }
+    }
+    return std::string();
+}
+
+// Respostas, confianas e regies de uma pgina a partir do _confidence.csv ("nome;subdiviso;resposta;confiana")
+// ou, se ele no existir, do _answers.txt ("nome Subdivision N: resposta")
+static void lerRespostasDaPagina(const std::string& arquivoRespostas, RegistroResultado& registro) {
+    auto acrescentar = [&](const std::string& regiao, char resposta, float confianca) {
+        if (registro.regioes.empty() || registro.regioes.back().first != regiao) {
+            registro.regioes.emplace_back(regiao, 0);
+        }
+        registro.regioes.back().second++;
+        registro.respostas += resposta;
+        registro.confiancas.push_back(confianca);
+    };
+
+    std::string arquivoConfianca = arquivoRespostas.substr(0, arquivoRespostas.size() - std::string("_answers.txt").size()) + "_confidence.csv";
+    std::ifstream confianca(arquivoConfianca);
+    std::string linha;
+    if (confianca.is_open()) {
+        while (std::getline(confianca, linha)) {
+            // O nome da regio pode ter ';', ento os campos so lidos a partir do fim
+            size_t p3 = linha.rfind(';');
+            size_t p2 = p3 == std::string::npos || p3 == 0 ? std::string::npos : linha.rfind(';', p3 - 1);
+            size_t p1 = p2 == std::string::npos || p2 == 0 ? std::string::npos : linha.rfind(';', p2 - 1);
+            if (p1 == std::string::npos || p3 == p2 + 1) continue;
+            acrescentar(linha.substr(0, p1), linha[p2 + 1], static_cast<float>(std::atof(linha.c_str() + p3 + 1)));
+        }
+        return;
+    }
+
+    std::ifstream respostas(arquivoRespostas);
+    while (std::getline(respostas, linha)) {
+        size_t doisPontos = linha.rfind(':');
+        size_t subdivisao = linha.rfind(" Subdivision ", doisPontos);
+        if (doisPontos == std::string::npos || subdivisao == std::string::npos) continue;
+        size_t inicio = linha.find_first_not_of(" \t", doisPontos + 1);
+        acrescentar(linha.substr(0, subdivisao), inicio != std::string::npos ? linha[inicio] : 'V', 0.0f);
+    }
+}
+
+// Linhas "nome: texto | confiana" do _words.txt
+static void lerPalavrasDaPagina(const std::string& arquivoPalavras, RegistroResultado& registro) {
+    std::ifstream palavras(arquivoPalavras);
+    std::string linha;
+    while (std::getline(palavras, linha)) {
+        size_t doisPontos = linha.find(": ");
+        size_t barra = linha.rfind(" | ");
+        if (doisPontos == std::string::npos || barra == std::string::npos || barra < doisPontos) continue;
+        registro.palavras.emplace_back(linha.substr(0, doisPontos), linha.substr(doisPontos + 2, barra - doisPontos - 2));
+    }
+}
+
+RegistroResultado registroDaPagina(const std::string& lote, const std::string& arquivoOrigem, const ResultadoParcialPagina& resultado) {
+    RegistroResultado registro;
+    registro.lote = lote;
+    registro.arquivo = arquivoOrigem;
+    registro.pagina = numeroDaPaginaDoArquivo(resultado.fileName);
+    registro.modelo = resultado.modelo;
+    if (resultado.ignorada || !resultado.alinhada) {
+        registro.situacao = "ignorada:" + (resultado.ignorada ? resultado.motivo : std::string(nomeTipoPagina(TipoPagina::NaoAlinhada)));
+        return registro;
+    }
+    registro.regioes = resultado.regioes;
+    for (const auto& leitura : resultado.leituras) {
+        registro.respostas += leitura.resposta;
+        registro.confiancas.push_back(leitura.confianca);
+    }
+    return registro;
+}
+
+int importarRespostas(Logger& logger, ArmazemResultados& armazem, const std::string& lote, const std::string& arquivoOrigem,
+    const std::string& pastaRespostas, const std::string& pastaPalavras, const std::string& pastaTriagem) {
+    std::map<std::string, std::string> modelosPaginas;
+    if (!pastaRespostas.empty()) modelosPaginas = lerModelosPaginas(pastaRespostas);
+    if (modelosPaginas.empty() && !pastaTriagem.empty()) {
+        modelosPaginas = lerModelosPaginas(pastaTriagem);
+    }
+
+    int gravadas = 0;
+    std::set<std::string> paginasLidas;
+    std::vector<std::string> arquivos;
+    if (!pastaRespostas.empty()) {
+        cv::glob(pastaRespostas + "/*_answers.txt", arquivos, false);
+    }
+    for (const auto& arquivo : arquivos) {
+        std::string fileName = fs::path(arquivo).filename().string();
+        fileName = fileName.substr(0, fileName.size() - std::string("_answers.txt").size());
+
+        RegistroResultado registro;
+        registro.lote = lote;
+        registro.arquivo = arquivoOrigem;
+        registro.pagina = numeroDaPaginaDoArquivo(fileName);
+        auto modelo = modelosPaginas.find(fileName);
+        if (modelo != modelosPaginas.end()) registro.modelo = modelo->second;
+
+        lerRespostasDaPagina(arquivo, registro);
+        if (!pastaPalavras.empty()) {
+            lerPalavrasDaPagina(pastaPalavras + "/" + fs::path(fileName).stem().string() + "_words.txt", registro);
+        }
+        registro.idAluno = identificarAluno(registro.palavras);
+
+        paginasLidas.insert(fileName);
+        if (armazem.anexar(registro)) gravadas++;
+    }
+
+    // Pginas descartadas na triagem tambm entram, para o lote ter uma entrada por pgina
+    std::set<std::string> ignoradasVistas;
+    for (const std::string& pasta : { pastaTriagem, pastaRespostas }) {
+        if (pasta.empty()) continue;
+        for (const auto& pagina : lerPaginasIgnoradas(pasta)) {
+            // Uma leitura que existe tem prioridade sobre um relatrio de triagem antigo
+            if (paginasLidas.count(pagina.fileName) > 0 || !ignoradasVistas.insert(pagina.fileName).second) continue;
+            RegistroResultado registro;
+            registro.lote = lote;
+            registro.arquivo = arquivoOrigem;
+            registro.pagina = numeroDaPaginaDoArquivo(pagina.fileName);
+            registro.situacao = std::string("ignorada:") + nomeTipoPagina(pagina.classificacao.tipo);
+            if (armazem.anexar(registro)) gravadas++;
+        }
+    }
+
+    armazem.salvarIndice();
+    logger.AddLogMessage(LogLevel::Info, std::to_string(gravadas) + " pginas gravadas no armazm de resultados (lote " + lote + ").");
+    return gravadas;
+}
+
+void exportarRegistroCsv(std::ostream& saida, const RegistroResultado& registro) {
+    saida << registro.lote << ";" << registro.arquivo << ";" << registro.pagina << ";" << registro.idAluno << ";"
+        << registro.modelo << ";" << registro.situacao << ";";
+    // Respostas separadas por vrgula, sem o agrupamento em blocos de cinco do respostas.txt
+    for (size_t i = 0; i < registro.respostas.size(); i++) {
+        if (i > 0) saida << ",";
+        saida << registro.respostas[i];
+    }
+    saida << "\n";
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Logger.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Armazm de resultados s de acrscimo, indexado por lote, arquivo de origem, pgina e aluno,
+// para achar a folha de um aluno ou reexportar um lote sem varrer pastas de arquivos de texto.
+//
+// Pasta do armazm:
+//   seg_<escritor>.dat   um segmento por processo escritor (workers em mquinas diferentes nunca
+//                        escrevem no mesmo arquivo); cada registro vai emoldurado por assinatura,
+//                        tamanho e CRC-32, ento um registro cortado por uma queda  descartado
+//   indice.bin           foto do ndice e at onde cada segmento j foi indexado; a abertura s
+//                        varre o que foi acrescentado depois dela
+//
+// Entre registros da mesma pgina (mesmo lote, arquivo e nmero), vale o de instante mais recente,
+// qualquer que seja o segmento ou a ordem em que os segmentos so lidos.
+
+// Subpasta do armazm dentro da pasta de sada (GUI, pasta monitorada e trabalho distribudo)
+const std::string PASTA_ARMAZEM_RESULTADOS = "armazem";
+
+// Regio de palavra usada como identificao do aluno, se existir no modelo
+const std::string REGIAO_ID_ALUNO_PADRAO = "matricula";
+
+struct ResultadoParcialPagina;
+
+struct RegistroResultado {
+    std::string lote;
+    std::string arquivo;             // Arquivo de origem (PDF, TIFF...) dentro do lote
+    int pagina = 0;                  // Nmero da pgina no arquivo (base 1)
+    std::string idAluno;             // Vazio se a pgina no tem identificao
+    std::string modelo;
+    int64_t instante = 0;            // Segundos desde 1970 em que o registro foi gravado
+    std::string situacao = "lida";   // "lida" ou "ignorada:<motivo>"
+    std::string respostas;           // Uma por questo, na ordem do modelo ('X' = dupla, 'V' = em branco)
+    std::vector<float> confiancas;   // Uma por questo
+    std::vector<std::pair<std::string, int>> regioes;           // Nome e nmero de questes, na ordem das respostas
+    std::vector<std::pair<std::string, std::string>> palavras;  // Regio de palavra e texto lido
+};
+
+class ArmazemResultados {
+public:
+    ArmazemResultados();
+    ~ArmazemResultados();
+
+    // idEscritor vazio abre s para leitura. Com idEscritor, os registros vo para seg_<idEscritor>.dat.
+    bool abrir(Logger& logger, const std::string& pasta, const std::string& idEscritor = "");
+
+    // Pode ser chamada de vrias threads; o registro est no disco (flush) quando retorna true
+    bool anexar(const RegistroResultado& registro);
+
+    // Indexa o que outros processos acrescentaram desde a abertura (ou a ltima atualizao)
+    void atualizar();
+
+    // Grava a foto do ndice (arquivo temporrio + rename)
+    bool salvarIndice();
+
+    size_t numeroPaginas() const;
+
+    bool buscarPagina(const std::string& lote, const std::string& arquivo, int pagina, RegistroResultado& registro) const;
+    std::vector<RegistroResultado> buscarAluno(const std::string& idAluno) const;
+
+    // Percorre as pginas de um lote em ordem (arquivo, pgina). arquivo vazio = todos os arquivos do
+    // lote; paginaFinal < 0 = at a ltima. O callback retorna false para interromper.
+    void percorrer(const std::string& lote, const std::string& arquivo, int paginaInicial, int paginaFinal,
+        const std::function<bool(const RegistroResultado&)>& callback) const;
+
+    std::vector<std::string> lotes() const;
+
+private:
+    struct Dados;
+    std::unique_ptr<Dados> dados;
+};
+
+// Identificao do aluno a partir das palavras lidas: a regio REGIAO_ID_ALUNO_PADRAO (sem
+// diferenciar maisculas) ou, se no houver, a primeira regio lida s com dgitos
+std::string identificarAluno(const std::vector<std::pair<std::string, std::string>>& palavras);
+
+// Registro de uma pgina a partir do resultado publicado pela leitura (ResultStream.h), para gravar
+// a pgina assim que ela termina, sem reler os arquivos de texto. Ainda sem palavras.
+RegistroResultado registroDaPagina(const std::string& lote, const std::string& arquivoOrigem, const ResultadoParcialPagina& resultado);
+
+// Acrescenta ao armazm as pginas de uma pasta de respostas do pipeline (_answers.txt com o
+// _confidence.csv ao lado, _words.txt em pastaPalavras e as pginas ignoradas na triagem).
+// pastaRespostas vazia = s as pginas ignoradas. Retorna quantas pginas foram gravadas.
+int importarRespostas(Logger& logger, ArmazemResultados& armazem, const std::string& lote, const std::string& arquivoOrigem,
+    const std::string& pastaRespostas, const std::string& pastaPalavras = "", const std::string& pastaTriagem = "");
+
+// Exporta registros em CSV: lote;arquivo;pagina;aluno;modelo;situacao;respostas
+void exportarRegistroCsv(std::ostream& saida, const RegistroResultado& registro);
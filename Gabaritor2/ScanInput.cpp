@@ -0,0 +1,145 @@
+#include "ScanInput.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+static std::string extensaoMinuscula(const fs::path& caminho) {
+    std::string extensao = caminho.extension().string();
+    std::transform(extensao.begin(), extensao.end(), extensao.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extensao;
+}
+
+static bool extensaoDeImagem(const std::string& extensao) {
+    return extensao == ".tif" || extensao == ".tiff" || extensao == ".jpg" || extensao == ".jpeg"
+        || extensao == ".png" || extensao == ".bmp";
+}
+
+// Ordem natural: "scan_2.tif" vem antes de "scan_10.tif"
+static bool compararNomesNatural(const std::string& a, const std::string& b) {
+    size_t i = 0, j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (std::isdigit(static_cast<unsigned char>(a[i])) && std::isdigit(static_cast<unsigned char>(b[j]))) {
+            size_t fimA = i, fimB = j;
+            while (fimA < a.size() && std::isdigit(static_cast<unsigned char>(a[fimA]))) fimA++;
+            while (fimB < b.size() && std::isdigit(static_cast<unsigned char>(b[fimB]))) fimB++;
+            // Sem zeros  esquerda, o nmero com mais dgitos  o maior
+            size_t inicioA = a.find_first_not_of('0', i), inicioB = b.find_first_not_of('0', j);
+            inicioA = std::min(inicioA, fimA);
+            inicioB = std::min(inicioB, fimB);
+            if (fimA - inicioA != fimB - inicioB) return fimA - inicioA < fimB - inicioB;
+            int comparacao = a.compare(inicioA, fimA - inicioA, b, inicioB, fimB - inicioB);
+            if (comparacao != 0) return comparacao < 0;
+            i = fimA;
+            j = fimB;
+        }
+        else {
+            if (a[i] != b[j]) return a[i] < b[j];
+            i++;
+            j++;
+        }
+    }
+    return a.size() - i < b.size() - j;
+}
+
+bool ehEntradaDigitalizada(const std::string& caminho) {
+    std::error_code erro;
+    if (fs::is_directory(caminho, erro)) return true;
+    return extensaoDeImagem(extensaoMinuscula(caminho));
+}
+
+bool FonteDigitalizacao::abrir(Logger& logger, const std::string& caminho, int dpiDigitalizacao) {
+    entradas.clear();
+    this->dpiDigitalizacao = std::max(dpiDigitalizacao, 1);
+
+    std::vector<std::string> arquivos;
+    std::error_code erro;
+    if (fs::is_directory(caminho, erro)) {
+        for (const auto& entrada : fs::directory_iterator(caminho, erro)) {
+            if (entrada.is_regular_file(erro) && extensaoDeImagem(extensaoMinuscula(entrada.path()))) {
+                arquivos.push_back(entrada.path().string());
+            }
+        }
+        std::sort(arquivos.begin(), arquivos.end(), [](const std::string& a, const std::string& b) {
+            return compararNomesNatural(fs::path(a).filename().string(), fs::path(b).filename().string());
+        });
+    }
+    else if (fs::is_regular_file(caminho, erro)) {
+        arquivos.push_back(caminho);
+    }
+    else {
+        logger.AddLogMessage(LogLevel::Error, "Entrada no encontrada: " + caminho);
+        return false;
+    }
+
+    for (const auto& arquivo : arquivos) {
+        std::string extensao = extensaoMinuscula(arquivo);
+        // S os TIFFs podem ter vrias pginas; contar as pginas l apenas os cabealhos
+        size_t paginas = (extensao == ".tif" || extensao == ".tiff") ? cv::imcount(arquivo) : 1;
+        if (paginas == 0) {
+            logger.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + arquivo);
+            continue;
+        }
+        if (paginas == 1) {
+            entradas.push_back({ arquivo, -1 });
+        }
+        else {
+            for (size_t p = 0; p < paginas; p++) {
+                entradas.push_back({ arquivo, static_cast<int>(p) });
+            }
+        }
+    }
+
+    logger.AddLogMessage(LogLevel::Info, std::to_string(entradas.size()) + " pginas digitalizadas em " + std::to_string(arquivos.size()) + " arquivos.");
+    return !entradas.empty();
+}
+
+std::string FonteDigitalizacao::nomePagina(int indice) const {
+    return "page_" + std::to_string(indice + 1) + ".png";
+}
+
+cv::Mat FonteDigitalizacao::lerPagina(int indice, int dpi) const {
+    const Entrada& entrada = entradas[indice];
+    double escala = static_cast<double>(dpi) / dpiDigitalizacao;
+
+    cv::Mat pagina;
+    int reducao = 1;
+    if (entrada.pagina < 0) {
+        // Maior fator de reduo da decodificao que no passa da resoluo pedida
+        int flags = cv::IMREAD_COLOR;
+        if (escala <= 1.0 / 8) { reducao = 8; flags = cv::IMREAD_REDUCED_COLOR_8; }
+        else if (escala <= 1.0 / 4) { reducao = 4; flags = cv::IMREAD_REDUCED_COLOR_4; }
+        else if (escala <= 1.0 / 2) { reducao = 2; flags = cv::IMREAD_REDUCED_COLOR_2; }
+        pagina = cv::imread(entrada.arquivo, flags);
+    }
+    else {
+        // imreadmulti no tem as flags reduzidas; a pgina inteira  decodificada
+        std::vector<cv::Mat> paginas;
+        if (cv::imreadmulti(entrada.arquivo, paginas, entrada.pagina, 1, cv::IMREAD_COLOR) && !paginas.empty()) {
+            pagina = paginas[0];
+        }
+    }
+    if (pagina.empty()) {
+        return pagina;
+    }
+
+    double restante = escala * reducao;
+    if (std::abs(restante - 1.0) > 0.01) {
+        cv::resize(pagina, pagina, cv::Size(), restante, restante, restante < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+    }
+    return pagina;
+}
+
+bool FonteDigitalizacao::salvarOrigemPaginas(Logger& logger, const std::string& pasta) const {
+    std::ofstream arquivo(pasta + "/" + ARQUIVO_ORIGEM_PAGINAS);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "Erro ao criar o arquivo: " + pasta + "/" + ARQUIVO_ORIGEM_PAGINAS);
+        return false;
+    }
+    for (size_t i = 0; i < entradas.size(); i++) {
+        arquivo << nomePagina(static_cast<int>(i)) << ";" << entradas[i].arquivo << ";" << std::max(entradas[i].pagina, 0) + 1 << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+#include "Logger.h"
+
+// Entrada direta de digitalizaes, sem PDF: uma pasta de imagens (uma pgina por arquivo, em
+// ordem natural dos nomes), um TIFF com vrias pginas ou uma imagem avulsa. As pginas so
+// decodificadas sob demanda, direto para as etapas seguintes, sem a pasta intermediria de PNGs.
+
+// Relao "page_N.png;arquivo;pgina no arquivo" gravada junto com a sada, para achar a folha original
+const std::string ARQUIVO_ORIGEM_PAGINAS = "origem_paginas.txt";
+
+// true para pastas e arquivos de imagem (.tif, .tiff, .jpg, .jpeg, .png, .bmp)
+bool ehEntradaDigitalizada(const std::string& caminho);
+
+class FonteDigitalizacao {
+public:
+    // dpiDigitalizacao: resoluo em que o scanner gravou as imagens
+    bool abrir(Logger& logger, const std::string& caminho, int dpiDigitalizacao = 300);
+
+    int numeroPaginas() const { return static_cast<int>(entradas.size()); }
+
+    // Nome usado pelas etapas seguintes: page_N.png, N a partir de 1 na ordem das pginas
+    std::string nomePagina(int indice) const;
+
+    // Decodifica a pgina em BGR na resoluo pedida. Abaixo da resoluo do scanner a reduo 
+    // feita j na decodificao (IMREAD_REDUCED_COLOR_2/4/8, que no JPEG reduz na prpria DCT) e
+    // s o resto  reduzido com resize. Pode ser chamada de vrias threads ao mesmo tempo.
+    cv::Mat lerPagina(int indice, int dpi) const;
+
+    bool salvarOrigemPaginas(Logger& logger, const std::string& pasta) const;
+
+private:
+    struct Entrada {
+        std::string arquivo;
+        int pagina;  // Pgina dentro de um TIFF com vrias pginas; -1 para arquivos de uma pgina
+    };
+
+    std::vector<Entrada> entradas;
+    int dpiDigitalizacao = 300;
+};
@@ -0,0 +1,500 @@
+#include "Sharding.h"
+#include "TemplateRegistry.h"
+#include "ResultsStore.h"
+#include "CpuBudget.h"
+#include <poppler/cpp/poppler-document.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+
+namespace fs = std::filesystem;
+
+const std::string ARQUIVO_TRABALHO = "trabalho.txt";
+const std::string PASTA_SHARDS = "shards";
+const std::string PASTA_RESULTADOS = "resultados";
+const std::string PASTA_MESCLAGEM = "mesclagem";
+
+// Intervalo entre as verificaes da pasta de trabalho
+const int SEGUNDOS_ENTRE_VERIFICACOES = 2;
+
+static std::string nomeShard(int indice) {
+    std::ostringstream nome;
+    nome << "shard_" << std::setw(5) << std::setfill('0') << indice;
+    return nome.str();
+}
+
+// Grava em um arquivo temporrio e renomeia, para que outro processo nunca leia um arquivo pela metade.
+// Processos que podem gravar o mesmo arquivo ao mesmo tempo passam sufixos diferentes para o temporrio.
+static bool gravarArquivoAtomico(const fs::path& caminho, const std::string& conteudo, const std::string& sufixoTemporario = "") {
+    fs::path temporario = caminho;
+    if (!sufixoTemporario.empty()) temporario += "." + sufixoTemporario;
+    temporario += ".tmp";
+    {
+        std::ofstream arquivo(temporario, std::ios::binary | std::ios::trunc);
+        if (!arquivo.is_open()) return false;
+        arquivo << conteudo;
+        if (!arquivo) return false;
+    }
+    std::error_code erro;
+    fs::rename(temporario, caminho, erro);
+    return !erro;
+}
+
+static bool salvarTrabalho(const fs::path& caminho, const TrabalhoDistribuido& trabalho, int totalPaginas, int numeroShards) {
+    std::ostringstream conteudo;
+    conteudo << "pdf=" << trabalho.filenamePdf << "\n"
+        << "referencia=" << trabalho.referenceImagePath << "\n"
+        << "coordenadas=" << trabalho.coordinatesFilePath << "\n"
+        << "modelos=" << trabalho.templatesFilePath << "\n"
+        << "paginas=" << totalPaginas << "\n"
+        << "paginas_por_shard=" << trabalho.paginasPorShard << "\n"
+        << "shards=" << numeroShards << "\n"
+        << "dpi_baixo=" << trabalho.leitura.dpiBaixo << "\n"
+        << "dpi_alto=" << trabalho.leitura.dpiAlto << "\n"
+        << "limiar_confianca=" << trabalho.leitura.limiarConfianca << "\n"
+        << "triagem=" << (trabalho.leitura.triarPaginas ? 1 : 0) << "\n";
+    return gravarArquivoAtomico(caminho, conteudo.str());
+}
+
+static bool lerTrabalho(const fs::path& caminho, TrabalhoDistribuido& trabalho, int& totalPaginas, int& numeroShards) {
+    std::ifstream arquivo(caminho);
+    if (!arquivo.is_open()) return false;
+
+    std::map<std::string, std::string> valores;
+    std::string linha;
+    while (std::getline(arquivo, linha)) {
+        if (!linha.empty() && linha.back() == '\r') linha.pop_back();
+        size_t pos = linha.find('=');
+        if (pos != std::string::npos) {
+            valores[linha.substr(0, pos)] = linha.substr(pos + 1);
+        }
+    }
+
+    if (!valores.count("pdf") || !valores.count("shards")) return false;
+    trabalho.filenamePdf = valores["pdf"];
+    trabalho.referenceImagePath = valores["referencia"];
+    trabalho.coordinatesFilePath = valores["coordenadas"];
+    trabalho.templatesFilePath = valores["modelos"];
+    totalPaginas = std::atoi(valores["paginas"].c_str());
+    trabalho.paginasPorShard = std::atoi(valores["paginas_por_shard"].c_str());
+    numeroShards = std::atoi(valores["shards"].c_str());
+    trabalho.leitura.dpiBaixo = std::atoi(valores["dpi_baixo"].c_str());
+    trabalho.leitura.dpiAlto = std::atoi(valores["dpi_alto"].c_str());
+    trabalho.leitura.limiarConfianca = static_cast<float>(std::atof(valores["limiar_confianca"].c_str()));
+    trabalho.leitura.triarPaginas = valores["triagem"] != "0";
+    return true;
+}
+
+// Quantos shards tm o arquivo de estado com a extenso dada (".done" ou ".failed")
+static int contarShards(const fs::path& pastaShards, int numeroShards, const std::string& extensao) {
+    int encontrados = 0;
+    for (int k = 0; k < numeroShards; k++) {
+        if (fs::exists(pastaShards / (nomeShard(k) + extensao))) encontrados++;
+    }
+    return encontrados;
+}
+
+static int contarShardsConcluidos(const fs::path& pastaShards, int numeroShards) {
+    return contarShards(pastaShards, numeroShards, ".done");
+}
+
+// Conta mais uma devoluo do shard para a fila e retorna o total
+static int registrarTentativa(const fs::path& pastaShards, const std::string& shard) {
+    fs::path caminho = pastaShards / (shard + ".attempts");
+    int tentativas = 0;
+    {
+        std::ifstream arquivo(caminho);
+        arquivo >> tentativas;
+    }
+    tentativas++;
+    gravarArquivoAtomico(caminho, std::to_string(tentativas) + "\n");
+    return tentativas;
+}
+
+// Devolve para a fila os shards cujas reservas pararam de ser renovadas (RenovacaoReserva), ou os
+// marca como falhos depois de TENTATIVAS_POR_SHARD reservas perdidas
+static void liberarShardsAbandonados(Logger& logger, const fs::path& pastaShards, int segundosShardAbandonado) {
+    std::error_code erro;
+    auto agora = fs::file_time_type::clock::now();
+    for (const auto& entrada : fs::directory_iterator(pastaShards, erro)) {
+        std::string nome = entrada.path().filename().string();
+        size_t pos = nome.find(".claimed.");
+        if (pos == std::string::npos) continue;
+
+        std::string shard = nome.substr(0, pos);
+        if (fs::exists(pastaShards / (shard + ".done"))) {
+            fs::remove(entrada.path(), erro);
+            continue;
+        }
+
+        auto ultimaAtividade = fs::last_write_time(entrada.path(), erro);
+        if (erro) continue;
+        if (agora - ultimaAtividade > std::chrono::seconds(segundosShardAbandonado)) {
+            int tentativas = registrarTentativa(pastaShards, shard);
+            if (tentativas >= TENTATIVAS_POR_SHARD) {
+                fs::rename(entrada.path(), pastaShards / (shard + ".failed"), erro);
+                if (!erro) {
+                    logger.AddLogMessage(LogLevel::Error, "Shard falhou " + std::to_string(tentativas) + " vezes e foi abandonado: " + shard);
+                }
+                continue;
+            }
+            fs::rename(entrada.path(), pastaShards / (shard + ".todo"), erro);
+            if (!erro) {
+                logger.AddLogMessage(LogLevel::Warning, "Shard abandonado devolvido para a fila (tentativa " + std::to_string(tentativas + 1)
+                    + " de " + std::to_string(TENTATIVAS_POR_SHARD) + "): " + nome);
+            }
+        }
+    }
+}
+
+int executarCoordenador(Logger& logger, const TrabalhoDistribuido& trabalho, const std::string& pastaTrabalho,
+    int workersLocais, const std::string& executavel, int segundosShardAbandonado) {
+    fs::path pasta(pastaTrabalho);
+    fs::path pastaShards = pasta / PASTA_SHARDS;
+    fs::path caminhoTrabalho = pasta / ARQUIVO_TRABALHO;
+    std::error_code erro;
+    fs::create_directories(pastaShards, erro);
+    fs::create_directories(pasta / PASTA_RESULTADOS, erro);
+
+    int totalPaginas = 0;
+    int numeroShards = 0;
+    if (fs::exists(caminhoTrabalho)) {
+        // Retoma um trabalho interrompido: os shards concludos continuam valendo
+        TrabalhoDistribuido existente;
+        if (!lerTrabalho(caminhoTrabalho, existente, totalPaginas, numeroShards)) {
+            logger.AddLogMessage(LogLevel::Error, "Arquivo de trabalho invlido: " + caminhoTrabalho.string());
+            return 1;
+        }
+        if (existente.filenamePdf != trabalho.filenamePdf) {
+            logger.AddLogMessage(LogLevel::Error, "A pasta de trabalho j pertence a outro PDF: " + existente.filenamePdf);
+            return 1;
+        }
+        logger.AddLogMessage(LogLevel::Info, "Retomando trabalho existente: " + std::to_string(contarShardsConcluidos(pastaShards, numeroShards))
+            + " de " + std::to_string(numeroShards) + " shards j concludos.");
+
+        // Shards que falharam na execuo anterior ganham novas tentativas
+        for (int k = 0; k < numeroShards; k++) {
+            fs::path falho = pastaShards / (nomeShard(k) + ".failed");
+            if (!fs::exists(falho)) continue;
+            fs::remove(pastaShards / (nomeShard(k) + ".attempts"), erro);
+            fs::rename(falho, pastaShards / (nomeShard(k) + ".todo"), erro);
+        }
+    }
+    else {
+        std::unique_ptr<poppler::document> documento(poppler::document::load_from_file(trabalho.filenamePdf));
+        if (documento == nullptr) {
+            logger.AddLogMessage(LogLevel::Error, "couldn't read pdf: " + trabalho.filenamePdf);
+            return 1;
+        }
+        totalPaginas = documento->pages();
+        int paginasPorShard = std::max(trabalho.paginasPorShard, 1);
+        numeroShards = (totalPaginas + paginasPorShard - 1) / paginasPorShard;
+
+        for (int k = 0; k < numeroShards; k++) {
+            int primeira = k * paginasPorShard;
+            int ultima = std::min(primeira + paginasPorShard, totalPaginas) - 1;
+            if (!gravarArquivoAtomico(pastaShards / (nomeShard(k) + ".todo"), std::to_string(primeira) + " " + std::to_string(ultima) + "\n")) {
+                logger.AddLogMessage(LogLevel::Error, "No foi possvel criar os shards em: " + pastaShards.string());
+                return 1;
+            }
+        }
+
+        // O arquivo de trabalho  o ltimo a ser gravado: os workers s comeam quando ele existe
+        if (!salvarTrabalho(caminhoTrabalho, trabalho, totalPaginas, numeroShards)) {
+            logger.AddLogMessage(LogLevel::Error, "No foi possvel gravar o arquivo de trabalho: " + caminhoTrabalho.string());
+            return 1;
+        }
+        logger.AddLogMessage(LogLevel::Info, std::to_string(totalPaginas) + " pginas divididas em " + std::to_string(numeroShards) + " shards.");
+    }
+
+    // Os workers locais dividem o oramento (ncleos e as contagens de threads, inclusive as explcitas
+    // de --cpu-budget), gravado na pasta de trabalho; com ncleos fixados, cada um fica com um trecho do intervalo
+    const OrcamentoCpu& orcamento = orcamentoCpu();
+    OrcamentoCpu orcamentoWorker = dividirOrcamentoCpu(orcamento, workersLocais);
+    int nucleosPorWorker = orcamentoWorker.nucleos;
+    bool fixarWorkers = orcamento.primeiroNucleo >= 0 && orcamento.nucleos >= workersLocais;
+    fs::path arquivoOrcamentoWorker = fs::absolute(pasta / ("worker_" + ARQUIVO_ORCAMENTO_CPU));
+    if (workersLocais > 0 && !salvarOrcamentoCpu(arquivoOrcamentoWorker.string(), orcamentoWorker)) {
+        logger.AddLogMessage(LogLevel::Error, "No foi possvel gravar o oramento de CPU dos workers: " + arquivoOrcamentoWorker.string());
+        return 1;
+    }
+
+    std::vector<std::thread> processos;
+    std::atomic<int> processosAtivos{ workersLocais };
+    for (int w = 0; w < workersLocais; w++) {
+        std::string comando = "\"" + executavel + "\" --worker --work-dir \"" + fs::absolute(pasta).string()
+            + "\" --worker-id \"" + idWorkerPadrao() + "-" + std::to_string(w) + "\" --cpu-budget \"" + arquivoOrcamentoWorker.string() + "\"";
+        if (fixarWorkers) {
+            comando += " --first-core " + std::to_string(orcamento.primeiroNucleo + w * nucleosPorWorker);
+        }
+#ifdef _WIN32
+        // O cmd.exe remove o primeiro par de aspas da linha inteira
+        comando = "\"" + comando + "\"";
+#endif
+        processos.emplace_back([comando, &processosAtivos]() {
+            std::system(comando.c_str());
+            processosAtivos--;
+        });
+    }
+    if (workersLocais == 0) {
+        logger.AddLogMessage(LogLevel::Info, "Aguardando workers externos em: " + fs::absolute(pasta).string());
+    }
+
+    int concluidosAntes = -1;
+    bool falhou = false;
+    for (;;) {
+        int concluidos = contarShardsConcluidos(pastaShards, numeroShards);
+        if (concluidos != concluidosAntes) {
+            logger.AddLogMessage(LogLevel::Info, std::to_string(concluidos) + " de " + std::to_string(numeroShards) + " shards concludos.");
+            concluidosAntes = concluidos;
+        }
+        if (concluidos == numeroShards) break;
+
+        int falhos = contarShards(pastaShards, numeroShards, ".failed");
+        if (concluidos + falhos == numeroShards) {
+            logger.AddLogMessage(LogLevel::Error, std::to_string(falhos) + " shards falharam em todas as tentativas; o trabalho no foi concludo.");
+            falhou = true;
+            break;
+        }
+        // Sem workers locais vivos ningum mais vai pegar os shards pendentes (com workersLocais = 0 os
+        // workers so externos e o coordenador s espera)
+        if (workersLocais > 0 && processosAtivos.load() == 0) {
+            logger.AddLogMessage(LogLevel::Error, "Todos os workers locais terminaram com " + std::to_string(numeroShards - concluidos)
+                + " shards pendentes.");
+            falhou = true;
+            break;
+        }
+
+        liberarShardsAbandonados(logger, pastaShards, segundosShardAbandonado);
+        std::this_thread::sleep_for(std::chrono::seconds(SEGUNDOS_ENTRE_VERIFICACOES));
+    }
+
+    for (auto& processo : processos) {
+        processo.join();
+    }
+    if (falhou) {
+        return 1;
+    }
+
+    return juntarShards(logger, pastaTrabalho) ? 0 : 1;
+}
+
+// Renova a reserva de um shard em segundo plano enquanto existir
+class RenovacaoReserva {
+public:
+    explicit RenovacaoReserva(const fs::path& caminho) : caminho(caminho), thread([this] { renovar(); }) {}
+
+    ~RenovacaoReserva() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            parar = true;
+        }
+        condicao.notify_all();
+        thread.join();
+    }
+
+    RenovacaoReserva(const RenovacaoReserva&) = delete;
+    RenovacaoReserva& operator=(const RenovacaoReserva&) = delete;
+
+private:
+    void renovar() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!condicao.wait_for(lock, std::chrono::seconds(SEGUNDOS_RENOVACAO_RESERVA), [this] { return parar; })) {
+            // Se o coordenador j devolveu o shard, o arquivo no existe mais e nada acontece: a publicao
+            // abaixo resolve quem termina primeiro
+            std::error_code erro;
+            fs::last_write_time(caminho, fs::file_time_type::clock::now(), erro);
+        }
+    }
+
+    fs::path caminho;
+    std::mutex mutex;
+    std::condition_variable condicao;
+    bool parar = false;
+    std::thread thread;
+};
+
+// Tenta reservar um shard livre. Retorna o ndice do shard ou -1 se no houver nenhum na fila.
+static int reservarShard(const fs::path& pastaShards, const std::string& idWorker, int& primeira, int& ultima, fs::path& caminhoReserva) {
+    std::vector<fs::path> livres;
+    std::error_code erro;
+    for (const auto& entrada : fs::directory_iterator(pastaShards, erro)) {
+        if (entrada.path().extension() == ".todo") {
+            livres.push_back(entrada.path());
+        }
+    }
+    std::sort(livres.begin(), livres.end());
+
+    for (const auto& livre : livres) {
+        std::string shard = livre.stem().string();
+        fs::path reserva = pastaShards / (shard + ".claimed." + idWorker);
+
+        // S um worker consegue renomear o arquivo; os outros recebem erro e tentam o prximo
+        fs::rename(livre, reserva, erro);
+        if (erro) continue;
+
+        // O rename preserva o mtime antigo; atualiza para marcar o incio do processamento
+        fs::last_write_time(reserva, fs::file_time_type::clock::now(), erro);
+
+        std::ifstream arquivo(reserva);
+        if (!(arquivo >> primeira >> ultima)) {
+            continue;
+        }
+        caminhoReserva = reserva;
+        return std::atoi(shard.c_str() + std::string("shard_").size());
+    }
+    return -1;
+}
+
+int executarWorker(Logger& logger, const std::string& pastaTrabalho, const std::string& idWorker) {
+    fs::path pasta(pastaTrabalho);
+    fs::path pastaShards = pasta / PASTA_SHARDS;
+    fs::path pastaResultados = pasta / PASTA_RESULTADOS;
+
+    TrabalhoDistribuido trabalho;
+    int totalPaginas = 0;
+    int numeroShards = 0;
+    if (!lerTrabalho(pasta / ARQUIVO_TRABALHO, trabalho, totalPaginas, numeroShards)) {
+        logger.AddLogMessage(LogLevel::Error, "Arquivo de trabalho no encontrado em: " + pastaTrabalho);
+        return 1;
+    }
+
+    // Os modelos (referncias, features ORB e geometria) so carregados uma vez por processo
+    TemplateRegistry modelos;
+    if (!modelos.carregar(logger, trabalho.templatesFilePath, trabalho.referenceImagePath, trabalho.coordinatesFilePath)) {
+        return 1;
+    }
+
+    // Cada worker acrescenta ao armazm no seu prprio segmento
+    ArmazemResultados armazem;
+    bool usarArmazem = armazem.abrir(logger, (pasta / PASTA_ARMAZEM_RESULTADOS).string(), idWorker);
+
+    int shardsProcessados = 0;
+    for (;;) {
+        int primeira = 0, ultima = -1;
+        fs::path caminhoReserva;
+        int shard = reservarShard(pastaShards, idWorker, primeira, ultima, caminhoReserva);
+        if (shard < 0) {
+            // Nada na fila: termina se todos os shards terminaram (concludos ou falhos), seno espera um
+            // shard abandonado voltar
+            if (contarShardsConcluidos(pastaShards, numeroShards) + contarShards(pastaShards, numeroShards, ".failed") == numeroShards) break;
+            std::this_thread::sleep_for(std::chrono::seconds(SEGUNDOS_ENTRE_VERIFICACOES));
+            continue;
+        }
+
+        std::string nome = nomeShard(shard);
+        logger.AddLogMessage(LogLevel::Info, "Worker " + idWorker + ": " + nome + " (pginas " + std::to_string(primeira + 1)
+            + " a " + std::to_string(ultima + 1) + ")");
+
+        // Os resultados vo para uma pasta prpria do worker e s so publicados no fim, para que
+        // um shard reprocessado por outro worker no misture arquivos dos dois
+        fs::path pastaTemporaria = pastaResultados / (nome + "." + idWorker + ".tmp");
+        fs::path pastaFinal = pastaResultados / nome;
+        std::error_code erro;
+        fs::remove_all(pastaTemporaria, erro);
+
+        ConfiguracaoDuasPassadas leitura = trabalho.leitura;
+        leitura.primeiraPagina = primeira;
+        leitura.ultimaPagina = ultima;
+        {
+            RenovacaoReserva renovacao(caminhoReserva);
+            processarPdfDuasPassadas(logger, trabalho.filenamePdf, modelos, pastaTemporaria.string(), leitura);
+        }
+
+        // Publicao: o rename da pasta inteira no substitui um destino que j existe (a pasta do shard
+        // nunca fica vazia), ento s um worker publica; quem perde descarta a prpria sada
+        fs::path arquivoConcluido = pastaShards / (nome + ".done");
+        bool publicou = false;
+        if (!fs::exists(arquivoConcluido)) {
+            fs::rename(pastaTemporaria, pastaFinal, erro);
+            publicou = !erro;
+        }
+        if (!publicou) {
+            fs::remove_all(pastaTemporaria, erro);
+            if (!fs::exists(pastaFinal)) {
+                logger.AddLogMessage(LogLevel::Error, "No foi possvel publicar os resultados de " + nome);
+                return 1;
+            }
+        }
+
+        // Quem publicou marca o shard como concludo; quem perdeu s marca se o vencedor parou antes disso.
+        // S quem publicou importa para o armazm, para o perdedor no duplicar os registros do shard.
+        if (publicou || !fs::exists(arquivoConcluido)) {
+            if (!gravarArquivoAtomico(arquivoConcluido, idWorker + "\n", idWorker)) {
+                logger.AddLogMessage(LogLevel::Error, "No foi possvel marcar " + nome + " como concludo");
+                return 1;
+            }
+            if (usarArmazem && publicou) {
+                fs::path pdf(trabalho.filenamePdf);
+                importarRespostas(logger, armazem, pdf.stem().string(), pdf.filename().string(), pastaFinal.string(), pastaFinal.string());
+            }
+        }
+        fs::remove(caminhoReserva, erro);
+        shardsProcessados++;
+    }
+
+    logger.AddLogMessage(LogLevel::Info, "Worker " + idWorker + " terminou: " + std::to_string(shardsProcessados) + " shards processados.");
+    return 0;
+}
+
+static void anexarArquivo(std::ostream& destino, const fs::path& origem) {
+    std::ifstream arquivo(origem, std::ios::binary);
+    if (arquivo.is_open()) {
+        destino << arquivo.rdbuf();
+    }
+}
+
+bool juntarShards(Logger& logger, const std::string& pastaTrabalho) {
+    fs::path pasta(pastaTrabalho);
+    TrabalhoDistribuido trabalho;
+    int totalPaginas = 0;
+    int numeroShards = 0;
+    if (!lerTrabalho(pasta / ARQUIVO_TRABALHO, trabalho, totalPaginas, numeroShards)) {
+        logger.AddLogMessage(LogLevel::Error, "Arquivo de trabalho no encontrado em: " + pastaTrabalho);
+        return false;
+    }
+
+    // Os shards cobrem intervalos de pginas crescentes, ento juntar shard a shard, cada um em
+    // ordem de pgina, d sempre o mesmo arquivo, independente de quem processou o qu
+    std::ostringstream respostas;
+    std::ostringstream modelosPaginas;
+    for (int k = 0; k < numeroShards; k++) {
+        std::string nome = nomeShard(k);
+        fs::path pastaShard = pasta / PASTA_RESULTADOS / nome;
+        fs::path pastaMesclagem = pasta / PASTA_MESCLAGEM / nome;
+        if (!fs::exists(pasta / PASTA_SHARDS / (nome + ".done"))) {
+            logger.AddLogMessage(LogLevel::Error, "Shard ainda no concludo: " + nome);
+            return false;
+        }
+
+        juntarRespostasEmTXT(logger, pastaShard.string(), pastaMesclagem.string());
+        anexarArquivo(respostas, pastaMesclagem / "respostas.txt");
+        anexarArquivo(modelosPaginas, pastaShard / ARQUIVO_MODELOS_PAGINAS);
+    }
+
+    fs::path arquivoFinal = pasta / "respostas.txt";
+    if (!gravarArquivoAtomico(arquivoFinal, respostas.str()) || !gravarArquivoAtomico(pasta / ARQUIVO_MODELOS_PAGINAS, modelosPaginas.str())) {
+        logger.AddLogMessage(LogLevel::Error, "Erro ao gravar o resultado final em: " + arquivoFinal.string());
+        return false;
+    }
+
+    logger.AddLogMessage(LogLevel::Info, "Respostas de " + std::to_string(totalPaginas) + " pginas juntadas em: " + arquivoFinal.string());
+    return true;
+}
+
+std::string idWorkerPadrao() {
+    const char* maquina = std::getenv("COMPUTERNAME");
+    if (maquina == nullptr) maquina = std::getenv("HOSTNAME");
+    auto instante = std::chrono::steady_clock::now().time_since_epoch().count();
+    return std::string(maquina != nullptr ? maquina : "worker") + "-" + std::to_string(instante % 1000000007);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Logger.h"
+#include "TwoPassReading.h"
+#include <string>
+
+// Processamento distribudo de um PDF grande por vrios processos (na mesma mquina ou em
+// mquinas que compartilham uma pasta de trabalho). O coordenador divide as pginas em shards,
+// cada worker pega um shard por vez renomeando o arquivo do shard (operao atmica no sistema
+// de arquivos) e, no fim, o coordenador junta as respostas em ordem de pgina.
+//
+// Pasta de trabalho:
+//   trabalho.txt                 configurao do trabalho (chave=valor), gravada pelo coordenador
+//   shards/shard_NNNNN.todo      shard livre, contm "primeira ultima" (pginas base 0)
+//   shards/shard_NNNNN.claimed.<worker>  shard em processamento (mtime = ltima renovao da reserva)
+//   shards/shard_NNNNN.done      shard concludo
+//   shards/shard_NNNNN.attempts  quantas vezes o shard voltou para a fila (gravado pelo coordenador)
+//   shards/shard_NNNNN.failed    shard que esgotou TENTATIVAS_POR_SHARD; o trabalho termina com erro
+//   resultados/shard_NNNNN/      respostas e relatrios de triagem/modelos do shard
+//   worker_orcamento_cpu.txt     parte do oramento de CPU de cada worker local (--cpu-budget dos workers)
+//   respostas.txt                resultado final juntado pelo coordenador
+struct TrabalhoDistribuido {
+    std::string filenamePdf;
+    std::string referenceImagePath;
+    std::string coordinatesFilePath;
+    std::string templatesFilePath;     // Se no for vazio, substitui referncia e coordenadas
+    int paginasPorShard = 50;
+    ConfiguracaoDuasPassadas leitura;
+};
+
+// Enquanto processa um shard, o worker renova a reserva (o mtime do arquivo .claimed) a cada
+// SEGUNDOS_RENOVACAO_RESERVA. Uma reserva sem renovao por segundosShardAbandonado  de um worker
+// que morreu e o shard volta para a fila; o valor s precisa cobrir algumas renovaes perdidas,
+// no o tempo de processar o shard.
+const int SEGUNDOS_RENOVACAO_RESERVA = 15;
+const int SEGUNDOS_SHARD_ABANDONADO_PADRAO = 2 * 60;
+// Reservas de um shard antes de ele ser dado como falho: um shard que derruba o worker toda vez
+// (pgina corrompida, por exemplo) no pode prender o trabalho para sempre
+const int TENTATIVAS_POR_SHARD = 3;
+
+// Cria os shards (ou retoma um trabalho existente na mesma pasta), inicia workersLocais processos
+// de "executavel --worker" (com os ncleos do oramento de CPU divididos entre eles) e espera todos os
+// shards terminarem. Retorna 0 em caso de sucesso; desiste com erro se algum shard falhar
+// TENTATIVAS_POR_SHARD vezes ou se os workers locais terminarem com shards pendentes. Ao retomar um
+// trabalho, os shards falhos voltam para a fila.
+int executarCoordenador(Logger& logger, const TrabalhoDistribuido& trabalho, const std::string& pastaTrabalho,
+    int workersLocais, const std::string& executavel, int segundosShardAbandonado = SEGUNDOS_SHARD_ABANDONADO_PADRAO);
+
+// Processa shards da pasta de trabalho at no restar nenhum. Retorna 0 em caso de sucesso.
+int executarWorker(Logger& logger, const std::string& pastaTrabalho, const std::string& idWorker);
+
+// Junta as respostas de todos os shards concludos em <pastaTrabalho>/respostas.txt
+bool juntarShards(Logger& logger, const std::string& pastaTrabalho);
+
+// Identificador padro de um worker: nome da mquina mais um nmero nico do processo
+std::string idWorkerPadrao();
@@ -0,0 +1,177 @@
+#include "StageGraph.h"
+#include "CpuBudget.h"
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Etapa (ou fuso de duas) pronta para rodar
+struct UnidadeExecucao {
+    std::string nome;
+    std::vector<std::string> entradas;
+    std::vector<std::string> saidas;
+    std::function<void(Logger&)> executar;
+};
+
+static bool contem(const std::vector<std::string>& lista, const std::string& valor) {
+    return std::find(lista.begin(), lista.end(), valor) != lista.end();
+}
+
+void GrafoEtapas::adicionar(const EtapaGrafo& etapa) {
+    etapas.push_back(etapa);
+}
+
+void GrafoEtapas::adicionarFusao(const FusaoEtapas& fusao) {
+    fusoes.push_back(fusao);
+}
+
+int GrafoEtapas::produtor(const std::string& pasta) const {
+    for (int i = static_cast<int>(etapas.size()) - 1; i >= 0; i--) {
+        if (contem(etapas[i].saidas, pasta)) return i;
+    }
+    return -1;
+}
+
+std::vector<TempoEtapa> GrafoEtapas::executar(Logger& logger) const {
+    int n = static_cast<int>(etapas.size());
+    std::vector<TempoEtapa> tempos;
+
+    // Das etapas finais para trs: uma etapa ativa  necessria se uma etapa necessria l a sua sada
+    std::vector<bool> necessaria(n, false);
+    std::vector<int> pilha;
+    for (int i = 0; i < n; i++) {
+        if (etapas[i].ativa && etapas[i].final) {
+            necessaria[i] = true;
+            pilha.push_back(i);
+        }
+    }
+    while (!pilha.empty()) {
+        int i = pilha.back();
+        pilha.pop_back();
+        for (const auto& entrada : etapas[i].entradas) {
+            int p = produtor(entrada);
+            if (p >= 0 && etapas[p].ativa && !necessaria[p]) {
+                necessaria[p] = true;
+                pilha.push_back(p);
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (!necessaria[i]) {
+            TempoEtapa tempo;
+            tempo.nome = etapas[i].nome;
+            tempo.motivo = etapas[i].ativa ? "nenhuma etapa usa as sadas" : "desativada";
+            tempos.push_back(tempo);
+        }
+    }
+
+    // Fuses: a primeira etapa deixa de existir sozinha e a segunda roda as duas juntas
+    auto indice = [&](const std::string& nome) {
+        for (int i = 0; i < n; i++) if (etapas[i].nome == nome) return i;
+        return -1;
+    };
+    std::vector<int> fundidaEm(n, -1);
+    std::vector<UnidadeExecucao> unidadesFundidas(n);
+    for (const auto& fusao : fusoes) {
+        int a = indice(fusao.primeira);
+        int b = indice(fusao.segunda);
+        if (a < 0 || b < 0 || !necessaria[a] || !necessaria[b] || fundidaEm[a] >= 0 || fundidaEm[b] >= 0) continue;
+        bool soLeDaPrimeira = !etapas[b].entradas.empty();
+        for (const auto& entrada : etapas[b].entradas) {
+            if (produtor(entrada) != a) soLeDaPrimeira = false;
+        }
+        if (!soLeDaPrimeira) continue;
+
+        bool gravarIntermediaria = false;
+        for (int c = 0; c < n; c++) {
+            if (c == a || c == b || !necessaria[c]) continue;
+            for (const auto& saida : etapas[a].saidas) {
+                if (contem(etapas[c].entradas, saida)) gravarIntermediaria = true;
+            }
+        }
+
+        UnidadeExecucao unidade;
+        unidade.nome = etapas[a].nome + "+" + etapas[b].nome;
+        unidade.entradas = etapas[a].entradas;
+        if (gravarIntermediaria) {
+            unidade.saidas = etapas[a].saidas;
+        }
+        unidade.saidas.insert(unidade.saidas.end(), etapas[b].saidas.begin(), etapas[b].saidas.end());
+        auto executarFusao = fusao.executar;
+        unidade.executar = [executarFusao, gravarIntermediaria](Logger& l) { executarFusao(l, gravarIntermediaria); };
+        unidadesFundidas[b] = unidade;
+        fundidaEm[a] = b;
+        fundidaEm[b] = b;
+    }
+
+    std::vector<UnidadeExecucao> unidades;
+    for (int i = 0; i < n; i++) {
+        if (!necessaria[i] || (fundidaEm[i] >= 0 && fundidaEm[i] != i)) continue;
+        if (fundidaEm[i] == i) {
+            unidades.push_back(unidadesFundidas[i]);
+        }
+        else {
+            unidades.push_back({ etapas[i].nome, etapas[i].entradas, etapas[i].saidas, etapas[i].executar });
+        }
+    }
+
+    // Ordem topolgica estvel: entre as unidades prontas, a que foi declarada primeiro
+    size_t total = unidades.size();
+    std::vector<bool> executada(total, false);
+    for (size_t rodadas = 0; rodadas < total; rodadas++) {
+        int proxima = -1;
+        for (size_t u = 0; u < total && proxima < 0; u++) {
+            if (executada[u]) continue;
+            bool pronta = true;
+            for (size_t v = 0; v < total && pronta; v++) {
+                if (v == u || executada[v]) continue;
+                for (const auto& entrada : unidades[u].entradas) {
+                    if (contem(unidades[v].saidas, entrada)) pronta = false;
+                }
+            }
+            if (pronta) proxima = static_cast<int>(u);
+        }
+        if (proxima < 0) {
+            logger.AddLogMessage(LogLevel::Error, "Dependncia circular entre as etapas do pipeline.");
+            break;
+        }
+
+        const UnidadeExecucao& unidade = unidades[proxima];
+        for (const auto& entrada : unidade.entradas) {
+            std::error_code erro;
+            if (!fs::exists(entrada, erro)) {
+                logger.AddLogMessage(LogLevel::Warning, "Etapa " + unidade.nome + ": entrada no encontrada: " + entrada);
+            }
+        }
+
+        MedidorCpu medidor;
+        unidade.executar(logger);
+        executada[proxima] = true;
+
+        TempoEtapa tempo;
+        tempo.nome = unidade.nome;
+        tempo.executada = true;
+        tempo.milissegundos = medidor.milissegundos();
+        tempo.cpuMs = medidor.cpuMs();
+        tempo.utilizacao = medidor.utilizacao();
+        tempos.push_back(tempo);
+    }
+
+    // Resumo no fim, uma linha por etapa
+    for (const auto& tempo : tempos) {
+        std::ostringstream linha;
+        linha << "Etapa " << tempo.nome << ": ";
+        if (tempo.executada) {
+            linha << std::fixed << std::setprecision(0) << tempo.milissegundos << " ms, CPU " << tempo.utilizacao * 100.0
+                << "% de " << orcamentoCpu().nucleos << " ncleos";
+        }
+        else {
+            linha << "no executada (" << tempo.motivo << ")";
+        }
+        logger.AddLogMessage(LogLevel::Info, linha.str());
+    }
+    return tempos;
+}
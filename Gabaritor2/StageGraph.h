@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Logger.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// Grafo das etapas do pipeline em pastas. Cada etapa declara as pastas que l e as que grava; a ordem
+// de execuo sai das dependncias, no da ordem em que as etapas foram escritas.
+//
+// - Uma etapa desativada (os "Skip ..." da interface) no roda e as suas pastas de uma execuo
+//   anterior so reaproveitadas por quem depende delas.
+// - Uma etapa ativa s roda se for final ou se alguma etapa que vai rodar ler uma das suas sadas.
+// - Duas etapas com uma fuso registrada, que vo rodar e em que a segunda l s a sada da primeira,
+//   viram uma etapa s. A pasta intermediria s  gravada se mais algum a l.
+
+struct EtapaGrafo {
+    std::string nome;
+    std::vector<std::string> entradas;   // Pastas lidas; sem etapa que as produza, precisam existir
+    std::vector<std::string> saidas;     // Pastas gravadas
+    bool ativa = true;
+    bool final = false;                  // Produz o resultado do lote (roda mesmo sem ningum ler as sadas)
+    std::function<void(Logger&)> executar;
+};
+
+struct FusaoEtapas {
+    std::string primeira;
+    std::string segunda;
+    // gravarIntermediaria: outra etapa que vai rodar l as sadas de primeira
+    std::function<void(Logger&, bool gravarIntermediaria)> executar;
+};
+
+struct TempoEtapa {
+    std::string nome;            // Fuses aparecem como "primeira+segunda"
+    bool executada = false;
+    std::string motivo;          // Por que no rodou
+    double milissegundos = 0;
+    double cpuMs = 0;            // Tempo de CPU do processo durante a etapa
+    double utilizacao = 0;       // Frao dos ncleos do oramento de CPU ocupada (CpuBudget.h)
+};
+
+class GrafoEtapas {
+public:
+    void adicionar(const EtapaGrafo& etapa);
+    void adicionarFusao(const FusaoEtapas& fusao);
+
+    // Executa as etapas necessrias em ordem de dependncia e registra o tempo e o uso de CPU de cada uma no logger.
+    // Retorna uma entrada por etapa (ou fuso), incluindo as que no rodaram.
+    std::vector<TempoEtapa> executar(Logger& logger) const;
+
+private:
+    int produtor(const std::string& pasta) const;
+
+    std::vector<EtapaGrafo> etapas;
+    std::vector<FusaoEtapas> fusoes;
+};
@@ -0,0 +1,185 @@
+#include "TemplateRegistry.h"
+#include "LocalRegistration.h"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+bool TemplateRegistry::adicionar(Logger& logger, const std::string& nome, const std::string& referenceImagePath, const std::string& coordinatesFilePath) {
+    cv::Mat imagem = cv::imread(referenceImagePath);
+    if (imagem.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Error loading reference image from path: " + referenceImagePath);
+        return false;
+    }
+
+    if (!adicionar(logger, nome, imagem, coordinatesFilePath)) {
+        return false;
+    }
+    modelos.back().referenceImagePath = referenceImagePath;
+    return true;
+}
+
+bool TemplateRegistry::adicionar(Logger& logger, const std::string& nome, const cv::Mat& imagem, const std::string& coordinatesFilePath) {
+    ModeloGabarito modelo;
+    modelo.nome = nome;
+    modelo.coordinatesFilePath = coordinatesFilePath;
+
+    if (imagem.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Imagem de referncia vazia para o modelo: " + nome);
+        return false;
+    }
+
+    if (!coordinatesFilePath.empty()) {
+        modelo.rectangles = loadAnswerRectangles(coordinatesFilePath);
+        if (modelo.rectangles.empty()) {
+            logger.AddLogMessage(LogLevel::Error, "Failed to load answer areas from file: " + coordinatesFilePath);
+            return false;
+        }
+    }
+
+    // Tudo que depende s da referncia  calculado uma vez aqui, no por pgina
+    modelo.alinhamento = prepararReferenciaAlinhamento(imagem);
+    modelo.miniatura = criarMiniatura(imagem);
+    modelo.mapaRegistro = criarMapaRegistro(imagem);
+    modelos.push_back(std::move(modelo));
+    return true;
+}
+
+static std::string aparar(const std::string& texto) {
+    size_t inicio = texto.find_first_not_of(" \t\r");
+    if (inicio == std::string::npos) return "";
+    size_t fim = texto.find_last_not_of(" \t\r");
+    return texto.substr(inicio, fim - inicio + 1);
+}
+
+bool TemplateRegistry::carregarLista(Logger& logger, const std::string& arquivoLista) {
+    std::ifstream arquivo(arquivoLista);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "Erro ao abrir a lista de modelos: " + arquivoLista);
+        return false;
+    }
+
+    modelos.clear();
+    std::string linha;
+    while (std::getline(arquivo, linha)) {
+        linha = aparar(linha);
+        if (linha.empty() || linha[0] == '#') continue;
+
+        std::istringstream campos(linha);
+        std::string nome, referencia, coordenadas;
+        std::getline(campos, nome, ';');
+        std::getline(campos, referencia, ';');
+        std::getline(campos, coordenadas);
+        if (!adicionar(logger, aparar(nome), aparar(referencia), aparar(coordenadas))) {
+            return false;
+        }
+    }
+
+    if (modelos.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Nenhum modelo na lista: " + arquivoLista);
+        return false;
+    }
+
+    logger.AddLogMessage(LogLevel::Info, std::to_string(modelos.size()) + " modelos carregados de " + arquivoLista);
+    return true;
+}
+
+bool TemplateRegistry::carregar(Logger& logger, const std::string& arquivoLista, const std::string& referenceImagePath, const std::string& coordinatesFilePath) {
+    if (!arquivoLista.empty()) {
+        return carregarLista(logger, arquivoLista);
+    }
+    modelos.clear();
+    return adicionar(logger, "referencia", referenceImagePath, coordinatesFilePath);
+}
+
+RoteamentoPagina TemplateRegistry::rotear(const MiniaturaPagina& pagina) const {
+    RoteamentoPagina roteamento{ -1, { TipoPagina::NaoResposta, pagina.coberturaTinta, 0.0 } };
+
+    for (size_t i = 0; i < modelos.size(); i++) {
+        ClassificacaoPagina classificacao = classificarPagina(pagina, modelos[i].miniatura);
+        if (classificacao.tipo == TipoPagina::EmBranco) {
+            // Cobertura de tinta no depende do modelo
+            roteamento.classificacao = classificacao;
+            return roteamento;
+        }
+        if (roteamento.modelo < 0 || classificacao.similaridade > roteamento.classificacao.similaridade) {
+            roteamento.modelo = static_cast<int>(i);
+            roteamento.classificacao = classificacao;
+        }
+    }
+    return roteamento;
+}
+
+int TemplateRegistry::indice(const std::string& nome) const {
+    for (size_t i = 0; i < modelos.size(); i++) {
+        if (modelos[i].nome == nome) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+void salvarModelosPaginas(Logger& logger, const std::string& pasta, std::vector<std::pair<std::string, std::string>> modelosPaginas) {
+    if (!criarDiretorio(logger, pasta)) {
+        return;
+    }
+
+    std::sort(modelosPaginas.begin(), modelosPaginas.end(), [](const auto& a, const auto& b) {
+        return numeroDaPaginaDoArquivo(a.first) < numeroDaPaginaDoArquivo(b.first);
+    });
+
+    std::string caminho = pasta + "/" + ARQUIVO_MODELOS_PAGINAS;
+    std::ofstream arquivo(caminho);
+    if (!arquivo.is_open()) {
+        logger.AddLogMessage(LogLevel::Error, "Erro ao abrir o arquivo de modelos das pginas: " + caminho);
+        return;
+    }
+
+    for (const auto& modeloPagina : modelosPaginas) {
+        arquivo << modeloPagina.first << ": " << modeloPagina.second << "\n";
+    }
+}
+
+std::map<std::string, std::string> lerModelosPaginas(const std::string& pasta) {
+    std::map<std::string, std::string> modelosPaginas;
+    std::ifstream arquivo(pasta + "/" + ARQUIVO_MODELOS_PAGINAS);
+
+    std::string linha;
+    while (std::getline(arquivo, linha)) {
+        size_t pos = linha.find(':');
+        if (pos == std::string::npos) continue;
+        modelosPaginas[linha.substr(0, pos)] = aparar(linha.substr(pos + 1));
+    }
+    return modelosPaginas;
+}
+
+GeometriaPorPagina::GeometriaPorPagina(const std::vector<RectangleData>& padrao, const TemplateRegistry* modelos, const std::string& pastaRoteamento)
+    : padrao(padrao), modelos(modelos) {
+    if (modelos != nullptr && !pastaRoteamento.empty()) {
+        modelosPaginas = lerModelosPaginas(pastaRoteamento);
+    }
+}
+
+const std::vector<RectangleData>& GeometriaPorPagina::para(const std::string& fileName) const {
+    if (modelos != nullptr) {
+        auto it = modelosPaginas.find(fileName);
+        if (it != modelosPaginas.end()) {
+            int indice = modelos->indice(it->second);
+            if (indice >= 0 && !modelos->modelo(indice).rectangles.empty()) {
+                return modelos->modelo(indice).rectangles;
+            }
+        }
+    }
+    return padrao;
+}
+
+std::string GeometriaPorPagina::nomeModelo(const std::string& fileName) const {
+    if (&para(fileName) == &padrao) return "";
+    return modelosPaginas.find(fileName)->second;
+}
+
+bool GeometriaPorPagina::vazia() const {
+    if (!padrao.empty()) return false;
+    if (modelos == nullptr) return true;
+    for (size_t i = 0; i < modelos->size(); i++) {
+        if (!modelos->modelo(static_cast<int>(i)).rectangles.empty()) return false;
+    }
+    return true;
+}
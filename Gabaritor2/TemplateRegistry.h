@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ImageProcessing.h"
+#include "PageTriage.h"
+#include <map>
+
+// Arquivo com o modelo escolhido para cada pgina, gravado na pasta de sada do alinhamento
+const std::string ARQUIVO_MODELOS_PAGINAS = "modelos_paginas.txt";
+
+// Um modelo de prova (verso): referncia com as features de alinhamento e a miniatura de
+// roteamento j calculadas, e a geometria das regies j lida do arquivo de coordenadas
+struct ModeloGabarito {
+    std::string nome;
+    std::string referenceImagePath;
+    std::string coordinatesFilePath;
+    ReferenciaAlinhamento alinhamento;
+    MiniaturaPagina miniatura;
+    cv::Mat mapaRegistro;  // Mapa de tinta do registro local das regies (LocalRegistration.h)
+    std::vector<RectangleData> rectangles;
+};
+
+struct RoteamentoPagina {
+    int modelo;                        // ndice do modelo mais parecido, -1 se a pgina est em branco
+    ClassificacaoPagina classificacao;  // Classificao contra esse modelo
+};
+
+// Registro dos modelos de uma execuo. Cada pgina  roteada para o modelo cuja miniatura
+// tem a maior correlao com a dela, o que permite misturar verses da prova no mesmo lote.
+class TemplateRegistry {
+public:
+    // coordinatesFilePath pode ser vazio quando o modelo s  usado para alinhar
+    bool adicionar(Logger& logger, const std::string& nome, const std::string& referenceImagePath, const std::string& coordinatesFilePath);
+    // Referncia j em memria (BGR)
+    bool adicionar(Logger& logger, const std::string& nome, const cv::Mat& referencia, const std::string& coordinatesFilePath);
+
+    // L uma lista de modelos, uma linha "nome;imagem de referncia;arquivo de coordenadas" por modelo.
+    // Linhas vazias e comeando com '#' so ignoradas.
+    bool carregarLista(Logger& logger, const std::string& arquivoLista);
+
+    // Carrega a lista de modelos, ou, se arquivoLista for vazio, um nico modelo com a referncia e as coordenadas
+    bool carregar(Logger& logger, const std::string& arquivoLista, const std::string& referenceImagePath, const std::string& coordinatesFilePath);
+
+    RoteamentoPagina rotear(const MiniaturaPagina& pagina) const;
+
+    const ModeloGabarito& modelo(int indice) const { return modelos[indice]; }
+    int indice(const std::string& nome) const;
+    size_t size() const { return modelos.size(); }
+    bool empty() const { return modelos.empty(); }
+    void limpar() { modelos.clear(); }
+
+private:
+    std::vector<ModeloGabarito> modelos;
+};
+
+// Relatrio "page_N.png: nome do modelo", uma linha por pgina alinhada
+void salvarModelosPaginas(Logger& logger, const std::string& pasta, std::vector<std::pair<std::string, std::string>> modelosPaginas);
+std::map<std::string, std::string> lerModelosPaginas(const std::string& pasta);
+
+// Escolhe a geometria de cada pgina nas etapas de leitura: a do modelo roteado para ela
+// (conforme ARQUIVO_MODELOS_PAGINAS) ou, na falta dele, a geometria padro
+class GeometriaPorPagina {
+public:
+    GeometriaPorPagina(const std::vector<RectangleData>& padrao, const TemplateRegistry* modelos, const std::string& pastaRoteamento);
+
+    const std::vector<RectangleData>& para(const std::string& fileName) const;
+    std::string nomeModelo(const std::string& fileName) const;  // Vazio para a geometria padro
+    bool vazia() const;
+
+private:
+    const std::vector<RectangleData>& padrao;
+    const TemplateRegistry* modelos;
+    std::map<std::string, std::string> modelosPaginas;
+};
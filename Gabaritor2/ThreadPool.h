@@ -0,0 +1,166 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Pool de threads simples para paralelizar laos (pginas, blocos, regies).
+// A thread que chama parallelFor tambm executa itens, ento chamadas aninhadas
+// (por exemplo, blocos dentro de uma pgina que j roda em um worker) no travam.
+class ThreadPool {
+public:
+    // aoIniciarWorker (se houver) roda em cada worker antes do primeiro item, com o ndice do worker
+    explicit ThreadPool(unsigned numThreads = std::thread::hardware_concurrency(), std::function<void(int)> aoIniciarWorker = nullptr)
+        : aoIniciarWorker(std::move(aoIniciarWorker)) {
+        if (numThreads == 0) numThreads = 1;
+        for (unsigned i = 0; i < numThreads; ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, static_cast<int>(i));
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCondition.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Nmero de ndices de worker possveis: os workers do pool mais a thread externa
+    int slots() const { return static_cast<int>(workers.size()) + 1; }
+
+    // ndice do worker da thread atual (threads externas ao pool usam size())
+    int currentSlot() const { return currentWorker() >= 0 ? currentWorker() : static_cast<int>(workers.size()); }
+
+    // Executa func(indice, slot) para cada indice em [0, count) e bloqueia at todos terminarem
+    void parallelFor(int count, const std::function<void(int, int)>& func) {
+        if (count <= 0) return;
+        if (count == 1 || workers.empty()) {
+            int slot = currentSlot();
+            for (int i = 0; i < count; ++i) func(i, slot);
+            return;
+        }
+
+        auto job = std::make_shared<Job>();
+        job->count = count;
+        job->func = &func;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            jobs.push_back(job);
+        }
+        queueCondition.notify_all();
+
+        runJob(*job, currentSlot());
+
+        std::unique_lock<std::mutex> lock(job->doneMutex);
+        job->doneCondition.wait(lock, [&job] { return job->done.load() == job->count; });
+    }
+
+    // Pool compartilhado pelo processo, com o tamanho de prepararGlobal (ou um worker por ncleo)
+    static ThreadPool& global() {
+        static ThreadPool pool(fecharConfiguracaoGlobal());
+        return pool;
+    }
+
+    // Define o tamanho do pool global e o ajuste de cada worker (o oramento de CPU, CpuBudget.h).
+    // S vale antes do primeiro global(); depois retorna false e o pool fica como est.
+    static bool prepararGlobal(unsigned numThreads, std::function<void(int)> aoIniciarWorker = nullptr) {
+        std::lock_guard<std::mutex> lock(mutexConfiguracaoGlobal());
+        ConfiguracaoGlobal& configuracao = configuracaoGlobal();
+        if (configuracao.criado) return false;
+        configuracao.numThreads = numThreads;
+        configuracao.aoIniciarWorker = std::move(aoIniciarWorker);
+        return true;
+    }
+
+private:
+    struct ConfiguracaoGlobal {
+        unsigned numThreads = std::thread::hardware_concurrency();
+        std::function<void(int)> aoIniciarWorker;
+        bool criado = false;
+    };
+
+    explicit ThreadPool(const ConfiguracaoGlobal& configuracao) : ThreadPool(configuracao.numThreads, configuracao.aoIniciarWorker) {}
+
+    static ConfiguracaoGlobal& configuracaoGlobal() {
+        static ConfiguracaoGlobal configuracao;
+        return configuracao;
+    }
+
+    static std::mutex& mutexConfiguracaoGlobal() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Marca o pool global como criado e devolve a configurao com que ele  criado
+    static ConfiguracaoGlobal fecharConfiguracaoGlobal() {
+        std::lock_guard<std::mutex> lock(mutexConfiguracaoGlobal());
+        configuracaoGlobal().criado = true;
+        return configuracaoGlobal();
+    }
+
+    struct Job {
+        int count = 0;
+        const std::function<void(int, int)>* func = nullptr;
+        std::atomic<int> next{ 0 };
+        std::atomic<int> done{ 0 };
+        std::mutex doneMutex;
+        std::condition_variable doneCondition;
+    };
+
+    static int& currentWorker() {
+        thread_local int worker = -1;
+        return worker;
+    }
+
+    static void runJob(Job& job, int slot) {
+        int index;
+        while ((index = job.next.fetch_add(1)) < job.count) {
+            (*job.func)(index, slot);
+            if (job.done.fetch_add(1) + 1 == job.count) {
+                std::lock_guard<std::mutex> lock(job.doneMutex);
+                job.doneCondition.notify_all();
+            }
+        }
+    }
+
+    void workerLoop(int index) {
+        currentWorker() = index;
+        if (aoIniciarWorker) aoIniciarWorker(index);
+        for (;;) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) return;
+                job = jobs.front();
+                // Remove da fila quando no h mais ndices para distribuir
+                if (job->next.load() >= job->count) {
+                    jobs.pop_front();
+                    continue;
+                }
+            }
+            runJob(*job, index);
+        }
+    }
+
+    std::function<void(int)> aoIniciarWorker;
+    std::vector<std::thread> workers;
+    std::deque<std::shared_ptr<Job>> jobs;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+};
@@ -0,0 +1,117 @@
+#include "TileExecutor.h"
+#include "ThreadPool.h"
+#include <cfloat>
+#include <algorithm>
+#include <vector>
+
+int numeroDeBlocos(const cv::Size& tamanhoImagem, int tileWidth, int tileHeight) {
+    if (tamanhoImagem.width <= 0 || tamanhoImagem.height <= 0) return 0;
+    return ((tamanhoImagem.width + tileWidth - 1) / tileWidth) * ((tamanhoImagem.height + tileHeight - 1) / tileHeight);
+}
+
+void executarEmBlocos(const cv::Size& tamanhoImagem, int halo,
+    const std::function<void(int indice, const cv::Rect& bloco, const cv::Rect& blocoComHalo)>& kernel,
+    int tileWidth, int tileHeight) {
+    if (tamanhoImagem.width <= 0 || tamanhoImagem.height <= 0) return;
+
+    int blocosX = (tamanhoImagem.width + tileWidth - 1) / tileWidth;
+    int blocosY = (tamanhoImagem.height + tileHeight - 1) / tileHeight;
+    cv::Rect limites(0, 0, tamanhoImagem.width, tamanhoImagem.height);
+
+    ThreadPool::global().parallelFor(blocosX * blocosY, [&](int indice, int) {
+        int bx = indice % blocosX;
+        int by = indice / blocosX;
+        cv::Rect bloco = cv::Rect(bx * tileWidth, by * tileHeight, tileWidth, tileHeight) & limites;
+
+        // Expande o bloco pelo halo, sem sair da imagem
+        cv::Rect blocoComHalo(bloco.x - halo, bloco.y - halo, bloco.width + 2 * halo, bloco.height + 2 * halo);
+        blocoComHalo &= limites;
+
+        kernel(indice, bloco, blocoComHalo);
+    });
+}
+
+void adaptiveThresholdEmBlocos(const cv::Mat& src, cv::Mat& dst, double maxValue, int adaptiveMethod, int thresholdType, int blockSize, double C) {
+    dst.create(src.size(), CV_8UC1);
+
+    // A mdia local usa uma janela blockSize x blockSize com BORDER_REPLICATE isolado na ROI.
+    // Com halo = blockSize / 2 os pixels internos do bloco s enxergam dados reais, e nas
+    // bordas da imagem a ROI termina junto com a imagem, ento a replicao  a mesma.
+    int halo = blockSize / 2;
+    executarEmBlocos(src.size(), halo, [&](int, const cv::Rect& bloco, const cv::Rect& blocoComHalo) {
+        cv::Mat resultado;
+        cv::adaptiveThreshold(src(blocoComHalo), resultado, maxValue, adaptiveMethod, thresholdType, blockSize, C);
+        cv::Rect interno(bloco.x - blocoComHalo.x, bloco.y - blocoComHalo.y, bloco.width, bloco.height);
+        resultado(interno).copyTo(dst(bloco));
+    });
+}
+
+void cvtColorEmBlocos(const cv::Mat& src, cv::Mat& dst, int code, int dstChannels) {
+    // Converso de cor  por pixel, no precisa de halo. Se dst for a prpria src (converso
+    // in-place com mudana de canais), usa um buffer novo.
+    cv::Mat saida(src.size(), CV_MAKETYPE(src.depth(), dstChannels));
+    executarEmBlocos(src.size(), 0, [&](int, const cv::Rect& bloco, const cv::Rect&) {
+        cv::Mat destino = saida(bloco);
+        cv::cvtColor(src(bloco), destino, code);
+    });
+    dst = saida;
+}
+
+void calcularHistogramaEmBlocos(const cv::Mat& gray, int histograma[256]) {
+    std::fill(histograma, histograma + 256, 0);
+
+    // Um histograma parcial por bloco, somado no final (soma de inteiros, ordem no importa)
+    std::vector<std::vector<int>> parciais(numeroDeBlocos(gray.size()), std::vector<int>(256, 0));
+
+    executarEmBlocos(gray.size(), 0, [&](int indice, const cv::Rect& bloco, const cv::Rect&) {
+        std::vector<int>& parcial = parciais[indice];
+        for (int y = bloco.y; y < bloco.y + bloco.height; y++) {
+            const uchar* linha = gray.ptr<uchar>(y);
+            for (int x = bloco.x; x < bloco.x + bloco.width; x++) {
+                parcial[linha[x]]++;
+            }
+        }
+    });
+
+    for (const auto& parcial : parciais) {
+        for (int i = 0; i < 256; i++) {
+            histograma[i] += parcial[i];
+        }
+    }
+}
+
+// Mesmo clculo de getThreshVal_Otsu_8u do OpenCV, a partir de um histograma j pronto,
+// para que o threshold seja idntico ao de cv::threshold(..., THRESH_OTSU)
+double calcularThresholdOtsu(const int histograma[256], int totalPixels) {
+    double mu = 0, scale = 1. / totalPixels;
+    for (int i = 0; i < 256; i++) {
+        mu += i * (double)histograma[i];
+    }
+    mu *= scale;
+
+    double mu1 = 0, q1 = 0;
+    double maxSigma = 0, maxVal = 0;
+
+    for (int i = 0; i < 256; i++) {
+        double p_i, q2, mu2, sigma;
+
+        p_i = histograma[i] * scale;
+        mu1 *= q1;
+        q1 += p_i;
+        q2 = 1. - q1;
+
+        if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1. - FLT_EPSILON) {
+            continue;
+        }
+
+        mu1 = (mu1 + i * p_i) / q1;
+        mu2 = (mu - q1 * mu1) / q2;
+        sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+        if (sigma > maxSigma) {
+            maxSigma = sigma;
+            maxVal = i;
+        }
+    }
+
+    return maxVal;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <functional>
+
+// Tamanho padro dos blocos: ~200 KB por bloco em BGR 8 bits, cabe no cache L2
+const int TILE_WIDTH_PADRAO = 256;
+const int TILE_HEIGHT_PADRAO = 256;
+
+// Divide uma imagem em blocos e executa o kernel de cada bloco no ThreadPool global.
+// "bloco"  a rea que o kernel deve escrever; "blocoComHalo"  o bloco expandido
+// por "halo" pixels (limitado s bordas da imagem) que o kernel pode ler.
+// "indice" vai de 0 a numeroDeBlocos() - 1, til para acumular resultados parciais.
+void executarEmBlocos(const cv::Size& tamanhoImagem, int halo,
+    const std::function<void(int indice, const cv::Rect& bloco, const cv::Rect& blocoComHalo)>& kernel,
+    int tileWidth = TILE_WIDTH_PADRAO, int tileHeight = TILE_HEIGHT_PADRAO);
+int numeroDeBlocos(const cv::Size& tamanhoImagem, int tileWidth = TILE_WIDTH_PADRAO, int tileHeight = TILE_HEIGHT_PADRAO);
+
+// Verses em blocos dos kernels por pixel. O resultado  idntico bit a bit ao da verso sem blocos.
+void adaptiveThresholdEmBlocos(const cv::Mat& src, cv::Mat& dst, double maxValue, int adaptiveMethod, int thresholdType, int blockSize, double C);
+void cvtColorEmBlocos(const cv::Mat& src, cv::Mat& dst, int code, int dstChannels);
+void calcularHistogramaEmBlocos(const cv::Mat& gray, int histograma[256]);
+double calcularThresholdOtsu(const int histograma[256], int totalPixels);
@@ -0,0 +1,258 @@
+#include "TwoPassReading.h"
+#include "ThreadPool.h"
+#include "PageTriage.h"
+#include "TemplateRegistry.h"
+#include "ResultStream.h"
+#include "ScanInput.h"
+#include "PdfImages.h"
+#include "MeasurementStore.h"
+#include "PackedPage.h"
+#include "LocalRegistration.h"
+#include <poppler/cpp/poppler-document.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+// Mesmo encadeamento das etapas do pipeline em pastas (alinhamento, reduo de rudo,
+// binarizao e leitura), mas com a pgina em memria
+static std::vector<LeituraQuestao> lerPaginaEmMemoria(Logger& logger, const cv::Mat& pagina, const ReferenciaAlinhamento& referencia,
+    const cv::Mat& mapaReferencia, const std::vector<RectangleData>& rectangles, const ParametrosLeitura& parametros, cv::Mat* imagemLida = nullptr,
+    MedicoesPagina* medicoes = nullptr) {
+    cv::Mat imagem;
+    if (pagina.channels() == 4) {
+        cv::cvtColor(pagina, imagem, cv::COLOR_BGRA2BGR);
+    }
+    else {
+        imagem = pagina;
+    }
+
+    cv::Mat alignedImage, h;
+    double qualidade = 0;
+    alignImagesORB(imagem, referencia, alignedImage, h, &qualidade);
+    if (alignedImage.empty()) {
+        return {};
+    }
+    if (medicoes != nullptr) {
+        medicoes->qualidadeAlinhamento = static_cast<float>(qualidade);
+    }
+
+    PaginaBits paginaBinarizada = reduzirRuidoEBinarizar(alignedImage);
+    if (imagemLida != nullptr) {
+        *imagemLida = reduzirPagina(paginaBinarizada, LARGURA_MINIATURA_PROGRESSO);
+    }
+    // O mapa de registro  normalizado pela largura: o mesmo serve para os dois DPIs
+    std::vector<RectangleData> regioes = registrarRegioes(paginaBinarizada, mapaReferencia, rectangles, parametrosPipeline().raioRegistroLocal);
+    return readAnswersWithConfidence(paginaBinarizada, regioes, logger, parametros, medicoes);
+}
+
+// Em branco e mltipla marcao tambm tm confiana (a folga at o threshold): s as perto do limite so relidas
+static bool precisaReler(const std::vector<LeituraQuestao>& leituras, float limiar) {
+    if (leituras.empty()) return true;
+    for (const auto& leitura : leituras) {
+        if (leitura.confianca < limiar) return true;
+    }
+    return false;
+}
+
+void processarPdfDuasPassadas(Logger& logger, const std::string& filenamePdf, const std::string& referenceImagePath,
+    const std::string& coordinatesFilePath, const std::string& outputFolder, const ConfiguracaoDuasPassadas& configuracao,
+    ProgressoLeitura* progresso) {
+    TemplateRegistry modelos;
+    if (!modelos.adicionar(logger, "referencia", referenceImagePath, coordinatesFilePath)) {
+        return;
+    }
+    processarPdfDuasPassadas(logger, filenamePdf, modelos, outputFolder, configuracao, progresso);
+}
+
+// Ncleo comum ao PDF e s digitalizaes: renderizar(i, dpi) devolve a pgina i na resoluo
+// pedida (vazia se no pde ser lida) e pode ser chamada de vrias threads
+static void lerPaginasDuasPassadas(Logger& logger, int num_pages, const std::function<cv::Mat(int, int)>& renderizar,
+    const TemplateRegistry& modelos, const std::string& outputFolder, const ConfiguracaoDuasPassadas& configuracao, ProgressoLeitura* progresso) {
+    for (size_t m = 0; m < modelos.size(); m++) {
+        if (modelos.modelo(static_cast<int>(m)).rectangles.empty()) {
+            logger.AddLogMessage(LogLevel::Error, "Modelo sem arquivo de coordenadas: " + modelos.modelo(static_cast<int>(m)).nome);
+            return;
+        }
+    }
+    if (modelos.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Nenhum modelo de referncia carregado.");
+        return;
+    }
+
+    if (!criarDiretorio(logger, outputFolder)) {
+        return;
+    }
+    ArquivoMedicoes arquivoMedicoes;
+    arquivoMedicoes.abrir(logger, outputFolder);
+
+    // Referncias (com as features ORB) e margens reduzidas na mesma proporo do DPI baixo
+    double fator = static_cast<double>(configuracao.dpiBaixo) / configuracao.dpiAlto;
+    std::vector<ReferenciaAlinhamento> referenciasBaixas;
+    for (size_t m = 0; m < modelos.size(); m++) {
+        cv::Mat referenciaBaixa;
+        cv::resize(modelos.modelo(static_cast<int>(m)).alinhamento.imagem, referenciaBaixa, cv::Size(), fator, fator, cv::INTER_AREA);
+        referenciasBaixas.push_back(prepararReferenciaAlinhamento(referenciaBaixa));
+    }
+    ParametrosLeitura parametrosAltos = parametrosPipeline().leitura;
+    ParametrosLeitura parametrosBaixos = parametrosAltos.escalados(fator);
+
+    // Os nomes dos arquivos usam a numerao do PDF inteiro, mesmo lendo s um intervalo
+    int primeiraPagina = std::max(configuracao.primeiraPagina, 0);
+    int ultimaPagina = configuracao.ultimaPagina < 0 ? num_pages - 1 : std::min(configuracao.ultimaPagina, num_pages - 1);
+    int paginasLidas = std::max(ultimaPagina - primeiraPagina + 1, 0);
+    // Com os dois DPIs iguais no h o que ganhar relendo
+    bool escalonar = configuracao.dpiAlto > configuracao.dpiBaixo;
+    if (progresso != nullptr) {
+        progresso->iniciar(paginasLidas);
+    }
+
+    std::atomic<int> paginasRelidas{ 0 };
+    std::atomic<int> questoesRelidas{ 0 };
+    std::mutex relatoriosMutex;
+    std::vector<PaginaIgnorada> paginasIgnoradas;
+    std::vector<std::pair<std::string, std::string>> modelosPaginas;
+
+    ThreadPool::global().parallelFor(paginasLidas, [&](int k, int) {
+        int i = primeiraPagina + k;
+        std::string fileName = "page_" + std::to_string(i + 1) + ".png";
+
+        // Pginas que no puderam ser lidas ou alinhadas entram no relatrio de ignoradas com o motivo
+        auto registrarFalha = [&](const ClassificacaoPagina& classificacao) {
+            if (progresso != nullptr) {
+                progresso->publicar(resultadoPaginaIgnorada(fileName, classificacao));
+            }
+            std::lock_guard<std::mutex> lock(relatoriosMutex);
+            paginasIgnoradas.push_back({ fileName, classificacao });
+        };
+
+        cv::Mat paginaBaixa = renderizar(i, configuracao.dpiBaixo);
+        if (paginaBaixa.empty()) {
+            logger.AddLogMessage(LogLevel::Error, "Error loading page " + std::to_string(i + 1));
+            registrarFalha({ TipoPagina::Ilegivel, 0.0, 0.0 });
+            return;
+        }
+
+        int indiceModelo = 0;
+        ClassificacaoPagina classificacao{ TipoPagina::Resposta, 0.0, 0.0 };
+        if (configuracao.triarPaginas || modelos.size() > 1) {
+            RoteamentoPagina roteamento = modelos.rotear(criarMiniatura(paginaBaixa));
+            if (configuracao.triarPaginas && roteamento.classificacao.tipo != TipoPagina::Resposta) {
+                if (progresso != nullptr) {
+                    progresso->publicar(resultadoPaginaIgnorada(fileName, roteamento.classificacao));
+                }
+                std::lock_guard<std::mutex> lock(relatoriosMutex);
+                paginasIgnoradas.push_back({ fileName, roteamento.classificacao });
+                return;
+            }
+            indiceModelo = std::max(roteamento.modelo, 0);
+            classificacao = roteamento.classificacao;
+        }
+        const ModeloGabarito& modelo = modelos.modelo(indiceModelo);
+        const std::vector<RectangleData>& rectangles = modelo.rectangles;
+
+        cv::Mat paginaLida;
+        MedicoesPagina medicoes;
+        MedicoesPagina* medir = arquivoMedicoes.aberto() ? &medicoes : nullptr;
+        std::vector<LeituraQuestao> leituras = lerPaginaEmMemoria(logger, paginaBaixa, referenciasBaixas[indiceModelo], modelo.mapaRegistro, rectangles, parametrosBaixos,
+            progresso != nullptr ? &paginaLida : nullptr, medir);
+
+        if (escalonar && precisaReler(leituras, configuracao.limiarConfianca)) {
+            cv::Mat paginaAlta = renderizar(i, configuracao.dpiAlto);
+
+            cv::Mat paginaLidaAlta;
+            MedicoesPagina medicoesAltas;
+            std::vector<LeituraQuestao> leiturasAltas;
+            if (!paginaAlta.empty()) {
+                leiturasAltas = lerPaginaEmMemoria(logger, paginaAlta, modelo.alinhamento, modelo.mapaRegistro, rectangles, parametrosAltos,
+                    progresso != nullptr ? &paginaLidaAlta : nullptr, medir != nullptr ? &medicoesAltas : nullptr);
+            }
+            paginasRelidas++;
+
+            // Uma releitura que falhou (renderizao ou alinhamento) nunca descarta a leitura em DPI baixo;
+            // a leitura inteira s  trocada quando a de DPI baixo falhou. Nos outros casos, s as questes
+            // duvidosas so substitudas pela leitura em DPI alto (junto com as medies delas).
+            if (leiturasAltas.empty()) {
+                logger.AddLogMessage(LogLevel::Warning, "Releitura em " + std::to_string(configuracao.dpiAlto) + " DPI falhou, mantida a leitura em DPI baixo: " + fileName);
+            }
+            else if (leituras.empty()) {
+                leituras = std::move(leiturasAltas);
+                medicoes = std::move(medicoesAltas);
+                paginaLida = paginaLidaAlta;
+            }
+            else if (leituras.size() == leiturasAltas.size()) {
+                paginaLida = paginaLidaAlta;
+                for (size_t q = 0; q < leituras.size(); q++) {
+                    if (leituras[q].confianca < configuracao.limiarConfianca) {
+                        leituras[q] = leiturasAltas[q];
+                        if (medir != nullptr) medicoes.questoes[q] = medicoesAltas.questoes[q];
+                        questoesRelidas++;
+                    }
+                }
+                medicoes.qualidadeAlinhamento = medicoesAltas.qualidadeAlinhamento;
+            }
+        }
+
+        if (leituras.empty()) {
+            logger.AddLogMessage(LogLevel::Error, "Error aligning image: " + fileName);
+            classificacao.tipo = TipoPagina::NaoAlinhada;
+            registrarFalha(classificacao);
+            return;
+        }
+
+        if (progresso != nullptr) {
+            progresso->publicar(montarResultadoParcial(fileName, modelo.nome, rectangles, leituras, paginaLida, progresso->limiarDuvida));
+        }
+
+        salvarRespostas(logger, outputFolder, fileName, rectangles, leituras);
+        if (medir != nullptr) {
+            medicoes.fileName = fileName;
+            medicoes.modelo = modelo.nome;
+            arquivoMedicoes.gravar(medicoes);
+        }
+        std::lock_guard<std::mutex> lock(relatoriosMutex);
+        modelosPaginas.emplace_back(fileName, modelo.nome);
+    });
+
+    // O relatrio  regravado mesmo sem triagem, para no sobrar o de uma execuo anterior
+    salvarPaginasIgnoradas(logger, configuracao.pastaTriagem.empty() ? outputFolder : configuracao.pastaTriagem, paginasIgnoradas);
+    if (configuracao.triarPaginas) {
+        logger.AddLogMessage(LogLevel::Info, std::to_string(paginasIgnoradas.size()) + " pginas ignoradas na triagem.");
+    }
+    salvarModelosPaginas(logger, outputFolder, modelosPaginas);
+
+    logger.AddLogMessage(LogLevel::Info, "Leitura em duas passadas concluda: " + std::to_string(paginasRelidas.load()) + " de "
+        + std::to_string(paginasLidas) + " pginas relidas em " + std::to_string(configuracao.dpiAlto) + " DPI ("
+        + std::to_string(questoesRelidas.load()) + " questes substitudas).");
+}
+
+void processarPdfDuasPassadas(Logger& logger, const std::string& filenamePdf, const TemplateRegistry& modelos,
+    const std::string& outputFolder, const ConfiguracaoDuasPassadas& configuracao, ProgressoLeitura* progresso) {
+    std::unique_ptr<poppler::document> documento(poppler::document::load_from_file(filenamePdf));
+    if (documento == nullptr) {
+        logger.AddLogMessage(LogLevel::Error, "couldn't read pdf: " + filenamePdf);
+        return;
+    }
+
+    int num_pages = documento->pages();
+    logger.AddLogMessage(LogLevel::Info, "pdf has " + std::to_string(num_pages) + " pages");
+
+    ImagensEmbutidasPdf imagensEmbutidas;
+    imagensEmbutidas.abrir(logger, filenamePdf, num_pages);
+
+    // O poppler no garante renderizao concorrente no mesmo documento; o resto (inclusive a
+    // decodificao das imagens embutidas) roda em paralelo
+    std::mutex renderMutex;
+    lerPaginasDuasPassadas(logger, num_pages, [&](int i, int dpi) {
+        return lerPaginaPdf(*documento, imagensEmbutidas, i, dpi, &renderMutex);
+    }, modelos, outputFolder, configuracao, progresso);
+}
+
+void processarDigitalizacaoDuasPassadas(Logger& logger, const FonteDigitalizacao& entrada, const TemplateRegistry& modelos,
+    const std::string& outputFolder, const ConfiguracaoDuasPassadas& configuracao, ProgressoLeitura* progresso) {
+    // A decodificao de arquivos diferentes (ou pginas diferentes do mesmo TIFF)  independente
+    lerPaginasDuasPassadas(logger, entrada.numeroPaginas(), [&](int i, int dpi) {
+        return entrada.lerPagina(i, dpi);
+    }, modelos, outputFolder, configuracao, progresso);
+    entrada.salvarOrigemPaginas(logger, outputFolder);
+}
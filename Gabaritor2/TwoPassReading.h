@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ImageProcessing.h"
+
+// Leitura em duas passadas: todas as pginas so renderizadas e lidas em DPI baixo, e s as
+// pginas com alguma questo abaixo do limiar de confiana so renderizadas de novo em DPI alto.
+// A imagem de referncia deve estar na resoluo do DPI alto.
+struct ConfiguracaoDuasPassadas {
+    int dpiBaixo = 100;
+    int dpiAlto = 300;
+    float limiarConfianca = 0.15f;  // Confiana mnima (LeituraQuestao) para no reler a questo
+    bool triarPaginas = true;       // Descarta pginas em branco/sem gabarito a partir da renderizao em DPI baixo
+    int primeiraPagina = 0;         // Intervalo de pginas lido (base 0, inclusivo); -1 em ultimaPagina = at o fim
+    int ultimaPagina = -1;
+    std::string pastaTriagem;       // ARQUIVO_PAGINAS_IGNORADAS; vazia = a pasta de sada
+};
+
+// Com progresso, cada pgina (lida ou descartada na triagem)  publicada assim que termina
+void processarPdfDuasPassadas(Logger& logger, const std::string& filenamePdf, const std::string& referenceImagePath,
+    const std::string& coordinatesFilePath, const std::string& outputFolder, const ConfiguracaoDuasPassadas& configuracao,
+    ProgressoLeitura* progresso = nullptr);
+// Com vrios modelos, cada pgina  roteada pela miniatura da renderizao em DPI baixo
+void processarPdfDuasPassadas(Logger& logger, const std::string& filenamePdf, const TemplateRegistry& modelos,
+    const std::string& outputFolder, const ConfiguracaoDuasPassadas& configuracao, ProgressoLeitura* progresso = nullptr);
+// Mesma leitura a partir de digitalizaes (pasta de imagens ou TIFF multipgina): a passada em DPI
+// baixo usa a decodificao reduzida, sem rasterizar PDF nem gravar PNGs
+void processarDigitalizacaoDuasPassadas(Logger& logger, const FonteDigitalizacao& entrada, const TemplateRegistry& modelos,
+    const std::string& outputFolder, const ConfiguracaoDuasPassadas& configuracao, ProgressoLeitura* progresso = nullptr);
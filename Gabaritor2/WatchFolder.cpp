@@ -0,0 +1,259 @@
+#include "WatchFolder.h"
+#include "PagePipeline.h"
+#include "ThreadPool.h"
+#include "ScanInput.h"
+#include "PdfImages.h"
+#include "MeasurementStore.h"
+#include "ResultsStore.h"
+#include "Sharding.h"
+#include <poppler/cpp/poppler-document.h>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <algorithm>
+#include <cctype>
+
+namespace fs = std::filesystem;
+
+// Arquivo de entrada sendo gravado: tamanho da ltima varredura e desde quando no muda
+struct ArquivoPendente {
+    std::uintmax_t tamanho;
+    std::chrono::steady_clock::time_point estavelDesde;
+};
+
+// Relatrios compartilhados pelas pginas de um arquivo processadas em paralelo
+struct RelatoriosArquivo {
+    std::mutex mutex;
+    std::vector<PaginaIgnorada> paginasIgnoradas;
+    std::vector<std::pair<std::string, std::string>> modelosPaginas;
+    ArquivoMedicoes medicoes;
+};
+
+static std::string extensaoMinuscula(const fs::path& caminho) {
+    std::string extensao = caminho.extension().string();
+    std::transform(extensao.begin(), extensao.end(), extensao.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extensao;
+}
+
+static bool extensaoSuportada(const std::string& extensao) {
+    return extensao == ".pdf" || extensao == ".png" || extensao == ".jpg" || extensao == ".jpeg"
+        || extensao == ".tif" || extensao == ".tiff" || extensao == ".bmp";
+}
+
+// Pginas descartadas na triagem e as que no puderam ser lidas ou alinhadas vo para o relatrio de ignoradas
+static void registrarIgnorada(RelatoriosArquivo& relatorios, const std::string& fileName, const ClassificacaoPagina& classificacao) {
+    std::lock_guard<std::mutex> lock(relatorios.mutex);
+    relatorios.paginasIgnoradas.push_back({ fileName, classificacao });
+}
+
+static void processarPagina(Logger& logger, const TemplateRegistry& modelos, OcrEnginePool& ocrEngines,
+    const ConfiguracaoPastaMonitorada& configuracao, const cv::Mat& pagina, const std::string& fileName,
+    const std::string& pastaResultado, RelatoriosArquivo& relatorios) {
+    OpcoesPagina opcoes;
+    opcoes.triarPaginas = configuracao.triarPaginas;
+    opcoes.lerPalavras = configuracao.lerPalavras;
+    opcoes.medirCelulas = relatorios.medicoes.aberto();
+    ResultadoPagina resultado = processarPaginaEmMemoria(logger, modelos, ocrEngines, pagina, opcoes);
+
+    if (resultado.modelo == nullptr) {
+        registrarIgnorada(relatorios, fileName, resultado.classificacao);
+        return;
+    }
+    if (!resultado.alinhada) {
+        logger.AddLogMessage(LogLevel::Error, "Error aligning image: " + fileName);
+        ClassificacaoPagina classificacao = resultado.classificacao;
+        classificacao.tipo = TipoPagina::NaoAlinhada;
+        registrarIgnorada(relatorios, fileName, classificacao);
+        return;
+    }
+
+    salvarResultadoPagina(logger, pastaResultado, fileName, resultado);
+    if (opcoes.medirCelulas) {
+        resultado.medicoes.fileName = fileName;
+        relatorios.medicoes.gravar(resultado.medicoes);
+    }
+    std::lock_guard<std::mutex> lock(relatorios.mutex);
+    relatorios.modelosPaginas.emplace_back(fileName, resultado.modelo->nome);
+}
+
+// Processa um arquivo de entrada, gravando tudo em pastaResultado. Retorna false se o arquivo no pde ser lido.
+static bool processarArquivo(Logger& logger, const TemplateRegistry& modelos, OcrEnginePool& ocrEngines,
+    const ConfiguracaoPastaMonitorada& configuracao, const fs::path& arquivo, const std::string& pastaResultado) {
+    if (!criarDiretorio(logger, pastaResultado)) {
+        return false;
+    }
+
+    RelatoriosArquivo relatorios;
+    relatorios.medicoes.abrir(logger, pastaResultado);
+
+    if (extensaoMinuscula(arquivo) == ".pdf") {
+        std::unique_ptr<poppler::document> documento(poppler::document::load_from_file(arquivo.string()));
+        if (documento == nullptr) {
+            logger.AddLogMessage(LogLevel::Error, "couldn't read pdf: " + arquivo.string());
+            return false;
+        }
+
+        ImagensEmbutidasPdf imagensEmbutidas;
+        imagensEmbutidas.abrir(logger, arquivo.string(), documento->pages());
+
+        // O poppler no garante renderizao concorrente no mesmo documento; o resto roda em paralelo
+        std::mutex renderMutex;
+        ThreadPool::global().parallelFor(documento->pages(), [&](int i, int) {
+            std::string fileName = "page_" + std::to_string(i + 1) + ".png";
+            cv::Mat pagina = lerPaginaPdf(*documento, imagensEmbutidas, i, configuracao.DPI, &renderMutex);
+            if (pagina.empty()) {
+                logger.AddLogMessage(LogLevel::Error, "Unsupported PDF format in page " + std::to_string(i + 1));
+                registrarIgnorada(relatorios, fileName, { TipoPagina::Ilegivel, 0.0, 0.0 });
+                return;
+            }
+            processarPagina(logger, modelos, ocrEngines, configuracao, pagina, fileName, pastaResultado, relatorios);
+        });
+    }
+    else {
+        // Imagem avulsa ou TIFF com vrias pginas, decodificada j na resoluo do PDF
+        FonteDigitalizacao entrada;
+        if (!entrada.abrir(logger, arquivo.string(), configuracao.dpiDigitalizacao)) {
+            return false;
+        }
+        ThreadPool::global().parallelFor(entrada.numeroPaginas(), [&](int i, int) {
+            cv::Mat pagina = entrada.lerPagina(i, configuracao.DPI);
+            if (pagina.empty()) {
+                logger.AddLogMessage(LogLevel::Error, "Erro ao carregar a imagem: " + arquivo.string() + " (pgina " + std::to_string(i + 1) + ")");
+                registrarIgnorada(relatorios, entrada.nomePagina(i), { TipoPagina::Ilegivel, 0.0, 0.0 });
+                return;
+            }
+            processarPagina(logger, modelos, ocrEngines, configuracao, pagina, entrada.nomePagina(i), pastaResultado, relatorios);
+        });
+        if (entrada.numeroPaginas() > 1) {
+            entrada.salvarOrigemPaginas(logger, pastaResultado);
+        }
+    }
+
+    // Gravado mesmo sem triagem: as pginas ilegveis ou no alinhadas tambm esto nele
+    salvarPaginasIgnoradas(logger, pastaResultado, relatorios.paginasIgnoradas);
+    salvarModelosPaginas(logger, pastaResultado, relatorios.modelosPaginas);
+    juntarRespostasEmTXT(logger, pastaResultado, pastaResultado);
+    return true;
+}
+
+// Caminho livre dentro de "pasta" para "nome", acrescentando _2, _3... se j existir
+static fs::path caminhoLivre(const fs::path& pasta, const std::string& nome, const std::string& extensao) {
+    fs::path caminho = pasta / (nome + extensao);
+    for (int n = 2; fs::exists(caminho); n++) {
+        caminho = pasta / (nome + "_" + std::to_string(n) + extensao);
+    }
+    return caminho;
+}
+
+// Move um arquivo, copiando se origem e destino estiverem em volumes diferentes
+static bool moverArquivo(const fs::path& origem, const fs::path& destino) {
+    std::error_code erro;
+    fs::rename(origem, destino, erro);
+    if (!erro) return true;
+
+    fs::copy_file(origem, destino, erro);
+    if (erro) return false;
+    fs::remove(origem, erro);
+    return !erro;
+}
+
+int executarPastaMonitorada(Logger& logger, const TemplateRegistry& modelos, OcrEnginePool& ocrEngines,
+    const ConfiguracaoPastaMonitorada& configuracao, const std::atomic<bool>* parar) {
+    if (modelos.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Nenhum modelo de referncia carregado.");
+        return 1;
+    }
+
+    for (const std::string& pasta : { configuracao.pastaEntrada, configuracao.pastaSaida, configuracao.pastaConcluidos, configuracao.pastaFalhas }) {
+        if (!criarDiretorio(logger, pasta)) {
+            return 1;
+        }
+    }
+
+    ArmazemResultados armazem;
+    bool usarArmazem = armazem.abrir(logger, (fs::path(configuracao.pastaSaida) / PASTA_ARMAZEM_RESULTADOS).string(), idWorkerPadrao());
+
+    logger.AddLogMessage(LogLevel::Info, "Monitorando a pasta: " + configuracao.pastaEntrada);
+
+    std::map<fs::path, ArquivoPendente> pendentes;
+    while (parar == nullptr || !*parar) {
+        auto agora = std::chrono::steady_clock::now();
+        std::vector<fs::path> prontos;
+        std::map<fs::path, ArquivoPendente> vistos;
+
+        std::error_code erro;
+        for (const auto& entrada : fs::directory_iterator(configuracao.pastaEntrada, erro)) {
+            if (!entrada.is_regular_file(erro) || !extensaoSuportada(extensaoMinuscula(entrada.path()))) continue;
+
+            std::uintmax_t tamanho = entrada.file_size(erro);
+            if (erro) continue;
+
+            // O scanner ainda pode estar gravando: s processa depois que o tamanho parar de mudar
+            auto anterior = pendentes.find(entrada.path());
+            ArquivoPendente pendente{ tamanho, agora };
+            if (anterior != pendentes.end() && anterior->second.tamanho == tamanho) {
+                pendente.estavelDesde = anterior->second.estavelDesde;
+            }
+            vistos[entrada.path()] = pendente;
+
+            if (tamanho > 0 && agora - pendente.estavelDesde >= std::chrono::milliseconds(configuracao.estabilidadeMs)) {
+                prontos.push_back(entrada.path());
+            }
+        }
+        pendentes = vistos;
+
+        // Ordem de chegada previsvel: por nome
+        std::sort(prontos.begin(), prontos.end());
+        for (const auto& arquivo : prontos) {
+            std::string nome = arquivo.stem().string();
+            auto inicio = std::chrono::steady_clock::now();
+            logger.AddLogMessage(LogLevel::Info, "Processando: " + arquivo.string());
+
+            fs::path pastaTemporaria = fs::path(configuracao.pastaSaida) / ("." + nome + ".tmp");
+            fs::remove_all(pastaTemporaria, erro);
+
+            bool sucesso = false;
+            try {
+                sucesso = processarArquivo(logger, modelos, ocrEngines, configuracao, arquivo, pastaTemporaria.string());
+            }
+            catch (const std::exception& e) {
+                logger.AddLogMessage(LogLevel::Error, "Erro ao processar " + arquivo.string() + ": " + e.what());
+            }
+
+            if (sucesso) {
+                // Publica o resultado de uma vez
+                fs::path pastaResultado = caminhoLivre(configuracao.pastaSaida, nome, "");
+                fs::rename(pastaTemporaria, pastaResultado, erro);
+                if (erro) {
+                    logger.AddLogMessage(LogLevel::Error, "No foi possvel publicar o resultado em: " + pastaResultado.string());
+                    sucesso = false;
+                }
+                else if (usarArmazem) {
+                    // Cada arquivo de entrada  um lote, com o nome da pasta de resultado
+                    importarRespostas(logger, armazem, pastaResultado.filename().string(), arquivo.filename().string(),
+                        pastaResultado.string(), pastaResultado.string(), pastaResultado.string());
+                }
+            }
+            if (!sucesso) {
+                fs::remove_all(pastaTemporaria, erro);
+            }
+
+            const std::string& pastaDestino = sucesso ? configuracao.pastaConcluidos : configuracao.pastaFalhas;
+            if (!moverArquivo(arquivo, caminhoLivre(pastaDestino, nome, arquivo.extension().string()))) {
+                logger.AddLogMessage(LogLevel::Error, "No foi possvel mover " + arquivo.string() + " para " + pastaDestino);
+            }
+            pendentes.erase(arquivo);
+
+            auto duracao = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - inicio).count();
+            logger.AddLogMessage(sucesso ? LogLevel::Info : LogLevel::Error, (sucesso ? "Concludo: " : "Falhou: ") + arquivo.filename().string()
+                + " em " + std::to_string(duracao) + " ms");
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(configuracao.intervaloMs));
+    }
+
+    return 0;
+}
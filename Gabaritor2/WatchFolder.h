@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Logger.h"
+#include "OcrEnginePool.h"
+#include <atomic>
+#include <string>
+
+class TemplateRegistry;
+
+// Servio de pasta monitorada: os scanners gravam PDFs ou imagens na pasta de entrada e cada
+// arquivo  processado assim que termina de ser gravado, com modelos (referncias, features ORB,
+// geometria) e engines de OCR carregados uma vez s, no incio do servio.
+//
+// Para cada arquivo "<nome>.<ext>" o resultado vai para "<sada>/<nome>/" (respostas por pgina,
+// confianas, palavras, relatrios de triagem/modelos e respostas.txt). A pasta  montada em uma
+// pasta temporria e renomeada no fim, ento quem l a sada nunca v um resultado incompleto.
+// O arquivo de entrada  movido para a pasta de concludos ou de falhas.
+struct ConfiguracaoPastaMonitorada {
+    std::string pastaEntrada;
+    std::string pastaSaida;
+    std::string pastaConcluidos;
+    std::string pastaFalhas;
+    int intervaloMs = 1000;      // Intervalo entre as varreduras da pasta de entrada
+    int estabilidadeMs = 2000;   // Tempo sem mudar de tamanho para o arquivo ser considerado completo
+    int DPI = 300;               // Resoluo de renderizao dos PDFs (e de leitura das imagens)
+    int dpiDigitalizacao = 300;  // Resoluo em que os scanners gravam as imagens
+    bool triarPaginas = true;
+    bool lerPalavras = true;
+};
+
+// Roda at "parar" ficar true (ou para sempre, se for nulo). Retorna 0 em caso de sucesso.
+int executarPastaMonitorada(Logger& logger, const TemplateRegistry& modelos, OcrEnginePool& ocrEngines,
+    const ConfiguracaoPastaMonitorada& configuracao, const std::atomic<bool>* parar = nullptr);
@@ -0,0 +1,106 @@
+#ifndef GABARITOR_C_H
+#define GABARITOR_C_H
+
+/* API C da biblioteca de leitura (para chamar de C, C#, Python via ctypes, etc.).
+   Strings e caminhos na codificao local (a mesma dos nomes de arquivo). Os ponteiros dentro de GabResultado s valem durante o callback. */
+
+#include <stddef.h>
+
+/* A DLL (GabaritorLib.vcxproj)  compilada com GABARITOR_EXPORTS. Quem usa a biblioteca esttica ou compila
+   os fontes junto com o programa define GABARITOR_ESTATICA. */
+#if defined(_WIN32) && !defined(GABARITOR_ESTATICA)
+#ifdef GABARITOR_EXPORTS
+#define GABARITOR_API __declspec(dllexport)
+#else
+#define GABARITOR_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define GABARITOR_API __attribute__((visibility("default")))
+#else
+#define GABARITOR_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct GabLeitor GabLeitor;
+
+typedef enum GabFormatoPixel {
+    GAB_CINZA8 = 0,
+    GAB_BGR8 = 1,
+    GAB_RGB8 = 2,
+    GAB_BGRA8 = 3,
+    GAB_RGBA8 = 4
+} GabFormatoPixel;
+
+typedef struct GabBufferPagina {
+    const unsigned char* dados;
+    int largura;
+    int altura;
+    size_t stride;              /* 0 = largura * bytes por pixel */
+    GabFormatoPixel formato;
+} GabBufferPagina;
+
+typedef struct GabResposta {
+    const char* regiao;
+    int subdivisao;
+    char resposta;              /* 'A'.. ('0'.. nas regies de nmero), 'V' se nenhuma alternativa foi marcada
+                                   ou 'X' se mais de uma foi */
+    float confianca;
+} GabResposta;
+
+typedef struct GabTexto {
+    const char* regiao;
+    const char* texto;
+    float confianca;
+    int vazia;
+} GabTexto;
+
+typedef struct GabTempos {
+    double triagemMs;
+    double alinhamentoMs;
+    double reducaoRuidoMs;
+    double leituraRespostasMs;
+    double leituraPalavrasMs;
+    double totalMs;
+} GabTempos;
+
+typedef struct GabResultado {
+    int indicePagina;
+    const char* modelo;         /* "" se a pgina foi descartada */
+    int descartada;
+    const char* motivoDescarte; /* "em_branco", "nao_resposta", "ilegivel" ou "nao_alinhada" */
+    int alinhada;
+    const GabResposta* respostas;
+    size_t numeroRespostas;
+    const GabTexto* palavras;
+    size_t numeroPalavras;
+    GabTempos tempos;
+    int erro;                   /* 1 se a leitura desta pgina falhou; as outras pginas seguem */
+    const char* mensagemErro;   /* "" sem erro */
+} GabResultado;
+
+/* nivel: 0 = info, 1 = warning, 2 = error */
+typedef void (*GabCallbackLog)(void* usuario, int nivel, const char* mensagem);
+typedef void (*GabCallbackResultado)(void* usuario, const GabResultado* resultado);
+
+/* callbackLog pode ser NULL. Retorna NULL em caso de erro. */
+GABARITOR_API GabLeitor* gab_criar(const char* idiomaOcr, GabCallbackLog callbackLog, void* usuarioLog);
+GABARITOR_API void gab_destruir(GabLeitor* leitor);
+
+/* Retornam 1 em caso de sucesso e 0 em caso de erro */
+GABARITOR_API int gab_adicionar_modelo(GabLeitor* leitor, const char* nome, const char* imagemReferencia, const char* arquivoCoordenadas);
+GABARITOR_API int gab_adicionar_modelo_buffer(GabLeitor* leitor, const char* nome, const GabBufferPagina* referencia, const char* arquivoCoordenadas);
+GABARITOR_API int gab_carregar_modelos(GabLeitor* leitor, const char* arquivoLista);
+
+/* L as pginas em paralelo; callback  chamado uma vez por pgina, de uma thread de cada vez.
+   Chamadas de threads diferentes no mesmo leitor esperam umas pelas outras; no chamar de dentro do callback. */
+GABARITOR_API int gab_processar_paginas(GabLeitor* leitor, const GabBufferPagina* paginas, size_t numeroPaginas,
+    int triarPaginas, int lerPalavras, GabCallbackResultado callback, void* usuario);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,8 +1,256 @@
 #include "Application.h"
+#include "Sharding.h"
+#include "WatchFolder.h"
+#include "TemplateRegistry.h"
+#include "MeasurementStore.h"
+#include "ResultsStore.h"
+#include "ParameterTuner.h"
+#include "CpuBudget.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Valor de uma opo "--nome valor" da linha de comando
+static std::string valorOpcao(int argc, char** argv, const char* nome, const std::string& padrao = "") {
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], nome) == 0) return argv[i + 1];
+    }
+    return padrao;
+}
+
+static bool temOpcao(int argc, char** argv, const char* nome) {
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], nome) == 0) return true;
+    }
+    return false;
+}
+
+// Modos sem interface, para dividir PDFs grandes entre vrios processos/mquinas:
+//   --coordinator --pdf <arquivo> --work-dir <pasta> (--reference <imagem> --coordinates <txt> | --templates <lista>)
+//                 [--workers N] [--pages-per-shard N] [--dpi-low N] [--dpi-high N] [--threshold X]
+//                 [--no-triage] [--stale-seconds N]
+//   --worker --work-dir <pasta> [--worker-id <id>]
+//   --merge --work-dir <pasta>
+// Os workers locais dividem o oramento de CPU do coordenador (e os ncleos fixados, se houver).
+//
+// Oramento de CPU, em qualquer modo (CpuBudget.h): [--cpu-budget <arquivo>] [--cpus N] [--first-core N]
+//
+// Servio de pasta monitorada (modelos e engines de OCR ficam carregados entre os arquivos):
+//   --watch --inbox <pasta> --outbox <pasta> (--reference <imagem> --coordinates <txt> | --templates <lista>)
+//           [--done <pasta>] [--failed <pasta>] [--dpi N] [--scan-dpi N] [--poll-ms N] [--no-triage] [--no-words]
+static int executarPastaMonitoradaLinhaDeComando(Logger& logger, int argc, char** argv) {
+    ConfiguracaoPastaMonitorada configuracao;
+    configuracao.pastaEntrada = valorOpcao(argc, argv, "--inbox");
+    configuracao.pastaSaida = valorOpcao(argc, argv, "--outbox");
+    if (configuracao.pastaEntrada.empty() || configuracao.pastaSaida.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Informe as pastas com --inbox e --outbox");
+        return 2;
+    }
+    configuracao.pastaConcluidos = valorOpcao(argc, argv, "--done", configuracao.pastaEntrada + "/concluidos");
+    configuracao.pastaFalhas = valorOpcao(argc, argv, "--failed", configuracao.pastaEntrada + "/falhas");
+    configuracao.DPI = std::atoi(valorOpcao(argc, argv, "--dpi", std::to_string(parametrosPipeline().DPI)).c_str());
+    configuracao.dpiDigitalizacao = std::atoi(valorOpcao(argc, argv, "--scan-dpi", std::to_string(configuracao.dpiDigitalizacao)).c_str());
+    configuracao.intervaloMs = std::atoi(valorOpcao(argc, argv, "--poll-ms", std::to_string(configuracao.intervaloMs)).c_str());
+    configuracao.triarPaginas = !temOpcao(argc, argv, "--no-triage");
+    configuracao.lerPalavras = !temOpcao(argc, argv, "--no-words");
+
+    TemplateRegistry modelos;
+    if (!modelos.carregar(logger, valorOpcao(argc, argv, "--templates"), valorOpcao(argc, argv, "--reference"), valorOpcao(argc, argv, "--coordinates"))) {
+        return 1;
+    }
+
+    OcrEnginePool ocrEngines;
+    return executarPastaMonitorada(logger, modelos, ocrEngines, configuracao);
+}
+
+// Releitura das medies gravadas em uma leitura anterior, sem abrir as imagens (margens em pixels a 300 DPI):
+//   --regrade --measurements <medicoes.bin> --out <pasta> [--margin-x N] [--margin-y N]
+//             [--max-divisor X] [--mean-divisor X] [--min-fill X] [--key <_answers.txt com as respostas certas>]
+static int executarReleituraLinhaDeComando(Logger& logger, int argc, char** argv) {
+    std::string arquivoMedicoes = valorOpcao(argc, argv, "--measurements");
+    std::string pastaSaida = valorOpcao(argc, argv, "--out");
+    if (arquivoMedicoes.empty() || pastaSaida.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Informe o arquivo de medies com --measurements e a pasta com --out");
+        return 2;
+    }
+
+    ParametrosLeitura parametros = parametrosPipeline().leitura;
+    parametros.marginX = std::atoi(valorOpcao(argc, argv, "--margin-x", std::to_string(parametros.marginX)).c_str());
+    parametros.marginY = std::atoi(valorOpcao(argc, argv, "--margin-y", std::to_string(parametros.marginY)).c_str());
+    parametros.divisorMaximo = std::atof(valorOpcao(argc, argv, "--max-divisor", std::to_string(parametros.divisorMaximo)).c_str());
+    parametros.divisorMedia = std::atof(valorOpcao(argc, argv, "--mean-divisor", std::to_string(parametros.divisorMedia)).c_str());
+    parametros.preenchimentoMinimo = std::atof(valorOpcao(argc, argv, "--min-fill", std::to_string(parametros.preenchimentoMinimo)).c_str());
+
+    return relerMedicoes(logger, arquivoMedicoes, pastaSaida, parametros, valorOpcao(argc, argv, "--key")) ? 0 : 1;
+}
+
+// Consulta ao armazm de resultados (<pasta de sada>/armazem), em CSV no terminal ou em --csv:
+//   --results <pasta do armazm> --student <id>
+//   --results <pasta do armazm> --batch <lote> [--file <arquivo de origem>] [--first N] [--last N]
+//   --results <pasta do armazm>                    (lista os lotes)
+static int executarConsultaLinhaDeComando(Logger& logger, int argc, char** argv) {
+    ArmazemResultados armazem;
+    if (!armazem.abrir(logger, valorOpcao(argc, argv, "--results"))) {
+        return 1;
+    }
+
+    std::ofstream arquivoCsv;
+    std::string caminhoCsv = valorOpcao(argc, argv, "--csv");
+    if (!caminhoCsv.empty()) {
+        arquivoCsv.open(caminhoCsv);
+        if (!arquivoCsv.is_open()) {
+            logger.AddLogMessage(LogLevel::Error, "No foi possvel criar o arquivo: " + caminhoCsv);
+            return 1;
+        }
+    }
+    std::ostream& saida = caminhoCsv.empty() ? std::cout : arquivoCsv;
+
+    std::string idAluno = valorOpcao(argc, argv, "--student");
+    std::string lote = valorOpcao(argc, argv, "--batch");
+    if (!idAluno.empty()) {
+        for (const auto& registro : armazem.buscarAluno(idAluno)) {
+            exportarRegistroCsv(saida, registro);
+        }
+    }
+    else if (!lote.empty()) {
+        int primeira = std::atoi(valorOpcao(argc, argv, "--first", "0").c_str());
+        int ultima = std::atoi(valorOpcao(argc, argv, "--last", "-1").c_str());
+        armazem.percorrer(lote, valorOpcao(argc, argv, "--file"), primeira, ultima, [&](const RegistroResultado& registro) {
+            exportarRegistroCsv(saida, registro);
+            return true;
+        });
+    }
+    else {
+        for (const auto& nome : armazem.lotes()) {
+            saida << nome << "\n";
+        }
+    }
+    return 0;
+}
+
+// Ajuste automtico dos parmetros do pipeline sobre uma amostra com gabarito (ParameterTuner.h):
+//   --tune --samples <pasta> (--reference <imagem> --coordinates <txt> | --templates <lista>)
+//          [--target 0.995] [--sample-dpi N] [--rounds N] [--out <arquivo de parmetros>] [--report <csv>]
+static int executarAjusteLinhaDeComando(Logger& logger, int argc, char** argv) {
+    ConfiguracaoAjuste configuracao;
+    configuracao.pastaAmostra = valorOpcao(argc, argv, "--samples");
+    if (configuracao.pastaAmostra.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Informe a pasta da amostra com --samples");
+        return 2;
+    }
+    configuracao.acuraciaAlvo = std::atof(valorOpcao(argc, argv, "--target", std::to_string(configuracao.acuraciaAlvo)).c_str());
+    configuracao.dpiAmostra = std::atoi(valorOpcao(argc, argv, "--sample-dpi", std::to_string(configuracao.dpiAmostra)).c_str());
+    configuracao.rodadas = std::atoi(valorOpcao(argc, argv, "--rounds", std::to_string(configuracao.rodadas)).c_str());
+    configuracao.arquivoSaida = valorOpcao(argc, argv, "--out", configuracao.arquivoSaida);
+    configuracao.relatorioCsv = valorOpcao(argc, argv, "--report");
+
+    TemplateRegistry modelos;
+    if (!modelos.carregar(logger, valorOpcao(argc, argv, "--templates"), valorOpcao(argc, argv, "--reference"), valorOpcao(argc, argv, "--coordinates"))) {
+        return 2;
+    }
+
+    ParametrosPipeline melhor;
+    return ajustarParametros(logger, modelos, configuracao, parametrosPipeline(), melhor) ? 0 : 1;
+}
+
+static int executarLinhaDeComando(int argc, char** argv) {
+    LoggerTerminal logger;
+
+    // Parmetros ajustados (--tune) valem para todos os modos; --params escolhe outro arquivo
+    carregarParametrosPipelineSeExistir(logger, valorOpcao(argc, argv, "--params", ARQUIVO_PARAMETROS_PIPELINE));
+
+    if (temOpcao(argc, argv, "--tune")) {
+        return executarAjusteLinhaDeComando(logger, argc, argv);
+    }
+
+    if (temOpcao(argc, argv, "--watch")) {
+        return executarPastaMonitoradaLinhaDeComando(logger, argc, argv);
+    }
+
+    if (temOpcao(argc, argv, "--regrade")) {
+        return executarReleituraLinhaDeComando(logger, argc, argv);
+    }
+
+    if (temOpcao(argc, argv, "--results")) {
+        return executarConsultaLinhaDeComando(logger, argc, argv);
+    }
+
+    std::string pastaTrabalho = valorOpcao(argc, argv, "--work-dir");
+    if (pastaTrabalho.empty()) {
+        logger.AddLogMessage(LogLevel::Error, "Informe a pasta de trabalho com --work-dir");
+        return 2;
+    }
+
+    if (temOpcao(argc, argv, "--worker")) {
+        MedidorCpu medidor;
+        int resultado = executarWorker(logger, pastaTrabalho, valorOpcao(argc, argv, "--worker-id", idWorkerPadrao()));
+        logger.AddLogMessage(LogLevel::Info, "Uso de CPU do worker: " + std::to_string(static_cast<int>(std::lround(medidor.utilizacao() * 100.0)))
+            + "% de " + std::to_string(orcamentoCpu().nucleos) + " ncleos em " + std::to_string(static_cast<int>(medidor.milissegundos() / 1000.0)) + " s");
+        return resultado;
+    }
+
+    if (temOpcao(argc, argv, "--merge")) {
+        return juntarShards(logger, pastaTrabalho) ? 0 : 1;
+    }
+
+    TrabalhoDistribuido trabalho;
+    trabalho.filenamePdf = valorOpcao(argc, argv, "--pdf");
+    trabalho.referenceImagePath = valorOpcao(argc, argv, "--reference");
+    trabalho.coordinatesFilePath = valorOpcao(argc, argv, "--coordinates");
+    trabalho.templatesFilePath = valorOpcao(argc, argv, "--templates");
+    if (trabalho.filenamePdf.empty() || (trabalho.templatesFilePath.empty() && (trabalho.referenceImagePath.empty() || trabalho.coordinatesFilePath.empty()))) {
+        logger.AddLogMessage(LogLevel::Error, "Informe --pdf e --reference/--coordinates ou --templates");
+        return 2;
+    }
+
+    // Os workers podem rodar em outras mquinas: os caminhos gravados no trabalho so absolutos
+    for (std::string* caminho : { &trabalho.filenamePdf, &trabalho.referenceImagePath, &trabalho.coordinatesFilePath, &trabalho.templatesFilePath }) {
+        if (!caminho->empty()) *caminho = std::filesystem::absolute(*caminho).string();
+    }
+
+    trabalho.paginasPorShard = std::atoi(valorOpcao(argc, argv, "--pages-per-shard", std::to_string(trabalho.paginasPorShard)).c_str());
+    trabalho.leitura.dpiBaixo = std::atoi(valorOpcao(argc, argv, "--dpi-low", std::to_string(trabalho.leitura.dpiBaixo)).c_str());
+    trabalho.leitura.dpiAlto = std::atoi(valorOpcao(argc, argv, "--dpi-high", std::to_string(trabalho.leitura.dpiAlto)).c_str());
+    trabalho.leitura.limiarConfianca = static_cast<float>(std::atof(valorOpcao(argc, argv, "--threshold", std::to_string(trabalho.leitura.limiarConfianca)).c_str()));
+    trabalho.leitura.triarPaginas = !temOpcao(argc, argv, "--no-triage");
+
+    int workersLocais = std::atoi(valorOpcao(argc, argv, "--workers", "0").c_str());
+    int segundosShardAbandonado = std::atoi(valorOpcao(argc, argv, "--stale-seconds", std::to_string(SEGUNDOS_SHARD_ABANDONADO_PADRAO)).c_str());
+    return executarCoordenador(logger, trabalho, pastaTrabalho, workersLocais, argv[0], segundosShardAbandonado);
+}
+
+// Oramento de CPU de todos os modos, inclusive a interface (CpuBudget.h): ARQUIVO_ORCAMENTO_CPU se existir
+// (ou --cpu-budget <arquivo>), com --cpus N e --first-core N por cima
+static void aplicarOrcamentoCpuDaLinhaDeComando(int argc, char** argv) {
+    LoggerTerminal logger;
+    OrcamentoCpu orcamento;
+    std::error_code erro;
+    if (temOpcao(argc, argv, "--cpu-budget")) {
+        carregarOrcamentoCpu(logger, valorOpcao(argc, argv, "--cpu-budget"), orcamento);
+    }
+    else if (std::filesystem::exists(ARQUIVO_ORCAMENTO_CPU, erro)) {
+        carregarOrcamentoCpu(logger, ARQUIVO_ORCAMENTO_CPU, orcamento);
+    }
+    orcamento.nucleos = std::max(0, std::atoi(valorOpcao(argc, argv, "--cpus", std::to_string(orcamento.nucleos)).c_str()));
+    orcamento.primeiroNucleo = std::max(-1, std::atoi(valorOpcao(argc, argv, "--first-core", std::to_string(orcamento.primeiroNucleo)).c_str()));
+    aplicarOrcamentoCpu(logger, orcamento);
+}
 
 // Funo principal
-int main() {
+int main(int argc, char** argv) {
+    // Antes de qualquer coisa usar o pool de threads, o gravador ou o Tesseract
+    aplicarOrcamentoCpuDaLinhaDeComando(argc, argv);
+
+    if (temOpcao(argc, argv, "--coordinator") || temOpcao(argc, argv, "--worker") || temOpcao(argc, argv, "--merge") || temOpcao(argc, argv, "--watch")
+        || temOpcao(argc, argv, "--regrade") || temOpcao(argc, argv, "--results") || temOpcao(argc, argv, "--tune")) {
+        return executarLinhaDeComando(argc, argv);
+    }
+
     // Cria uma instncia da aplicao e a executa
     Application app;
     app.run();
-}
\ No newline at end of file
+}
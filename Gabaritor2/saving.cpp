@@ -2,37 +2,33 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utils/filesystem.hpp>
 #include "ImageProcessing.h"
+#include "ImageWriter.h"
 
 // Funo para criar um diretrio
-bool criarDiretorio(ConsoleBuffer& consoleBuffer, const std::string& pastaDestino) {
+bool criarDiretorio(Logger& logger, const std::string& pastaDestino) {
     if (cv::utils::fs::exists(pastaDestino)) {
         return true;
     }
 
     // Tenta criar o diretrio
     if (!cv::utils::fs::createDirectories(pastaDestino)) {
-        consoleBuffer.AddLogMessage(LogLevel::Error, "No foi possvel criar a pasta de destino: " + pastaDestino);
+        logger.AddLogMessage(LogLevel::Error, "No foi possvel criar a pasta de destino: " + pastaDestino);
         return false;
     }
 
     return true;
 }
 
-// Funo para salvar uma imagem
-void salvarImagem(ConsoleBuffer& consoleBuffer, const std::string& pastaDestino, const std::string& nomeArquivo, const cv::Mat& imagem) {
-	// Verifica se o diretrio de destino existe
-	if (!criarDiretorio(consoleBuffer, pastaDestino)) {
-		return;
-	}
-
-	// Constri o caminho completo para salvar a imagem
-	std::string caminhoCompleto = pastaDestino + "/" + nomeArquivo;
+// Funo para salvar uma imagem: a cpia garante que quem chamou pode reaproveitar o buffer
+void salvarImagem(Logger& logger, const std::string& pastaDestino, const std::string& nomeArquivo, const cv::Mat& imagem) {
+	salvarImagem(logger, pastaDestino, nomeArquivo, imagem.clone());
+}
 
-	// Tenta salvar a imagem
-	if (!cv::imwrite(caminhoCompleto, imagem)) {
-		consoleBuffer.AddLogMessage(LogLevel::Error, "Falha ao salvar a imagem em: " + caminhoCompleto);
-		return;
-	}
+// A criao da pasta, a codificao e a escrita acontecem nas threads do gravador
+void salvarImagem(Logger& logger, const std::string& pastaDestino, const std::string& nomeArquivo, cv::Mat&& imagem) {
+	GravadorImagens::global().enfileirar(logger, pastaDestino, nomeArquivo, std::move(imagem));
+}
 
-	consoleBuffer.AddLogMessage(LogLevel::Warning, "Imagem salva com sucesso em: " + caminhoCompleto);
+void aguardarImagensSalvas() {
+	GravadorImagens::global().aguardar();
 }